@@ -0,0 +1,351 @@
+/**************************************************
+ * FILENAME:	actuator.c
+ *
+ * DESCRIPTION:
+ * 		Writes servo positions from a dedicated thread, so the time spent talking
+ * 		to the servo controller never delays the control loop. Every servo has a
+ * 		slot holding the latest requested position: the control loop only stores
+ * 		into the slot and wakes the writer, which never blocks. If a new position
+ * 		arrives before the previous one was written, the previous one is replaced
+ * 		(coalesced). Positions within the deadband of the position last written
+ * 		are not written at all, which is common while the output sits at a limit.
+ * 		Once made safe, every servo in use is turned off and positions requested
+ * 		afterwards are ignored, so a control loop gone wrong cannot turn it on again.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int actuator_start(double deadband)
+ * 		void actuator_set(int index, double position)
+ * 		void actuator_statistics(int index, ActuatorStatistics *statistics)
+ * 		void actuator_safe(void)
+ * 		int actuator_busy_since(unsigned long *start)
+ * 		void actuator_stop(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#define _GNU_SOURCE	// pthread_timedjoin_np()
+
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "headers/actuator.h"
+#include "headers/phidget_connection.h"
+#include "headers/time_utils.h"
+#include "headers/trace.h"
+
+// latest-value slot of one servo, on a cache line of its own
+typedef struct
+{
+	_Alignas(64) _Atomic double position;	// written by the control loop
+	atomic_bool pending;					// set when the position has not been taken yet
+	atomic_ulong requested;
+
+	// owned by the writer thread
+	double lastWritten;
+	atomic_ulong written;
+	atomic_ulong deadband;
+} ServoSlot;
+
+static ServoSlot slots[ACTUATOR_MAX_SERVOS];
+static double deadbandWidth;
+
+static sem_t wakeup;	// posted whenever a slot gets a new position
+static atomic_bool safe;	// motors off for good
+
+// the write in progress, so a stalled servo controller can be noticed
+static atomic_int writing = -1;	// the servo, -1 if none
+static atomic_ulong writeStart;
+static atomic_bool writerRunning;
+static pthread_t writerThread;
+static bool started;
+
+static const unsigned long STOP_TIMEOUT = 1000000000UL;	// 1 second
+
+/**************************************************
+ * NAME: static void write_pending(void)
+ *
+ * DESCRIPTION:
+ * 		Takes the pending position of every servo and writes it, unless it is
+ * 		within the deadband of the position last written.
+ *
+ * INPUTS:
+ * 		EXTERNALS:
+ * 			ServoSlot slots[]:	The requested positions.
+ *
+ * OUTPUTS:
+ * 		EXTERNALS:
+ * 			ServoSlot slots[]:	The written positions and updated counters.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void write_pending(void)
+{
+	for (int i = 0; i < ACTUATOR_MAX_SERVOS; i++)
+	{
+		ServoSlot *slot = &slots[i];
+		if (!atomic_exchange_explicit(&(*slot).pending, false, memory_order_acquire))
+			continue;
+
+		double position = atomic_load_explicit(&(*slot).position, memory_order_relaxed);
+		if (fabs(position - (*slot).lastWritten) <= deadbandWidth)
+		{
+			atomic_fetch_add_explicit(&(*slot).deadband, 1, memory_order_relaxed);
+			continue;
+		}
+
+		if (atomic_load(&safe))
+			continue;	// made safe since the position was requested
+
+		unsigned long start = nano_time();
+		atomic_store_explicit(&writeStart, start, memory_order_relaxed);
+		atomic_store_explicit(&writing, i, memory_order_release);
+		set_servo_position(i, position);
+		if (atomic_load(&safe))
+			set_servo_position(i, 0.0);	// made safe while writing, the position may have won
+		atomic_store_explicit(&writing, -1, memory_order_release);
+		trace_record(TRACE_SERVO_WRITE, start, nano_time());
+
+		(*slot).lastWritten = position;
+		atomic_fetch_add_explicit(&(*slot).written, 1, memory_order_relaxed);
+	}
+}
+
+/**************************************************
+ * NAME: static void *writer_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Writes pending positions whenever woken, until the actuator is stopped.
+ * 		Positions requested before the stop are still written. This function is
+ * 		run in a separate thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	Not used.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *writer_func(void *void_ptr)
+{
+	trace_thread_init("actuator");
+
+	while (atomic_load(&writerRunning))
+	{
+		sem_wait(&wakeup);
+		write_pending();
+	}
+
+	write_pending();	// e.g. turning the motors off
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int actuator_start(double deadband)
+ *
+ * DESCRIPTION:
+ * 		Starts the thread writing servo positions. Must be called after the
+ * 		phidgets are connected.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			double deadband:	Positions closer than this to the position last
+ * 								written are not written, 0.0 only skips repeats.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int actuator_start(double deadband)
+{
+	deadbandWidth = deadband;
+	for (int i = 0; i < ACTUATOR_MAX_SERVOS; i++)
+		slots[i].lastWritten = NAN;	// the first position is always written
+
+	if (sem_init(&wakeup, 0, 0) != 0)
+	{
+		perror("Could not create actuator semaphore");
+		return 1;
+	}
+
+	atomic_store(&writerRunning, true);
+	if (pthread_create(&writerThread, NULL, writer_func, NULL) != 0)
+	{
+		printf("Could not start actuator thread\n");
+		sem_destroy(&wakeup);
+		return 1;
+	}
+	started = true;
+	return 0;
+}
+
+/**************************************************
+ * NAME: void actuator_set(int index, double position)
+ *
+ * DESCRIPTION:
+ * 		Requests a new servo position. Returns immediately, the position is written
+ * 		by the actuator thread. Only one thread may set the position of a servo.
+ * 		Does nothing once the actuator has been made safe.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int index:			The servo motor on the controller.
+ * 			double position:	The new servo motor position.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void actuator_set(int index, double position)
+{
+	if (index < 0 || index >= ACTUATOR_MAX_SERVOS || atomic_load_explicit(&safe,
+			memory_order_relaxed))
+		return;
+
+	ServoSlot *slot = &slots[index];
+	atomic_store_explicit(&(*slot).position, position, memory_order_relaxed);
+	atomic_fetch_add_explicit(&(*slot).requested, 1, memory_order_relaxed);
+	// the writer has already been woken for a position it has not taken yet
+	if (!atomic_exchange_explicit(&(*slot).pending, true, memory_order_release))
+		sem_post(&wakeup);
+}
+
+/**************************************************
+ * NAME: void actuator_statistics(int index, ActuatorStatistics *statistics)
+ *
+ * DESCRIPTION:
+ * 		Gets the number of positions requested and written for a servo. Requested
+ * 		positions that were neither written nor skipped by the deadband were
+ * 		replaced by a newer position before they could be written.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int index:	The servo motor on the controller.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ActuatorStatistics *statistics:	The counters.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void actuator_statistics(int index, ActuatorStatistics *statistics)
+{
+	ActuatorStatistics none = { 0, 0, 0 };
+	*statistics = none;
+	if (index < 0 || index >= ACTUATOR_MAX_SERVOS)
+		return;
+
+	// read the results before the requests, so written never exceeds requested
+	(*statistics).written = atomic_load(&slots[index].written);
+	(*statistics).deadband = atomic_load(&slots[index].deadband);
+	(*statistics).requested = atomic_load(&slots[index].requested);
+}
+
+/**************************************************
+ * NAME: void actuator_safe(void)
+ *
+ * DESCRIPTION:
+ * 		Turns off every servo a position has been requested for, directly from the
+ * 		calling thread so a stalled actuator thread does not delay it, and ignores
+ * 		all positions requested from now on. May be called from any thread.
+ *
+ * INPUTS:
+ * 		EXTERNALS:
+ * 			ServoSlot slots[]:	The servos in use.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void actuator_safe(void)
+{
+	atomic_store(&safe, true);
+	for (int i = 0; i < ACTUATOR_MAX_SERVOS; i++)
+	{
+		if (atomic_load(&slots[i].requested) > 0)
+			set_servo_position(i, 0.0);	// turn off motor
+	}
+}
+
+/**************************************************
+ * NAME: int actuator_busy_since(unsigned long *start)
+ *
+ * DESCRIPTION:
+ * 		Tells which servo is being written, and since when.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			unsigned long *start:	When the write started, from nano_time().
+ * 		RETURN:
+ * 			int:	The servo being written, -1 if none.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int actuator_busy_since(unsigned long *start)
+{
+	int servo = atomic_load_explicit(&writing, memory_order_acquire);
+	*start = atomic_load_explicit(&writeStart, memory_order_relaxed);
+	return servo;
+}
+
+/**************************************************
+ * NAME: void actuator_stop(void)
+ *
+ * DESCRIPTION:
+ * 		Writes the positions still pending and stops the actuator thread. A thread
+ * 		stuck in a stalled servo controller is waited for at most STOP_TIMEOUT and
+ * 		then left behind, so the program can still end.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void actuator_stop(void)
+{
+	if (!started)
+		return;
+
+	atomic_store(&writerRunning, false);
+	sem_post(&wakeup);
+	started = false;
+
+	// pthread_timedjoin_np() takes the wall clock
+	struct timespec now, until;
+	clock_gettime(CLOCK_REALTIME, &now);
+	to_timespec(now.tv_sec * 1000000000UL + now.tv_nsec + STOP_TIMEOUT, &until);
+	if (pthread_timedjoin_np(writerThread, NULL, &until) != 0)
+	{
+		printf("Servo %d: write still stalled, not waiting for the actuator thread\n",
+				atomic_load(&writing));
+		pthread_detach(writerThread);
+		return;	// the thread may still use the semaphore
+	}
+	sem_destroy(&wakeup);
+
+	for (int i = 0; i < ACTUATOR_MAX_SERVOS; i++)
+	{
+		ActuatorStatistics s;
+		actuator_statistics(i, &s);
+		if (s.requested > 0)
+			printf("Servo %d: %lu positions requested, %lu written, %lu dropped "
+					"(%lu within deadband)\n", i, s.requested, s.written,
+					s.requested - s.written, s.deadband);
+	}
+}
@@ -0,0 +1,1014 @@
+/**************************************************
+ * FILENAME:	archive.c
+ *
+ * DESCRIPTION:
+ * 		A compact, append-only archive of the logged data of a channel, kept
+ * 		across runs and searchable by time.
+ *
+ * 		The file starts with a header, followed by blocks of up to
+ * 		ARCHIVE_BLOCK_ROWS rows. Every block stores its rows column by column:
+ * 			time:	microseconds since the Unix epoch, the first in the block header,
+ * 					then the change of the difference to the previous row as a
+ * 					zigzag varint, usually a single byte at a steady logging rate.
+ * 			values:	32 bit floats, XOR-ed with the previous value of the column and
+ * 					stored as only the bits that differ, a bit for an unchanged value.
+ * 		The block header holds the time range, the size of every column and a
+ * 		CRC32 of the block. The headers are the index: a reader maps the file,
+ * 		walks the headers once without touching the payloads and bisects them by
+ * 		time, so a time window is read by decoding only the blocks covering it.
+ *
+ * 		A block is written when ARCHIVE_BLOCK_ROWS rows have been collected or
+ * 		the rows span ARCHIVE_FLUSH_TIME, so a crash loses a few seconds at most.
+ * 		The one appending only encodes the block; a writer thread of the archive
+ * 		writes it with a single write() and syncs it to disk, while the next block
+ * 		is collected. A crash can only leave a torn block at the end, which is cut
+ * 		off when the archive is opened for writing again, and skipped by readers.
+ * 		All numbers are in the byte order of the machine.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int archive_open(ArchiveWriter *writer, const char *filename)
+ * 		int archive_append(ArchiveWriter *writer, const ArchiveRow *row)
+ * 		int archive_flush(ArchiveWriter *writer)
+ * 		void archive_close(ArchiveWriter *writer)
+ * 		int archive_reader_open(ArchiveReader *reader, const char *filename)
+ * 		long archive_read_range(ArchiveReader *reader, int64_t from, int64_t to,
+ * 				ArchiveRow rows[], long max)
+ * 		void archive_reader_close(ArchiveReader *reader)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "headers/archive.h"
+
+static const char FILE_MAGIC[8] = { 'D', 'P', 'A', 'R', 'C', 'H', '0', '1' };
+static const uint32_t BLOCK_MAGIC = 0x4b4c4244;	// "DBLK"
+
+typedef struct
+{
+	char magic[8];
+	uint32_t columns;
+	uint32_t reserved;
+} FileHeader;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t rows;
+	int64_t firstTime;
+	int64_t lastTime;
+	uint32_t columnSize[ARCHIVE_COLUMNS];	// bytes of every column in the payload
+	uint32_t checksum;	// CRC32 of the header, with this field 0, and the payload
+} BlockHeader;
+
+// bits written or read from the most significant bit of every byte
+typedef struct
+{
+	unsigned char *data;
+	size_t bit;
+} BitWriter;
+
+typedef struct
+{
+	const unsigned char *data;
+	size_t size;
+	size_t bit;
+} BitReader;
+
+/**************************************************
+ * NAME: static uint32_t crc32(uint32_t crc, const unsigned char *data, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Continues a CRC32 (IEEE 802.3) over more data.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			uint32_t crc:				The CRC so far, 0 to start.
+ * 			const unsigned char *data:	The data.
+ * 			size_t size:				Number of bytes.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			uint32_t:	The CRC including the data.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static uint32_t crc32(uint32_t crc, const unsigned char *data, size_t size)
+{
+	static uint32_t table[256];
+	if (table[1] == 0)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++)
+				value = value & 1 ? 0xedb88320 ^ (value >> 1) : value >> 1;
+			table[i] = value;
+		}
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+/**************************************************
+ * NAME: static void put_bits(BitWriter *writer, uint32_t value, int count)
+ *
+ * DESCRIPTION:
+ * 		Writes the lowest bits of a value, the most significant first. The buffer
+ * 		must be zeroed.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			BitWriter *writer:	The writer.
+ * 			uint32_t value:		The bits.
+ * 			int count:			Number of bits, 0..32.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			BitWriter *writer:	The writer after the bits.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void put_bits(BitWriter *writer, uint32_t value, int count)
+{
+	while (count > 0)
+	{
+		int free = 8 - ((*writer).bit & 7);
+		int take = count < free ? count : free;
+		uint32_t bits = (value >> (count - take)) & ((1u << take) - 1);
+		(*writer).data[(*writer).bit >> 3] |= bits << (free - take);
+		(*writer).bit += take;
+		count -= take;
+	}
+}
+
+/**************************************************
+ * NAME: static uint32_t get_bits(BitReader *reader, int count)
+ *
+ * DESCRIPTION:
+ * 		Reads bits written by put_bits(). Reads past the end give zeros.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			BitReader *reader:	The reader.
+ * 			int count:			Number of bits, 0..32.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			BitReader *reader:	The reader after the bits.
+ * 		RETURN:
+ * 			uint32_t:	The bits.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static uint32_t get_bits(BitReader *reader, int count)
+{
+	uint32_t value = 0;
+	while (count > 0)
+	{
+		size_t byte = (*reader).bit >> 3;
+		int left = 8 - ((*reader).bit & 7);
+		int take = count < left ? count : left;
+		uint32_t bits = byte < (*reader).size ?
+				((*reader).data[byte] >> (left - take)) & ((1u << take) - 1) : 0;
+		value = (value << take) | bits;
+		(*reader).bit += take;
+		count -= take;
+	}
+	return value;
+}
+
+/**************************************************
+ * NAME: static size_t encode_times(const ArchiveRow rows[], int count,
+ * 				unsigned char *out)
+ *
+ * DESCRIPTION:
+ * 		Encodes the times after the first one as zigzag varints of the change of
+ * 		the difference between rows.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const ArchiveRow rows[]:	The rows.
+ * 			int count:					Number of rows.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			unsigned char *out:	The encoded column.
+ * 		RETURN:
+ * 			size_t:	Bytes written.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static size_t encode_times(const ArchiveRow rows[], int count, unsigned char *out)
+{
+	size_t size = 0;
+	int64_t lastDelta = 0;
+	for (int i = 1; i < count; i++)
+	{
+		int64_t delta = rows[i].time - rows[i - 1].time;
+		int64_t change = delta - lastDelta;
+		lastDelta = delta;
+
+		uint64_t zigzag = ((uint64_t) change << 1) ^ (uint64_t) (change >> 63);
+		do
+		{
+			unsigned char byte = zigzag & 0x7f;
+			zigzag >>= 7;
+			out[size++] = byte | (zigzag ? 0x80 : 0);
+		} while (zigzag);
+	}
+	return size;
+}
+
+/**************************************************
+ * NAME: static int decode_times(const unsigned char *in, size_t size,
+ * 				int64_t firstTime, ArchiveRow rows[], int count)
+ *
+ * DESCRIPTION:
+ * 		Decodes a column written by encode_times().
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const unsigned char *in:	The encoded column.
+ * 			size_t size:				Bytes in the column.
+ * 			int64_t firstTime:			Time of the first row.
+ * 			int count:					Number of rows.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveRow rows[]:	The rows with their times.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if the column is too short.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int decode_times(const unsigned char *in, size_t size, int64_t firstTime,
+		ArchiveRow rows[], int count)
+{
+	size_t position = 0;
+	int64_t delta = 0;
+	rows[0].time = firstTime;
+	for (int i = 1; i < count; i++)
+	{
+		uint64_t zigzag = 0;
+		int shift = 0;
+		unsigned char byte;
+		do
+		{
+			if (position >= size || shift > 63)
+				return 1;
+			byte = in[position++];
+			zigzag |= (uint64_t) (byte & 0x7f) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		delta += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+		rows[i].time = rows[i - 1].time + delta;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static size_t encode_values(const ArchiveRow rows[], int count, int column,
+ * 				unsigned char *out)
+ *
+ * DESCRIPTION:
+ * 		Encodes a column of values by XOR with the previous value: a 0 bit if
+ * 		unchanged, else the bits that differ, within the window of the previous
+ * 		value if they fit, or with their new position.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const ArchiveRow rows[]:	The rows.
+ * 			int count:					Number of rows.
+ * 			int column:					Index of the value.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			unsigned char *out:	The encoded column, zeroed before.
+ * 		RETURN:
+ * 			size_t:	Bytes written.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static size_t encode_values(const ArchiveRow rows[], int count, int column,
+		unsigned char *out)
+{
+	BitWriter writer = { out, 0 };
+	uint32_t last;
+	memcpy(&last, &rows[0].values[column], sizeof(last));
+	put_bits(&writer, last, 32);
+
+	int leading = -1, trailing = 0;	// window of the previous change
+	for (int i = 1; i < count; i++)
+	{
+		uint32_t bits;
+		memcpy(&bits, &rows[i].values[column], sizeof(bits));
+		uint32_t change = bits ^ last;
+		last = bits;
+
+		if (change == 0)
+		{
+			put_bits(&writer, 0, 1);
+			continue;
+		}
+		put_bits(&writer, 1, 1);
+
+		int newLeading = __builtin_clz(change);
+		int newTrailing = __builtin_ctz(change);
+		if (leading >= 0 && newLeading >= leading && newTrailing >= trailing)
+		{
+			put_bits(&writer, 0, 1);
+			put_bits(&writer, change >> trailing, 32 - leading - trailing);
+		} else
+		{
+			int length = 32 - newLeading - newTrailing;
+			put_bits(&writer, 1, 1);
+			put_bits(&writer, newLeading, 5);
+			put_bits(&writer, length - 1, 5);
+			put_bits(&writer, change >> newTrailing, length);
+			leading = newLeading;
+			trailing = newTrailing;
+		}
+	}
+	return (writer.bit + 7) / 8;
+}
+
+/**************************************************
+ * NAME: static void decode_values(const unsigned char *in, size_t size,
+ * 				ArchiveRow rows[], int count, int column)
+ *
+ * DESCRIPTION:
+ * 		Decodes a column written by encode_values().
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const unsigned char *in:	The encoded column.
+ * 			size_t size:				Bytes in the column.
+ * 			int count:					Number of rows.
+ * 			int column:					Index of the value.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveRow rows[]:	The rows with the values of the column.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void decode_values(const unsigned char *in, size_t size, ArchiveRow rows[],
+		int count, int column)
+{
+	BitReader reader = { in, size, 0 };
+	uint32_t last = get_bits(&reader, 32);
+	memcpy(&rows[0].values[column], &last, sizeof(last));
+
+	int leading = 0, trailing = 0;
+	for (int i = 1; i < count; i++)
+	{
+		if (get_bits(&reader, 1))
+		{
+			if (get_bits(&reader, 1))
+			{
+				leading = get_bits(&reader, 5);
+				trailing = 32 - leading - (get_bits(&reader, 5) + 1);
+			}
+			last ^= get_bits(&reader, 32 - leading - trailing) << trailing;
+		}
+		memcpy(&rows[i].values[column], &last, sizeof(last));
+	}
+}
+
+/**************************************************
+ * NAME: static int valid_header(const unsigned char *data, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Checks the file header of a mapped archive.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const unsigned char *data:	The file.
+ * 			size_t size:				Size of the file.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	1 if the file is an archive with the columns of this program.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int valid_header(const unsigned char *data, size_t size)
+{
+	FileHeader header;
+	if (size < sizeof(header))
+		return 0;
+	memcpy(&header, data, sizeof(header));
+	return memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0
+			&& header.columns == ARCHIVE_COLUMNS;
+}
+
+/**************************************************
+ * NAME: static size_t block_size(const unsigned char *data, size_t size,
+ * 				size_t offset, BlockHeader *header)
+ *
+ * DESCRIPTION:
+ * 		Reads the header of the block at an offset and checks that the block is
+ * 		complete, without reading its payload.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const unsigned char *data:	The file.
+ * 			size_t size:				Size of the file.
+ * 			size_t offset:				Offset of the block.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			BlockHeader *header:	The header of the block.
+ * 		RETURN:
+ * 			size_t:	Size of the block including its header, 0 if it is not valid.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static size_t block_size(const unsigned char *data, size_t size, size_t offset,
+		BlockHeader *header)
+{
+	if (size - offset < sizeof(*header))
+		return 0;
+	memcpy(header, data + offset, sizeof(*header));
+	if ((*header).magic != BLOCK_MAGIC || (*header).rows == 0
+			|| (*header).rows > ARCHIVE_BLOCK_ROWS)
+		return 0;
+
+	size_t payload = 0;
+	for (int c = 0; c < ARCHIVE_COLUMNS; c++)
+		payload += (*header).columnSize[c];
+	if (payload > ARCHIVE_PAYLOAD_SIZE || size - offset - sizeof(*header) < payload)
+		return 0;
+	return sizeof(*header) + payload;
+}
+
+/**************************************************
+ * NAME: static int block_intact(const unsigned char *data, size_t offset,
+ * 				const BlockHeader *header, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Verifies the checksum of a block.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const unsigned char *data:	The file.
+ * 			size_t offset:				Offset of the block.
+ * 			const BlockHeader *header:	Its header.
+ * 			size_t size:				Its size from block_size().
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	1 if the block is intact.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int block_intact(const unsigned char *data, size_t offset,
+		const BlockHeader *header, size_t size)
+{
+	BlockHeader zeroed = *header;
+	zeroed.checksum = 0;
+	uint32_t crc = crc32(0, (const unsigned char*) &zeroed, sizeof(zeroed));
+	crc = crc32(crc, data + offset + sizeof(zeroed), size - sizeof(zeroed));
+	return crc == (*header).checksum;
+}
+
+/**************************************************
+ * NAME: static void *writer_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Writes the blocks handed over and syncs them to disk, until the archive
+ * 		is closed.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	The ArchiveWriter.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *writer_func(void *void_ptr)
+{
+	ArchiveWriter *writer = (ArchiveWriter*) void_ptr;
+
+	pthread_mutex_lock(&(*writer).lock);
+	while (true)
+	{
+		while (!(*writer).pending && !(*writer).stopping)
+			pthread_cond_wait(&(*writer).changed, &(*writer).lock);
+		if (!(*writer).pending)
+			break;	// stopping with everything written
+
+		// the block is not touched by the one appending until pending is cleared
+		const unsigned char *block = (*writer).blocks[!(*writer).active];
+		size_t size = (*writer).pending;
+		pthread_mutex_unlock(&(*writer).lock);
+
+		bool failed = write((*writer).fd, block, size) != (ssize_t) size
+				|| fdatasync((*writer).fd) < 0;
+		if (failed)
+			perror("Could not write archive block");
+
+		pthread_mutex_lock(&(*writer).lock);
+		(*writer).failed |= failed;
+		(*writer).pending = 0;
+		pthread_cond_broadcast(&(*writer).changed);
+	}
+	pthread_mutex_unlock(&(*writer).lock);
+	return NULL;
+}
+
+/**************************************************
+ * NAME: static int start_writer(ArchiveWriter *writer, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Starts the thread writing the blocks of an open archive.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer with the archive open.
+ * 			const char *filename:	The archive, for the message.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The running writer, closed if failure.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int start_writer(ArchiveWriter *writer, const char *filename)
+{
+	pthread_mutex_init(&(*writer).lock, NULL);
+	pthread_cond_init(&(*writer).changed, NULL);
+	if (pthread_create(&(*writer).thread, NULL, writer_func, writer))
+	{
+		printf("Could not start the writer of %s\n", filename);
+		archive_close(writer);
+		return 1;
+	}
+	(*writer).running = true;
+	return 0;
+}
+
+/**************************************************
+ * NAME: int archive_open(ArchiveWriter *writer, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Opens an archive for appending, creating it if it does not exist. A torn
+ * 		block left at the end by a crash is cut off.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer.
+ * 			const char *filename:	The archive.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The open writer.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int archive_open(ArchiveWriter *writer, const char *filename)
+{
+	(*writer).count = 0;
+	(*writer).active = 0;
+	(*writer).pending = 0;
+	(*writer).failed = false;
+	(*writer).stopping = false;
+	(*writer).running = false;
+	(*writer).fd = open(filename, O_RDWR | O_CREAT, 0644);
+	if ((*writer).fd < 0)
+	{
+		perror(filename);
+		return 1;
+	}
+
+	struct stat status;
+	fstat((*writer).fd, &status);
+	size_t size = status.st_size;
+
+	if (size == 0)
+	{
+		FileHeader header = { { 0 }, ARCHIVE_COLUMNS, 0 };
+		memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+		if (write((*writer).fd, &header, sizeof(header)) != sizeof(header))
+		{
+			perror(filename);
+			archive_close(writer);
+			return 1;
+		}
+		return start_writer(writer, filename);
+	}
+
+	const unsigned char *data = mmap(NULL, size, PROT_READ, MAP_SHARED, (*writer).fd, 0);
+	if (data == MAP_FAILED)
+	{
+		perror(filename);
+		archive_close(writer);
+		return 1;
+	}
+	if (!valid_header(data, size))
+	{
+		printf("%s is not an archive of this program\n", filename);
+		munmap((void*) data, size);
+		archive_close(writer);
+		return 1;
+	}
+
+	// find the end of the complete blocks, only the last one can be torn by a crash
+	size_t end = sizeof(FileHeader), last = 0;
+	BlockHeader header, lastHeader;
+	size_t blockSize;
+	while ((blockSize = block_size(data, size, end, &header)))
+	{
+		last = end;
+		lastHeader = header;
+		end += blockSize;
+	}
+	if (last && !block_intact(data, last, &lastHeader, end - last))
+		end = last;
+	munmap((void*) data, size);
+
+	if (end < size)
+	{
+		printf("%s: cutting off %zu bytes of an incomplete block\n", filename, size - end);
+		if (ftruncate((*writer).fd, end) < 0)
+		{
+			perror(filename);
+			archive_close(writer);
+			return 1;
+		}
+	}
+	lseek((*writer).fd, 0, SEEK_END);
+	return start_writer(writer, filename);
+}
+
+/**************************************************
+ * NAME: static int hand_over(ArchiveWriter *writer, bool wait)
+ *
+ * DESCRIPTION:
+ * 		Encodes the collected rows as a block and hands it to the writer thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer.
+ * 			bool wait:				Wait for the writer if it is busy, else keep
+ * 									the rows for later.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer without rows, unless not waiting
+ * 									for a busy writer.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if a block could not be written.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int hand_over(ArchiveWriter *writer, bool wait)
+{
+	int count = (*writer).count;
+	if (count == 0 || !(*writer).running)
+		return 0;
+
+	pthread_mutex_lock(&(*writer).lock);
+	if ((*writer).pending && !wait)
+	{
+		pthread_mutex_unlock(&(*writer).lock);
+		return 0;
+	}
+	pthread_mutex_unlock(&(*writer).lock);
+	(*writer).count = 0;
+
+	BlockHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BLOCK_MAGIC;
+	header.rows = count;
+	header.firstTime = (*writer).rows[0].time;
+	header.lastTime = (*writer).rows[count - 1].time;
+
+	// the header is put in front of the payload, so the block is a single write
+	unsigned char *block = (*writer).blocks[(*writer).active];
+	memset(block, 0, ARCHIVE_PAYLOAD_SIZE);
+	size_t size = sizeof(header);
+	header.columnSize[0] = encode_times((*writer).rows, count, block + size);
+	size += header.columnSize[0];
+	for (int v = 0; v < ARCHIVE_VALUES; v++)
+	{
+		header.columnSize[v + 1] = encode_values((*writer).rows, count, v, block + size);
+		size += header.columnSize[v + 1];
+	}
+
+	header.checksum = crc32(0, (const unsigned char*) &header, sizeof(header));
+	header.checksum = crc32(header.checksum, block + sizeof(header), size - sizeof(header));
+	memcpy(block, &header, sizeof(header));
+
+	pthread_mutex_lock(&(*writer).lock);
+	while ((*writer).pending)
+		pthread_cond_wait(&(*writer).changed, &(*writer).lock);
+	(*writer).pending = size;
+	(*writer).active = !(*writer).active;
+	pthread_cond_broadcast(&(*writer).changed);
+	int failed = (*writer).failed;
+	(*writer).failed = false;
+	pthread_mutex_unlock(&(*writer).lock);
+	return failed;
+}
+
+/**************************************************
+ * NAME: int archive_append(ArchiveWriter *writer, const ArchiveRow *row)
+ *
+ * DESCRIPTION:
+ * 		Adds a row to the archive. Rows are handed to the writer as a block when
+ * 		ARCHIVE_BLOCK_ROWS have been collected, waiting for it if it is still busy
+ * 		with the previous block, or when they span ARCHIVE_FLUSH_TIME and the
+ * 		writer is idle.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer.
+ * 			const ArchiveRow *row:	The row.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer with the row.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if a block could not be written.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int archive_append(ArchiveWriter *writer, const ArchiveRow *row)
+{
+	(*writer).rows[(*writer).count++] = *row;
+	if ((*writer).count == ARCHIVE_BLOCK_ROWS)
+		return hand_over(writer, true);
+
+	// also a time set back, so the times of a block do not jump back
+	int64_t span = (*row).time - (*writer).rows[0].time;
+	if (span >= ARCHIVE_FLUSH_TIME || span < 0)
+		return hand_over(writer, false);
+	return 0;
+}
+
+/**************************************************
+ * NAME: int archive_flush(ArchiveWriter *writer)
+ *
+ * DESCRIPTION:
+ * 		Hands the collected rows to the writer as a block, waiting for the writer
+ * 		if it is still busy with the previous block. The block is written and
+ * 		synced to disk in the background.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer without rows.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if a previous block could not be written.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int archive_flush(ArchiveWriter *writer)
+{
+	return hand_over(writer, true);
+}
+
+/**************************************************
+ * NAME: void archive_close(ArchiveWriter *writer)
+ *
+ * DESCRIPTION:
+ * 		Writes the remaining rows, waits for the writer to sync them and closes
+ * 		the archive.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The writer.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveWriter *writer:	The closed writer.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void archive_close(ArchiveWriter *writer)
+{
+	if ((*writer).fd < 0)
+		return;
+	if ((*writer).running)
+	{
+		archive_flush(writer);
+		pthread_mutex_lock(&(*writer).lock);
+		(*writer).stopping = true;
+		pthread_cond_broadcast(&(*writer).changed);
+		pthread_mutex_unlock(&(*writer).lock);
+		pthread_join((*writer).thread, NULL);
+		(*writer).running = false;
+	}
+	close((*writer).fd);
+	(*writer).fd = -1;
+}
+
+/**************************************************
+ * NAME: int archive_reader_open(ArchiveReader *reader, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Maps an archive and indexes its blocks by time. Only the block headers
+ * 		are read. A torn block at the end is ignored.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveReader *reader:	The reader.
+ * 			const char *filename:	The archive.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveReader *reader:	The open reader.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int archive_reader_open(ArchiveReader *reader, const char *filename)
+{
+	memset(reader, 0, sizeof(*reader));
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		perror(filename);
+		return 1;
+	}
+	struct stat status;
+	fstat(fd, &status);
+	(*reader).size = status.st_size;
+
+	void *data = (*reader).size ?
+			mmap(NULL, (*reader).size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);	// the mapping stays valid
+	if (data == MAP_FAILED || !valid_header(data, (*reader).size))
+	{
+		printf("%s is not an archive of this program\n", filename);
+		if (data != MAP_FAILED)
+			munmap(data, (*reader).size);
+		return 1;
+	}
+	(*reader).data = data;
+
+	(*reader).decoded = malloc(ARCHIVE_BLOCK_ROWS * sizeof(ArchiveRow));
+	int capacity = 0;
+	size_t offset = sizeof(FileHeader), blockSize;
+	BlockHeader header;
+	(*reader).sorted = 1;
+	while ((blockSize = block_size((*reader).data, (*reader).size, offset, &header)))
+	{
+		if ((*reader).blockCount == capacity)
+		{
+			capacity = capacity ? 2 * capacity : 64;
+			ArchiveBlock *blocks = realloc((*reader).blocks, capacity * sizeof(ArchiveBlock));
+			if (!blocks)
+				break;
+			(*reader).blocks = blocks;
+		}
+
+		ArchiveBlock *block = &(*reader).blocks[(*reader).blockCount];
+		if ((*reader).blockCount > 0 && header.firstTime < block[-1].lastTime)
+			(*reader).sorted = 0;	// the clock was set back
+		(*block).firstTime = header.firstTime;
+		(*block).lastTime = header.lastTime;
+		(*block).offset = offset;
+		(*block).rows = header.rows;
+		(*reader).blockCount++;
+		offset += blockSize;
+	}
+
+	if (!(*reader).decoded || ((*reader).blockCount == capacity && blockSize))
+	{
+		printf("Out of memory indexing %s\n", filename);
+		archive_reader_close(reader);
+		return 1;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: long archive_read_range(ArchiveReader *reader, int64_t from, int64_t to,
+ * 				ArchiveRow rows[], long max)
+ *
+ * DESCRIPTION:
+ * 		Reads the rows within a time window, in the order they were written.
+ * 		Only the blocks overlapping the window are decoded, blocks failing their
+ * 		checksum are skipped. To read a window of more than max rows, call again
+ * 		from the time after the last row returned.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveReader *reader:	The reader.
+ * 			int64_t from:			Start of the window, inclusive [us since the epoch].
+ * 			int64_t to:				End of the window, inclusive.
+ * 			long max:				Capacity of rows.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveRow rows[]:	The rows.
+ * 		RETURN:
+ * 			long:	Number of rows stored.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+long archive_read_range(ArchiveReader *reader, int64_t from, int64_t to, ArchiveRow rows[],
+		long max)
+{
+	// first block that can hold the start of the window
+	int first = 0;
+	if ((*reader).sorted)
+	{
+		int high = (*reader).blockCount;
+		while (first < high)
+		{
+			int middle = (first + high) / 2;
+			if ((*reader).blocks[middle].lastTime < from)
+				first = middle + 1;
+			else
+				high = middle;
+		}
+	}
+
+	long count = 0;
+	for (int b = first; b < (*reader).blockCount && count < max; b++)
+	{
+		const ArchiveBlock *block = &(*reader).blocks[b];
+		if ((*block).firstTime > to && (*reader).sorted)
+			break;
+		if ((*block).lastTime < from || (*block).firstTime > to)
+			continue;
+
+		BlockHeader header;
+		size_t size = block_size((*reader).data, (*reader).size, (*block).offset, &header);
+		if (!block_intact((*reader).data, (*block).offset, &header, size))
+		{
+			printf("Skipping damaged archive block at offset %zu\n", (*block).offset);
+			continue;
+		}
+
+		const unsigned char *column = (*reader).data + (*block).offset + sizeof(header);
+		ArchiveRow *decoded = (*reader).decoded;
+		if (decode_times(column, header.columnSize[0], header.firstTime, decoded,
+				header.rows))
+			continue;
+		column += header.columnSize[0];
+		for (int v = 0; v < ARCHIVE_VALUES; v++)
+		{
+			decode_values(column, header.columnSize[v + 1], decoded, header.rows, v);
+			column += header.columnSize[v + 1];
+		}
+
+		for (uint32_t r = 0; r < header.rows && count < max; r++)
+		{
+			if (decoded[r].time >= from && decoded[r].time <= to)
+				rows[count++] = decoded[r];
+		}
+	}
+	return count;
+}
+
+/**************************************************
+ * NAME: void archive_reader_close(ArchiveReader *reader)
+ *
+ * DESCRIPTION:
+ * 		Unmaps the archive and frees the index.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveReader *reader:	The reader.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ArchiveReader *reader:	The closed reader.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void archive_reader_close(ArchiveReader *reader)
+{
+	if ((*reader).data)
+		munmap((void*) (*reader).data, (*reader).size);
+	free((*reader).blocks);
+	free((*reader).decoded);
+	memset(reader, 0, sizeof(*reader));
+}
@@ -0,0 +1,465 @@
+/**************************************************
+ * FILENAME:	calibration.c
+ *
+ * DESCRIPTION:
+ * 		Linearizes the reading of a distance sensor that is not linear along the
+ * 		tank. The boat is placed at known positions and the average reading at
+ * 		each is recorded. A monotone curve is fitted through the points and
+ * 		sampled into a table holding, for every reading, the reading a linear
+ * 		sensor would give: one that agrees with the sensor at the outermost
+ * 		points and changes in proportion to the position in between. The rest of
+ * 		the program keeps working in sensor units, so gains, models and the width
+ * 		of the tank stay as they are, but equal steps in them are now equal
+ * 		distances in the tank.
+ *
+ * 		Applying the table costs one interpolation between neighboring entries
+ * 		per sample, it is done before the filter. The curve is a monotone cubic
+ * 		(Fritsch-Carlson) through the points after making them monotone by
+ * 		pooling adjacent violators, extended by straight lines beyond them.
+ *
+ * 		The calibration file of a channel, CALIBRATION_FILE_FORMAT, holds:
+ * 			point <reading> <position>		the recorded points
+ * 			table <reading> <linear>		for every reading from 0 to 1000
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int calibration_fit(const float readings[], const float positions[], int count,
+ * 				float table[CALIBRATION_TABLE_SIZE], float *scale)
+ * 		int calibration_record(const char *channelName, int sensorIndex)
+ * 		int calibration_load(SensorCalibration *calibration, const char *filename)
+ * 		float calibration_apply(const SensorCalibration *calibration, float reading)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "headers/calibration.h"
+#include "headers/phidget_connection.h"
+#include "headers/time_utils.h"
+
+#define CALIBRATION_SAMPLES 1000		// averaged per point
+#define CALIBRATION_SAMPLE_PERIOD 1000000	// nanoseconds between them
+
+#define LINE_LENGTH 256
+
+/**************************************************
+ * NAME: static int sort_points(const float readings[], const float positions[],
+ * 				int count, float x[], float y[], float weight[])
+ *
+ * DESCRIPTION:
+ * 		Sorts the points by reading and merges points of the same reading into
+ * 		their average.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const float readings[]:		The readings of the points.
+ * 			const float positions[]:	The positions of the points.
+ * 			int count:					Number of points.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float x[]:		The different readings in increasing order.
+ * 			float y[]:		The average position at each.
+ * 			float weight[]:	The number of points merged into each.
+ * 		RETURN:
+ * 			int:	The number of different readings.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int sort_points(const float readings[], const float positions[], int count,
+		float x[], float y[], float weight[])
+{
+	int n = 0;
+	for (int p = 0; p < count; p++)
+	{
+		// insert in order, or into the point of the same reading
+		int i = 0;
+		while (i < n && x[i] < readings[p])
+			i++;
+		if (i < n && x[i] == readings[p])
+		{
+			y[i] = (y[i] * weight[i] + positions[p]) / (weight[i] + 1.0);
+			weight[i] += 1.0;
+			continue;
+		}
+		for (int j = n; j > i; j--)
+		{
+			x[j] = x[j - 1];
+			y[j] = y[j - 1];
+			weight[j] = weight[j - 1];
+		}
+		x[i] = readings[p];
+		y[i] = positions[p];
+		weight[i] = 1.0;
+		n++;
+	}
+	return n;
+}
+
+/**************************************************
+ * NAME: static void make_monotone(float y[], const float weight[], int n)
+ *
+ * DESCRIPTION:
+ * 		Makes the positions monotone in the direction from the first to the last
+ * 		one with the least change, by pooling adjacent violators: neighbors in the
+ * 		wrong order are replaced by their weighted average until none are left.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			float y[]:				The positions.
+ * 			const float weight[]:	The weight of each.
+ * 			int n:					Number of positions.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float y[]:	The monotone positions.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void make_monotone(float y[], const float weight[], int n)
+{
+	float direction = y[n - 1] >= y[0] ? 1.0 : -1.0;
+	float value[CALIBRATION_MAX_POINTS], total[CALIBRATION_MAX_POINTS];
+	int size[CALIBRATION_MAX_POINTS];
+	int blocks = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		value[blocks] = direction * y[i];
+		total[blocks] = weight[i];
+		size[blocks++] = 1;
+		while (blocks > 1 && value[blocks - 2] > value[blocks - 1])
+		{
+			float merged = total[blocks - 2] + total[blocks - 1];
+			value[blocks - 2] = (value[blocks - 2] * total[blocks - 2]
+					+ value[blocks - 1] * total[blocks - 1]) / merged;
+			total[blocks - 2] = merged;
+			size[blocks - 2] += size[blocks - 1];
+			blocks--;
+		}
+	}
+
+	int i = 0;
+	for (int b = 0; b < blocks; b++)
+	{
+		for (int s = 0; s < size[b]; s++)
+			y[i++] = direction * value[b];
+	}
+}
+
+/**************************************************
+ * NAME: int calibration_fit(const float readings[], const float positions[],
+ * 				int count, float table[CALIBRATION_TABLE_SIZE], float *scale)
+ *
+ * DESCRIPTION:
+ * 		Fits a monotone curve from reading to position through the points and
+ * 		samples the reading of a linear sensor at every reading into the table.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const float readings[]:		The average reading at every point.
+ * 			const float positions[]:	The position of every point, in any unit.
+ * 			int count:					Number of points, at most
+ * 										CALIBRATION_MAX_POINTS.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float table[CALIBRATION_TABLE_SIZE]:	The linear reading at every reading.
+ * 			float *scale:							Units of the positions per unit of
+ * 													the linear reading.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if the points do not give a curve.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int calibration_fit(const float readings[], const float positions[], int count,
+		float table[CALIBRATION_TABLE_SIZE], float *scale)
+{
+	float x[CALIBRATION_MAX_POINTS], y[CALIBRATION_MAX_POINTS], weight[CALIBRATION_MAX_POINTS];
+	if (count > CALIBRATION_MAX_POINTS)
+		count = CALIBRATION_MAX_POINTS;
+	int n = sort_points(readings, positions, count, x, y, weight);
+	if (n < 2)
+	{
+		printf("At least two points of different readings are needed\n");
+		return 1;
+	}
+	make_monotone(y, weight, n);
+	if (y[n - 1] == y[0])
+	{
+		printf("The position does not change with the reading\n");
+		return 1;
+	}
+
+	// slopes of the monotone cubic, zero where the positions turn flat
+	float secant[CALIBRATION_MAX_POINTS], slope[CALIBRATION_MAX_POINTS];
+	for (int i = 0; i < n - 1; i++)
+		secant[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+	slope[0] = secant[0];
+	slope[n - 1] = secant[n - 2];
+	for (int i = 1; i < n - 1; i++)
+	{
+		if (secant[i - 1] * secant[i] <= 0.0)
+		{
+			slope[i] = 0.0;
+			continue;
+		}
+		float before = x[i] - x[i - 1], after = x[i + 1] - x[i];
+		float w1 = 2.0 * after + before, w2 = after + 2.0 * before;
+		slope[i] = (w1 + w2) / (w1 / secant[i - 1] + w2 / secant[i]);
+	}
+
+	// the linear sensor agrees with the sensor at the outermost points
+	float perPosition = (x[n - 1] - x[0]) / (y[n - 1] - y[0]);
+	int segment = 0;
+	for (int r = 0; r < CALIBRATION_TABLE_SIZE; r++)
+	{
+		float position;
+		if (r <= x[0])
+			position = y[0] + slope[0] * (r - x[0]);
+		else if (r >= x[n - 1])
+			position = y[n - 1] + slope[n - 1] * (r - x[n - 1]);
+		else
+		{
+			while (x[segment + 1] < r)
+				segment++;
+			float h = x[segment + 1] - x[segment];
+			float t = (r - x[segment]) / h;
+			float t2 = t * t, t3 = t2 * t;
+			position = (2.0 * t3 - 3.0 * t2 + 1.0) * y[segment]
+					+ (t3 - 2.0 * t2 + t) * h * slope[segment]
+					+ (-2.0 * t3 + 3.0 * t2) * y[segment + 1]
+					+ (t3 - t2) * h * slope[segment + 1];
+		}
+
+		float linear = x[0] + (position - y[0]) * perPosition;
+		if (linear < 0.0)
+			linear = 0.0;
+		else if (linear > CALIBRATION_TABLE_SIZE - 1)
+			linear = CALIBRATION_TABLE_SIZE - 1;
+		table[r] = linear;
+	}
+	*scale = 1.0 / perPosition;
+	return 0;
+}
+
+/**************************************************
+ * NAME: static float average_reading(int sensorIndex, float *deviation)
+ *
+ * DESCRIPTION:
+ * 		Averages CALIBRATION_SAMPLES readings of a sensor, one every
+ * 		CALIBRATION_SAMPLE_PERIOD.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int sensorIndex:	The analog input.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float *deviation:	The standard deviation of the readings.
+ * 		RETURN:
+ * 			float:	The average reading.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static float average_reading(int sensorIndex, float *deviation)
+{
+	double sum = 0.0, sumSquares = 0.0;
+	unsigned long deadline = nano_time();
+	for (int s = 0; s < CALIBRATION_SAMPLES; s++)
+	{
+		SensorFrame frame;
+		read_frame(&frame);
+		double value = frame.sensors[sensorIndex];
+		sum += value;
+		sumSquares += value * value;
+
+		deadline += CALIBRATION_SAMPLE_PERIOD;
+		struct timespec wakeup;
+		to_timespec(deadline, &wakeup);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+			;	// interrupted by a signal
+	}
+	double mean = sum / CALIBRATION_SAMPLES;
+	*deviation = sqrt(fmax(sumSquares / CALIBRATION_SAMPLES - mean * mean, 0.0));
+	return mean;
+}
+
+/**************************************************
+ * NAME: int calibration_record(const char *channelName, int sensorIndex)
+ *
+ * DESCRIPTION:
+ * 		Records the points of a calibration: asks for the position of the boat,
+ * 		averages the reading there and repeats until an empty line is entered.
+ * 		Then fits the table and saves it to CALIBRATION_FILE_FORMAT. The phidgets
+ * 		must be connected.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *channelName:	The name of the channel, for the file.
+ * 			int sensorIndex:			The analog input of its sensor.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int calibration_record(const char *channelName, int sensorIndex)
+{
+	SensorFrame frame;
+	read_frame(&frame);
+	if (sensorIndex >= frame.sensorCount)
+	{
+		printf("The interface kit has no sensor %d\n", sensorIndex);
+		return 1;
+	}
+
+	float readings[CALIBRATION_MAX_POINTS], positions[CALIBRATION_MAX_POINTS];
+	int count = 0;
+	char line[LINE_LENGTH];
+	printf("Calibrating the sensor of %s. Place the boat at known positions along the "
+			"tank, from one end to the other, and enter each, e.g. in mm. An empty line "
+			"ends.\n", channelName);
+	while (count < CALIBRATION_MAX_POINTS)
+	{
+		printf("Position %d: ", count + 1);
+		fflush(stdout);
+		if (!fgets(line, sizeof(line), stdin) || line[strspn(line, " \t\r\n")] == '\0')
+			break;
+		if (sscanf(line, "%f", &positions[count]) != 1)
+		{
+			printf("Not a position: %s", line);
+			continue;
+		}
+
+		float deviation;
+		readings[count] = average_reading(sensorIndex, &deviation);
+		printf("Reading %.1f, standard deviation %.2f\n", readings[count], deviation);
+		count++;
+	}
+
+	float table[CALIBRATION_TABLE_SIZE], scale;
+	if (calibration_fit(readings, positions, count, table, &scale))
+		return 1;
+
+	char filename[CALIBRATION_FILENAME_LENGTH];
+	snprintf(filename, sizeof(filename), CALIBRATION_FILE_FORMAT, channelName);
+	FILE *fp = fopen(filename, "w");
+	if (!fp)
+	{
+		perror("Could not save the calibration");
+		return 1;
+	}
+	fprintf(fp, "# calibration of %s, sensor %d, %.5g position units per sensor unit\n",
+			channelName, sensorIndex, fabs(scale));
+	fprintf(fp, "# reading, position\n");
+	for (int p = 0; p < count; p++)
+		fprintf(fp, "point %.2f %.4g\n", readings[p], positions[p]);
+	fprintf(fp, "# reading, reading of a linear sensor\n");
+	for (int r = 0; r < CALIBRATION_TABLE_SIZE; r++)
+		fprintf(fp, "table %d %.3f\n", r, table[r]);
+	fclose(fp);
+
+	printf("One sensor unit is %.4g position units. Saved to %s, used with 'calibration "
+			"%s %s' in the configuration\n", fabs(scale), filename, channelName, filename);
+	return 0;
+}
+
+/**************************************************
+ * NAME: int calibration_load(SensorCalibration *calibration, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Loads the table of a calibration file. Every reading must be in it.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SensorCalibration *calibration:	The calibration of a channel.
+ * 			const char *filename:			The calibration file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SensorCalibration *calibration:	The loaded calibration.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int calibration_load(SensorCalibration *calibration, const char *filename)
+{
+	if (strlen(filename) >= CALIBRATION_FILENAME_LENGTH)
+	{
+		printf("Calibration file name too long: %s\n", filename);
+		return 1;
+	}
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+	{
+		printf("Could not open calibration %s\n", filename);
+		return 1;
+	}
+
+	bool found[CALIBRATION_TABLE_SIZE] = { false };
+	char line[LINE_LENGTH];
+	int reading, entries = 0;
+	float value;
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (sscanf(line, "table %d %f", &reading, &value) != 2)
+			continue;
+		if (reading < 0 || reading >= CALIBRATION_TABLE_SIZE)
+			continue;
+		(*calibration).table[reading] = value;
+		if (!found[reading])
+			entries++;
+		found[reading] = true;
+	}
+	fclose(fp);
+
+	if (entries < CALIBRATION_TABLE_SIZE)
+	{
+		printf("Calibration %s misses %d readings\n", filename,
+				CALIBRATION_TABLE_SIZE - entries);
+		return 1;
+	}
+	strcpy((*calibration).filename, filename);
+	(*calibration).loaded = true;
+	return 0;
+}
+
+/**************************************************
+ * NAME: float calibration_apply(const SensorCalibration *calibration, float reading)
+ *
+ * DESCRIPTION:
+ * 		Converts a reading to that of a linear sensor, interpolating between the
+ * 		neighboring entries of the table.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const SensorCalibration *calibration:	The calibration of the sensor.
+ * 			float reading:							The reading.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			float:	The linear reading, the reading itself if not calibrated.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+float calibration_apply(const SensorCalibration *calibration, float reading)
+{
+	if (!(*calibration).loaded)
+		return reading;
+	if (reading <= 0.0)
+		return (*calibration).table[0];
+	if (reading >= CALIBRATION_TABLE_SIZE - 1)
+		return (*calibration).table[CALIBRATION_TABLE_SIZE - 1];
+
+	int index = (int) reading;
+	float fraction = reading - index;
+	return (*calibration).table[index]
+			+ ((*calibration).table[index + 1] - (*calibration).table[index]) * fraction;
+}
@@ -0,0 +1,102 @@
+/**************************************************
+ * FILENAME:	command_queue.c
+ *
+ * DESCRIPTION:
+ * 		Implementation of a bounded lock-free single-producer single-consumer queue
+ * 		for commands to the control loop. The producer only writes the tail and the
+ * 		consumer only writes the head, so neither thread ever waits for the other.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		bool command_queue_push(CommandQueue *queue, Command command)
+ * 		bool command_queue_pop(CommandQueue *queue, Command *command)
+ * 		unsigned int command_queue_free(CommandQueue *queue)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include "headers/command_queue.h"
+
+/**************************************************
+ * NAME: bool command_queue_push(CommandQueue *queue, Command command)
+ *
+ * DESCRIPTION:
+ * 		Adds a command to the queue. Must only be called from the producer thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			CommandQueue *queue:	The queue to add to.
+ * 			Command command:		The command to add.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			bool:	true if the command was added, false if the queue is full.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool command_queue_push(CommandQueue *queue, Command command)
+{
+	unsigned int tail = atomic_load_explicit(&(*queue).tail, memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&(*queue).head, memory_order_acquire);
+	if (tail - head >= COMMAND_QUEUE_SIZE)
+		return false;	// full
+
+	(*queue).commands[tail & (COMMAND_QUEUE_SIZE - 1)] = command;
+	atomic_store_explicit(&(*queue).tail, tail + 1, memory_order_release);
+	return true;
+}
+
+/**************************************************
+ * NAME: bool command_queue_pop(CommandQueue *queue, Command *command)
+ *
+ * DESCRIPTION:
+ * 		Removes the oldest command from the queue. Must only be called from the
+ * 		consumer thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			CommandQueue *queue:	The queue to remove from.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Command *command:	The removed command.
+ * 		RETURN:
+ * 			bool:	true if a command was removed, false if the queue is empty.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool command_queue_pop(CommandQueue *queue, Command *command)
+{
+	unsigned int head = atomic_load_explicit(&(*queue).head, memory_order_relaxed);
+	unsigned int tail = atomic_load_explicit(&(*queue).tail, memory_order_acquire);
+	if (head == tail)
+		return false;	// empty
+
+	*command = (*queue).commands[head & (COMMAND_QUEUE_SIZE - 1)];
+	atomic_store_explicit(&(*queue).head, head + 1, memory_order_release);
+	return true;
+}
+
+/**************************************************
+ * NAME: unsigned int command_queue_free(CommandQueue *queue)
+ *
+ * DESCRIPTION:
+ * 		Counts the commands that can be added before the queue is full. Must only
+ * 		be called from the producer thread, for which the space can only grow
+ * 		until it adds commands itself.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			CommandQueue *queue:	The queue.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			unsigned int:	The number of free slots.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+unsigned int command_queue_free(CommandQueue *queue)
+{
+	unsigned int tail = atomic_load_explicit(&(*queue).tail, memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&(*queue).head, memory_order_acquire);
+	return COMMAND_QUEUE_SIZE - (tail - head);
+}
@@ -0,0 +1,504 @@
+/**************************************************
+ * FILENAME:	command_server.c
+ *
+ * DESCRIPTION:
+ * 		A line based command interface on a Unix domain socket. Every line is parsed
+ * 		into one or more commands which are handed to the control loop through a
+ * 		lock-free queue, the control loop applies them at the start of its next
+ * 		iteration. Every line is answered with "ok" or "error: <reason>". Up to
+ * 		MAX_CLIENTS clients are served at once, so one staying connected does not
+ * 		keep the others waiting.
+ *
+ * 		Commands (positions in the same units as printed), optionally prefixed with
+ * 		@<channel name or index> to address a channel other than the first one:
+ * 			setpoint <position>
+ * 			move <change>
+ * 			trajectory <delay> <position> [<delay> <position> ...]
+ * 			gains <Kp> <Ki> <Kd>
+ * 			antiwindup <clamp|conditional|back-calculation> [<tracking time>]
+ * 			feedforward <velocity gain> <acceleration gain>
+ * 			observer <bandwidth>
+ * 			controller <pid|mpc>
+ * 			start
+ * 			stop
+ * 			quit
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int command_server_start(const char *socketPath, ControlRuntime *runtime)
+ * 		void command_server_stop(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "headers/command_server.h"
+#include "headers/pid_controller.h"
+
+#define LINE_LENGTH 1024
+#define MAX_ARGUMENTS (2 * COMMAND_QUEUE_SIZE)	// a trajectory filling the command queue
+#define MAX_CLIENTS 16
+
+// a connected client and the part of a line it has sent so far
+typedef struct
+{
+	int socket;
+	char buffer[LINE_LENGTH];
+	int length;
+} Client;
+
+static int listenSocket = -1;
+static atomic_bool serverRunning;
+static pthread_t serverThread;
+static ControlRuntime *controlRuntime;
+static char socketFile[sizeof(((struct sockaddr_un*) 0)->sun_path)];
+
+/**************************************************
+ * NAME: static int parse_numbers(char *text, float numbers[], int max)
+ *
+ * DESCRIPTION:
+ * 		Parses the whitespace separated numbers following a command word.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			char *text:	The arguments of the command, modified while parsing.
+ * 			int max:	Maximum number of numbers to parse.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float numbers[]:	The parsed numbers.
+ * 		RETURN:
+ * 			int:	The number of numbers, max + 1 if there were more than max, -1 if
+ * 					something was not a number.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static int parse_numbers(char *text, float numbers[], int max)
+{
+	int count = 0;
+	char *savePtr;
+	for (char *word = strtok_r(text, " \t", &savePtr); word; word = strtok_r(NULL, " \t",
+			&savePtr))
+	{
+		if (count >= max)
+			return max + 1;	// more than fit, the rest is not parsed
+
+		char *end;
+		numbers[count++] = strtof(word, &end);
+		if (*end != '\0')
+			return -1;
+	}
+	return count;
+}
+
+/**************************************************
+ * NAME: static const char *handle_line(char *line)
+ *
+ * DESCRIPTION:
+ * 		Parses one line and pushes the resulting commands onto the queue of the
+ * 		addressed channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			char *line:	The line without the line ending, modified while parsing.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			const char *:	NULL if successful, otherwise a description of the error.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static const char *handle_line(char *line)
+{
+	// an optional @<channel> prefix selects the channel, the first one by default
+	CommandQueue *commandQueue = &(*controlRuntime).channels[0].socketCommands;
+	if (*line == '@')
+	{
+		char *name = line + 1;
+		line = name + strcspn(name, " \t");
+		if (*line != '\0')
+			*line++ = '\0';
+		line += strspn(line, " \t");
+
+		int channel = runtime_find_channel(controlRuntime, name);
+		if (channel < 0)
+			return "unknown channel";
+		commandQueue = &(*controlRuntime).channels[channel].socketCommands;
+	}
+
+	char *arguments = line + strcspn(line, " \t");
+	if (*arguments != '\0')
+		*arguments++ = '\0';
+
+	Command command = { 0 };
+	if (strcmp(line, "antiwindup") == 0)
+	{
+		// the mode is given by name, the rest are numbers
+		arguments += strspn(arguments, " \t");
+		char *mode = arguments;
+		arguments += strcspn(arguments, " \t");
+		if (*arguments != '\0')
+			*arguments++ = '\0';
+
+		if (strcmp(mode, "clamp") == 0)
+			command.values[0] = ANTI_WINDUP_CLAMP;
+		else if (strcmp(mode, "conditional") == 0)
+			command.values[0] = ANTI_WINDUP_CONDITIONAL;
+		else if (strcmp(mode, "back-calculation") == 0)
+			command.values[0] = ANTI_WINDUP_BACK_CALCULATION;
+		else
+			return "expected clamp, conditional or back-calculation";
+
+		int count = parse_numbers(arguments, &command.values[1], 1);
+		if (count < 0 || count > 1 || command.values[1] < 0.0)
+			return "invalid tracking time";
+
+		command.type = COMMAND_ANTI_WINDUP;
+		if (!command_queue_push(commandQueue, command))
+			return "command queue full";
+		return NULL;
+	} else if (strcmp(line, "controller") == 0)
+	{
+		char mode[8];
+		char extra[2];
+		if (sscanf(arguments, "%7s %1s", mode, extra) != 1)
+			return "expected pid or mpc";
+
+		if (strcmp(mode, "pid") == 0)
+			command.values[0] = CONTROLLER_PID;
+		else if (strcmp(mode, "mpc") == 0)
+			command.values[0] = CONTROLLER_MPC;
+		else
+			return "expected pid or mpc";
+
+		command.type = COMMAND_CONTROLLER;
+		if (!command_queue_push(commandQueue, command))
+			return "command queue full";
+		return NULL;
+	}
+
+	float numbers[MAX_ARGUMENTS];
+	int count = parse_numbers(arguments, numbers, MAX_ARGUMENTS);
+	if (count < 0)
+		return "invalid argument";
+
+	if (strcmp(line, "setpoint") == 0)
+	{
+		if (count != 1)
+			return "expected one position";
+		command.type = COMMAND_SETPOINT;
+		command.values[0] = numbers[0];
+	} else if (strcmp(line, "move") == 0)
+	{
+		if (count != 1)
+			return "expected one change of position";
+		command.type = COMMAND_MOVE;
+		command.values[0] = numbers[0];
+	} else if (strcmp(line, "trajectory") == 0)
+	{
+		if (count > MAX_ARGUMENTS)
+			return "too many waypoints";
+		if (count == 0 || count % 2 != 0)
+			return "expected pairs of delay and position";
+
+		for (int i = 0; i < count; i += 2)
+		{
+			if (numbers[i] < 0.0)
+				return "negative delay";
+		}
+
+		// all waypoints or none, a cut off trajectory would be run as if it were whole
+		if (command_queue_free(commandQueue) < (unsigned int) count / 2)
+			return "command queue full";
+		for (int i = 0; i < count; i += 2)
+		{
+			Command waypoint = { COMMAND_WAYPOINT, { numbers[i], numbers[i + 1], i == 0 } };
+			command_queue_push(commandQueue, waypoint);	// the only producer, there is space
+		}
+		return NULL;
+	} else if (strcmp(line, "gains") == 0)
+	{
+		if (count != 3)
+			return "expected Kp, Ki and Kd";
+		if (numbers[0] < 0.0 || numbers[1] < 0.0 || numbers[2] < 0.0)
+			return "negative gain";
+		command.type = COMMAND_GAINS;
+		memcpy(command.values, numbers, sizeof(command.values));
+	} else if (strcmp(line, "feedforward") == 0)
+	{
+		if (count != 2)
+			return "expected velocity and acceleration gain";
+		command.type = COMMAND_FEED_FORWARD;
+		command.values[0] = numbers[0];
+		command.values[1] = numbers[1];
+	} else if (strcmp(line, "observer") == 0)
+	{
+		if (count != 1)
+			return "expected the bandwidth in Hz";
+		if (numbers[0] < 0.0)
+			return "negative bandwidth";
+		command.type = COMMAND_OBSERVER;
+		command.values[0] = numbers[0];
+	} else if (strcmp(line, "start") == 0)
+	{
+		command.type = COMMAND_START;
+	} else if (strcmp(line, "stop") == 0)
+	{
+		command.type = COMMAND_STOP;
+	} else if (strcmp(line, "quit") == 0)
+	{
+		command.type = COMMAND_QUIT;
+	} else
+	{
+		return "unknown command";
+	}
+
+	if ((command.type == COMMAND_START || command.type == COMMAND_STOP
+			|| command.type == COMMAND_QUIT) && count != 0)
+		return "unexpected argument";
+
+	if (!command_queue_push(commandQueue, command))
+		return "command queue full";
+	return NULL;
+}
+
+/**************************************************
+ * NAME: static bool reply(int client, const char *text)
+ *
+ * DESCRIPTION:
+ * 		Sends a reply without waiting. A client that does not read its replies
+ * 		until the socket buffer is full is not worth waiting for.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int client:			The connected socket.
+ * 			const char *text:	The reply, with the line ending.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			bool:	true if sent, false if the client has to be disconnected.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static bool reply(int client, const char *text)
+{
+	size_t length = strlen(text);
+	return send(client, text, length, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t) length;
+}
+
+/**************************************************
+ * NAME: static bool serve_client(Client *client)
+ *
+ * DESCRIPTION:
+ * 		Reads what a client has sent and answers every complete line. Only called
+ * 		when the socket is readable, so the read does not wait.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Client *client:	The client with the incomplete line from before.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Client *client:	The client with the incomplete line left.
+ * 		RETURN:
+ * 			bool:	false if the client has disconnected or has to be.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static bool serve_client(Client *client)
+{
+	char *buffer = (*client).buffer;
+	int n = read((*client).socket, buffer + (*client).length,
+			sizeof((*client).buffer) - 1 - (*client).length);
+	if (n <= 0)
+		return false;	// disconnected
+	(*client).length += n;
+	buffer[(*client).length] = '\0';
+
+	// answer every complete line
+	char *line = buffer;
+	char *end;
+	while ((end = strchr(line, '\n')))
+	{
+		*end = '\0';
+		if (end > line && end[-1] == '\r')
+			end[-1] = '\0';
+
+		if (*line != '\0' && *line != '#')
+		{
+			const char *error = handle_line(line);
+			char text[64];
+			if (error)
+				snprintf(text, sizeof(text), "error: %s\n", error);
+			else
+				snprintf(text, sizeof(text), "ok\n");
+			if (!reply((*client).socket, text))
+				return false;
+		}
+		line = end + 1;
+	}
+
+	// keep the incomplete line for the next read
+	(*client).length -= line - buffer;
+	memmove(buffer, line, (*client).length);
+	if ((*client).length >= (int) sizeof((*client).buffer) - 1)
+	{
+		(*client).length = 0;
+		if (!reply((*client).socket, "error: line too long\n"))
+			return false;
+	}
+	return true;
+}
+
+/**************************************************
+ * NAME: static void *server_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Accepts connections on the command socket and serves all connected
+ * 		clients, waiting for any of them in one poll(), until the server is
+ * 		stopped. This function is run in a separate thread which is the only
+ * 		producer of the command queues of the channels.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	Not used.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *server_func(void *void_ptr)
+{
+	static Client clients[MAX_CLIENTS];	// too large for the stack
+	int clientCount = 0;
+
+	while (atomic_load(&serverRunning))
+	{
+		// the listening socket first, then the clients in the same order
+		struct pollfd pfds[MAX_CLIENTS + 1];
+		pfds[0] = (struct pollfd) { listenSocket, clientCount < MAX_CLIENTS ? POLLIN : 0, 0 };
+		for (int i = 0; i < clientCount; i++)
+			pfds[i + 1] = (struct pollfd) { clients[i].socket, POLLIN, 0 };
+
+		// wake up regularly to check if the server should stop
+		if (poll(pfds, clientCount + 1, 200) <= 0)
+			continue;
+
+		// serve the clients before accepting, so the indices still match
+		for (int i = clientCount - 1; i >= 0; i--)
+		{
+			if (pfds[i + 1].revents == 0)
+				continue;
+			if ((pfds[i + 1].revents & POLLIN) && serve_client(&clients[i]))
+				continue;
+
+			close(clients[i].socket);
+			clients[i] = clients[--clientCount];	// order does not matter
+		}
+
+		if (pfds[0].revents & POLLIN)
+		{
+			int client = accept(listenSocket, NULL, NULL);
+			if (client >= 0)
+			{
+				clients[clientCount].socket = client;
+				clients[clientCount].length = 0;
+				clientCount++;
+			}
+		}
+	}
+
+	for (int i = 0; i < clientCount; i++)
+		close(clients[i].socket);
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int command_server_start(const char *socketPath, ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Creates the command socket and starts the thread serving it. An old socket
+ * 		file left behind by a previous run is replaced.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *socketPath:	Path of the Unix domain socket.
+ * 			ControlRuntime *runtime:	The runtime whose channels receive the commands.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int command_server_start(const char *socketPath, ControlRuntime *runtime)
+{
+	controlRuntime = runtime;
+
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		printf("Command socket path too long: %s\n", socketPath);
+		return 1;
+	}
+	strcpy(address.sun_path, socketPath);
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+	{
+		perror("Could not create command socket");
+		return 1;
+	}
+
+	unlink(socketPath);
+	if (bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) < 0
+			|| listen(listenSocket, 4) < 0)
+	{
+		perror("Could not listen on command socket");
+		close(listenSocket);
+		listenSocket = -1;
+		return 1;
+	}
+	strcpy(socketFile, socketPath);
+
+	atomic_store(&serverRunning, true);
+	pthread_create(&serverThread, NULL, server_func, NULL);
+
+	printf("Accepting commands on %s\n", socketPath);
+	return 0;
+}
+
+/**************************************************
+ * NAME: void command_server_stop(void)
+ *
+ * DESCRIPTION:
+ * 		Stops the server thread and removes the socket.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void command_server_stop(void)
+{
+	if (listenSocket < 0)
+		return;
+
+	atomic_store(&serverRunning, false);
+	pthread_join(serverThread, NULL);
+
+	close(listenSocket);
+	listenSocket = -1;
+	unlink(socketFile);
+}
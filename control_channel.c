@@ -0,0 +1,424 @@
+/**************************************************
+ * FILENAME:	control_channel.c
+ *
+ * DESCRIPTION:
+ * 		One control channel: a sensor and a servo, with the calibration, filter,
+ * 		trajectory and controller closing the loop between them. While running, a
+ * 		model of the boat is identified from the data of the loop. The output is
+ * 		computed by the PID-controller or by the model predictive controller, which
+ * 		uses the identified model once it can be trusted and a configured or default
+ * 		model until then. The gains of the PID-controller follow the gain schedule
+ * 		of the channel, if it has one. Every channel keeps its own state and
+ * 		receives its own commands, so several axes or boats can be controlled side
+ * 		by side. A channel is only ever touched by the thread running it.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void channel_init(ControlChannel *channel, const char *name, int sensorIndex,
+ * 				int servoIndex)
+ * 		void channel_start(ControlChannel *channel, int sensorValue, float period)
+ * 		bool channel_apply_commands(ControlChannel *channel, unsigned long now)
+ * 		PIDdata channel_update(ControlChannel *channel, int sensorValue,
+ * 				unsigned long now)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "headers/control_channel.h"
+#include "headers/time_utils.h"
+
+// iterations before the MPC uses the identified model
+#define IDENTIFIED_MODEL_SAMPLES 1000
+
+// iterations the MPC keeps a model before it may switch, so it does not flip back
+// and forth
+#define MODEL_HOLD_ITERATIONS 500
+
+/**************************************************
+ * NAME: void channel_init(ControlChannel *channel, const char *name,
+ * 				int sensorIndex, int servoIndex)
+ *
+ * DESCRIPTION:
+ * 		Initializes a channel with the PID-controller. The channel is active
+ * 		but does not know where it is until channel_start() is called.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel to initialize.
+ * 			const char *name:			Name used in commands, metrics and file names.
+ * 			int sensorIndex:			Analog input of the position sensor.
+ * 			int servoIndex:				Servo motor driving the thruster.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The initialized channel.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void channel_init(ControlChannel *channel, const char *name, int sensorIndex,
+		int servoIndex)
+{
+	memset(channel, 0, sizeof(*channel));
+	snprintf((*channel).name, CHANNEL_NAME_LENGTH, "%s", name);
+	(*channel).sensorIndex = sensorIndex;
+	(*channel).servoIndex = servoIndex;
+	pid_init(&(*channel).pid);
+	observer_init(&(*channel).observer);
+	plant_estimator_init(&(*channel).estimator);
+	step_analytics_init(&(*channel).analytics);
+	(*channel).data.controlActive = true;
+}
+
+/**************************************************
+ * NAME: void channel_start(ControlChannel *channel, int sensorValue, float period)
+ *
+ * DESCRIPTION:
+ * 		Takes the current position as the starting point, the tank extends from
+ * 		there, and starts moving to the middle of the tank.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel.
+ * 			int sensorValue:			The current sensor value.
+ * 			float period:				Seconds between iterations of the control loop.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The started channel.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void channel_start(ControlChannel *channel, int sensorValue, float period)
+{
+	BoatData *data = &(*channel).data;
+	(*data).startpoint = responsive_analog_read(&(*channel).filter,
+			calibration_apply(&(*channel).calibration, sensorValue));
+	(*data).sensorValue = (*data).startpoint;
+
+	// move from where the boat is to the middle of the tank
+	(*data).setpoint = (*data).startpoint;
+	(*data).target = (*data).startpoint - TANK_WIDTH / 2;
+
+	// setpoint changes are followed along jerk-limited profiles
+	trajectory_init(&(*channel).trajectory, (*data).setpoint, TRAJECTORY_MAX_VELOCITY,
+			TRAJECTORY_MAX_ACCELERATION, TRAJECTORY_MAX_JERK);
+
+	// the predictions of the MPC and the observer are made at the period of the loop
+	mpc_init(&(*channel).mpc, period);
+	observer_start(&(*channel).observer, period);
+	if (!(*channel).modelConfigured)
+		mpc_default_model(&(*channel).model, period);
+}
+
+/**************************************************
+ * NAME: static const PlantModel *mpc_model(ControlChannel *channel)
+ *
+ * DESCRIPTION:
+ * 		Chooses the model the MPC predicts with: the configured model, else the
+ * 		identified model once it has seen enough data and still describes the
+ * 		boat, else the default model. A switch between the identified and the
+ * 		default model waits until the current one has been used for
+ * 		MODEL_HOLD_ITERATIONS, unless the identified model has become unusable.
+ * 		Called once per iteration of the MPC.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel with the choice updated.
+ * 		RETURN:
+ * 			const PlantModel *:	The model.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static const PlantModel *mpc_model(ControlChannel *channel)
+{
+	// the channel thread is the writer of the published model, no lock needed
+	const PlantModel *identified = &(*channel).estimator.published;
+	bool usable = !(*channel).modelConfigured && mpc_model_usable(identified);
+	bool wanted = usable && (*identified).samples >= IDENTIFIED_MODEL_SAMPLES
+			&& !(*identified).dynamicsChanged;
+
+	if ((*channel).modelHeld < MODEL_HOLD_ITERATIONS)
+		(*channel).modelHeld++;
+	if (wanted != (*channel).identifiedModel
+			&& ((*channel).modelHeld >= MODEL_HOLD_ITERATIONS || !usable))
+	{
+		(*channel).identifiedModel = wanted;
+		(*channel).modelHeld = 0;
+	}
+	return (*channel).identifiedModel ? identified : &(*channel).model;
+}
+
+/**************************************************
+ * NAME: static void select_controller(ControlChannel *channel, ControllerMode mode)
+ *
+ * DESCRIPTION:
+ * 		Switches the controller computing the output. The new controller continues
+ * 		from the current output, so the thruster does not jump.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel.
+ * 			ControllerMode mode:		The controller to use.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel with the controller started.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void select_controller(ControlChannel *channel, ControllerMode mode)
+{
+	if (mode == (*channel).controller)
+		return;
+
+	float output = (*channel).data.controlActive ? (*channel).data.servoValue : MAX_OUTPUT;
+	if (mode == CONTROLLER_MPC)
+	{
+		mpc_reset(&(*channel).mpc, output);
+	} else
+	{
+		pid_reset(&(*channel).pid);
+		(*channel).pid.integralTerm = output;
+	}
+	(*channel).controller = mode;
+	printf("Controller of %s changed to %s\n", (*channel).name,
+			mode == CONTROLLER_MPC ? "mpc" : "pid");
+}
+
+/**************************************************
+ * NAME: static float to_target(BoatData *data, float position)
+ *
+ * DESCRIPTION:
+ * 		Converts a position in printed units to a target in sensor units, and
+ * 		keeps it inside the tank.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			BoatData *data:	Data of the channel.
+ * 			float position:	The wanted position.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			float:	The target.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static float to_target(BoatData *data, float position)
+{
+	float target = 1000.0 - position;
+	if (target > (*data).startpoint)
+		target = (*data).startpoint;
+	else if (target < (*data).startpoint - TANK_WIDTH)
+		target = (*data).startpoint - TANK_WIDTH;
+	return target;
+}
+
+/**************************************************
+ * NAME: static bool apply_command(ControlChannel *channel, Command command,
+ * 				unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Applies a single command to the channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel.
+ * 			Command command:			The command to apply.
+ * 			unsigned long now:			The current time from nano_time().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	Updated target, waypoints and controller.
+ * 		RETURN:
+ * 			bool:	false if the program should quit.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static bool apply_command(ControlChannel *channel, Command command, unsigned long now)
+{
+	BoatData *data = &(*channel).data;
+	PIDController *pid = &(*channel).pid;
+
+	switch (command.type)
+	{
+	case COMMAND_SETPOINT:
+		(*channel).waypointCount = (*channel).nextWaypoint = 0;
+		(*data).target = to_target(data, command.values[0]);
+		break;
+	case COMMAND_MOVE:
+		(*data).target = to_target(data, 1000.0 - (*data).target + command.values[0]);
+		break;
+	case COMMAND_WAYPOINT:
+		if (command.values[2] != 0.0)
+			(*channel).waypointCount = (*channel).nextWaypoint = 0;
+		if ((*channel).waypointCount >= COMMAND_QUEUE_SIZE)
+		{
+			printf("Too many waypoints, ignoring waypoint\n");
+			break;
+		}
+
+		// the delay is counted from the previous waypoint, or from now if there is none
+		Waypoint *waypoints = (*channel).waypoints;
+		unsigned long base = (*channel).nextWaypoint < (*channel).waypointCount ?
+				waypoints[(*channel).waypointCount - 1].time : now;
+		waypoints[(*channel).waypointCount].time = base + sec_to_nano(command.values[0]);
+		waypoints[(*channel).waypointCount++].target = to_target(data, command.values[1]);
+		break;
+	case COMMAND_GAINS:
+		if (atomic_exchange(&(*channel).schedule.enabled, false))
+			printf("Gain schedule of %s turned off until its file changes\n",
+					(*channel).name);
+		pid_set_gains(pid, command.values[0], command.values[1], command.values[2]);
+		printf("Gains of %s changed to Kp: %.4f Ki: %.4f Kd: %.4f\n", (*channel).name,
+				command.values[0], command.values[1], command.values[2]);
+		break;
+	case COMMAND_ANTI_WINDUP:
+		pid_set_anti_windup(pid, (AntiWindupMode) command.values[0], command.values[1]);
+		break;
+	case COMMAND_FEED_FORWARD:
+		pid_set_feed_forward(pid, command.values[0], command.values[1]);
+		break;
+	case COMMAND_OBSERVER:
+		observer_set_bandwidth(&(*channel).observer, command.values[0]);
+		printf("Disturbance observer of %s %s\n", (*channel).name,
+				command.values[0] > 0.0 ? "on" : "off");
+		break;
+	case COMMAND_CONTROLLER:
+		select_controller(channel, (ControllerMode) command.values[0]);
+		break;
+	case COMMAND_START:
+		if (!(*data).controlActive)
+		{
+			// don't continue from the state before the stop
+			pid_reset(pid);
+			mpc_reset(&(*channel).mpc, MAX_OUTPUT);
+			observer_reset(&(*channel).observer);
+		}
+		(*data).controlActive = true;
+		break;
+	case COMMAND_STOP:
+		(*data).controlActive = false;
+		break;
+	case COMMAND_QUIT:
+		return false;
+	}
+	return true;
+}
+
+/**************************************************
+ * NAME: bool channel_apply_commands(ControlChannel *channel, unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Applies all commands received since the previous iteration and moves the
+ * 		target to any waypoint whose time has come. Called once per iteration of
+ * 		the control loop, so commands never change the channel in the middle of one.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel.
+ * 			unsigned long now:			The current time from nano_time().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	Updated target, waypoints and controller.
+ * 		RETURN:
+ * 			bool:	false if a quit command was received.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool channel_apply_commands(ControlChannel *channel, unsigned long now)
+{
+	bool running = true;
+	Command command;
+	while (command_queue_pop(&(*channel).socketCommands, &command))
+		running &= apply_command(channel, command, now);
+
+	Waypoint *waypoints = (*channel).waypoints;
+	while ((*channel).nextWaypoint < (*channel).waypointCount
+			&& waypoints[(*channel).nextWaypoint].time <= now)
+		(*channel).data.target = waypoints[(*channel).nextWaypoint++].target;
+
+	if ((*channel).nextWaypoint == (*channel).waypointCount)
+		(*channel).waypointCount = (*channel).nextWaypoint = 0;	// trajectory finished
+
+	return running;
+}
+
+/**************************************************
+ * NAME: PIDdata channel_update(ControlChannel *channel, int sensorValue,
+ * 				unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Runs one iteration of the control loop of the channel: linearizes and
+ * 		filters the sensor value, moves the setpoint along the trajectory to the
+ * 		target and computes the servo output with the selected controller, looking
+ * 		up the scheduled gains first. The disturbance observed is cancelled in the
+ * 		output of the PID-controller. While stopped the output gives no power. The
+ * 		position and output update the model of the boat and the measurement of the
+ * 		step response.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The channel.
+ * 			int sensorValue:			The raw sensor value of this iteration.
+ * 			unsigned long now:			Time of the sensor value from nano_time().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlChannel *channel:	The updated channel and its data.
+ * 		RETURN:
+ * 			PIDdata:	The servo output and the terms of the controller.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+PIDdata channel_update(ControlChannel *channel, int sensorValue, unsigned long now)
+{
+	BoatData *data = &(*channel).data;
+
+	// linearized, noise reduced position
+	float position = responsive_analog_read(&(*channel).filter,
+			calibration_apply(&(*channel).calibration, sensorValue));
+
+	trajectory_set_target(&(*channel).trajectory, (*data).target, now);
+	TrajectoryPoint reference = trajectory_sample(&(*channel).trajectory, now);
+
+	// the force on the boat the power applied since the previous iteration does not
+	// explain, by the configured or default model: a model changing under the observer
+	// would look like a disturbance itself
+	float disturbance = observer_update(&(*channel).observer, &(*channel).model,
+			1000.0 - position, MAX_OUTPUT - (*data).servoValue);
+
+	PIDdata pid = { MAX_OUTPUT, 0.0, MAX_OUTPUT, 0.0, 0.0 };
+	if ((*data).controlActive && (*channel).controller == CONTROLLER_MPC)
+		pid = mpc_compute(&(*channel).mpc, mpc_model(channel), position,
+				&(*channel).trajectory, now);
+	else if ((*data).controlActive)
+	{
+		float gains[3];
+		if (gain_schedule_lookup(&(*channel).schedule, (*data).startpoint - position,
+				reference.velocity, (*data).target - reference.position, gains))
+			pid_set_gains(&(*channel).pid, gains[0], gains[1], gains[2]);
+
+		// less power for a force pushing forward, more for one pushing back
+		pid_set_compensation(&(*channel).pid, disturbance);
+		pid = pid_compute(&(*channel).pid, position, reference.position, reference.velocity,
+				reference.acceleration, now);
+	}
+
+	// update the data
+	(*data).setpoint = reference.position;
+	(*data).sensorValue = position;
+	(*data).servoValue = pid.output;
+	(*data).pid = pid;
+
+	plant_estimator_update(&(*channel).estimator, position, pid.output);
+	step_analytics_record(&(*channel).analytics, now, 1000.0 - (*data).target,
+			1000.0 - position, pid.output, (*data).controlActive);
+	return pid;
+}
@@ -0,0 +1,607 @@
+/**************************************************
+ * FILENAME:	control_runtime.c
+ *
+ * DESCRIPTION:
+ * 		Runs any number of control channels on a shared periodic scheduler. The
+ * 		channels are read from a configuration file and spread over one or more
+ * 		worker threads. Every worker wakes up at absolute deadlines, so the period
+ * 		does not drift with the time spent in an iteration, and takes one frame of
+ * 		all inputs of the interface kit before computing and writing the outputs of
+ * 		its channels.
+ * 		If an iteration overruns, the missed deadlines are skipped instead of being
+ * 		run back to back.
+ *
+ * 		The configuration file holds one setting per line, '#' starts a comment:
+ * 			period <seconds>
+ * 			workers <count>
+ * 			deadband <servo position change>
+ * 			channel <name> <sensor index> <servo index> [<Kp> <Ki> <Kd>]
+ * 			controller <channel name> <pid|mpc>
+ * 			model <channel name> <a1> <a2> <b1> <b2> <c>
+ * 			schedule <channel name> <gain table file>
+ * 			calibration <channel name> <calibration file>
+ * 			thrust <channel name> <thrust curve file>
+ * 			observer <channel name> <bandwidth Hz>
+ * 			watchdog <timeout ms> [<stuck ms> [<sensor min> <sensor max>]]
+ * 		Without a configuration file a single channel "boat" is run on sensor 2
+ * 		and servo 0.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int runtime_load(ControlRuntime *runtime, const char *filename)
+ * 		int runtime_start(ControlRuntime *runtime)
+ * 		void runtime_run(ControlRuntime *runtime)
+ * 		void runtime_stop(ControlRuntime *runtime)
+ * 		bool runtime_is_running(ControlRuntime *runtime)
+ * 		int runtime_find_channel(ControlRuntime *runtime, const char *name)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "headers/actuator.h"
+#include "headers/control_runtime.h"
+#include "headers/metrics.h"
+#include "headers/phidget_connection.h"
+#include "headers/telemetry.h"
+#include "headers/time_utils.h"
+#include "headers/trace.h"
+#include "headers/watchdog.h"
+
+// used when there is no configuration file
+#define DEFAULT_CHANNEL_NAME "boat"
+#define DEFAULT_SENSOR_INDEX 2
+#define DEFAULT_SERVO_INDEX 0
+
+#define LINE_LENGTH 256
+
+// what a worker thread needs to know
+typedef struct
+{
+	ControlRuntime *runtime;
+	int index;
+} Worker;
+
+/**************************************************
+ * NAME: static int add_channel(ControlRuntime *runtime, const char *name,
+ * 				int sensorIndex, int servoIndex)
+ *
+ * DESCRIPTION:
+ * 		Adds a channel with the default controller to the runtime.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime.
+ * 			const char *name:			Unique name of the channel.
+ * 			int sensorIndex:			Analog input of the position sensor.
+ * 			int servoIndex:				Servo motor driving the thruster.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime with the new channel.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int add_channel(ControlRuntime *runtime, const char *name, int sensorIndex,
+		int servoIndex)
+{
+	if ((*runtime).channelCount >= MAX_CHANNELS)
+	{
+		printf("Too many channels, at most %d are supported\n", MAX_CHANNELS);
+		return 1;
+	}
+	if (strlen(name) >= CHANNEL_NAME_LENGTH || strchr(name, '@'))
+	{
+		printf("Invalid channel name: %s\n", name);
+		return 1;
+	}
+	if (sensorIndex < 0 || servoIndex < 0 || servoIndex >= ACTUATOR_MAX_SERVOS)
+	{
+		printf("Invalid sensor or servo index for channel %s\n", name);
+		return 1;
+	}
+
+	for (int c = 0; c < (*runtime).channelCount; c++)
+	{
+		ControlChannel *other = &(*runtime).channels[c];
+		if (strcmp((*other).name, name) == 0)
+		{
+			printf("Channel %s is defined twice\n", name);
+			return 1;
+		}
+		if ((*other).servoIndex == servoIndex)
+		{
+			printf("Channels %s and %s use the same servo\n", (*other).name, name);
+			return 1;
+		}
+	}
+
+	channel_init(&(*runtime).channels[(*runtime).channelCount++], name, sensorIndex,
+			servoIndex);
+	return 0;
+}
+
+/**************************************************
+ * NAME: static int parse_line(ControlRuntime *runtime, char *line)
+ *
+ * DESCRIPTION:
+ * 		Applies one line of the configuration file.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime.
+ * 			char *line:					The line, without comments.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The configured runtime.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int parse_line(ControlRuntime *runtime, char *line)
+{
+	char keyword[LINE_LENGTH];
+	char name[LINE_LENGTH];
+	char mode[LINE_LENGTH];
+	char filename[LINE_LENGTH];
+	char extra[2];
+	int sensorIndex, servoIndex, count, channel, sensorMin, sensorMax;
+	float period, deadband, kp, ki, kd, timeout, stuckTime, bandwidth;
+	double a1, a2, b1, b2, c;
+
+	if (sscanf(line, "%s", keyword) != 1)
+		return 0;	// empty line
+
+	if (strcmp(keyword, "period") == 0)
+	{
+		if (sscanf(line, "%*s %f %1s", &period, extra) != 1 || period <= 0.0)
+			return 1;
+		(*runtime).period = sec_to_nano(period);
+	} else if (strcmp(keyword, "deadband") == 0)
+	{
+		if (sscanf(line, "%*s %f %1s", &deadband, extra) != 1 || deadband < 0.0)
+			return 1;
+		(*runtime).deadband = deadband;
+	} else if (strcmp(keyword, "watchdog") == 0)
+	{
+		int fields = sscanf(line, "%*s %f %f %d %d %1s", &timeout, &stuckTime, &sensorMin,
+				&sensorMax, extra);
+		if (fields < 1 || fields == 3 || fields > 4 || timeout < 0.0)
+			return 1;
+		(*runtime).watchdogTimeout = sec_to_nano(timeout / 1000.0);
+		if (fields >= 2)
+		{
+			if (stuckTime < 0.0)
+				return 1;
+			(*runtime).sensorStuckTime = sec_to_nano(stuckTime / 1000.0);
+		}
+		if (fields == 4)
+		{
+			if (sensorMin > sensorMax)
+				return 1;
+			(*runtime).sensorMin = sensorMin;
+			(*runtime).sensorMax = sensorMax;
+		}
+	} else if (strcmp(keyword, "workers") == 0)
+	{
+		if (sscanf(line, "%*s %d %1s", &count, extra) != 1 || count < 1
+				|| count > MAX_WORKERS)
+			return 1;
+		(*runtime).workerCount = count;
+	} else if (strcmp(keyword, "channel") == 0)
+	{
+		int fields = sscanf(line, "%*s %s %d %d %f %f %f %1s", name, &sensorIndex,
+				&servoIndex, &kp, &ki, &kd, extra);
+		if (fields != 3 && fields != 6)
+			return 1;
+		if (add_channel(runtime, name, sensorIndex, servoIndex))
+			return 1;
+		if (fields == 6)
+			pid_set_gains(&(*runtime).channels[(*runtime).channelCount - 1].pid, kp, ki, kd);
+	} else if (strcmp(keyword, "controller") == 0)
+	{
+		if (sscanf(line, "%*s %s %s %1s", name, mode, extra) != 2)
+			return 1;
+		if ((channel = runtime_find_channel(runtime, name)) < 0)
+			return 1;
+		if (strcmp(mode, "pid") == 0)
+			(*runtime).channels[channel].controller = CONTROLLER_PID;
+		else if (strcmp(mode, "mpc") == 0)
+			(*runtime).channels[channel].controller = CONTROLLER_MPC;
+		else
+			return 1;
+	} else if (strcmp(keyword, "model") == 0)
+	{
+		if (sscanf(line, "%*s %s %lf %lf %lf %lf %lf %1s", name, &a1, &a2, &b1, &b2, &c,
+				extra) != 6)
+			return 1;
+		if ((channel = runtime_find_channel(runtime, name)) < 0)
+			return 1;
+
+		PlantModel *model = &(*runtime).channels[channel].model;
+		memset(model, 0, sizeof(*model));
+		(*model).a[0] = a1;
+		(*model).a[1] = a2;
+		(*model).b[0] = b1;
+		(*model).b[1] = b2;
+		(*model).c = c;
+		if (!mpc_model_usable(model))
+		{
+			printf("Model of %s is unstable or has no gain\n", name);
+			return 1;
+		}
+		(*runtime).channels[channel].modelConfigured = true;
+	} else if (strcmp(keyword, "schedule") == 0)
+	{
+		if (sscanf(line, "%*s %s %s %1s", name, filename, extra) != 2)
+			return 1;
+		if ((channel = runtime_find_channel(runtime, name)) < 0)
+			return 1;
+		if (gain_schedule_load(&(*runtime).channels[channel].schedule, filename))
+			return 1;
+	} else if (strcmp(keyword, "calibration") == 0)
+	{
+		if (sscanf(line, "%*s %s %s %1s", name, filename, extra) != 2)
+			return 1;
+		if ((channel = runtime_find_channel(runtime, name)) < 0)
+			return 1;
+		if (calibration_load(&(*runtime).channels[channel].calibration, filename))
+			return 1;
+	} else if (strcmp(keyword, "thrust") == 0)
+	{
+		if (sscanf(line, "%*s %s %s %1s", name, filename, extra) != 2)
+			return 1;
+		if ((channel = runtime_find_channel(runtime, name)) < 0)
+			return 1;
+		if (thrust_map_load(&(*runtime).channels[channel].thrustMap, filename))
+			return 1;
+	} else if (strcmp(keyword, "observer") == 0)
+	{
+		if (sscanf(line, "%*s %s %f %1s", name, &bandwidth, extra) != 2 || bandwidth < 0.0)
+			return 1;
+		if ((channel = runtime_find_channel(runtime, name)) < 0)
+			return 1;
+		(*runtime).channels[channel].observer.bandwidth = bandwidth;	// used once started
+	} else
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: int runtime_load(ControlRuntime *runtime, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Initializes the runtime from a configuration file. If the file does not
+ * 		exist the runtime gets the single default channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime to initialize.
+ * 			const char *filename:		The configuration file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The initialized runtime.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int runtime_load(ControlRuntime *runtime, const char *filename)
+{
+	memset(runtime, 0, sizeof(*runtime));
+	(*runtime).workerCount = 1;
+	(*runtime).period = sec_to_nano(DEFAULT_LOOP_PERIOD);
+	(*runtime).deadband = DEFAULT_ACTUATOR_DEADBAND;
+	(*runtime).watchdogTimeout = sec_to_nano(DEFAULT_WATCHDOG_TIMEOUT);
+	(*runtime).sensorStuckTime = sec_to_nano(DEFAULT_SENSOR_STUCK_TIME);
+	(*runtime).sensorMin = DEFAULT_SENSOR_MIN;
+	(*runtime).sensorMax = DEFAULT_SENSOR_MAX;
+	atomic_store(&(*runtime).running, true);
+
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+		return add_channel(runtime, DEFAULT_CHANNEL_NAME, DEFAULT_SENSOR_INDEX,
+				DEFAULT_SERVO_INDEX);
+
+	char line[LINE_LENGTH];
+	int lineNumber = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		lineNumber++;
+		line[strcspn(line, "#\n")] = '\0';	// strip comments
+		if (parse_line(runtime, line))
+		{
+			printf("%s:%d: invalid setting\n", filename, lineNumber);
+			fclose(fp);
+			return 1;
+		}
+	}
+	fclose(fp);
+
+	if ((*runtime).channelCount == 0)
+	{
+		printf("%s: no channels defined\n", filename);
+		return 1;
+	}
+	if ((*runtime).workerCount > (*runtime).channelCount)
+		(*runtime).workerCount = (*runtime).channelCount;	// idle workers are of no use
+	return 0;
+}
+
+/**************************************************
+ * NAME: int runtime_start(ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Starts every channel from the current position of its boat. Fails if a
+ * 		channel uses a sensor the interface kit does not have.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The started runtime.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int runtime_start(ControlRuntime *runtime)
+{
+	SensorFrame frame;
+	read_frame(&frame);
+
+	for (int c = 0; c < (*runtime).channelCount; c++)
+	{
+		ControlChannel *channel = &(*runtime).channels[c];
+		if ((*channel).sensorIndex >= frame.sensorCount)
+		{
+			printf("Channel %s uses sensor %d, the interface kit has %d\n", (*channel).name,
+					(*channel).sensorIndex, frame.sensorCount);
+			return 1;
+		}
+		channel_start(channel, frame.sensors[(*channel).sensorIndex],
+				nano_to_sec((*runtime).period));
+	}
+
+	(*runtime).startTime = nano_time();
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void *worker_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		The control loop of one worker. Runs the channels assigned to the worker at
+ * 		the period of the runtime until the runtime is stopped: applies commands,
+ * 		takes a frame of all inputs, updates every channel and hands the servo
+ * 		outputs to the actuator. Every iteration is traced, recorded in the metrics,
+ * 		published as telemetry and reported to the watchdog.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	A pointer to the 'Worker' to run.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *worker_func(void *void_ptr)
+{
+	Worker *worker = (Worker*) void_ptr;
+	ControlRuntime *runtime = (*worker).runtime;
+
+	// preallocate the trace buffer before entering the loop
+	char threadName[16];
+	snprintf(threadName, sizeof(threadName), "control-%d", (*worker).index);
+	trace_thread_init(threadName);
+
+	// the channels of this worker
+	int channels[MAX_CHANNELS];
+	int count = 0;
+	for (int c = (*worker).index; c < (*runtime).channelCount; c += (*runtime).workerCount)
+		channels[count++] = c;
+
+	SensorFrame frame;
+	PIDdata outputs[MAX_CHANNELS];
+
+	unsigned long period = (*runtime).period;
+	unsigned long deadline = nano_time();
+	while (atomic_load(&(*runtime).running))
+	{
+		// sleep until the next deadline, skipping deadlines already missed
+		deadline += period;
+		unsigned long now = nano_time();
+		if (now > deadline)
+			deadline += (now - deadline) / period * period;
+		struct timespec wakeup;
+		to_timespec(deadline, &wakeup);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+			;	// interrupted by a signal
+
+		unsigned long tickStart = nano_time();
+
+		for (int i = 0; i < count; i++)
+		{
+			if (!channel_apply_commands(&(*runtime).channels[channels[i]], tickStart))
+				runtime_stop(runtime);
+		}
+
+		// read all inputs at once
+		read_frame(&frame);
+		unsigned long sensorDone = nano_time();
+
+		// calculate new servo values
+		for (int i = 0; i < count; i++)
+		{
+			ControlChannel *channel = &(*runtime).channels[channels[i]];
+			int sensorValue = frame.sensors[(*channel).sensorIndex];
+			watchdog_sensor(channels[i], sensorValue, frame.time);
+			outputs[i] = channel_update(channel, sensorValue, frame.time);
+		}
+		unsigned long pidDone = nano_time();
+
+		// set the new servo values for the thrust wanted, written by the actuator thread
+		for (int i = 0; i < count; i++)
+		{
+			ControlChannel *channel = &(*runtime).channels[channels[i]];
+			actuator_set((*channel).servoIndex,
+					(double) thrust_map_apply(&(*channel).thrustMap, outputs[i].output));
+		}
+		unsigned long servoDone = nano_time();
+
+		// record where the time of this iteration went
+		trace_record(TRACE_SENSOR, tickStart, sensorDone);
+		trace_record(TRACE_PID, sensorDone, pidDone);
+		trace_record(TRACE_SERVO, pidDone, servoDone);
+		trace_record(TRACE_TICK, tickStart, servoDone);
+		watchdog_kick((*worker).index, servoDone);
+
+		float timePassed = nano_to_sec(servoDone - (*runtime).startTime);
+		for (int i = 0; i < count; i++)
+		{
+			ControlChannel *channel = &(*runtime).channels[channels[i]];
+			BoatData *data = &(*channel).data;
+			(*data).timePassed = timePassed;
+			metrics_record_model(channels[i], &(*channel).estimator.published);
+			metrics_record_tick(channels[i], tickStart, (*data).sensorValue,
+					(*data).setpoint, outputs[i]);
+
+			// for other processes, in the units printed
+			TelemetryRecord record = { tickStart, 1000.0 - (*data).sensorValue,
+					1000.0 - (*data).setpoint, 1000.0 - (*data).target,
+					MAX_OUTPUT - outputs[i].output, -outputs[i].Pterm,
+					MAX_OUTPUT - outputs[i].Iterm, -outputs[i].Dterm,
+					1000.0 - (*data).startpoint };
+			telemetry_publish(channels[i], &record);
+		}
+	}
+	return NULL;
+}
+
+/**************************************************
+ * NAME: void runtime_run(ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Runs the control loops until the runtime is stopped. The first worker runs
+ * 		in the calling thread, the others in threads of their own. Turns off all
+ * 		servos before returning.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The started runtime.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void runtime_run(ControlRuntime *runtime)
+{
+	Worker workers[MAX_WORKERS];
+	pthread_t threads[MAX_WORKERS];
+
+	for (int w = 0; w < (*runtime).workerCount; w++)
+	{
+		workers[w].runtime = runtime;
+		workers[w].index = w;
+		if (w > 0)
+			pthread_create(&threads[w], NULL, worker_func, &workers[w]);
+	}
+
+	worker_func(&workers[0]);
+
+	for (int w = 1; w < (*runtime).workerCount; w++)
+		pthread_join(threads[w], NULL);
+
+	// turn off motors
+	for (int c = 0; c < (*runtime).channelCount; c++)
+		actuator_set((*runtime).channels[c].servoIndex, 0.0);
+}
+
+/**************************************************
+ * NAME: void runtime_stop(ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Makes all workers leave their control loops. May be called from any thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void runtime_stop(ControlRuntime *runtime)
+{
+	atomic_store(&(*runtime).running, false);
+}
+
+/**************************************************
+ * NAME: bool runtime_is_running(ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Tells if the runtime has not been stopped yet. May be called from any thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			bool:	true until runtime_stop() is called.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool runtime_is_running(ControlRuntime *runtime)
+{
+	return atomic_load(&(*runtime).running);
+}
+
+/**************************************************
+ * NAME: int runtime_find_channel(ControlRuntime *runtime, const char *name)
+ *
+ * DESCRIPTION:
+ * 		Looks up a channel by its name or its position in the configuration.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime.
+ * 			const char *name:			Name or index of the channel.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	Index of the channel, -1 if there is no such channel.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int runtime_find_channel(ControlRuntime *runtime, const char *name)
+{
+	for (int c = 0; c < (*runtime).channelCount; c++)
+	{
+		if (strcmp((*runtime).channels[c].name, name) == 0)
+			return c;
+	}
+
+	char *end;
+	long index = strtol(name, &end, 10);
+	if (*name != '\0' && *end == '\0' && index >= 0 && index < (*runtime).channelCount)
+		return (int) index;
+	return -1;
+}
@@ -0,0 +1,190 @@
+/**************************************************
+ * FILENAME:	disturbance_observer.c
+ *
+ * DESCRIPTION:
+ * 		A disturbance observer for the PID-controller. Waves, wake and pushes
+ * 		otherwise have to be countered by the integral term, which is slow. The
+ * 		observer inverts the plant model: every iteration the last positions and
+ * 		powers give the power that, added to the commanded power, explains how the
+ * 		boat actually moved. The difference is the disturbance. Taken from the
+ * 		second difference of a noisy position it is very noisy, so it is low-pass
+ * 		filtered with two first order stages at the bandwidth of the observer. The
+ * 		higher the bandwidth the faster the disturbance is cancelled and the more
+ * 		sensor noise reaches the thruster: on the tank about 0.5 Hz cancels waves
+ * 		best, from 1 Hz the noise of the position takes over. Each iteration costs
+ * 		the same few multiplications.
+ *
+ * 		The power applied, not the power wanted, has to be given, so a saturated
+ * 		thruster does not make the estimate run away.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void observer_init(DisturbanceObserver *observer)
+ * 		void observer_start(DisturbanceObserver *observer, float period)
+ * 		void observer_set_bandwidth(DisturbanceObserver *observer, float bandwidth)
+ * 		void observer_reset(DisturbanceObserver *observer)
+ * 		float observer_update(DisturbanceObserver *observer, const PlantModel *model,
+ * 				float position, float lastPower)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "headers/disturbance_observer.h"
+#include "headers/pid_controller.h"
+
+#define MAX_POWER (MAX_OUTPUT - MIN_OUTPUT)
+
+/**************************************************
+ * NAME: void observer_init(DisturbanceObserver *observer)
+ *
+ * DESCRIPTION:
+ * 		Initializes the observer, turned off.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The initialized observer.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void observer_init(DisturbanceObserver *observer)
+{
+	memset(observer, 0, sizeof(*observer));
+}
+
+/**************************************************
+ * NAME: void observer_start(DisturbanceObserver *observer, float period)
+ *
+ * DESCRIPTION:
+ * 		Prepares the observer for a control loop with the given period, keeping
+ * 		its bandwidth.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer.
+ * 			float period:					Seconds between iterations.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer, with no estimate yet.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void observer_start(DisturbanceObserver *observer, float period)
+{
+	(*observer).period = period;
+	observer_set_bandwidth(observer, (*observer).bandwidth);
+	observer_reset(observer);
+}
+
+/**************************************************
+ * NAME: void observer_set_bandwidth(DisturbanceObserver *observer, float bandwidth)
+ *
+ * DESCRIPTION:
+ * 		Sets the bandwidth of the filter, 0 turns the observer off. May be called
+ * 		while running, the estimate continues from where it is.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer.
+ * 			float bandwidth:				Hz, at most a tenth of the loop rate is
+ * 											sensible.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer with the new filter gain.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void observer_set_bandwidth(DisturbanceObserver *observer, float bandwidth)
+{
+	(*observer).bandwidth = bandwidth > 0.0 ? bandwidth : 0.0;
+	(*observer).alpha = 1.0 - exp(-2.0 * M_PI * (*observer).bandwidth * (*observer).period);
+	if ((*observer).bandwidth == 0.0)
+		(*observer).stage = (*observer).estimate = 0.0;
+}
+
+/**************************************************
+ * NAME: void observer_reset(DisturbanceObserver *observer)
+ *
+ * DESCRIPTION:
+ * 		Forgets the positions, powers and the estimate, e.g. when control starts.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer with no estimate.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void observer_reset(DisturbanceObserver *observer)
+{
+	(*observer).samples = 0;
+	(*observer).stage = 0.0;
+	(*observer).estimate = 0.0;
+}
+
+/**************************************************
+ * NAME: float observer_update(DisturbanceObserver *observer, const PlantModel *model,
+ * 				float position, float lastPower)
+ *
+ * DESCRIPTION:
+ * 		Updates the estimate with the position of this iteration. With the model
+ * 		y[k] = a1 y[k-1] + a2 y[k-2] + b1 (u[k-1] + d) + b2 (u[k-2] + d) + c the
+ * 		disturbance d held over the last two iterations is
+ * 		(y[k] - a1 y[k-1] - a2 y[k-2] - c - b1 u[k-1] - b2 u[k-2]) / (b1 + b2).
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The observer.
+ * 			const PlantModel *model:		The plant model.
+ * 			float position:					Printed position of this iteration.
+ * 			float lastPower:				Power applied since the previous iteration.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			DisturbanceObserver *observer:	The updated observer.
+ * 		RETURN:
+ * 			float:	The disturbance as power pushing the boat forward, subtract it
+ * 					from the power to cancel it. 0 while off or not settled.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+float observer_update(DisturbanceObserver *observer, const PlantModel *model,
+		float position, float lastPower)
+{
+	double *y = (*observer).y, *u = (*observer).u;
+	y[2] = y[1];
+	y[1] = y[0];
+	y[0] = position - (*model).origin;
+	u[1] = u[0];
+	u[0] = lastPower;
+
+	double gain = (*model).b[0] + (*model).b[1];
+	if ((*observer).bandwidth == 0.0 || gain <= 0.0)
+		return 0.0;
+	if (++(*observer).samples < PLANT_ORDER + 1)
+		return 0.0;	// not yet positions and powers enough
+
+	double disturbance = (y[0] - (*model).a[0] * y[1] - (*model).a[1] * y[2] - (*model).c
+			- (*model).b[0] * u[0] - (*model).b[1] * u[1]) / gain;
+
+	double alpha = (*observer).alpha;
+	(*observer).stage += alpha * (disturbance - (*observer).stage);
+	(*observer).estimate += alpha * ((*observer).stage - (*observer).estimate);
+
+	// no more than the thruster can cancel, so the estimate recovers quickly
+	if ((*observer).estimate > MAX_POWER)
+		(*observer).estimate = MAX_POWER;
+	else if ((*observer).estimate < -MAX_POWER)
+		(*observer).estimate = -MAX_POWER;
+	return (*observer).estimate;
+}
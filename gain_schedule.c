@@ -0,0 +1,472 @@
+/**************************************************
+ * FILENAME:	gain_schedule.c
+ *
+ * DESCRIPTION:
+ * 		Gain scheduling for the PID-controller. A table file gives the gains at
+ * 		breakpoints along one or two axes, the position in the tank, the speed of
+ * 		the reference or the distance left to the target. Every iteration finds
+ * 		the breakpoints around the current state and interpolates the gains
+ * 		bilinearly between them, so the gains at the breakpoints are exactly those
+ * 		of the file.
+ *
+ * 		The table file holds, '#' starting a comment:
+ * 			axis <position|velocity|distance> <breakpoint> [<breakpoint> ...]
+ * 			[axis <position|velocity|distance> <breakpoint> [<breakpoint> ...]]
+ * 			<Kp> <Ki> <Kd>		one line per combination of breakpoints, the
+ * 								breakpoints of the last axis varying fastest
+ * 		Breakpoints must increase, outside of them the gains of the nearest one
+ * 		are used.
+ *
+ * 		The reloader thread checks the loaded files every RELOAD_INTERVAL and
+ * 		loads them again when they have changed, without stopping the control
+ * 		loop. A new table is published through a sequence lock, the control loop
+ * 		never waits for it. A file that cannot be loaded leaves the old table in use.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int gain_schedule_load(GainSchedule *schedule, const char *filename)
+ * 		bool gain_schedule_lookup(GainSchedule *schedule, float position,
+ * 				float velocity, float distance, float gains[3])
+ * 		int gain_schedule_start_reloader(void)
+ * 		void gain_schedule_stop_reloader(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "headers/gain_schedule.h"
+#include "headers/seqlock.h"
+
+#define MAX_SCHEDULES 8
+#define LINE_LENGTH 256
+#define GAIN_COUNT (GAIN_MAX_BREAKPOINTS * GAIN_MAX_BREAKPOINTS)
+#define SEPARATORS " \t"
+
+static const struct timespec RELOAD_INTERVAL = { 1, 0 };	// 1 second
+
+static const char *AXIS_NAMES[] = { "position", "velocity", "distance" };
+
+// schedules loaded from a file, checked by the reloader
+static GainSchedule *schedules[MAX_SCHEDULES];
+static int scheduleCount;
+
+static pthread_t reloaderThread;
+static atomic_bool reloaderRunning;
+
+/**************************************************
+ * NAME: static int parse_axis(GainTable *file, char *arguments)
+ *
+ * DESCRIPTION:
+ * 		Parses the name and the breakpoints of an axis.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			GainTable *file:	The table read so far.
+ * 			char *arguments:	The line after the 'axis' keyword, modified.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			GainTable *file:	The table with the axis added.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int parse_axis(GainTable *file, char *arguments)
+{
+	if ((*file).axisCount >= GAIN_MAX_AXES || (*file).gainCount > 0)
+		return 1;	// too many axes, or after the gains
+
+	int a = (*file).axisCount;
+	char *rest;
+	char *token = strtok_r(arguments, SEPARATORS, &rest);
+	if (!token)
+		return 1;
+
+	int axis = -1;
+	for (unsigned int i = 0; i < sizeof(AXIS_NAMES) / sizeof(AXIS_NAMES[0]); i++)
+	{
+		if (strcmp(token, AXIS_NAMES[i]) == 0)
+			axis = i;
+	}
+	if (axis < 0)
+		return 1;
+	(*file).axes[a] = (ScheduleAxis) axis;
+
+	int count = 0;
+	while ((token = strtok_r(NULL, SEPARATORS, &rest)))
+	{
+		char *end;
+		float value = strtof(token, &end);
+		if (*end != '\0' || count >= GAIN_MAX_BREAKPOINTS)
+			return 1;
+		if (count > 0 && value <= (*file).breakpoints[a][count - 1])
+			return 1;	// must increase
+		(*file).breakpoints[a][count++] = value;
+	}
+	if (count == 0)
+		return 1;
+
+	(*file).breakpointCount[a] = count;
+	(*file).axisCount++;
+	return 0;
+}
+
+/**************************************************
+ * NAME: static int read_table(GainTable *file, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Reads and checks a table file.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *filename:	The file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			GainTable *file:	The table.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int read_table(GainTable *file, const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+	{
+		printf("can't open file: %s\n", filename);
+		return 1;
+	}
+
+	memset(file, 0, sizeof(*file));
+	char line[LINE_LENGTH];
+	int lineNumber = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		lineNumber++;
+		line[strcspn(line, "#\n")] = '\0';	// strip comments
+
+		char keyword[LINE_LENGTH];
+		char extra[2];
+		float *gains = (*file).gains[(*file).gainCount];
+		int invalid = 0;
+
+		if (sscanf(line, "%s", keyword) != 1)
+			continue;	// empty line
+
+		if (strcmp(keyword, "axis") == 0)
+			invalid = parse_axis(file, line + strspn(line, " \t") + strlen(keyword));
+		else if ((*file).gainCount >= GAIN_COUNT
+				|| sscanf(line, "%f %f %f %1s", &gains[0], &gains[1], &gains[2], extra) != 3
+				|| gains[0] < 0.0 || gains[1] < 0.0 || gains[2] < 0.0)
+			invalid = 1;
+		else
+			(*file).gainCount++;
+
+		if (invalid)
+		{
+			printf("%s:%d: invalid line\n", filename, lineNumber);
+			fclose(fp);
+			return 1;
+		}
+	}
+	fclose(fp);
+
+	int expected = 1;
+	for (int a = 0; a < (*file).axisCount; a++)
+		expected *= (*file).breakpointCount[a];
+	if ((*file).axisCount == 0 || (*file).gainCount != expected)
+	{
+		printf("%s: expected an axis and %d lines of gains\n", filename, expected);
+		return 1;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void locate(const float breakpoints[], int count, float value,
+ * 				int *index, float *fraction)
+ *
+ * DESCRIPTION:
+ * 		Finds the breakpoints surrounding a value.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const float breakpoints[]:	Increasing breakpoints.
+ * 			int count:					Number of breakpoints.
+ * 			float value:				The value.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			int *index:			The breakpoint at or below the value.
+ * 			float *fraction:	Where the value lies towards the next breakpoint, 0..1.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void locate(const float breakpoints[], int count, float value, int *index,
+		float *fraction)
+{
+	*index = 0;
+	*fraction = 0.0;
+	if (count < 2 || value <= breakpoints[0])
+		return;
+	if (value >= breakpoints[count - 1])
+	{
+		*index = count - 2;
+		*fraction = 1.0;
+		return;
+	}
+
+	int k = 0;
+	while (value >= breakpoints[k + 1])
+		k++;
+	*index = k;
+	*fraction = (value - breakpoints[k]) / (breakpoints[k + 1] - breakpoints[k]);
+}
+
+/**************************************************
+ * NAME: static int load(GainSchedule *schedule)
+ *
+ * DESCRIPTION:
+ * 		Loads the file of a schedule and publishes the table. The schedule is
+ * 		enabled if successful.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			GainSchedule *schedule:	The schedule with the name of its file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			GainSchedule *schedule:	The schedule with the new table.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int load(GainSchedule *schedule)
+{
+	static GainTable file;		// only used by one thread at a time
+
+	struct stat status;
+	if (stat((*schedule).filename, &status) < 0)
+	{
+		perror((*schedule).filename);
+		return 1;
+	}
+	(*schedule).modified = status.st_mtim;
+
+	if (read_table(&file, (*schedule).filename))
+		return 1;
+
+	seqlock_publish(&(*schedule).sequence, &(*schedule).table, &file, sizeof(file));
+	atomic_store(&(*schedule).enabled, true);
+	return 0;
+}
+
+/**************************************************
+ * NAME: int gain_schedule_load(GainSchedule *schedule, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Loads a table file into a schedule and enables it. The file is watched
+ * 		for changes by the reloader. Must be called before the reloader is started.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			GainSchedule *schedule:	The schedule.
+ * 			const char *filename:	The table file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			GainSchedule *schedule:	The loaded schedule.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int gain_schedule_load(GainSchedule *schedule, const char *filename)
+{
+	if (strlen(filename) >= GAIN_FILENAME_LENGTH)
+	{
+		printf("Gain schedule file name too long: %s\n", filename);
+		return 1;
+	}
+	strcpy((*schedule).filename, filename);
+
+	if (load(schedule))
+		return 1;
+
+	for (int s = 0; s < scheduleCount; s++)
+	{
+		if (schedules[s] == schedule)
+			return 0;	// already watched
+	}
+	if (scheduleCount >= MAX_SCHEDULES)
+	{
+		printf("Too many gain schedules, not reloading %s\n", filename);
+		return 0;
+	}
+	schedules[scheduleCount++] = schedule;
+	return 0;
+}
+
+/**************************************************
+ * NAME: bool gain_schedule_lookup(GainSchedule *schedule, float position,
+ * 				float velocity, float distance, float gains[3])
+ *
+ * DESCRIPTION:
+ * 		Interpolates the gains at the current state between the breakpoints of a
+ * 		copy of the table, copied again if a new one was published in the meantime.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			GainSchedule *schedule:	The schedule.
+ * 			float position:			Distance into the tank from the start.
+ * 			float velocity:			Velocity of the reference.
+ * 			float distance:			Distance from the reference to the target.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float gains[3]:	Kp, Ki and Kd.
+ * 		RETURN:
+ * 			bool:	false if the schedule is not enabled, the gains are not set.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool gain_schedule_lookup(GainSchedule *schedule, float position, float velocity,
+		float distance, float gains[3])
+{
+	if (!atomic_load_explicit(&(*schedule).enabled, memory_order_relaxed))
+		return false;
+
+	float values[3];
+	values[SCHEDULE_POSITION] = position;
+	values[SCHEDULE_VELOCITY] = velocity < 0.0 ? -velocity : velocity;
+	values[SCHEDULE_DISTANCE] = distance < 0.0 ? -distance : distance;
+
+	GainTable table;
+	seqlock_read(&(*schedule).sequence, &(*schedule).table, &table, sizeof(table));
+
+	// breakpoints around the state and position between them along both axes
+	int index[GAIN_MAX_AXES] = { 0, 0 };
+	int next[GAIN_MAX_AXES] = { 0, 0 };
+	float fraction[GAIN_MAX_AXES] = { 0.0, 0.0 };
+	int counts[GAIN_MAX_AXES] = { 1, 1 };
+	for (int a = 0; a < table.axisCount; a++)
+	{
+		counts[a] = table.breakpointCount[a];
+		locate(table.breakpoints[a], counts[a], values[table.axes[a]], &index[a],
+				&fraction[a]);
+		next[a] = counts[a] > 1 ? index[a] + 1 : index[a];
+	}
+
+	for (int g = 0; g < 3; g++)
+	{
+		float low = (1.0 - fraction[1]) * table.gains[index[0] * counts[1] + index[1]][g]
+				+ fraction[1] * table.gains[index[0] * counts[1] + next[1]][g];
+		float high = (1.0 - fraction[1]) * table.gains[next[0] * counts[1] + index[1]][g]
+				+ fraction[1] * table.gains[next[0] * counts[1] + next[1]][g];
+		gains[g] = (1.0 - fraction[0]) * low + fraction[0] * high;
+	}
+	return true;
+}
+
+/**************************************************
+ * NAME: static void *reloader_func(void *ptr)
+ *
+ * DESCRIPTION:
+ * 		Loads the table files again when they have been modified, until the
+ * 		reloader is stopped.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *ptr:	Not used.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			void *:	NULL
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *reloader_func(void *ptr)
+{
+	while (atomic_load(&reloaderRunning))
+	{
+		nanosleep(&RELOAD_INTERVAL, NULL);
+
+		for (int s = 0; s < scheduleCount; s++)
+		{
+			GainSchedule *schedule = schedules[s];
+			struct stat status;
+			if (stat((*schedule).filename, &status) < 0)
+				continue;	// may be in the middle of being replaced
+			if (status.st_mtim.tv_sec == (*schedule).modified.tv_sec
+					&& status.st_mtim.tv_nsec == (*schedule).modified.tv_nsec)
+				continue;
+
+			if (load(schedule))
+				printf("Keeping the previous gain schedule of %s\n", (*schedule).filename);
+			else
+				printf("Gain schedule %s reloaded\n", (*schedule).filename);
+		}
+	}
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int gain_schedule_start_reloader(void)
+ *
+ * DESCRIPTION:
+ * 		Starts the thread reloading modified table files. Does nothing if no
+ * 		schedule has been loaded.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int gain_schedule_start_reloader(void)
+{
+	if (scheduleCount == 0)
+		return 0;
+
+	atomic_store(&reloaderRunning, true);
+	if (pthread_create(&reloaderThread, NULL, reloader_func, NULL) != 0)
+	{
+		printf("Could not start the gain schedule reloader\n");
+		atomic_store(&reloaderRunning, false);
+		return 1;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: void gain_schedule_stop_reloader(void)
+ *
+ * DESCRIPTION:
+ * 		Stops the reloader thread.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void gain_schedule_stop_reloader(void)
+{
+	if (!atomic_load(&reloaderRunning))
+		return;
+
+	atomic_store(&reloaderRunning, false);
+	pthread_join(reloaderThread, NULL);
+}
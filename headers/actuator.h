@@ -0,0 +1,22 @@
+#ifndef HEADERS_ACTUATOR_H_
+#define HEADERS_ACTUATOR_H_
+
+#define ACTUATOR_MAX_SERVOS 8
+
+#define DEFAULT_ACTUATOR_DEADBAND 0.01	// servo position units
+
+typedef struct
+{
+	unsigned long requested;	// positions handed to actuator_set()
+	unsigned long written;		// positions written to the servo
+	unsigned long deadband;		// positions not written for being too close to the last
+} ActuatorStatistics;
+
+int actuator_start(double deadband);
+void actuator_set(int index, double position);
+void actuator_statistics(int index, ActuatorStatistics *statistics);
+void actuator_safe(void);
+int actuator_busy_since(unsigned long *start);
+void actuator_stop(void);
+
+#endif /* HEADERS_ACTUATOR_H_ */
@@ -0,0 +1,73 @@
+#ifndef HEADERS_ARCHIVE_H_
+#define HEADERS_ARCHIVE_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Values of a row, in the same units as printed: position, power, setpoint,
+ * P-term, I-term and D-term. */
+#define ARCHIVE_VALUES 6
+#define ARCHIVE_COLUMNS (ARCHIVE_VALUES + 1)	// with the time
+#define ARCHIVE_BLOCK_ROWS 1024
+#define ARCHIVE_FLUSH_TIME 5000000	// microseconds of rows after which a block is written
+
+// worst case of the compressed columns: a varint per time, 44 bits per value
+#define ARCHIVE_PAYLOAD_SIZE (ARCHIVE_BLOCK_ROWS * (10 + ARCHIVE_VALUES * 6) + 64)
+
+typedef struct
+{
+	int64_t time;	// microseconds since the Unix epoch
+	float values[ARCHIVE_VALUES];
+} ArchiveRow;
+
+// appends rows to an archive, one block of up to ARCHIVE_BLOCK_ROWS at a time
+typedef struct
+{
+	int fd;
+	int count;	// rows waiting for the next block
+	ArchiveRow rows[ARCHIVE_BLOCK_ROWS];
+
+	// a block is encoded in one buffer while the other is written by the writer thread
+	unsigned char blocks[2][ARCHIVE_PAYLOAD_SIZE];
+	int active;			// the buffer encoded into next
+	size_t pending;		// bytes of the other buffer not yet written, guarded by lock
+	bool failed;		// a block could not be written, guarded by lock
+	bool stopping;		// guarded by lock
+	bool running;		// the writer thread was started
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} ArchiveWriter;
+
+// where a block is and which time it covers
+typedef struct
+{
+	int64_t firstTime;
+	int64_t lastTime;
+	size_t offset;
+	int rows;
+} ArchiveBlock;
+
+typedef struct
+{
+	const unsigned char *data;	// the mapped file
+	size_t size;
+	ArchiveBlock *blocks;
+	int blockCount;
+	int sorted;		// blocks follow each other in time, so they can be bisected
+	ArchiveRow *decoded;	// rows of the block being read
+} ArchiveReader;
+
+int archive_open(ArchiveWriter *writer, const char *filename);
+int archive_append(ArchiveWriter *writer, const ArchiveRow *row);
+int archive_flush(ArchiveWriter *writer);
+void archive_close(ArchiveWriter *writer);
+
+int archive_reader_open(ArchiveReader *reader, const char *filename);
+long archive_read_range(ArchiveReader *reader, int64_t from, int64_t to, ArchiveRow rows[],
+		long max);
+void archive_reader_close(ArchiveReader *reader);
+
+#endif /* HEADERS_ARCHIVE_H_ */
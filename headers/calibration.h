@@ -0,0 +1,25 @@
+#ifndef HEADERS_CALIBRATION_H_
+#define HEADERS_CALIBRATION_H_
+
+#include <stdbool.h>
+
+#define CALIBRATION_FILE_FORMAT "calibration_%s.txt"	// per channel name
+#define CALIBRATION_FILENAME_LENGTH 128
+#define CALIBRATION_MAX_POINTS 64
+#define CALIBRATION_TABLE_SIZE 1001		// one entry per reading of an analog input (0-1000)
+
+// the reading a linear sensor would give, for every reading of the sensor
+typedef struct
+{
+	bool loaded;
+	char filename[CALIBRATION_FILENAME_LENGTH];
+	float table[CALIBRATION_TABLE_SIZE];
+} SensorCalibration;
+
+int calibration_fit(const float readings[], const float positions[], int count,
+		float table[CALIBRATION_TABLE_SIZE], float *scale);
+int calibration_record(const char *channelName, int sensorIndex);
+int calibration_load(SensorCalibration *calibration, const char *filename);
+float calibration_apply(const SensorCalibration *calibration, float reading);
+
+#endif /* HEADERS_CALIBRATION_H_ */
@@ -0,0 +1,44 @@
+#ifndef HEADERS_COMMAND_QUEUE_H_
+#define HEADERS_COMMAND_QUEUE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define COMMAND_QUEUE_SIZE 64	// must be a power of two
+
+// positions are given in the same units as printed, i.e. 1000 - sensor value
+typedef enum
+{
+	COMMAND_SETPOINT,	// values[0]: position, cancels pending waypoints
+	COMMAND_MOVE,		// values[0]: change of position
+	COMMAND_WAYPOINT,	// values[0]: delay after previous waypoint [s], values[1]: position,
+						// values[2]: non-zero to cancel pending waypoints first
+	COMMAND_GAINS,		// values[0..2]: Kp, Ki, Kd
+	COMMAND_ANTI_WINDUP,	// values[0]: AntiWindupMode, values[1]: tracking time [s]
+	COMMAND_FEED_FORWARD,	// values[0..1]: velocity and acceleration gain
+	COMMAND_OBSERVER,	// values[0]: bandwidth of the disturbance observer [Hz]
+	COMMAND_CONTROLLER,	// values[0]: ControllerMode
+	COMMAND_START,
+	COMMAND_STOP,
+	COMMAND_QUIT
+} CommandType;
+
+typedef struct
+{
+	CommandType type;
+	float values[3];
+} Command;
+
+// lock-free queue for exactly one producer thread and one consumer thread
+typedef struct
+{
+	Command commands[COMMAND_QUEUE_SIZE];
+	atomic_uint head;	// next command to pop, written by the consumer
+	atomic_uint tail;	// next free slot, written by the producer
+} CommandQueue;
+
+bool command_queue_push(CommandQueue *queue, Command command);
+bool command_queue_pop(CommandQueue *queue, Command *command);
+unsigned int command_queue_free(CommandQueue *queue);
+
+#endif /* HEADERS_COMMAND_QUEUE_H_ */
@@ -0,0 +1,11 @@
+#ifndef HEADERS_COMMAND_SERVER_H_
+#define HEADERS_COMMAND_SERVER_H_
+
+#include "control_runtime.h"
+
+#define COMMAND_SOCKET_PATH "/tmp/dynamic_positioning.command"
+
+int command_server_start(const char *socketPath, ControlRuntime *runtime);
+void command_server_stop(void);
+
+#endif /* HEADERS_COMMAND_SERVER_H_ */
@@ -0,0 +1,72 @@
+#ifndef HEADERS_CONTROL_CHANNEL_H_
+#define HEADERS_CONTROL_CHANNEL_H_
+
+#include <stdbool.h>
+#include "calibration.h"
+#include "command_queue.h"
+#include "disturbance_observer.h"
+#include "gain_schedule.h"
+#include "main.h"
+#include "mpc_controller.h"
+#include "pid_controller.h"
+#include "plant_estimator.h"
+#include "responsive_analog_read.h"
+#include "step_analytics.h"
+#include "thrust_map.h"
+#include "trajectory.h"
+
+#define CHANNEL_NAME_LENGTH 16
+
+typedef enum
+{
+	CONTROLLER_PID,
+	CONTROLLER_MPC
+} ControllerMode;
+
+// waypoints received in trajectory commands, waiting for their time
+typedef struct
+{
+	unsigned long time;
+	float target;
+} Waypoint;
+
+// one controlled axis: a sensor, a servo and everything needed to control it
+typedef struct
+{
+	char name[CHANNEL_NAME_LENGTH];
+	int sensorIndex;
+	int servoIndex;
+
+	SensorCalibration calibration;	// linearizes the sensor before the filter
+	ResponsiveAnalogRead filter;
+	ControllerMode controller;	// which of the controllers computes the output
+	PIDController pid;
+	GainSchedule schedule;		// gains of the PID-controller depending on the state
+	DisturbanceObserver observer;	// cancels forces on the boat for the PID-controller
+	MPCController mpc;
+	Trajectory trajectory;
+	PlantEstimator estimator;	// model of the boat identified while running
+	PlantModel model;			// model used by the MPC until one has been identified
+	ThrustMap thrustMap;		// servo position for the thrust the output stands for
+	StepAnalytics analytics;	// how the boat answers changes of the target
+	bool modelConfigured;		// use the model even when one has been identified
+	bool identifiedModel;		// the MPC predicts with the identified model
+	int modelHeld;				// iterations since the MPC last changed models
+
+	Waypoint waypoints[COMMAND_QUEUE_SIZE];
+	int waypointCount;	// number of waypoints in the array
+	int nextWaypoint;	// index of the first waypoint not yet reached
+
+	// filled by the command server, the thread running the channel is the consumer
+	CommandQueue socketCommands;
+
+	BoatData data;	// always updated values, read by the printer and the visualization
+} ControlChannel;
+
+void channel_init(ControlChannel *channel, const char *name, int sensorIndex,
+		int servoIndex);
+void channel_start(ControlChannel *channel, int sensorValue, float period);
+bool channel_apply_commands(ControlChannel *channel, unsigned long now);
+PIDdata channel_update(ControlChannel *channel, int sensorValue, unsigned long now);
+
+#endif /* HEADERS_CONTROL_CHANNEL_H_ */
@@ -0,0 +1,38 @@
+#ifndef HEADERS_CONTROL_RUNTIME_H_
+#define HEADERS_CONTROL_RUNTIME_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "control_channel.h"
+
+#define CHANNELS_CONFIG "channels.conf"
+
+#define MAX_CHANNELS 8
+#define MAX_WORKERS 4
+
+#define DEFAULT_LOOP_PERIOD 0.02	// seconds
+
+// the control channels and the threads running them at a fixed rate
+typedef struct
+{
+	ControlChannel channels[MAX_CHANNELS];
+	int channelCount;
+	int workerCount;				// channels are spread round-robin over the workers
+	unsigned long period;			// nanoseconds between iterations
+	unsigned long startTime;		// from nano_time(), when the channels were started
+	double deadband;				// smallest change of a servo position written
+	unsigned long watchdogTimeout;	// nanoseconds an iteration may be late, 0 disables
+	unsigned long sensorStuckTime;	// nanoseconds a reading may stay the same, 0 disables
+	int sensorMin;					// readings outside are a broken sensor
+	int sensorMax;
+	atomic_bool running;
+} ControlRuntime;
+
+int runtime_load(ControlRuntime *runtime, const char *filename);
+int runtime_start(ControlRuntime *runtime);
+void runtime_run(ControlRuntime *runtime);
+void runtime_stop(ControlRuntime *runtime);
+bool runtime_is_running(ControlRuntime *runtime);
+int runtime_find_channel(ControlRuntime *runtime, const char *name);
+
+#endif /* HEADERS_CONTROL_RUNTIME_H_ */
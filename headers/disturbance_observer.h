@@ -0,0 +1,31 @@
+#ifndef HEADERS_DISTURBANCE_OBSERVER_H_
+#define HEADERS_DISTURBANCE_OBSERVER_H_
+
+#include <stdbool.h>
+#include "plant_estimator.h"
+
+/* Estimates the force on the boat the commanded power does not explain, from the
+ * plant model, as the power that would cancel it. Positions and powers are in the
+ * units of the plant model. */
+typedef struct
+{
+	float bandwidth;	// Hz, 0 when off
+	float period;		// seconds between iterations
+	double alpha;		// gain of each of the two filter stages per iteration
+
+	// state
+	double y[PLANT_ORDER + 1];	// latest positions, newest first
+	double u[PLANT_ORDER];		// latest powers applied, newest first
+	int samples;				// positions seen since started
+	double stage;				// output of the first filter stage
+	double estimate;			// the disturbance, as power
+} DisturbanceObserver;
+
+void observer_init(DisturbanceObserver *observer);
+void observer_start(DisturbanceObserver *observer, float period);
+void observer_set_bandwidth(DisturbanceObserver *observer, float bandwidth);
+void observer_reset(DisturbanceObserver *observer);
+float observer_update(DisturbanceObserver *observer, const PlantModel *model,
+		float position, float lastPower);
+
+#endif /* HEADERS_DISTURBANCE_OBSERVER_H_ */
@@ -0,0 +1,49 @@
+#ifndef HEADERS_GAIN_SCHEDULE_H_
+#define HEADERS_GAIN_SCHEDULE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define GAIN_MAX_AXES 2
+#define GAIN_MAX_BREAKPOINTS 16
+#define GAIN_FILENAME_LENGTH 128
+
+// what the gains are scheduled on
+typedef enum
+{
+	SCHEDULE_POSITION,	// distance into the tank from the start, 0..TANK_WIDTH
+	SCHEDULE_VELOCITY,	// speed of the reference
+	SCHEDULE_DISTANCE	// distance left from the reference to the target
+} ScheduleAxis;
+
+// the table as written in the file
+typedef struct
+{
+	int axisCount;
+	ScheduleAxis axes[GAIN_MAX_AXES];
+	int breakpointCount[GAIN_MAX_AXES];
+	float breakpoints[GAIN_MAX_AXES][GAIN_MAX_BREAKPOINTS];
+	int gainCount;
+	float gains[GAIN_MAX_BREAKPOINTS * GAIN_MAX_BREAKPOINTS][3];	// Kp, Ki, Kd
+} GainTable;
+
+typedef struct
+{
+	char filename[GAIN_FILENAME_LENGTH];
+	struct timespec modified;	// of the file loaded last, used by the reloader only
+	atomic_bool enabled;
+
+	// published table, guarded by a sequence lock with the loader as the only writer
+	GainTable table;
+	_Atomic uint64_t sequence;
+} GainSchedule;
+
+int gain_schedule_load(GainSchedule *schedule, const char *filename);
+bool gain_schedule_lookup(GainSchedule *schedule, float position, float velocity,
+		float distance, float gains[3]);
+int gain_schedule_start_reloader(void);
+void gain_schedule_stop_reloader(void);
+
+#endif /* HEADERS_GAIN_SCHEDULE_H_ */
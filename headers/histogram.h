@@ -0,0 +1,25 @@
+#ifndef HEADERS_HISTOGRAM_H_
+#define HEADERS_HISTOGRAM_H_
+
+// values are recorded with a relative precision of 2 / HISTOGRAM_SUB_BUCKETS
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_SHIFT 40
+#define HISTOGRAM_BUCKETS (HISTOGRAM_MAX_SHIFT * HISTOGRAM_SUB_BUCKETS / 2 + HISTOGRAM_SUB_BUCKETS)
+
+typedef struct
+{
+	unsigned long count;
+	unsigned long min;
+	unsigned long max;
+	double sum;
+	unsigned int buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+void histogram_reset(Histogram *hist);
+void histogram_record(Histogram *hist, unsigned long value);
+void histogram_merge(Histogram *dest, const Histogram *src);
+unsigned long histogram_percentile(const Histogram *hist, double percentile);
+double histogram_mean(const Histogram *hist);
+
+#endif /* HEADERS_HISTOGRAM_H_ */
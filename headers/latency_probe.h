@@ -0,0 +1,11 @@
+#ifndef HEADERS_LATENCY_PROBE_H_
+#define HEADERS_LATENCY_PROBE_H_
+
+#include "control_runtime.h"
+
+#define LATENCY_FILE_FORMAT "latency_%s.txt"	// per channel name
+
+int latency_probe(ControlRuntime *runtime, int channel);
+int latency_load(const char *channelName, float *delay);
+
+#endif /* HEADERS_LATENCY_PROBE_H_ */
@@ -11,9 +11,10 @@ typedef struct
 	float servoValue;
 	float sensorValue;
 	float setpoint;
+	float target;
 	float timePassed;
 	float startpoint;
-	_Bool programRunning;
+	_Bool controlActive;
 	PIDdata pid;
 } BoatData;
 
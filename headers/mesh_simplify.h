@@ -0,0 +1,8 @@
+#ifndef HEADERS_MESH_SIMPLIFY_H_
+#define HEADERS_MESH_SIMPLIFY_H_
+
+#include "obj_loader.h"
+
+int mesh_simplify(const Mesh *mesh, int resolution, Mesh *simplified, float *cellSize);
+
+#endif /* HEADERS_MESH_SIMPLIFY_H_ */
@@ -0,0 +1,19 @@
+#ifndef HEADERS_METRICS_H_
+#define HEADERS_METRICS_H_
+
+#include "pid_controller.h"
+#include "plant_estimator.h"
+
+#define METRICS_SOCKET_PATH "/tmp/dynamic_positioning.metrics"
+
+#define METRICS_MAX_CHANNELS 8
+
+int metrics_start_server(const char *socketPath, float loopPeriod,
+		const char *channelNames[], int count);
+void metrics_stop_server(void);
+void metrics_record_tick(int channel, unsigned long tickStart, float sensorValue,
+		float setpoint, PIDdata pid);
+void metrics_record_model(int channel, const PlantModel *model);
+void metrics_record_logged(int channel);
+
+#endif /* HEADERS_METRICS_H_ */
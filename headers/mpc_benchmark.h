@@ -0,0 +1,6 @@
+#ifndef HEADERS_MPC_BENCHMARK_H_
+#define HEADERS_MPC_BENCHMARK_H_
+
+int mpc_benchmark(float period, float delay);
+
+#endif /* HEADERS_MPC_BENCHMARK_H_ */
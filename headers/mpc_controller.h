@@ -0,0 +1,45 @@
+#ifndef HEADERS_MPC_CONTROLLER_H_
+#define HEADERS_MPC_CONTROLLER_H_
+
+#include <stdbool.h>
+#include "pid_controller.h"
+#include "plant_estimator.h"
+#include "trajectory.h"
+
+/* The position is predicted MPC_HORIZON iterations ahead. The power is held
+ * constant for MPC_BLOCK iterations at a time, giving MPC_MOVES free moves. */
+#define MPC_HORIZON 50
+#define MPC_BLOCK 5
+#define MPC_MOVES (MPC_HORIZON / MPC_BLOCK)
+
+// weights, options and state of one model predictive controller
+typedef struct
+{
+	float period;			// seconds between iterations
+	float moveWeight;		// cost of a change of power relative to the position error
+	int maxIterations;		// bound on the iterations of the solver
+
+	// the quadratic program, rebuilt every iteration, preallocated
+	double hessian[MPC_MOVES][MPC_MOVES];
+	double gradient[MPC_MOVES];
+	double solution[MPC_MOVES];	// powers of the last solution, warm start of the next
+	double lipschitz;			// largest eigenvalue bound of the hessian
+
+	// state, positions are printed positions, not relative to the origin of a model
+	bool started;
+	PlantModel model;		// the model of the previous iteration
+	double lastPosition;	// position of the previous iteration
+	double lastPower;		// power applied in the previous iteration
+	double predicted;		// position predicted for this iteration
+	double disturbance;		// estimated constant force not explained by the model
+	int iterations;			// iterations of the last solve
+} MPCController;
+
+void mpc_init(MPCController *mpc, float period);
+void mpc_default_model(PlantModel *model, float period);
+bool mpc_model_usable(const PlantModel *model);
+void mpc_reset(MPCController *mpc, float output);
+PIDdata mpc_compute(MPCController *mpc, const PlantModel *model, float input,
+		const Trajectory *trajectory, unsigned long now);
+
+#endif /* HEADERS_MPC_CONTROLLER_H_ */
@@ -1,6 +1,21 @@
 #ifndef HEADERS_OBJ_LOADER_H_
 #define HEADERS_OBJ_LOADER_H_
 
-GLuint load_obj(char fname[]);
+// a corner of a triangle
+typedef struct
+{
+	float position[3];
+	float normal[3];
+} MeshVertex;
+
+// triangles of three vertices each, ready to be copied to a vertex buffer
+typedef struct
+{
+	MeshVertex *vertices;
+	int vertexCount;
+} Mesh;
+
+int load_obj(const char *filename, Mesh *mesh);
+void free_mesh(Mesh *mesh);
 
 #endif /* HEADERS_OBJ_LOADER_H_ */
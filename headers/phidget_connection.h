@@ -1,9 +1,31 @@
 #ifndef HEADERS_PHIDGET_CONNECTION_H_
 #define HEADERS_PHIDGET_CONNECTION_H_
 
+#include <stdbool.h>
+
+#define PHIDGET_MAX_SENSORS 8
+#define PHIDGET_MAX_INPUTS 16
+
+#define ATTACH_TIMEOUT 10000	// milliseconds to wait for a device
+
+// all inputs of the interface kit at one point in time
+typedef struct
+{
+	unsigned long time;		// when the frame was taken, from nano_time()
+	unsigned long updated;	// when an input last changed, from nano_time()
+	int sensorCount;
+	int inputCount;
+	int sensors[PHIDGET_MAX_SENSORS];	// analog inputs (0-1000)
+	bool inputs[PHIDGET_MAX_INPUTS];	// digital inputs
+} SensorFrame;
+
+void open_phidgets(void);
+int wait_for_interface_kit(void);
+int wait_for_servo(void);
 int connect_phidgets(void);
-int get_sensor_value(void);
-void set_servo_position(double position);
+int get_sensor_value(int index);
+void read_frame(SensorFrame *frame);
+void set_servo_position(int index, double position);
 void close_connections(void);
 
 #endif /* HEADERS_PHIDGET_CONNECTION_H_ */
@@ -4,15 +4,50 @@
 #define MIN_OUTPUT 101.0
 #define MAX_OUTPUT 107.0
 
+#define PID_DERIVATIVE_COUNT 10
+
 typedef struct
 {
 	float output;
 	float Pterm;
 	float Iterm;
 	float Dterm;
+	float FFterm;
 } PIDdata;
 
-PIDdata pid_compute(float input, float setpoint);
+typedef enum
+{
+	ANTI_WINDUP_CLAMP,
+	ANTI_WINDUP_CONDITIONAL,
+	ANTI_WINDUP_BACK_CALCULATION
+} AntiWindupMode;
+
+// coefficients, options and state of one controller
+typedef struct
+{
+	float Kp;
+	float Ki;
+	float Kd;
+	float Kv;
+	float Ka;
+	float compensation;	// output cancelling a known force on the boat
+	AntiWindupMode antiWindup;
+	float trackingTime;
+	unsigned long lastTime;
+	float lastInput;
+	float integralTerm;
+	float derivativeTerms[PID_DERIVATIVE_COUNT];
+	int derivativeIndex;
+} PIDController;
+
+void pid_init(PIDController *pid);
+PIDdata pid_compute(PIDController *pid, float input, float setpoint,
+		float setpointVelocity, float setpointAcceleration, unsigned long now);
+void pid_set_gains(PIDController *pid, float kp, float ki, float kd);
+void pid_set_anti_windup(PIDController *pid, AntiWindupMode mode, float time);
+void pid_set_feed_forward(PIDController *pid, float velocityGain, float accelerationGain);
+void pid_set_compensation(PIDController *pid, float compensation);
+void pid_reset(PIDController *pid);
 
 #endif /* PID_CONTROLLER_H_ */
 
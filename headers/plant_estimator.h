@@ -0,0 +1,50 @@
+#ifndef HEADERS_PLANT_ESTIMATOR_H_
+#define HEADERS_PLANT_ESTIMATOR_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The plant is modeled as y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c,
+ * with y the printed position (1000 - sensor value) and u the power (MAX_OUTPUT -
+ * servo output), one step per iteration of the control loop. */
+#define PLANT_ORDER 2
+#define PLANT_PARAMETERS (2 * PLANT_ORDER + 1)
+
+// the identified model and how much it can be trusted
+typedef struct
+{
+	double a[PLANT_ORDER];
+	double b[PLANT_ORDER];
+	double c;
+	double origin;						// position y is measured from
+	double deviation[PLANT_PARAMETERS];	// standard deviation of a, b and c
+	double errorVariance;				// of the one step prediction error
+	unsigned long samples;
+	bool dynamicsChanged;	// the dynamics differ from those identified until lately
+} PlantModel;
+
+typedef struct
+{
+	// recursive least squares state, owned by the thread running the channel
+	double theta[PLANT_PARAMETERS];	// a, b and c
+	double reference[PLANT_PARAMETERS];	// slowly following theta
+	double P[PLANT_PARAMETERS][PLANT_PARAMETERS];
+	double y[PLANT_ORDER];			// latest positions, newest first
+	double u[PLANT_ORDER];			// latest powers, newest first
+	double origin;					// first position, subtracted for conditioning
+	double shortErrorSquared;		// reference prediction error over a short time
+	double longErrorSquared;		// prediction error over a long time
+	unsigned long samples;
+	unsigned int changedSamples;	// consecutive samples with a high prediction error
+
+	// published copy, guarded by a sequence lock with the channel thread as the only writer
+	PlantModel published;
+	_Atomic uint64_t sequence;
+} PlantEstimator;
+
+void plant_estimator_init(PlantEstimator *estimator);
+void plant_estimator_update(PlantEstimator *estimator, float sensorValue, float output);
+void plant_estimator_read(PlantEstimator *estimator, PlantModel *model);
+
+#endif /* HEADERS_PLANT_ESTIMATOR_H_ */
@@ -0,0 +1,23 @@
+#ifndef HEADERS_RENDERER_H_
+#define HEADERS_RENDERER_H_
+
+#include <stdbool.h>
+
+#define RENDERER_MAX_VESSELS 64
+
+// what is drawn of a vessel, taken from the data of its channel once per frame
+typedef struct
+{
+	float boatX;		// window coordinates
+	float setpointX;
+	float power;		// 0 (none) to 1 (full)
+	bool onTarget;		// the setline is green when close to the target, else red
+} VesselView;
+
+int renderer_load(const char *boatModel);
+int renderer_init(const char *boatModel);
+void renderer_resize(int width, int height);
+void renderer_draw(const VesselView vessels[], int count);
+void renderer_cleanup(void);
+
+#endif /* HEADERS_RENDERER_H_ */
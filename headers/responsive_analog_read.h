@@ -1,6 +1,11 @@
 #ifndef RESPONSIVE_ANALOG_READ_H_
 #define RESPONSIVE_ANALOG_READ_H_
 
-int responsive_analog_read(float newValue);
+typedef struct
+{
+	float smoothValue;
+} ResponsiveAnalogRead;
+
+int responsive_analog_read(ResponsiveAnalogRead *filter, float newValue);
 
 #endif /* RESPONSIVE_ANALOG_READ_H_ */
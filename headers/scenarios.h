@@ -0,0 +1,12 @@
+#ifndef HEADERS_SCENARIOS_H_
+#define HEADERS_SCENARIOS_H_
+
+#include <stdbool.h>
+#include "pid_controller.h"
+
+#define SCENARIO_BASELINE "scenarios.baseline"
+
+int scenarios_run(const PIDController *pid, float observerBandwidth, float period,
+		float delay, const char *baselineFile, bool update);
+
+#endif /* HEADERS_SCENARIOS_H_ */
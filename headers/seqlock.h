@@ -0,0 +1,17 @@
+#ifndef HEADERS_SEQLOCK_H_
+#define HEADERS_SEQLOCK_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// sequence lock with a single writer: version n of the data is written while the
+// sequence number is 2n + 1 and complete when it is 2n + 2
+void seqlock_write(_Atomic uint64_t *sequence, uint64_t version, void *data,
+		const void *value, size_t size);
+void seqlock_publish(_Atomic uint64_t *sequence, void *data, const void *value,
+		size_t size);
+uint64_t seqlock_read(_Atomic uint64_t *sequence, const void *data, void *value,
+		size_t size);
+
+#endif /* HEADERS_SEQLOCK_H_ */
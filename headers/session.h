@@ -0,0 +1,63 @@
+#ifndef HEADERS_SESSION_H_
+#define HEADERS_SESSION_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include "control_runtime.h"
+
+#define SESSION_ROOT "sessions"
+#define SESSION_SUMMARY "summary.txt"	// results of the run, in its directory
+#define SESSION_PATH_LENGTH 128
+#define SESSION_HEADER_LENGTH 4096
+#define SESSION_BUFFER_SIZE 65536
+
+// a log file is continued in a new part when it gets too large or too old
+#define SESSION_ROTATE_SIZE (64L * 1024 * 1024)	// bytes
+#define SESSION_ROTATE_TIME 3600				// seconds
+
+// the directory of a run and the settings it was started with
+typedef struct
+{
+	char directory[SESSION_PATH_LENGTH];
+	char header[SESSION_HEADER_LENGTH];	// metadata as comment lines, atop every log file
+} Session;
+
+// a log written in parts by a thread of its own, so the one logging never waits for
+// the disk
+typedef struct
+{
+	const Session *session;
+	bool running;					// open with its writer started
+	char name[CHANNEL_NAME_LENGTH];
+	char columns[256];				// comment line naming the columns
+	char filename[SESSION_PATH_LENGTH + CHANNEL_NAME_LENGTH + 32];	// of the current part
+	int part;
+	int fd;
+	off_t size;						// bytes written to the current part
+	unsigned long opened;			// from nano_time(), when the current part was opened
+
+	// filled by the one logging, written by the writer thread once handed over
+	char buffers[2][SESSION_BUFFER_SIZE];
+	int active;						// buffer being filled
+	size_t fill;
+	unsigned long handedOver;		// from nano_time(), the last hand-over of a buffer
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	size_t pending;					// bytes of the other buffer waiting to be written
+	bool stopping;
+	unsigned long stalls;			// times the one logging had to wait for the writer
+	pthread_t thread;
+} SessionLog;
+
+int session_create(Session *session, const ControlRuntime *runtime);
+FILE *session_open_summary(const Session *session);
+int session_log_open(SessionLog *log, const Session *session, const char *name,
+		const char *columns);
+void session_log_printf(SessionLog *log, const char *format, ...)
+		__attribute__((format(printf, 2, 3)));
+void session_log_close(SessionLog *log);
+
+#endif /* HEADERS_SESSION_H_ */
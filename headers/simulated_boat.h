@@ -0,0 +1,21 @@
+#ifndef HEADERS_SIMULATED_BOAT_H_
+#define HEADERS_SIMULATED_BOAT_H_
+
+#define SIMULATION_STEP 0.001		// seconds
+#define SIMULATION_MAX_DELAY 1000	// simulation steps the power can be delayed
+
+// a boat pushed by its thruster against the drag of the water and a current
+typedef struct
+{
+	double position;	// printed units
+	double velocity;	// printed units per second
+	double force;		// printed units per second squared from waves and pushes
+	double delayed[SIMULATION_MAX_DELAY];	// the power on its way to the boat
+	int delaySteps;
+	int delayIndex;
+} SimulatedBoat;
+
+void simulated_boat_init(SimulatedBoat *boat, double position, double delay);
+void simulated_boat_step(SimulatedBoat *boat, double power, double duration);
+
+#endif /* HEADERS_SIMULATED_BOAT_H_ */
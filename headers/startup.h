@@ -0,0 +1,18 @@
+#ifndef HEADERS_STARTUP_H_
+#define HEADERS_STARTUP_H_
+
+#include <stdbool.h>
+
+// a part of the startup, run on a thread of its own
+typedef struct
+{
+	const char *name;
+	int (*run)(void);		// 0 if successful
+	bool required;			// nothing can be run without it
+	int result;
+	unsigned long time;		// nanoseconds it took
+} StartupStage;
+
+int startup_run(StartupStage stages[], int count);
+
+#endif /* HEADERS_STARTUP_H_ */
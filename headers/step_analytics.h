@@ -0,0 +1,71 @@
+#ifndef HEADERS_STEP_ANALYTICS_H_
+#define HEADERS_STEP_ANALYTICS_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define STEP_QUEUE_SIZE 16		// results not yet taken, must be a power of two
+#define STEP_MIN_SIZE 2.0		// printed units the target has to move for a step
+#define STEP_SETTLING_FRACTION 0.05	// of the step, the band the boat has to stay within
+#define STEP_SETTLING_MIN 2.0	// printed units, the narrowest band
+#define STEP_HOLD_TIME 5.0		// seconds within the band before a step is settled
+#define STEP_MAX_TIME 60.0		// seconds a step is followed at most
+
+// how the boat answered one change of the target, positions in printed units
+typedef struct
+{
+	unsigned long start;	// from nano_time(), when the target changed
+	float size;				// target minus position at the start
+	float riseTime;			// seconds from 10% to 90% of the step, NAN if not reached
+	float overshoot;		// percent of the step beyond the target
+	float settlingTime;		// seconds until within the band for good, NAN if never
+	double iae;				// integral of the absolute error [units * s]
+	double itae;			// integral of the time weighted absolute error [units * s^2]
+	float saturation;		// percent of the iterations the output was at a limit
+	bool interrupted;		// by another step or a stop before it was settled
+} StepResult;
+
+// measures the steps of one channel with constant memory, however long the run
+typedef struct
+{
+	// the step followed, written by the channel thread only
+	bool running;
+	float target;			// the target of the last step
+	bool targetKnown;		// false until the first iteration of control
+	StepResult current;
+	float startPosition;
+	unsigned long lastTime;
+	double rise10, rise90;	// seconds after the start, negative until reached
+	double lastOutside;		// seconds after the start the boat was last outside the band
+	long ticks;
+	long saturatedTicks;
+
+	// results handed from the channel thread to the one reporting them
+	StepResult results[STEP_QUEUE_SIZE];
+	atomic_uint head;	// next result to take, written by the consumer
+	atomic_uint tail;	// next free slot, written by the producer
+	atomic_uint dropped;	// results lost because nobody took them
+
+	// totals of the results taken, written by the consumer only
+	int count;
+	int settled;
+	int risen;
+	double riseSum;
+	double overshootSum, overshootMax;
+	double settlingSum, settlingMax;
+	double iaeSum, itaeSum;
+	double saturationSum;
+} StepAnalytics;
+
+void step_analytics_init(StepAnalytics *analytics);
+void step_analytics_record(StepAnalytics *analytics, unsigned long now, float target,
+		float position, float output, bool active);
+void step_analytics_finish(StepAnalytics *analytics);
+bool step_analytics_take(StepAnalytics *analytics, StepResult *result);
+void step_analytics_print(FILE *file, const char *name, const StepResult *result,
+		float time);
+void step_analytics_print_totals(FILE *file, const char *name,
+		const StepAnalytics *analytics);
+
+#endif /* HEADERS_STEP_ANALYTICS_H_ */
@@ -0,0 +1,69 @@
+#ifndef HEADERS_TELEMETRY_H_
+#define HEADERS_TELEMETRY_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Layout of the shared memory every tick of the control loops is published in,
+ * shared by the control program and the readers in tools/. A reader must check
+ * the magic number and the major version, and use the sizes in the header rather
+ * than its own, so records can grow within a major version. */
+
+#define TELEMETRY_NAME "/dynamic_positioning.telemetry"	// for shm_open()
+#define TELEMETRY_MAGIC 0x42545044u		// "DPTB"
+#define TELEMETRY_VERSION_MAJOR 1		// changed when the layout breaks readers
+#define TELEMETRY_VERSION_MINOR 1		// changed when fields are appended
+#define TELEMETRY_SLOTS 4096			// records kept per channel, a power of two
+#define TELEMETRY_MAX_CHANNELS 8
+#define TELEMETRY_NAME_LENGTH 16
+#define TELEMETRY_CACHE_LINE 64
+
+// one tick of a channel, in the same units as printed
+typedef struct
+{
+	uint64_t time;		// nanoseconds of CLOCK_MONOTONIC when the tick started
+	float position;
+	float setpoint;
+	float target;
+	float power;		// MAX_OUTPUT - output of the controller
+	float pTerm;
+	float iTerm;
+	float dTerm;
+	float startpoint;	// where the channel started, since 1.1
+} TelemetryRecord;
+
+// a record with its sequence number: 2n + 1 while record n is written, 2n + 2 after
+typedef struct
+{
+	_Atomic uint64_t sequence;
+	TelemetryRecord record;
+} TelemetrySlot;
+
+// records written to a channel, on a cache line of its own as every worker writes its own
+typedef struct
+{
+	_Alignas(TELEMETRY_CACHE_LINE) _Atomic uint64_t head;
+} TelemetryHead;
+
+// at the start of the shared memory, followed by a ring of slotCount slots per channel
+typedef struct
+{
+	_Atomic uint32_t magic;	// TELEMETRY_MAGIC once the rest of the header is written
+	uint32_t versionMajor;
+	uint32_t versionMinor;
+	uint32_t headerSize;	// bytes before the first ring
+	uint32_t slotSize;		// bytes per slot
+	uint32_t slotCount;
+	uint32_t channelCount;
+	float period;			// seconds between ticks
+	uint64_t started;		// microseconds since the Unix epoch, differs for every run
+	_Atomic uint32_t closed;	// set when the control program has stopped
+	char channelNames[TELEMETRY_MAX_CHANNELS][TELEMETRY_NAME_LENGTH];
+	TelemetryHead heads[TELEMETRY_MAX_CHANNELS];
+} TelemetryHeader;
+
+int telemetry_open(const char *name, float period, const char *channelNames[], int count);
+void telemetry_publish(int channel, const TelemetryRecord *record);
+void telemetry_close(void);
+
+#endif /* HEADERS_TELEMETRY_H_ */
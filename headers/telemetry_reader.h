@@ -0,0 +1,26 @@
+#ifndef HEADERS_TELEMETRY_READER_H_
+#define HEADERS_TELEMETRY_READER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+// follows the rings of a telemetry object mapped read-only, on its own
+typedef struct
+{
+	const TelemetryHeader *header;
+	size_t size;
+	uint64_t next[TELEMETRY_MAX_CHANNELS];	// number of the record to read next
+	uint64_t lost[TELEMETRY_MAX_CHANNELS];	// records overwritten before they were read
+} TelemetryReader;
+
+int telemetry_reader_open(TelemetryReader *reader, const char *name);
+int telemetry_reader_find(const TelemetryReader *reader, const char *channelName);
+void telemetry_reader_rewind(TelemetryReader *reader, int channel, uint64_t records);
+int telemetry_reader_next(TelemetryReader *reader, int channel, TelemetryRecord *record);
+int telemetry_reader_latest(TelemetryReader *reader, int channel, TelemetryRecord *record);
+bool telemetry_reader_closed(const TelemetryReader *reader);
+void telemetry_reader_close(TelemetryReader *reader);
+
+#endif /* HEADERS_TELEMETRY_READER_H_ */
@@ -0,0 +1,21 @@
+#ifndef HEADERS_THRUST_MAP_H_
+#define HEADERS_THRUST_MAP_H_
+
+#include <stdbool.h>
+
+#define THRUST_FILENAME_LENGTH 128
+#define THRUST_MAX_POINTS 64
+#define THRUST_TABLE_SIZE 257	// entries from no to full thrust
+
+// the servo position giving each fraction of the full thrust
+typedef struct
+{
+	bool loaded;
+	char filename[THRUST_FILENAME_LENGTH];
+	float table[THRUST_TABLE_SIZE];
+} ThrustMap;
+
+int thrust_map_load(ThrustMap *map, const char *filename);
+float thrust_map_apply(const ThrustMap *map, float output);
+
+#endif /* HEADERS_THRUST_MAP_H_ */
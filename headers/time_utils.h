@@ -1,8 +1,12 @@
 #ifndef HEADERS_TIME_UTILS_H_
 #define HEADERS_TIME_UTILS_H_
 
+#include <time.h>
+
 float nano_to_sec(unsigned long nanos);
 unsigned long sec_to_nano(float secs);
 unsigned long nano_time(void);
+long micro_wall_time(void);
+void to_timespec(unsigned long nanos, struct timespec *time);
 
 #endif /* HEADERS_TIME_UTILS_H_ */
@@ -0,0 +1,20 @@
+#ifndef HEADERS_TRACE_H_
+#define HEADERS_TRACE_H_
+
+typedef enum
+{
+	TRACE_TICK,
+	TRACE_SENSOR,
+	TRACE_PID,
+	TRACE_SERVO,
+	TRACE_SERVO_WRITE,
+	TRACE_STAGE_COUNT
+} TraceStage;
+
+int trace_thread_init(const char *threadName);
+void trace_record(TraceStage stage, unsigned long start, unsigned long end);
+int trace_export_chrome(const char *filename);
+void trace_print_summary(void);
+void trace_cleanup(void);
+
+#endif /* HEADERS_TRACE_H_ */
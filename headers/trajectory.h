@@ -0,0 +1,52 @@
+#ifndef HEADERS_TRAJECTORY_H_
+#define HEADERS_TRAJECTORY_H_
+
+#include <stdbool.h>
+
+/* Limits of the motion profiles in sensor units. The thruster accelerates the boat by
+ * roughly THRUST_ACCELERATION at full power, the profiles only use a part of it so
+ * the controller has margin left to correct errors. */
+#define THRUST_ACCELERATION 20.0
+#define TRAJECTORY_MAX_VELOCITY 15.0
+#define TRAJECTORY_MAX_ACCELERATION (0.3 * THRUST_ACCELERATION)
+#define TRAJECTORY_MAX_JERK 10.0
+
+typedef struct
+{
+	float position;
+	float velocity;
+	float acceleration;
+} TrajectoryPoint;
+
+typedef struct
+{
+	// limits
+	float maxVelocity;
+	float maxAcceleration;
+	float maxJerk;
+
+	// the current profile
+	unsigned long startTime;
+	float start;
+	float distance;
+	float direction;
+	float jerkTime;
+	float accelerationTime;
+	float cruiseTime;
+	float duration;
+	float peakAcceleration;
+	float peakVelocity;
+
+	// target received while the current profile was still running
+	float pendingTarget;
+	bool hasPending;
+} Trajectory;
+
+void trajectory_init(Trajectory *trajectory, float position, float maxVelocity,
+		float maxAcceleration, float maxJerk);
+void trajectory_set_target(Trajectory *trajectory, float target, unsigned long now);
+float trajectory_target(const Trajectory *trajectory);
+TrajectoryPoint trajectory_evaluate(const Trajectory *trajectory, unsigned long time);
+TrajectoryPoint trajectory_sample(Trajectory *trajectory, unsigned long now);
+
+#endif /* HEADERS_TRAJECTORY_H_ */
@@ -1,6 +1,8 @@
 #ifndef HEADERS_VISUALIZATION_H_
 #define HEADERS_VISUALIZATION_H_
 
-void *start_animation(void *void_ptr);
+#define BOAT_MODEL "data/boat.obj"
+
+int start_animation(void);
 
 #endif /* HEADERS_VISUALIZATION_H_ */
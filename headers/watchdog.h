@@ -0,0 +1,44 @@
+#ifndef HEADERS_WATCHDOG_H_
+#define HEADERS_WATCHDOG_H_
+
+#include <stdbool.h>
+#include "control_runtime.h"
+
+#define WATCHDOG_LOG "watchdog.log"
+
+#define DEFAULT_WATCHDOG_TIMEOUT 0.1	// seconds an iteration may be late
+#define DEFAULT_SENSOR_MIN 5			// readings outside are a broken sensor, a cut
+#define DEFAULT_SENSOR_MAX 995			// wire or a short reads at the end of the range
+#define DEFAULT_SENSOR_STUCK_TIME 5.0	// seconds a reading may stay the same
+
+#define WATCHDOG_MIN_INTERVAL 100000	// nanoseconds between checks at least
+
+// why the watchdog turned the motors off
+typedef enum
+{
+	INCIDENT_DEADLINE,		// a worker missed its deadline by more than the timeout
+	INCIDENT_SERVO_STALL,	// a servo write took longer than the timeout
+	INCIDENT_SENSOR_STUCK,	// a sensor kept its reading for longer than the stuck time
+	INCIDENT_SENSOR_RANGE	// a sensor read outside the valid range
+} IncidentKind;
+
+// what the watchdog saw when it tripped, times from nano_time()
+typedef struct
+{
+	IncidentKind kind;
+	int index;					// the worker, servo or channel concerned
+	int value;					// the reading of the sensor
+	unsigned long last;			// last sign of life: kick, start of the write or change
+	unsigned long detected;
+	unsigned long late;			// how much later than allowed it was detected
+	unsigned long safeTime;		// spent turning the motors off
+	bool safe;					// false if the motors were not confirmed off in time
+} WatchdogIncident;
+
+int watchdog_start(ControlRuntime *runtime, const char *logFilename);
+void watchdog_kick(int worker, unsigned long time);
+void watchdog_sensor(int channel, int value, unsigned long time);
+bool watchdog_tripped(WatchdogIncident *incident);
+void watchdog_stop(void);
+
+#endif /* HEADERS_WATCHDOG_H_ */
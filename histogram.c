@@ -0,0 +1,231 @@
+/**************************************************
+ * FILENAME:	histogram.c
+ *
+ * DESCRIPTION:
+ * 		Implementation of a high dynamic range (HDR) histogram. Values are sorted
+ * 		into log-linear buckets: every power of two is split into a fixed number of
+ * 		linear sub-buckets. This gives a constant relative precision over a huge
+ * 		range of values with a small, fixed memory footprint and O(1) recording,
+ * 		which makes it suitable for latency measurements inside the control loop.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void histogram_reset(Histogram *hist)
+ * 		void histogram_record(Histogram *hist, unsigned long value)
+ * 		void histogram_merge(Histogram *dest, const Histogram *src)
+ * 		unsigned long histogram_percentile(const Histogram *hist, double percentile)
+ * 		double histogram_mean(const Histogram *hist)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <string.h>
+
+#include "headers/histogram.h"
+
+#define HALF_SUB_BUCKETS (HISTOGRAM_SUB_BUCKETS / 2)
+
+/**************************************************
+ * NAME: static int bucket_index(unsigned long value)
+ *
+ * DESCRIPTION:
+ * 		Finds the bucket a value belongs to. Values below HISTOGRAM_SUB_BUCKETS are
+ * 		stored exactly, larger values are shifted down until they fit in the upper
+ * 		half of the sub-buckets, and the shift selects the bucket group.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	unsigned long value:	The value to find the bucket for.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	int:	The index of the bucket.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int bucket_index(unsigned long value)
+{
+	if (value < HISTOGRAM_SUB_BUCKETS)
+		return (int) value;
+
+	int shift = (63 - __builtin_clzl(value)) - (HISTOGRAM_SUB_BITS - 1);
+	if (shift > HISTOGRAM_MAX_SHIFT)
+		return HISTOGRAM_BUCKETS - 1;	// out of range, saturate
+
+	return shift * HALF_SUB_BUCKETS + (int) (value >> shift);
+}
+
+/**************************************************
+ * NAME: static unsigned long bucket_value(int index)
+ *
+ * DESCRIPTION:
+ * 		The inverse of bucket_index(). Returns the value in the middle of the range
+ * 		covered by a bucket.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	int index:	The index of the bucket.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	unsigned long:	A representative value for the bucket.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static unsigned long bucket_value(int index)
+{
+	if (index < HISTOGRAM_SUB_BUCKETS)
+		return (unsigned long) index;
+
+	int shift = index / HALF_SUB_BUCKETS - 1;
+	unsigned long lowest = (unsigned long) (index - shift * HALF_SUB_BUCKETS) << shift;
+	return lowest + ((1UL << shift) >> 1);
+}
+
+/**************************************************
+ * NAME: void histogram_reset(Histogram *hist)
+ *
+ * DESCRIPTION:
+ * 		Removes all recorded values from the histogram.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	Histogram *hist:	The histogram to reset.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void histogram_reset(Histogram *hist)
+{
+	memset(hist, 0, sizeof(Histogram));
+}
+
+/**************************************************
+ * NAME: void histogram_record(Histogram *hist, unsigned long value)
+ *
+ * DESCRIPTION:
+ * 		Records a single value in the histogram. Runs in constant time and never
+ * 		allocates memory.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	Histogram *hist:		The histogram to record in.
+ *      	unsigned long value:	The value to record.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void histogram_record(Histogram *hist, unsigned long value)
+{
+	if ((*hist).count == 0 || value < (*hist).min)
+		(*hist).min = value;
+	if (value > (*hist).max)
+		(*hist).max = value;
+
+	(*hist).count++;
+	(*hist).sum += value;
+	(*hist).buckets[bucket_index(value)]++;
+}
+
+/**************************************************
+ * NAME: void histogram_merge(Histogram *dest, const Histogram *src)
+ *
+ * DESCRIPTION:
+ * 		Adds all values recorded in one histogram to another.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	Histogram *dest:		The histogram to add values to.
+ *      	const Histogram *src:	The histogram to copy values from.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void histogram_merge(Histogram *dest, const Histogram *src)
+{
+	if ((*src).count == 0)
+		return;
+
+	if ((*dest).count == 0 || (*src).min < (*dest).min)
+		(*dest).min = (*src).min;
+	if ((*src).max > (*dest).max)
+		(*dest).max = (*src).max;
+
+	(*dest).count += (*src).count;
+	(*dest).sum += (*src).sum;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+		(*dest).buckets[i] += (*src).buckets[i];
+}
+
+/**************************************************
+ * NAME: unsigned long histogram_percentile(const Histogram *hist, double percentile)
+ *
+ * DESCRIPTION:
+ * 		Finds the value below which the given percentage of the recorded values lie.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	const Histogram *hist:	The histogram to search.
+ *      	double percentile:		The percentile in the range 0 to 100.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	unsigned long:	The value at the percentile, 0 if the histogram is empty.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+unsigned long histogram_percentile(const Histogram *hist, double percentile)
+{
+	if ((*hist).count == 0)
+		return 0;
+
+	// number of values that must be at or below the result
+	unsigned long wanted = (unsigned long) (percentile / 100.0 * (*hist).count + 0.5);
+	if (wanted < 1)
+		wanted = 1;
+
+	unsigned long seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += (*hist).buckets[i];
+		if (seen >= wanted)
+		{
+			// never report something outside the recorded range
+			unsigned long value = bucket_value(i);
+			if (value < (*hist).min)
+				return (*hist).min;
+			if (value > (*hist).max)
+				return (*hist).max;
+			return value;
+		}
+	}
+	return (*hist).max;
+}
+
+/**************************************************
+ * NAME: double histogram_mean(const Histogram *hist)
+ *
+ * DESCRIPTION:
+ * 		Calculates the exact mean of the recorded values.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	const Histogram *hist:	The histogram.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	double:	The mean value, 0 if the histogram is empty.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+double histogram_mean(const Histogram *hist)
+{
+	if ((*hist).count == 0)
+		return 0.0;
+	return (*hist).sum / (*hist).count;
+}
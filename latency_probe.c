@@ -0,0 +1,760 @@
+/**************************************************
+ * FILENAME:	latency_probe.c
+ *
+ * DESCRIPTION:
+ * 		Measures how long it takes from writing a servo position until the boat
+ * 		visibly responds in the sensor reading, and how the boat responds to the
+ * 		power at different frequencies.
+ *
+ * 		The channel brings the boat to the middle of the tank and holds it there
+ * 		with its own controller while steps and a chirp are added to the power it
+ * 		commands. The servo is written directly, so the time of every write is
+ * 		known exactly, and the raw sensor reading is sampled every
+ * 		PROBE_SAMPLE_PERIOD. Samples missed while a write blocks get the value of
+ * 		the last sample. ctrl-c ends the measurement early, with the motor off.
+ *
+ * 		The transport delay is found by fitting a boat with drag, starting to move
+ * 		after the delay, to the average response to the steps: the cross
+ * 		correlation of the position with them. The frequency response from power
+ * 		to position is the cross spectrum of the two over the chirp divided by
+ * 		the spectrum of the power, averaged over bands of frequencies.
+ *
+ * 		The results are printed and saved to LATENCY_FILE_FORMAT:
+ * 			delay <seconds> <earliest> <latest>		until the boat starts moving
+ * 			visible <seconds>						until the reading shows it
+ * 			write <mean seconds> <max seconds>		spent in set_servo_position()
+ * 			response <Hz> <position units per power unit> <phase degrees>
+ * 		The simulated boat of the benchmark responds with the saved delay.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int latency_probe(ControlRuntime *runtime, int channel)
+ * 		int latency_load(const char *channelName, float *delay)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "headers/latency_probe.h"
+#include "headers/phidget_connection.h"
+#include "headers/time_utils.h"
+
+#define PROBE_SAMPLE_RATE 1000		// Hz, the fastest data rate of the interface kit
+#define PROBE_SAMPLE_PERIOD (1.0 / PROBE_SAMPLE_RATE)
+#define PROBE_SETTLE_TIME 5			// seconds holding the position before the steps
+#define PROBE_STEP_COUNT 40
+#define PROBE_STEP_TIME 1			// seconds per step
+#define PROBE_STEP_SIZE 3.0			// power units added and taken away
+#define PROBE_CHIRP_TIME 30			// seconds
+#define PROBE_CHIRP_START 0.1		// Hz
+#define PROBE_CHIRP_END 5.0			// Hz, at most a quarter of the loop rate
+#define PROBE_AMPLITUDE 1.0			// power units added by the chirp
+#define PROBE_MAX_EXCURSION 100.0	// sensor units from the target before giving up
+#define PROBE_HOLD_ERROR 5.0		// sensor units from the target to count as there
+#define PROBE_MOVE_TIMEOUT 60		// seconds to get there
+
+#define PROBE_CHIRP_START_TIME (PROBE_SETTLE_TIME + PROBE_STEP_COUNT * PROBE_STEP_TIME)
+#define PROBE_TIME (PROBE_CHIRP_START_TIME + PROBE_CHIRP_TIME)
+#define PROBE_SAMPLES (PROBE_TIME * PROBE_SAMPLE_RATE)
+
+#define RESPONSE_LENGTH 700			// samples after a step, less than a step lasts
+#define DELAY_RESOLUTION 0.0005		// seconds between the delays tried
+#define DELAY_STEPS 600				// tried, up to 0.3 s
+#define MIN_DRAG 0.05				// 1/s, of the velocity lost per second
+#define MAX_DRAG 20.0
+#define DRAG_ITERATIONS 20			// of the golden section search
+#define GOLDEN 0.6180339887
+#define FIT_TERMS 4					// offset, drift, slowing down and the step
+#define VISIBLE_LEVEL 3.0			// times the noise for a change to count as visible
+#define FREQUENCY_COUNT 16			// points of the frequency response
+#define FREQUENCY_BINS 8			// averaged per point
+#define TAPER_FRACTION 0.05			// of the chirp at either end
+
+// how many times the crossover frequency the loop rate must be to not limit it
+#define RATE_PER_CROSSOVER 20.0
+
+// what was added, what was commanded and what was read, one per sample
+typedef struct
+{
+	float excitation[PROBE_SAMPLES];	// power units
+	float power[PROBE_SAMPLES];			// power units, MAX_OUTPUT - servo output
+	float position[PROBE_SAMPLES];		// 1000 - raw sensor value
+	int count;
+	int chirpStart;						// first sample of the chirp
+	double writeTime;					// seconds spent in set_servo_position() in total
+	double maxWriteTime;
+	int writes;
+} ProbeRecord;
+
+// the transport delay found from the steps
+typedef struct
+{
+	double delay;		// seconds from the write until the boat starts moving
+	double earliest;	// the range of delays fitting the steps as well within the noise
+	double latest;
+	double visible;		// seconds from the write until the reading has changed
+	double drag;		// 1/s, of the velocity lost per second
+} DelayEstimate;
+
+/**************************************************
+ * NAME: static double excitation(double time, float period)
+ *
+ * DESCRIPTION:
+ * 		The power added at a time of the measurement: nothing while settling,
+ * 		steps alternating in sign, then a linear chirp.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			double time:	Seconds since the start of the measurement.
+ * 			float period:	Seconds between servo writes.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			double:	The power to add.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static double excitation(double time, float period)
+{
+	if (time < PROBE_SETTLE_TIME)
+		return 0.0;
+	time -= PROBE_SETTLE_TIME;
+
+	if (time < PROBE_STEP_COUNT * PROBE_STEP_TIME)
+		return ((int) (time / PROBE_STEP_TIME)) % 2 == 0 ? PROBE_STEP_SIZE
+				: -PROBE_STEP_SIZE;
+	time -= PROBE_STEP_COUNT * PROBE_STEP_TIME;
+
+	double end = fmin(PROBE_CHIRP_END, 0.25 / period);
+	double phase = PROBE_CHIRP_START * time
+			+ (end - PROBE_CHIRP_START) * time * time / (2.0 * PROBE_CHIRP_TIME);
+	return PROBE_AMPLITUDE * sin(2.0 * M_PI * phase);
+}
+
+/**************************************************
+ * NAME: static int move_to_target(ControlRuntime *runtime, ControlChannel *channel)
+ *
+ * DESCRIPTION:
+ * 		Runs the channel until the boat has been within PROBE_HOLD_ERROR of its
+ * 		target for PROBE_SETTLE_TIME, or the runtime is stopped.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime with the period.
+ * 			ControlChannel *channel:	The started channel.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if the boat did not get there in time or the
+ * 					runtime was stopped.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static int move_to_target(ControlRuntime *runtime, ControlChannel *channel)
+{
+	SensorFrame frame;
+	unsigned long period = (*runtime).period;
+	unsigned long start = nano_time();
+	unsigned long deadline = start;
+	unsigned long arrived = 0;	// 0 while away from the target
+	while (nano_to_sec(deadline - start) < PROBE_MOVE_TIMEOUT)
+	{
+		if (!runtime_is_running(runtime))
+		{
+			printf("Measurement stopped\n");
+			return 1;
+		}
+
+		deadline += period;
+		struct timespec wakeup;
+		to_timespec(deadline, &wakeup);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+			;	// interrupted by a signal
+
+		read_frame(&frame);
+		PIDdata pid = channel_update(channel, frame.sensors[(*channel).sensorIndex],
+				frame.time);
+		set_servo_position((*channel).servoIndex,
+				thrust_map_apply(&(*channel).thrustMap, pid.output));
+
+		if (fabs((*channel).data.sensorValue - (*channel).data.target) > PROBE_HOLD_ERROR)
+			arrived = 0;
+		else if (arrived == 0)
+			arrived = frame.time;
+		else if (nano_to_sec(frame.time - arrived) >= PROBE_SETTLE_TIME)
+			return 0;
+	}
+	printf("The boat did not settle at its target, measurement stopped\n");
+	return 1;
+}
+
+/**************************************************
+ * NAME: static int record(ControlRuntime *runtime, ControlChannel *channel,
+ * 				ProbeRecord *probe)
+ *
+ * DESCRIPTION:
+ * 		Runs the measurement: holds the position of the channel with its
+ * 		controller, adds the excitation to the power and records every sample.
+ * 		Gives up if the boat gets too far from its target or the runtime is
+ * 		stopped.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime with the period.
+ * 			ControlChannel *channel:	The started channel to measure.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ProbeRecord *probe:	The samples.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if the boat got too far or the runtime was
+ * 					stopped.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static int record(ControlRuntime *runtime, ControlChannel *channel, ProbeRecord *probe)
+{
+	unsigned long sample = sec_to_nano(PROBE_SAMPLE_PERIOD);
+	unsigned long period = (*runtime).period;
+	float periodSeconds = nano_to_sec(period);
+	memset(probe, 0, sizeof(*probe));
+	(*probe).chirpStart = PROBE_CHIRP_START_TIME * PROBE_SAMPLE_RATE;
+
+	SensorFrame frame;
+	float added = 0.0, power = 0.0;
+	int last = -1;
+	unsigned long start = nano_time();
+	unsigned long nextWrite = start;
+	while (last < PROBE_SAMPLES - 1)
+	{
+		if (!runtime_is_running(runtime))
+		{
+			printf("Measurement stopped\n");
+			return 1;
+		}
+
+		struct timespec wakeup;
+		to_timespec(start + (last + 1) * sample, &wakeup);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+			;	// interrupted by a signal
+
+		read_frame(&frame);
+		int sensorValue = frame.sensors[(*channel).sensorIndex];
+		int index = (int) ((frame.time - start) / sample);
+		if (index > PROBE_SAMPLES - 1)
+			index = PROBE_SAMPLES - 1;
+
+		// samples missed while writing keep the last reading, with what was written
+		for (int i = last + 1; i <= index; i++)
+		{
+			(*probe).excitation[i] = added;
+			(*probe).power[i] = power;
+			(*probe).position[i] = i == index || last < 0 ? 1000 - sensorValue :
+					(*probe).position[last];
+		}
+		last = index;
+
+		if (frame.time < nextWrite)
+			continue;
+		nextWrite += (frame.time - nextWrite) / period * period + period;
+
+		PIDdata pid = channel_update(channel, sensorValue, frame.time);
+		float excursion = (*channel).data.sensorValue - (*channel).data.target;
+		if (fabs(excursion) > PROBE_MAX_EXCURSION)
+		{
+			printf("The boat got too far from its target, measurement stopped\n");
+			return 1;
+		}
+
+		added = (float) excitation(nano_to_sec(frame.time - start), periodSeconds);
+		float output = pid.output - added;
+		if (output < MIN_OUTPUT)
+			output = MIN_OUTPUT;
+		else if (output > MAX_OUTPUT)
+			output = MAX_OUTPUT;
+		power = MAX_OUTPUT - output;
+
+		unsigned long writeStart = nano_time();
+		set_servo_position((*channel).servoIndex,
+				thrust_map_apply(&(*channel).thrustMap, output));
+		double writeTime = nano_to_sec(nano_time() - writeStart);
+		(*probe).writeTime += writeTime;
+		if (writeTime > (*probe).maxWriteTime)
+			(*probe).maxWriteTime = writeTime;
+		(*probe).writes++;
+	}
+	(*probe).count = PROBE_SAMPLES;
+	return 0;
+}
+
+/**************************************************
+ * NAME: static int solve(double a[FIT_TERMS][FIT_TERMS], double x[FIT_TERMS])
+ *
+ * DESCRIPTION:
+ * 		Solves a x = b by Gaussian elimination with partial pivoting.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			double a[FIT_TERMS][FIT_TERMS]:	The matrix, destroyed.
+ * 			double x[FIT_TERMS]:			The right hand side b.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			double x[FIT_TERMS]:	The solution.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if the matrix is singular.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int solve(double a[FIT_TERMS][FIT_TERMS], double x[FIT_TERMS])
+{
+	for (int c = 0; c < FIT_TERMS; c++)
+	{
+		int pivot = c;
+		for (int r = c + 1; r < FIT_TERMS; r++)
+			if (fabs(a[r][c]) > fabs(a[pivot][c]))
+				pivot = r;
+		if (fabs(a[pivot][c]) < 1e-9 * fabs(a[0][0]))
+			return 1;
+		for (int k = 0; k < FIT_TERMS; k++)
+		{
+			double swap = a[c][k];
+			a[c][k] = a[pivot][k];
+			a[pivot][k] = swap;
+		}
+		double swap = x[c];
+		x[c] = x[pivot];
+		x[pivot] = swap;
+
+		for (int r = c + 1; r < FIT_TERMS; r++)
+		{
+			double factor = a[r][c] / a[c][c];
+			for (int k = c; k < FIT_TERMS; k++)
+				a[r][k] -= factor * a[c][k];
+			x[r] -= factor * x[c];
+		}
+	}
+	for (int r = FIT_TERMS - 1; r >= 0; r--)
+	{
+		for (int k = r + 1; k < FIT_TERMS; k++)
+			x[r] -= a[r][k] * x[k];
+		x[r] /= a[r][r];
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void fit_terms(double time, double delay, double drag,
+ * 				double term[FIT_TERMS])
+ *
+ * DESCRIPTION:
+ * 		The motions the response to a step is made of, for a mass with linear
+ * 		drag: the position it had, the velocity it was heading for before the
+ * 		step, the velocity it was losing on the way and the step in power after
+ * 		the delay.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			double time:	Seconds since the write of the step.
+ * 			double delay:	Seconds.
+ * 			double drag:	1/s.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			double term[FIT_TERMS]:	The motions at the time, each for a unit amplitude.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void fit_terms(double time, double delay, double drag, double term[FIT_TERMS])
+{
+	double since = fmax(time - delay, 0.0);
+	term[0] = 1.0;
+	term[1] = time;
+	term[2] = (1.0 - exp(-drag * time)) / drag;
+	term[3] = (since - (1.0 - exp(-drag * since)) / drag) / drag;
+}
+
+/**************************************************
+ * NAME: static double step_residual(const double response[RESPONSE_LENGTH],
+ * 				double delay, double drag, double fit[FIT_TERMS])
+ *
+ * DESCRIPTION:
+ * 		Fits the motions of fit_terms() to the average response to a step by
+ * 		least squares.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const double response[RESPONSE_LENGTH]:	The average response.
+ * 			double delay:							Seconds.
+ * 			double drag:							1/s.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			double fit[FIT_TERMS]:	The amplitudes of the motions.
+ * 		RETURN:
+ * 			double:	The sum of the squared residuals, INFINITY if the step does not
+ * 					fit or moves the boat the wrong way.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static double step_residual(const double response[RESPONSE_LENGTH], double delay,
+		double drag, double fit[FIT_TERMS])
+{
+	// normal equations
+	double a[FIT_TERMS][FIT_TERMS] = { { 0.0 } }, b[FIT_TERMS] = { 0.0 }, rr = 0.0;
+	for (int j = 0; j < RESPONSE_LENGTH; j++)
+	{
+		double term[FIT_TERMS];
+		fit_terms(j * PROBE_SAMPLE_PERIOD, delay, drag, term);
+		for (int r = 0; r < FIT_TERMS; r++)
+		{
+			b[r] += term[r] * response[j];
+			for (int c = 0; c < FIT_TERMS; c++)
+				a[r][c] += term[r] * term[c];
+		}
+		rr += response[j] * response[j];
+	}
+	memcpy(fit, b, sizeof(b));
+	if (solve(a, fit) || fit[FIT_TERMS - 1] <= 0.0)
+		return INFINITY;
+
+	double residual = rr;
+	for (int r = 0; r < FIT_TERMS; r++)
+		residual -= fit[r] * b[r];
+	return fmax(residual, 0.0);
+}
+
+/**************************************************
+ * NAME: static int estimate_delay(const ProbeRecord *probe, DelayEstimate *estimate)
+ *
+ * DESCRIPTION:
+ * 		Lines the response of the position up at the write of every step, relative
+ * 		to the position at the step and with the sign of the step taken out, and
+ * 		averages them: the cross correlation of the position with the steps. For
+ * 		every delay the drag fitting best is searched for by golden section, and
+ * 		the delay with the smallest residual of all is taken. The delays fitting
+ * 		as well within the noise give the range of the estimate. The
+ * 		delay includes the lag of the thruster spinning up.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const ProbeRecord *probe:	The samples.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			DelayEstimate *estimate:	The delay.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if there was no response.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int estimate_delay(const ProbeRecord *probe, DelayEstimate *estimate)
+{
+	static double response[RESPONSE_LENGTH];	// too large for the stack
+	static double residuals[DELAY_STEPS];
+	memset(response, 0, sizeof(response));
+
+	const float *e = (*probe).excitation;
+	const float *y = (*probe).position;
+	int steps = 0;
+	for (int k = PROBE_SETTLE_TIME * PROBE_SAMPLE_RATE + 1;
+			k + RESPONSE_LENGTH < (*probe).chirpStart; k++)
+	{
+		if (e[k] == e[k - 1])
+			continue;
+		double sign = e[k] > e[k - 1] ? 1.0 : -1.0;
+		for (int j = 0; j < RESPONSE_LENGTH; j++)
+			response[j] += sign * (y[k + j] - y[k]);
+		steps++;
+	}
+	if (steps == 0)
+		return 1;
+	for (int j = 0; j < RESPONSE_LENGTH; j++)
+		response[j] /= steps;
+
+	double best = INFINITY, fit[FIT_TERMS], bestFit[FIT_TERMS] = { 0.0 };
+	(*estimate).delay = (*estimate).drag = 0.0;
+	for (int d = 0; d < DELAY_STEPS; d++)
+	{
+		double delay = (d + 1) * DELAY_RESOLUTION;
+
+		// golden section search of the logarithm of the drag
+		double low = log(MIN_DRAG), high = log(MAX_DRAG);
+		double inner = high - GOLDEN * (high - low), outer = low + GOLDEN * (high - low);
+		double innerResidual = step_residual(response, delay, exp(inner), fit);
+		double outerResidual = step_residual(response, delay, exp(outer), fit);
+		for (int i = 0; i < DRAG_ITERATIONS; i++)
+		{
+			if (innerResidual < outerResidual)
+			{
+				high = outer;
+				outer = inner;
+				outerResidual = innerResidual;
+				inner = high - GOLDEN * (high - low);
+				innerResidual = step_residual(response, delay, exp(inner), fit);
+			} else
+			{
+				low = inner;
+				inner = outer;
+				innerResidual = outerResidual;
+				outer = low + GOLDEN * (high - low);
+				outerResidual = step_residual(response, delay, exp(outer), fit);
+			}
+		}
+		double drag = exp(0.5 * (low + high));
+		residuals[d] = step_residual(response, delay, drag, fit);
+		if (residuals[d] < best)
+		{
+			best = residuals[d];
+			memcpy(bestFit, fit, sizeof(fit));
+			(*estimate).delay = delay;
+			(*estimate).drag = drag;
+		}
+	}
+	if (best == INFINITY)
+		return 1;
+
+	// delays whose residual is within two standard deviations of the noise of the best
+	double variance = best / (RESPONSE_LENGTH - FIT_TERMS - 2);
+	(*estimate).earliest = (*estimate).latest = (*estimate).delay;
+	for (int d = 0; d < DELAY_STEPS; d++)
+	{
+		if (residuals[d] > best + 4.0 * variance)
+			continue;
+		double delay = (d + 1) * DELAY_RESOLUTION;
+		(*estimate).earliest = fmin((*estimate).earliest, delay);
+		(*estimate).latest = fmax((*estimate).latest, delay);
+	}
+
+	// visible once the step stands out of the noise left by the fit
+	(*estimate).visible = RESPONSE_LENGTH * PROBE_SAMPLE_PERIOD;
+	for (int j = 0; j < RESPONSE_LENGTH; j++)
+	{
+		double term[FIT_TERMS], moved = response[j];
+		fit_terms(j * PROBE_SAMPLE_PERIOD, (*estimate).delay, (*estimate).drag, term);
+		for (int r = 0; r < FIT_TERMS - 1; r++)
+			moved -= bestFit[r] * term[r];
+		if (moved > VISIBLE_LEVEL * sqrt(variance))
+		{
+			(*estimate).visible = j * PROBE_SAMPLE_PERIOD;
+			break;
+		}
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void frequency_response(const ProbeRecord *probe, double frequency,
+ * 				double width, double *gain, double *phase)
+ *
+ * DESCRIPTION:
+ * 		Computes the response from power to position around one frequency, from
+ * 		their Fourier transforms over the chirp: the cross spectrum divided by the
+ * 		spectrum of the power, both summed over FREQUENCY_BINS frequencies around
+ * 		it to average out the noise. The ends of the chirp are tapered and the
+ * 		drift of the position is removed.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const ProbeRecord *probe:	The samples.
+ * 			double frequency:			Hz.
+ * 			double width:				Hz, of the band averaged over.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			double *gain:	Position units per power unit.
+ * 			double *phase:	Degrees.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void frequency_response(const ProbeRecord *probe, double frequency, double width,
+		double *gain, double *phase)
+{
+	int first = (*probe).chirpStart;
+	int count = (*probe).count - first;
+	int taper = (int) (TAPER_FRACTION * count);
+	const float *u = &(*probe).power[first];
+	const float *y = &(*probe).position[first];
+
+	// remove the mean of the power and the straight line through the position
+	double uMean = 0.0, yMean = 0.0, slope = 0.0, spread = 0.0;
+	for (int k = 0; k < count; k++)
+	{
+		uMean += u[k];
+		yMean += y[k];
+	}
+	uMean /= count;
+	yMean /= count;
+	for (int k = 0; k < count; k++)
+	{
+		double t = k - (count - 1) / 2.0;
+		slope += t * (y[k] - yMean);
+		spread += t * t;
+	}
+	slope /= spread;
+
+	double crossRe = 0.0, crossIm = 0.0, power = 0.0;
+	for (int bin = 0; bin < FREQUENCY_BINS; bin++)
+	{
+		double f = frequency + width * ((bin + 0.5) / FREQUENCY_BINS - 0.5);
+		double omega = 2.0 * M_PI * f * PROBE_SAMPLE_PERIOD;
+		double uRe = 0.0, uIm = 0.0, yRe = 0.0, yIm = 0.0;
+		for (int k = 0; k < count; k++)
+		{
+			int edge = k < count - 1 - k ? k : count - 1 - k;
+			double window = edge >= taper ? 1.0 : 0.5 - 0.5 * cos(M_PI * edge / taper);
+			double uk = (u[k] - uMean) * window;
+			double yk = (y[k] - yMean - slope * (k - (count - 1) / 2.0)) * window;
+			double c = cos(omega * k), s = sin(omega * k);
+			uRe += uk * c;
+			uIm -= uk * s;
+			yRe += yk * c;
+			yIm -= yk * s;
+		}
+		// Y conj(U)
+		crossRe += yRe * uRe + yIm * uIm;
+		crossIm += yIm * uRe - yRe * uIm;
+		power += uRe * uRe + uIm * uIm;
+	}
+
+	*gain = sqrt(crossRe * crossRe + crossIm * crossIm) / power;
+	*phase = atan2(crossIm, crossRe) * 180.0 / M_PI;
+}
+
+/**************************************************
+ * NAME: int latency_probe(ControlRuntime *runtime, int channel)
+ *
+ * DESCRIPTION:
+ * 		Measures the transport delay and the frequency response of a channel at
+ * 		the target it starts with, in the middle of the tank, prints them with the
+ * 		loop rate the delay makes useful, and saves them for the simulator. The
+ * 		channel must be started and not run by the runtime. Ends early when the
+ * 		runtime is stopped, e.g. by ctrl-c. Turns off its servo before returning,
+ * 		however it ends.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The started runtime.
+ * 			int channel:				The index of the channel to measure.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+int latency_probe(ControlRuntime *runtime, int channel)
+{
+	static ProbeRecord probe;	// too large for the stack
+	ControlChannel *measured = &(*runtime).channels[channel];
+	float period = nano_to_sec((*runtime).period);
+	double chirpEnd = fmin(PROBE_CHIRP_END, 0.25 / period);
+
+	printf("Measuring the latency of %s for %d s: steps of %.1f power, then a chirp from "
+			"%.1f to %.1f Hz\n", (*measured).name, PROBE_TIME, PROBE_STEP_SIZE,
+			PROBE_CHIRP_START, chirpEnd);
+	int failed = move_to_target(runtime, measured) || record(runtime, measured, &probe);
+	set_servo_position((*measured).servoIndex, 0.0);	// turn off motor
+	if (failed)
+		return 1;
+
+	DelayEstimate estimate;
+	if (estimate_delay(&probe, &estimate))
+	{
+		printf("The boat did not respond to the steps, no latency measured\n");
+		return 1;
+	}
+	double delay = estimate.delay;
+	double meanWrite = probe.writeTime / probe.writes;
+	printf("Transport delay %.1f ms (%.1f to %.1f ms fit as well), reading visibly "
+			"changed after %.1f ms\n", delay * 1000.0, estimate.earliest * 1000.0,
+			estimate.latest * 1000.0, estimate.visible * 1000.0);
+	printf("set_servo_position() took %.2f ms on average, at most %.2f ms\n",
+			meanWrite * 1000.0, probe.maxWriteTime * 1000.0);
+
+	// the delay costs omega * delay of phase, about 30 degrees at the crossover
+	if (delay > 0.0)
+	{
+		double crossover = 0.5 / delay / (2.0 * M_PI);
+		printf("The delay limits the crossover to about %.2f Hz, loop rates above "
+				"%.0f Hz gain little (running at %.0f Hz)\n", crossover,
+				RATE_PER_CROSSOVER * crossover, 1.0 / period);
+	}
+
+	char filename[CHANNEL_NAME_LENGTH + sizeof(LATENCY_FILE_FORMAT)];
+	snprintf(filename, sizeof(filename), LATENCY_FILE_FORMAT, (*measured).name);
+	FILE *fp = fopen(filename, "w");
+	if (!fp)
+	{
+		perror("Could not save the latency");
+		return 1;
+	}
+	fprintf(fp, "# latency of %s, sensor %d, servo %d, loop period %.4f s\n",
+			(*measured).name, (*measured).sensorIndex, (*measured).servoIndex, period);
+	fprintf(fp, "delay %.5f %.5f %.5f\n", delay, estimate.earliest, estimate.latest);
+	fprintf(fp, "visible %.5f\n", estimate.visible);
+	fprintf(fp, "write %.5f %.5f\n", meanWrite, probe.maxWriteTime);
+	fprintf(fp, "# frequency [Hz], position per power, phase [degrees]\n");
+
+	printf("%10s %10s %10s\n", "Hz", "gain", "phase");
+	double ratio = pow(chirpEnd / PROBE_CHIRP_START, 1.0 / FREQUENCY_COUNT);
+	for (int f = 0; f < FREQUENCY_COUNT; f++)
+	{
+		// in the middle of bands spanning the chirp
+		double low = PROBE_CHIRP_START * pow(ratio, f);
+		double frequency = low * sqrt(ratio);
+		double gain, phase;
+		frequency_response(&probe, frequency, low * (ratio - 1.0), &gain, &phase);
+		printf("%10.3f %10.3f %10.1f\n", frequency, gain, phase);
+		fprintf(fp, "response %.4f %.5g %.2f\n", frequency, gain, phase);
+	}
+	fclose(fp);
+	printf("Saved to %s\n", filename);
+	return 0;
+}
+
+/**************************************************
+ * NAME: int latency_load(const char *channelName, float *delay)
+ *
+ * DESCRIPTION:
+ * 		Reads the transport delay measured for a channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *channelName:	The name of the channel.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float *delay:	Seconds, untouched if not measured.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if the channel has not been measured.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int latency_load(const char *channelName, float *delay)
+{
+	char filename[CHANNEL_NAME_LENGTH + sizeof(LATENCY_FILE_FORMAT)];
+	snprintf(filename, sizeof(filename), LATENCY_FILE_FORMAT, channelName);
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+		return 1;
+
+	char line[256];
+	int found = 1;
+	while (fgets(line, sizeof(line), fp))
+	{
+		float value;
+		if (sscanf(line, "delay %f", &value) == 1 && value >= 0.0)
+		{
+			*delay = value;
+			found = 0;
+		}
+	}
+	fclose(fp);
+	return found;
+}
@@ -3,27 +3,52 @@
  *
  * DESCRIPTION:
  *		This is the entry point for the dynamic positioning program. This file
- * 		combines everything. The program runs in a loop, reading sensor data and
- * 		updating the servo motor to counter unwanted changes. It also handles
- * 		printing values to the screen and starts up a new thread which visualizes
- * 		the boat and handles input.
+ * 		combines everything. The program runs one or more control channels, each
+ * 		reading sensor data and updating a servo motor to counter unwanted changes.
+ * 		It also handles printing values to the screen and starts up a new thread
+ * 		which visualizes the boats and handles input.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 21.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
  **************************************************/
 
 #include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "headers/actuator.h"
+#include "headers/archive.h"
+#include "headers/calibration.h"
+#include "headers/command_server.h"
+#include "headers/gain_schedule.h"
+#include "headers/control_runtime.h"
+#include "headers/latency_probe.h"
 #include "headers/main.h"
+#include "headers/metrics.h"
+#include "headers/mpc_benchmark.h"
 #include "headers/phidget_connection.h"
+#include "headers/scenarios.h"
+#include "headers/session.h"
+#include "headers/startup.h"
+#include "headers/telemetry.h"
 #include "headers/time_utils.h"
-#include "headers/visualization.h"
+#include "headers/trace.h"
+#include "headers/watchdog.h"
 
 // Constants used for setting the delays
-static const struct timespec LOOP_DELAY = { 0, 20000000L };		// 0.02 seconds
 static const struct timespec PRINT_DELAY = { 0, 100000000L };	// 0.1 second
 
+#define FILENAME_LENGTH 64
+
+// the directory of this run and the logs of its channels, too large for the stack
+static Session session;
+static SessionLog logs[MAX_CHANNELS];
+static FILE *summary;	// of the run, NULL if it could not be created
+
+static ControlRuntime *signalledRuntime;	// stopped by SIGINT and SIGTERM
+
 /**************************************************
  * NAME: static void plot(char *filename)
  *
@@ -72,127 +97,446 @@ static void plot(char *filename)
 	pclose(gnuplot2);
 }
 
+/**************************************************
+ * NAME: static void archive_filename(char *filename, const ControlChannel *channel)
+ *
+ * DESCRIPTION:
+ * 		Gives the name of the archive the data of a channel is appended to, kept
+ * 		across runs unlike the output file.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const ControlChannel *channel:	The channel.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			char *filename:	The file name, FILENAME_LENGTH characters long at most.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void archive_filename(char *filename, const ControlChannel *channel)
+{
+	snprintf(filename, FILENAME_LENGTH, "archive_%s.dpa", (*channel).name);
+}
+
+/**************************************************
+ * NAME: static int export_archive(const char *filename, int64_t from, int64_t to)
+ *
+ * DESCRIPTION:
+ * 		Prints the rows of an archive within a time window, in the columns of
+ * 		the output files with the time in seconds since the Unix epoch.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *filename:	The archive.
+ * 			int64_t from:			Start of the window [us since the epoch].
+ * 			int64_t to:				End of the window.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int export_archive(const char *filename, int64_t from, int64_t to)
+{
+	static ArchiveReader reader;
+	static ArchiveRow rows[ARCHIVE_BLOCK_ROWS];	// too large for the stack
+
+	if (archive_reader_open(&reader, filename))
+		return 1;
+
+	printf("#\t%17s\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\n", "time[s]", "sensor", "output",
+			"setpoint", "P-term", "I-term", "D-term");
+	long count;
+	while (from <= to && (count = archive_read_range(&reader, from, to, rows,
+			ARCHIVE_BLOCK_ROWS)) > 0)
+	{
+		for (long r = 0; r < count; r++)
+		{
+			printf(" \t%17.6f", rows[r].time / 1e6);
+			for (int v = 0; v < ARCHIVE_VALUES; v++)
+				printf("\t%8.3f", rows[r].values[v]);
+			printf("\n");
+		}
+		from = rows[count - 1].time + 1;	// continue after the last row
+	}
+
+	archive_reader_close(&reader);
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void report_steps(ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Prints the steps the channels have completed since the last call, to
+ * 		screen and to the summary of the run. Must only be called from one thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime with its channels.
+ * 		EXTERNALS:
+ * 			FILE *summary:	The summary of the run.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void report_steps(ControlRuntime *runtime)
+{
+	for (int c = 0; c < (*runtime).channelCount; c++)
+	{
+		ControlChannel *channel = &(*runtime).channels[c];
+		StepResult result;
+		while (step_analytics_take(&(*channel).analytics, &result))
+		{
+			float time = nano_to_sec(result.start - (*runtime).startTime);
+			step_analytics_print(stdout, (*channel).name, &result, time);
+			if (summary)
+			{
+				step_analytics_print(summary, (*channel).name, &result, time);
+				fflush(summary);	// kept if the program does not end cleanly
+			}
+		}
+	}
+}
+
 /**************************************************
  * NAME: static void *printer_func(void *void_ptr)
  *
  * DESCRIPTION:
- * 		Prints values to screen and writes them to file in a timed loop. This function
- * 		is run in a separate thread, hence the pointer in the function name and the
- * 		void pointer parameter. This is a format enforced by the thread.
+ * 		Prints values to screen and writes them to file in a timed loop, one log
+ * 		per channel in the directory of the session. This function is run in a
+ * 		separate thread, hence the pointer in the function name and the void
+ * 		pointer parameter. This is a format enforced by the thread.
  *
  * INPUTS:
  * 		PARAMETERS:
- *      	void *void_ptr:	A pointer to a 'BoatData' struct containing
- *      					always updated values from the current run.
+ *      	void *void_ptr:	A pointer to the 'ControlRuntime' whose channels
+ *      					contain always updated values from the current run.
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 21.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 static void *printer_func(void *void_ptr)
 {
-	BoatData *data = (BoatData*) void_ptr;
-
-	FILE *fp = fopen("output.dat", "w");
+	ControlRuntime *runtime = (ControlRuntime*) void_ptr;
+	int channelCount = (*runtime).channelCount;
+
+	static ArchiveWriter archives[MAX_CHANNELS];	// too large for the stack
+	char columns[256];
+	snprintf(columns, sizeof(columns), "#\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\n", "time[s]",
+			"sensor", "output", "setpoint", "P-term", "I-term", "D-term");
+	for (int c = 0; c < channelCount; c++)
+	{
+		char filename[FILENAME_LENGTH];
+		archive_filename(filename, &(*runtime).channels[c]);
+		archive_open(&archives[c], filename);	// without it only the log is written
 
-	// create file header
-	fprintf(fp, "# Data gathered from running the dynamic positioning program.\n"
-			"#\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\n", "time[s]", "sensor", "output",
-			"setpoint", "P-term", "I-term", "D-term");
+		session_log_open(&logs[c], &session, (*runtime).channels[c].name, columns);
+	}
 
 	// continue to print to screen and write to file as long as the program is running
-	while ((*data).programRunning)
+	while (runtime_is_running(runtime))
 	{
 		nanosleep(&PRINT_DELAY, NULL);
-
-		// print to screen
-		printf("setpoint: %5.1f sensorValue: %5.1f servoValue: %5.1f\n",
-				1000.0 - (*data).setpoint, 1000.0 - (*data).sensorValue, (*data).servoValue);
-
-		// write to file
-		fprintf(fp, " \t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\n",
-				(*data).timePassed, 1000.0 - (*data).sensorValue,
-				MAX_OUTPUT - (*data).servoValue, 1000.0 - (*data).setpoint, -(*data).pid.Pterm,
-				MAX_OUTPUT - (*data).pid.Iterm, -(*data).pid.Dterm);
+		report_steps(runtime);
+
+		for (int c = 0; c < channelCount; c++)
+		{
+			BoatData *data = &(*runtime).channels[c].data;
+
+			// print to screen
+			printf("%-8s setpoint: %5.1f sensorValue: %5.1f servoValue: %5.1f\n",
+					(*runtime).channels[c].name, 1000.0 - (*data).setpoint,
+					1000.0 - (*data).sensorValue, (*data).servoValue);
+
+			// append to the archive
+			ArchiveRow row = { micro_wall_time(), { 1000.0 - (*data).sensorValue,
+					MAX_OUTPUT - (*data).servoValue, 1000.0 - (*data).setpoint,
+					-(*data).pid.Pterm, MAX_OUTPUT - (*data).pid.Iterm, -(*data).pid.Dterm } };
+			if (archives[c].fd >= 0)
+				archive_append(&archives[c], &row);
+
+			// write to file
+			if (!logs[c].running)
+				continue;
+			session_log_printf(&logs[c], " \t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\n",
+					(*data).timePassed, row.values[0], row.values[1], row.values[2],
+					row.values[3], row.values[4], row.values[5]);
+			metrics_record_logged(c);
+		}
 	}
 
-	fclose(fp);
+	for (int c = 0; c < channelCount; c++)
+	{
+		session_log_close(&logs[c]);
+		archive_close(&archives[c]);
+	}
 	return NULL;
 }
 
 /**************************************************
- * NAME: int main()
+ * NAME: static void stop_on_signal(int signalNumber)
  *
  * DESCRIPTION:
- * 		The main method. Sets up a connection to phidgets, starts threads for
- * 		visualization and printing, and starts the dynamic positioning control loop.
- * 		Upon exit it plots the recorded data.
+ * 		Ends the run on SIGINT (ctrl-c) or SIGTERM the same way as the quit command,
+ * 		so the motors are turned off and the data is saved.
  *
  * INPUTS:
- *     	none
+ * 		PARAMETERS:
+ * 			int signalNumber:	The signal, not used.
+ * 		EXTERNALS:
+ * 			ControlRuntime *signalledRuntime:	The runtime to stop.
  *
  * OUTPUTS:
- *		RETURNS:
- *			int:	0 if successful, 1 if failure.
+ * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 02.04.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-int main()
+static void stop_on_signal(int signalNumber)
 {
-	if (connect_phidgets())
-		return 1;	// could not connect
+	runtime_stop(signalledRuntime);	// an atomic store, safe in a signal handler
+}
 
-	// omitted fields are initialized to default values
-	BoatData boatData = { .programRunning = true };
+/**************************************************
+ * NAME: static void catch_stop_signals(ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Lets SIGINT (ctrl-c) and SIGTERM stop the runtime instead of killing the
+ * 		program, so whatever runs it can turn the motors off on the way out, and
+ * 		ignores SIGPIPE from clients leaving a socket.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime to stop.
+ *
+ * OUTPUTS:
+ * 		EXTERNALS:
+ * 			ControlRuntime *signalledRuntime:	The runtime.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static void catch_stop_signals(ControlRuntime *runtime)
+{
+	signalledRuntime = runtime;
+	struct sigaction stopAction = { .sa_handler = stop_on_signal };
+	sigaction(SIGINT, &stopAction, NULL);
+	sigaction(SIGTERM, &stopAction, NULL);
+	signal(SIGPIPE, SIG_IGN);
+}
 
-	// start thread for visualization
-	pthread_t visualizationThread;
-	pthread_create(&visualizationThread, NULL, start_animation, &boatData);
+/**************************************************
+ * NAME: int main(int argc, char *argv[])
+ *
+ * DESCRIPTION:
+ * 		The main method. Loads the control channels from CHANNELS_CONFIG, sets up a
+ * 		connection to phidgets, starts a thread for printing, and runs the dynamic
+ * 		positioning control loops until the quit command, ctrl-c or the watchdog
+ * 		ends them. There is no window, the viewer is a program of its own.
+ * 		With the argument --benchmark-mpc the controllers are compared on a
+ * 		simulated boat at the configured period instead, without any hardware.
+ * 		With --scenarios [update] the closed-loop scenarios are run on the
+ * 		simulated boat with the first channel's gains and compared to
+ * 		SCENARIO_BASELINE, or written to it.
+ * 		With --calibrate <channel> the sensor of a channel is calibrated from the
+ * 		positions entered for the boat.
+ * 		With --measure-latency [<channel>] the delay from writing the servo until
+ * 		the sensor responds is measured on the first or the named channel, until
+ * 		done or ctrl-c.
+ * 		With --export-archive <file> [<from> <to>] the rows of an archive are
+ * 		printed, optionally only those between two times in seconds since the
+ * 		Unix epoch.
+ * 		Live statistics are served on METRICS_SOCKET_PATH, every tick is published
+ * 		in shared memory as TELEMETRY_NAME and commands are accepted on
+ * 		COMMAND_SOCKET_PATH. A watchdog turns the motors off and ends the run if
+ * 		the loops miss their deadlines or a sensor fails. Every iteration of the
+ * 		loops is traced. Upon exit it writes the trace to 'trace.json', prints a
+ * 		latency summary and the models identified, and plots the recorded data of
+ * 		every channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int argc:		Number of arguments.
+ * 			char *argv[]:	The arguments.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+int main(int argc, char *argv[])
+{
+	static ControlRuntime runtime;	// too large for the stack
 
-	// start thread for printing and recording data
-	pthread_t printerThread;
-	pthread_create(&printerThread, NULL, printer_func, &boatData);
+	if (argc > 2 && strcmp(argv[1], "--export-archive") == 0)
+	{
+		int64_t from = argc > 4 ? (int64_t) (atof(argv[3]) * 1e6) : INT64_MIN;
+		int64_t to = argc > 4 ? (int64_t) (atof(argv[4]) * 1e6) : INT64_MAX;
+		return export_archive(argv[2], from, to);
+	}
 
-	boatData.startpoint = get_sensor_value();
+	if (runtime_load(&runtime, CHANNELS_CONFIG))
+		return 1;	// invalid configuration
 
-	// initialize setpoint to middle of the tank
-	boatData.setpoint = get_sensor_value() - TANK_WIDTH / 2;
+	if (argc > 1 && strcmp(argv[1], "--benchmark-mpc") == 0)
+	{
+		float delay = 0.0;
+		latency_load(runtime.channels[0].name, &delay);	// if measured on the rig
+		return mpc_benchmark(nano_to_sec(runtime.period), delay);
+	}
 
-	// main loop
-	unsigned long startTime = nano_time();
-	while (boatData.programRunning)
+	if (argc > 1 && strcmp(argv[1], "--scenarios") == 0)
 	{
-		nanosleep(&LOOP_DELAY, NULL);
+		float delay = 0.0;
+		latency_load(runtime.channels[0].name, &delay);	// if measured on the rig
+		return scenarios_run(&runtime.channels[0].pid,
+				runtime.channels[0].observer.bandwidth, nano_to_sec(runtime.period), delay,
+				SCENARIO_BASELINE, argc > 2 && strcmp(argv[2], "update") == 0);
+	}
 
-		// read position
-		float sensorValue = get_sensor_value();
+	if (argc > 2 && strcmp(argv[1], "--calibrate") == 0)
+	{
+		int channel = runtime_find_channel(&runtime, argv[2]);
+		if (channel < 0)
+		{
+			printf("No channel named %s\n", argv[2]);
+			return 1;
+		}
+		if (connect_phidgets())
+			return 1;	// could not connect
+		int result = calibration_record(runtime.channels[channel].name,
+				runtime.channels[channel].sensorIndex);
+		close_connections();
+		return result;
+	}
 
-		// calculate new servo value
-		PIDdata pid = pid_compute(sensorValue, boatData.setpoint);
+	if (argc > 1 && strcmp(argv[1], "--measure-latency") == 0)
+	{
+		if (connect_phidgets())
+			return 1;	// could not connect
+		int channel = argc > 2 ? runtime_find_channel(&runtime, argv[2]) : 0;
+		int result = 1;
+		if (channel < 0)
+			printf("No channel named %s\n", argv[2]);
+		else if (runtime_start(&runtime) == 0)
+		{
+			catch_stop_signals(&runtime);	// ctrl-c ends the probe with the motor off
+			result = latency_probe(&runtime, channel);
+		}
+		close_connections();
+		return result;
+	}
 
-		// set the new servo value
-		set_servo_position((double) pid.output);
+	// attach the devices at the same time
+	open_phidgets();
+	StartupStage stages[] = {
+			{ .name = "interface kit", .run = wait_for_interface_kit, .required = true },
+			{ .name = "servo", .run = wait_for_servo, .required = true }
+	};
+	if (startup_run(stages, sizeof(stages) / sizeof(stages[0])))
+	{
+		close_connections();
+		return 1;	// could not connect
+	}
 
-		float timePassed = nano_to_sec(nano_time() - startTime);
+	if (runtime_start(&runtime) || actuator_start(runtime.deadband))
+	{
+		close_connections();
+		return 1;	// a channel does not match the hardware
+	}
 
-		// update the data
-		boatData.sensorValue = sensorValue;
-		boatData.servoValue = pid.output;
-		boatData.timePassed = timePassed;
-		boatData.pid = pid;
+	// end the run cleanly on ctrl-c, and outlive clients leaving the command socket
+	catch_stop_signals(&runtime);
+
+	// serve live statistics and accept commands, the control loops run fine without them;
+	// set up before the printer, which records into the statistics
+	const char *channelNames[MAX_CHANNELS];
+	for (int c = 0; c < runtime.channelCount; c++)
+		channelNames[c] = runtime.channels[c].name;
+	metrics_start_server(METRICS_SOCKET_PATH, nano_to_sec(runtime.period), channelNames,
+			runtime.channelCount);
+	telemetry_open(TELEMETRY_NAME, nano_to_sec(runtime.period), channelNames,
+			runtime.channelCount);	// without it the loops run unobserved
+	command_server_start(COMMAND_SOCKET_PATH, &runtime);
+	gain_schedule_start_reloader();	// gain tables can be edited while running
+
+	// start thread for printing and recording data, in a directory of this run
+	session_create(&session, &runtime);
+	summary = session_open_summary(&session);
+	pthread_t printerThread;
+	pthread_create(&printerThread, NULL, printer_func, &runtime);
+
+	// turn the motors off if the control loops miss their deadlines
+	char watchdogLog[SESSION_PATH_LENGTH + sizeof(WATCHDOG_LOG) + 1];
+	if (session.directory[0] != '\0')
+		snprintf(watchdogLog, sizeof(watchdogLog), "%s/%s", session.directory, WATCHDOG_LOG);
+	else
+		snprintf(watchdogLog, sizeof(watchdogLog), "%s", WATCHDOG_LOG);
+	if (watchdog_start(&runtime, watchdogLog))
+	{
+		runtime_stop(&runtime);	// not without the watchdog
+		printf("Stopping, the motors would not be watched\n");
 	}
 
-	set_servo_position(0.0);	// turn off motor
-	close_connections();    	// close phidget connections
+	// run the control loops until the program is ended
+	runtime_run(&runtime);
+	watchdog_stop();
+	actuator_stop();		// write the last positions
+	close_connections();	// close phidget connections
 
 	// join threads
-	pthread_join(visualizationThread, NULL);
 	pthread_join(printerThread, NULL);
 
-	// plot results
-	plot("output.dat");
+	// report the steps still running and the totals of the run
+	for (int c = 0; c < runtime.channelCount; c++)
+		step_analytics_finish(&runtime.channels[c].analytics);
+	report_steps(&runtime);
+	printf("\nSteps:\n");
+	if (summary)
+		fprintf(summary, "\n# totals\n");
+	for (int c = 0; c < runtime.channelCount; c++)
+	{
+		step_analytics_print_totals(stdout, runtime.channels[c].name,
+				&runtime.channels[c].analytics);
+		if (summary)
+			step_analytics_print_totals(summary, runtime.channels[c].name,
+					&runtime.channels[c].analytics);
+	}
+	if (summary)
+		fclose(summary);
+	metrics_stop_server();
+	telemetry_close();
+	command_server_stop();
+	gain_schedule_stop_reloader();
+
+	// export the latency trace of the control loops
+	trace_export_chrome("trace.json");
+	trace_print_summary();
+	trace_cleanup();
+
+	// print the models identified while running
+	for (int c = 0; c < runtime.channelCount; c++)
+	{
+		PlantModel m;
+		plant_estimator_read(&runtime.channels[c].estimator, &m);
+		printf("Model of %s: y[k] = %.4f y[k-1] %+.4f y[k-2] %+.5f u[k-1] %+.5f u[k-2] "
+				"%+.4f, error variance %.4g%s\n", runtime.channels[c].name, m.a[0], m.a[1],
+				m.b[0], m.b[1], m.c, m.errorVariance,
+				m.dynamicsChanged ? ", dynamics changed lately" : "");
+	}
+
+	// plot the last part of the log of every channel
+	for (int c = 0; c < runtime.channelCount; c++)
+	{
+		if (logs[c].part > 0)
+			plot(logs[c].filename);
+	}
 
 	return 0;
 }
-
@@ -0,0 +1,360 @@
+/**************************************************
+ * FILENAME:	mesh_simplify.c
+ *
+ * DESCRIPTION:
+ * 		Simplifies a triangle mesh by vertex clustering with quadric error
+ * 		metrics. The bounding box of the mesh is divided into a grid of cubic
+ * 		cells and all vertices within a cell are merged into one. The merged
+ * 		vertex is placed where the sum of the squared distances to the planes of
+ * 		the triangles around it is least, which keeps edges and corners sharp
+ * 		where a plain average would round them off. Triangles with two corners in
+ * 		the same cell disappear.
+ *
+ * 		The work is linear in the size of the mesh, so levels of detail can be
+ * 		made every time the model is loaded. The error of a level is at most about
+ * 		the size of a cell.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int mesh_simplify(const Mesh *mesh, int resolution, Mesh *simplified,
+ * 				float *cellSize)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headers/mesh_simplify.h"
+
+#define EMPTY UINT32_MAX
+
+// the merged vertices of a cell
+typedef struct
+{
+	uint32_t key;		// the cell
+	double quadric[10];	// symmetric 4x4 matrix: a2 ab ac ad b2 bc bd c2 cd d2
+	double positionSum[3];
+	float normalSum[3];
+	int count;
+	float position[3];	// the merged vertex
+	float normal[3];
+} Cluster;
+
+/**************************************************
+ * NAME: static uint32_t hash(uint32_t key)
+ *
+ * DESCRIPTION:
+ * 		Spreads the bits of a key over the table.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			uint32_t key:	The key.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			uint32_t:	Its hash.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static uint32_t hash(uint32_t key)
+{
+	key ^= key >> 16;
+	key *= 0x7feb352d;
+	key ^= key >> 15;
+	key *= 0x846ca68b;
+	key ^= key >> 16;
+	return key;
+}
+
+/**************************************************
+ * NAME: static void add_plane(double quadric[10], const double plane[4], double weight)
+ *
+ * DESCRIPTION:
+ * 		Adds the squared distance to a plane to a quadric.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			double quadric[10]:		The quadric.
+ * 			const double plane[4]:	a, b, c, d of ax + by + cz + d = 0, normalized.
+ * 			double weight:			Weight of the plane, the area of its triangle.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			double quadric[10]:	The quadric with the plane.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void add_plane(double quadric[10], const double plane[4], double weight)
+{
+	int q = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = i; j < 4; j++)
+			quadric[q++] += weight * plane[i] * plane[j];
+	}
+}
+
+/**************************************************
+ * NAME: static void place(Cluster *cluster, const float low[3], const float high[3])
+ *
+ * DESCRIPTION:
+ * 		Places the merged vertex of a cluster where its quadric is least, or at
+ * 		the average of its vertices if that point is not well defined, e.g. on
+ * 		a flat part. The vertex is kept within its cell.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Cluster *cluster:		The cluster.
+ * 			const float low[3]:		Lower corner of the cell.
+ * 			const float high[3]:	Upper corner of the cell.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Cluster *cluster:	The cluster with its merged vertex.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void place(Cluster *cluster, const float low[3], const float high[3])
+{
+	const double *q = (*cluster).quadric;
+	double mean[3];
+	for (int i = 0; i < 3; i++)
+		mean[i] = (*cluster).positionSum[i] / (*cluster).count;
+
+	// solve A x = -b by Cramer's rule, A = [a2 ab ac; ab b2 bc; ac bc c2], b = [ad bd cd]
+	double a[3][3] = { { q[0], q[1], q[2] }, { q[1], q[4], q[5] }, { q[2], q[5], q[7] } };
+	double b[3] = { -q[3], -q[6], -q[8] };
+	double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+			- a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+			+ a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+	double trace = a[0][0] + a[1][1] + a[2][2];
+
+	double x[3];
+	if (fabs(det) > 1e-6 * trace * trace * trace)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			double m[3][3];
+			memcpy(m, a, sizeof(m));
+			for (int r = 0; r < 3; r++)
+				m[r][c] = b[r];
+			x[c] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+					- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+					+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / det;
+		}
+	} else
+	{
+		memcpy(x, mean, sizeof(x));
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (!isfinite(x[i]) || x[i] < low[i] || x[i] > high[i])
+			x[i] = mean[i];
+		(*cluster).position[i] = x[i];
+	}
+
+	float length = sqrtf((*cluster).normalSum[0] * (*cluster).normalSum[0]
+			+ (*cluster).normalSum[1] * (*cluster).normalSum[1]
+			+ (*cluster).normalSum[2] * (*cluster).normalSum[2]);
+	for (int i = 0; i < 3; i++)
+		(*cluster).normal[i] = length > 1e-6 ? (*cluster).normalSum[i] / length : 0.0;
+}
+
+/**************************************************
+ * NAME: int mesh_simplify(const Mesh *mesh, int resolution, Mesh *simplified,
+ * 				float *cellSize)
+ *
+ * DESCRIPTION:
+ * 		Makes a simpler version of a mesh by merging the vertices within every
+ * 		cell of a grid laid over it.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const Mesh *mesh:	The mesh.
+ * 			int resolution:		Cells along the longest side of the mesh, 2..1024.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Mesh *simplified:	The simpler mesh, to be freed with free_mesh().
+ * 			float *cellSize:	Size of a cell, about the largest error.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int mesh_simplify(const Mesh *mesh, int resolution, Mesh *simplified, float *cellSize)
+{
+	(*simplified).vertices = NULL;
+	(*simplified).vertexCount = 0;
+	int vertexCount = (*mesh).vertexCount;
+	if (vertexCount < 3)
+		return 1;
+
+	// the grid
+	float low[3], high[3];
+	memcpy(low, (*mesh).vertices[0].position, sizeof(low));
+	memcpy(high, low, sizeof(high));
+	for (int v = 1; v < vertexCount; v++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float p = (*mesh).vertices[v].position[i];
+			low[i] = p < low[i] ? p : low[i];
+			high[i] = p > high[i] ? p : high[i];
+		}
+	}
+	float extent = fmaxf(high[0] - low[0], fmaxf(high[1] - low[1], high[2] - low[2]));
+	float size = extent / resolution;
+	*cellSize = size;
+	if (size <= 0.0)
+		return 1;
+
+	// a table of at least twice the vertices, so probing stays short
+	uint32_t tableSize = 1;
+	while (tableSize < 2 * (uint32_t) vertexCount)
+		tableSize <<= 1;
+	uint32_t *table = malloc(tableSize * sizeof(uint32_t));
+	Cluster *clusters = calloc(vertexCount, sizeof(Cluster));
+	uint32_t *cornerCluster = malloc(vertexCount * sizeof(uint32_t));
+	(*simplified).vertices = malloc(vertexCount * sizeof(MeshVertex));
+	if (!table || !clusters || !cornerCluster || !(*simplified).vertices)
+	{
+		free(table);
+		free(clusters);
+		free(cornerCluster);
+		free_mesh(simplified);
+		return 1;
+	}
+	memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+	// the cluster of every corner
+	uint32_t clusterCount = 0;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		const float *p = (*mesh).vertices[v].position;
+		uint32_t cell[3];
+		for (int i = 0; i < 3; i++)
+		{
+			int c = (int) ((p[i] - low[i]) / size);
+			cell[i] = c < resolution ? c : resolution - 1;
+		}
+		uint32_t key = cell[0] + (resolution + 1) * (cell[1] + (resolution + 1) * cell[2]);
+
+		uint32_t slot = hash(key) & (tableSize - 1);
+		while (table[slot] != EMPTY && clusters[table[slot]].key != key)
+			slot = (slot + 1) & (tableSize - 1);
+		if (table[slot] == EMPTY)
+		{
+			table[slot] = clusterCount;
+			clusters[clusterCount++].key = key;
+		}
+		cornerCluster[v] = table[slot];
+
+		Cluster *cluster = &clusters[table[slot]];
+		for (int i = 0; i < 3; i++)
+		{
+			(*cluster).positionSum[i] += p[i];
+			(*cluster).normalSum[i] += (*mesh).vertices[v].normal[i];
+		}
+		(*cluster).count++;
+	}
+
+	// the planes of the triangles around every cluster
+	for (int t = 0; t + 2 < vertexCount; t += 3)
+	{
+		const float *p0 = (*mesh).vertices[t].position;
+		const float *p1 = (*mesh).vertices[t + 1].position;
+		const float *p2 = (*mesh).vertices[t + 2].position;
+		double e1[3], e2[3], n[3];
+		for (int i = 0; i < 3; i++)
+		{
+			e1[i] = p1[i] - p0[i];
+			e2[i] = p2[i] - p0[i];
+		}
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0.0)
+			continue;
+
+		double plane[4] = { n[0] / length, n[1] / length, n[2] / length, 0.0 };
+		plane[3] = -(plane[0] * p0[0] + plane[1] * p0[1] + plane[2] * p0[2]);
+		for (int corner = 0; corner < 3; corner++)
+			add_plane(clusters[cornerCluster[t + corner]].quadric, plane, length / 2.0);
+	}
+
+	for (uint32_t c = 0; c < clusterCount; c++)
+	{
+		uint32_t key = clusters[c].key;
+		uint32_t cell[3] = { key % (resolution + 1), key / (resolution + 1) % (resolution + 1),
+				key / (resolution + 1) / (resolution + 1) };
+		float cellLow[3], cellHigh[3];
+		for (int i = 0; i < 3; i++)
+		{
+			cellLow[i] = low[i] + cell[i] * size;
+			cellHigh[i] = cellLow[i] + size;
+		}
+		place(&clusters[c], cellLow, cellHigh);
+	}
+
+	// keep the triangles spanning three cells, once each
+	memset(table, 0xff, tableSize * sizeof(uint32_t));
+	int count = 0;
+	for (int t = 0; t + 2 < vertexCount; t += 3)
+	{
+		uint32_t a = cornerCluster[t], b = cornerCluster[t + 1], c = cornerCluster[t + 2];
+		if (a == b || b == c || a == c)
+			continue;
+
+		// the same three clusters in the same turn are the same triangle
+		uint32_t first = a < b ? (a < c ? 0 : 2) : (b < c ? 1 : 2);
+		uint32_t corners[3] = { a, b, c };
+		uint32_t k0 = corners[first], k1 = corners[(first + 1) % 3], k2 = corners[(first + 2) % 3];
+		uint32_t key = hash(k0 ^ hash(k1 ^ hash(k2)));
+		uint32_t slot = key & (tableSize - 1);
+		bool duplicate = false;
+		while (table[slot] != EMPTY)
+		{
+			const MeshVertex *other = &(*simplified).vertices[table[slot]];
+			if (memcmp((*other).position, clusters[k0].position, sizeof(float) * 3) == 0
+					&& memcmp(other[1].position, clusters[k1].position, sizeof(float) * 3) == 0
+					&& memcmp(other[2].position, clusters[k2].position, sizeof(float) * 3) == 0)
+			{
+				duplicate = true;
+				break;
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+		if (duplicate)
+			continue;
+		table[slot] = count;
+
+		// a cluster on both sides of a thin part has no normal of its own
+		const float *q0 = clusters[k0].position, *q1 = clusters[k1].position;
+		const float *q2 = clusters[k2].position;
+		float face[3] = { (q1[1] - q0[1]) * (q2[2] - q0[2]) - (q1[2] - q0[2]) * (q2[1] - q0[1]),
+				(q1[2] - q0[2]) * (q2[0] - q0[0]) - (q1[0] - q0[0]) * (q2[2] - q0[2]),
+				(q1[0] - q0[0]) * (q2[1] - q0[1]) - (q1[1] - q0[1]) * (q2[0] - q0[0]) };
+
+		const uint32_t ordered[3] = { k0, k1, k2 };
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const Cluster *cluster = &clusters[ordered[corner]];
+			MeshVertex *vertex = &(*simplified).vertices[count++];
+			memcpy((*vertex).position, (*cluster).position, sizeof(float) * 3);
+			bool hasNormal = (*cluster).normal[0] || (*cluster).normal[1] || (*cluster).normal[2];
+			memcpy((*vertex).normal, hasNormal ? (*cluster).normal : face, sizeof(float) * 3);
+		}
+	}
+	(*simplified).vertexCount = count;
+
+	free(table);
+	free(clusters);
+	free(cornerCluster);
+	return 0;
+}
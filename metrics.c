@@ -0,0 +1,706 @@
+/**************************************************
+ * FILENAME:	metrics.c
+ *
+ * DESCRIPTION:
+ * 		Live statistics of the control loops, served in the Prometheus text format
+ * 		on a Unix domain socket. Every control channel has its own statistics,
+ * 		labeled with the name of the channel. They are computed incrementally by
+ * 		the thread running the channel and published through a sequence lock per
+ * 		channel, so the control threads never wait for a reader or for each other.
+ * 		A separate server thread answers the requests, both plain HTTP requests
+ * 		(e.g. 'curl --unix-socket') and bare connections get the current metrics.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int metrics_start_server(const char *socketPath, float loopPeriod,
+ * 				const char *channelNames[], int count)
+ * 		void metrics_stop_server(void)
+ * 		void metrics_record_tick(int channel, unsigned long tickStart,
+ * 				float sensorValue, float setpoint, PIDdata pid)
+ * 		void metrics_record_model(int channel, const PlantModel *model)
+ * 		void metrics_record_logged(int channel)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "headers/actuator.h"
+#include "headers/metrics.h"
+#include "headers/seqlock.h"
+#include "headers/time_utils.h"
+
+// upper bounds of the jitter histogram buckets in seconds, +Inf is implicit
+static const float JITTER_BOUNDS[] = { 0.0001, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02 };
+#define JITTER_BUCKETS (sizeof(JITTER_BOUNDS) / sizeof(JITTER_BOUNDS[0]) + 1)
+
+// time constants of the exponential averages in seconds
+static const float RATE_TIME_CONSTANT = 1.0;
+static const float RMS_TIME_CONSTANT = 5.0;
+
+#define METRICS_NAME_LENGTH 16
+#define RESPONSE_SIZE (4096 * METRICS_MAX_CHANNELS)	// room for every channel
+
+typedef struct
+{
+	unsigned long ticks;
+	float loopRate;
+	unsigned long jitterCounts[JITTER_BUCKETS];
+	double jitterSum;
+	float meanSquaredError;
+	unsigned long saturatedMin;
+	unsigned long saturatedMax;
+	double windupSeconds;
+	unsigned long backlog;	// filled in when formatting
+	float position;
+	float setpoint;
+	float output;
+	float uptime;
+	PlantModel model;
+} MetricsSnapshot;
+
+typedef struct
+{
+	// state owned by the thread running the channel, on a cache line of its own
+	_Alignas(64) MetricsSnapshot current;
+	unsigned long startTime;
+	unsigned long lastTickStart;
+
+	// published copy, guarded by a sequence lock with the control thread as the only writer
+	MetricsSnapshot published;
+	_Atomic uint64_t sequence;
+	atomic_ulong publishedTicks;
+	atomic_ulong loggedTicks;
+
+	char name[METRICS_NAME_LENGTH];
+} MetricsChannel;
+
+// how a value of the snapshot is exposed
+typedef enum
+{
+	VALUE_COUNT,	// unsigned long
+	VALUE_FLOAT,
+	VALUE_DOUBLE,
+	VALUE_PRECISE,	// double with significant digits instead of decimals
+	VALUE_ROOT,		// square root of a float
+	VALUE_FLAG		// bool
+} ValueKind;
+
+typedef struct
+{
+	const char *name;
+	const char *type;
+	const char *help;
+	const char *labels;	// extra labels, NULL if none
+	size_t offset;		// of the value in MetricsSnapshot
+	ValueKind kind;
+} MetricInfo;
+
+// the metrics following the jitter histogram, in the order they are written
+static const MetricInfo METRICS[] = {
+	{ "dp_error_rms", "gauge",
+			"Root mean square of the position error, averaged over about 5 s.", NULL,
+			offsetof(MetricsSnapshot, meanSquaredError), VALUE_ROOT },
+	{ "dp_output_saturated_ticks_total", "counter", "Iterations with the output at a limit.",
+			"limit=\"min\"", offsetof(MetricsSnapshot, saturatedMin), VALUE_COUNT },
+	{ "dp_output_saturated_ticks_total", "counter", "Iterations with the output at a limit.",
+			"limit=\"max\"", offsetof(MetricsSnapshot, saturatedMax), VALUE_COUNT },
+	{ "dp_integral_windup_seconds_total", "counter",
+			"Time integrating while the output is saturated.", NULL,
+			offsetof(MetricsSnapshot, windupSeconds), VALUE_DOUBLE },
+	{ "dp_logger_backlog_ticks", "gauge", "Iterations not yet written by the logger.", NULL,
+			offsetof(MetricsSnapshot, backlog), VALUE_COUNT },
+	{ "dp_position", "gauge", "Measured position.", NULL,
+			offsetof(MetricsSnapshot, position), VALUE_FLOAT },
+	{ "dp_setpoint", "gauge", "Position setpoint.", NULL,
+			offsetof(MetricsSnapshot, setpoint), VALUE_FLOAT },
+	{ "dp_output", "gauge", "Servo output.", NULL,
+			offsetof(MetricsSnapshot, output), VALUE_FLOAT },
+	{ "dp_uptime_seconds", "gauge", "Time since the first iteration.", NULL,
+			offsetof(MetricsSnapshot, uptime), VALUE_FLOAT },
+	{ "dp_model_parameter", "gauge",
+			"Identified model y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c.",
+			"parameter=\"a1\"", offsetof(MetricsSnapshot, model.a[0]), VALUE_PRECISE },
+	{ "dp_model_parameter", "gauge",
+			"Identified model y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c.",
+			"parameter=\"a2\"", offsetof(MetricsSnapshot, model.a[1]), VALUE_PRECISE },
+	{ "dp_model_parameter", "gauge",
+			"Identified model y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c.",
+			"parameter=\"b1\"", offsetof(MetricsSnapshot, model.b[0]), VALUE_PRECISE },
+	{ "dp_model_parameter", "gauge",
+			"Identified model y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c.",
+			"parameter=\"b2\"", offsetof(MetricsSnapshot, model.b[1]), VALUE_PRECISE },
+	{ "dp_model_parameter", "gauge",
+			"Identified model y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c.",
+			"parameter=\"c\"", offsetof(MetricsSnapshot, model.c), VALUE_PRECISE },
+	{ "dp_model_parameter_deviation", "gauge",
+			"Standard deviation of the parameters of the identified model.",
+			"parameter=\"a1\"", offsetof(MetricsSnapshot, model.deviation[0]), VALUE_PRECISE },
+	{ "dp_model_parameter_deviation", "gauge",
+			"Standard deviation of the parameters of the identified model.",
+			"parameter=\"a2\"", offsetof(MetricsSnapshot, model.deviation[1]), VALUE_PRECISE },
+	{ "dp_model_parameter_deviation", "gauge",
+			"Standard deviation of the parameters of the identified model.",
+			"parameter=\"b1\"", offsetof(MetricsSnapshot, model.deviation[2]), VALUE_PRECISE },
+	{ "dp_model_parameter_deviation", "gauge",
+			"Standard deviation of the parameters of the identified model.",
+			"parameter=\"b2\"", offsetof(MetricsSnapshot, model.deviation[3]), VALUE_PRECISE },
+	{ "dp_model_parameter_deviation", "gauge",
+			"Standard deviation of the parameters of the identified model.",
+			"parameter=\"c\"", offsetof(MetricsSnapshot, model.deviation[4]), VALUE_PRECISE },
+	{ "dp_model_error_variance", "gauge",
+			"Variance of the one step prediction error of the identified model.", NULL,
+			offsetof(MetricsSnapshot, model.errorVariance), VALUE_PRECISE },
+	{ "dp_model_dynamics_changed", "gauge",
+			"1 if the dynamics have changed from those identified until lately.", NULL,
+			offsetof(MetricsSnapshot, model.dynamicsChanged), VALUE_FLAG } };
+#define METRIC_COUNT (sizeof(METRICS) / sizeof(METRICS[0]))
+
+static MetricsChannel channels[METRICS_MAX_CHANNELS];
+static int channelCount;	// set before the threads recording are started
+static float nominalPeriod;
+
+static int listenSocket = -1;
+static atomic_bool serverRunning;
+static pthread_t serverThread;
+static char socketFile[sizeof(((struct sockaddr_un*) 0)->sun_path)];
+
+/**************************************************
+ * NAME: static void publish(MetricsChannel *channel)
+ *
+ * DESCRIPTION:
+ * 		Copies the statistics of the control thread to the published snapshot. The
+ * 		sequence number is odd while the copy is in progress.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MetricsChannel *channel:	The channel with the statistics.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MetricsChannel *channel:	Updated copy of the statistics.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void publish(MetricsChannel *channel)
+{
+	seqlock_publish(&(*channel).sequence, &(*channel).published, &(*channel).current,
+			sizeof((*channel).current));
+	atomic_store_explicit(&(*channel).publishedTicks, (*channel).current.ticks,
+			memory_order_release);
+}
+
+/**************************************************
+ * NAME: static void read_snapshot(MetricsChannel *channel, MetricsSnapshot *snapshot)
+ *
+ * DESCRIPTION:
+ * 		Reads a consistent copy of the published statistics, retrying if the control
+ * 		thread published in the meantime.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MetricsChannel *channel:	The channel with the published statistics.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MetricsSnapshot *snapshot:	Where to store the copy.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void read_snapshot(MetricsChannel *channel, MetricsSnapshot *snapshot)
+{
+	seqlock_read(&(*channel).sequence, &(*channel).published, snapshot,
+			sizeof(*snapshot));
+}
+
+/**************************************************
+ * NAME: void metrics_record_tick(int channel, unsigned long tickStart,
+ * 				float sensorValue, float setpoint, PIDdata pid)
+ *
+ * DESCRIPTION:
+ * 		Updates the statistics of a channel with one iteration of its control loop
+ * 		and publishes them. Must only be called from the thread running the
+ * 		channel. Runs in constant time and never blocks.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int channel:				Index of the channel.
+ * 			unsigned long tickStart:	Start time of the iteration from nano_time().
+ * 			float sensorValue:			The measured position.
+ * 			float setpoint:				The setpoint used in this iteration.
+ * 			PIDdata pid:				Output and terms of the controller.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void metrics_record_tick(int channel, unsigned long tickStart, float sensorValue,
+		float setpoint, PIDdata pid)
+{
+	if (channel < 0 || channel >= channelCount)
+		return;
+
+	MetricsChannel *c = &channels[channel];
+	MetricsSnapshot *current = &(*c).current;
+
+	if ((*c).startTime == 0UL)
+		(*c).startTime = tickStart;
+
+	float error = setpoint - sensorValue;
+
+	if ((*c).lastTickStart != 0UL)
+	{
+		float period = nano_to_sec(tickStart - (*c).lastTickStart);
+
+		// loop rate as an exponential average of the instantaneous rate
+		float rateWeight = period / (RATE_TIME_CONSTANT + period);
+		if ((*current).loopRate == 0.0)
+			(*current).loopRate = 1.0 / period;
+		else
+			(*current).loopRate += (1.0 / period - (*current).loopRate) * rateWeight;
+
+		// jitter is the deviation from the nominal loop period
+		float jitter = fabsf(period - nominalPeriod);
+		unsigned int bucket = 0;
+		while (bucket < JITTER_BUCKETS - 1 && jitter > JITTER_BOUNDS[bucket])
+			bucket++;
+		(*current).jitterCounts[bucket]++;
+		(*current).jitterSum += jitter;
+
+		float errorWeight = period / (RMS_TIME_CONSTANT + period);
+		(*current).meanSquaredError += (error * error - (*current).meanSquaredError)
+				* errorWeight;
+
+		// the integral keeps growing while the output is stuck at a limit
+		if ((pid.output >= MAX_OUTPUT && error > 0.0)
+				|| (pid.output <= MIN_OUTPUT && error < 0.0))
+			(*current).windupSeconds += period;
+	}
+	(*c).lastTickStart = tickStart;
+
+	if (pid.output >= MAX_OUTPUT)
+		(*current).saturatedMax++;
+	else if (pid.output <= MIN_OUTPUT)
+		(*current).saturatedMin++;
+
+	(*current).ticks++;
+	(*current).position = 1000.0 - sensorValue;
+	(*current).setpoint = 1000.0 - setpoint;
+	(*current).output = pid.output;
+	(*current).uptime = nano_to_sec(tickStart - (*c).startTime);
+
+	publish(c);
+}
+
+/**************************************************
+ * NAME: void metrics_record_model(int channel, const PlantModel *model)
+ *
+ * DESCRIPTION:
+ * 		Updates the identified model of a channel, published with the next
+ * 		iteration. Must only be called from the thread running the channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int channel:				Index of the channel.
+ * 			const PlantModel *model:	The identified model.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void metrics_record_model(int channel, const PlantModel *model)
+{
+	if (channel < 0 || channel >= channelCount)
+		return;
+	channels[channel].current.model = *model;
+}
+
+/**************************************************
+ * NAME: void metrics_record_logged(int channel)
+ *
+ * DESCRIPTION:
+ * 		Tells the metrics that the logger has written everything published so far
+ * 		for a channel. The difference to the number of ticks is reported as the
+ * 		logger backlog.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int channel:	Index of the channel.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void metrics_record_logged(int channel)
+{
+	if (channel < 0 || channel >= channelCount)
+		return;
+	atomic_store(&channels[channel].loggedTicks, atomic_load(&channels[channel].publishedTicks));
+}
+
+/**************************************************
+ * NAME: static void append(char *buffer, int size, int *length, const char *format, ...)
+ *
+ * DESCRIPTION:
+ * 		Adds formatted text to a buffer, as much as fits. Once the buffer is full
+ * 		nothing more is written and the length stays at size - 1.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			char *buffer:			The text written so far.
+ * 			int size:				Size of the buffer.
+ * 			int *length:			Length of the text so far.
+ * 			const char *format:		Format of the text to add.
+ * 			...:					The values of the format.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			char *buffer:	The text with the addition, cut off if it did not fit.
+ * 			int *length:	The new length of the text.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void append(char *buffer, int size, int *length, const char *format, ...)
+		__attribute__((format(printf, 4, 5)));
+static void append(char *buffer, int size, int *length, const char *format, ...)
+{
+	if (*length >= size - 1)
+		return;	// full
+
+	va_list arguments;
+	va_start(arguments, format);
+	int written = vsnprintf(buffer + *length, size - *length, format, arguments);
+	va_end(arguments);
+
+	if (written < 0)
+		return;
+	*length += written;
+	if (*length > size - 1)
+		*length = size - 1;	// cut off
+}
+
+/**************************************************
+ * NAME: static int format_metrics(char *buffer, int size)
+ *
+ * DESCRIPTION:
+ * 		Writes the published statistics of all channels in the Prometheus text
+ * 		exposition format, grouped by metric.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			char *buffer:	Where to write the text.
+ * 			int size:		Size of the buffer.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	Length of the text.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int format_metrics(char *buffer, int size)
+{
+	MetricsSnapshot snapshots[METRICS_MAX_CHANNELS];
+	for (int c = 0; c < channelCount; c++)
+	{
+		MetricsSnapshot *s = &snapshots[c];
+		read_snapshot(&channels[c], s);
+		unsigned long logged = atomic_load(&channels[c].loggedTicks);
+		(*s).backlog = (*s).ticks > logged ? (*s).ticks - logged : 0;
+	}
+
+	int n = 0;
+	buffer[0] = '\0';	// also when nothing fits
+	append(buffer, size, &n,
+			"# HELP dp_loop_ticks_total Iterations of the control loop.\n"
+			"# TYPE dp_loop_ticks_total counter\n");
+	for (int c = 0; c < channelCount; c++)
+		append(buffer, size, &n, "dp_loop_ticks_total{channel=\"%s\"} %lu\n",
+				channels[c].name, snapshots[c].ticks);
+
+	append(buffer, size, &n,
+			"# HELP dp_loop_rate_hertz Rate of the control loop, averaged over about 1 s.\n"
+			"# TYPE dp_loop_rate_hertz gauge\n");
+	for (int c = 0; c < channelCount; c++)
+		append(buffer, size, &n, "dp_loop_rate_hertz{channel=\"%s\"} %.3f\n",
+				channels[c].name, snapshots[c].loopRate);
+
+	append(buffer, size, &n,
+			"# HELP dp_loop_jitter_seconds Deviation of the loop period from %.3f s.\n"
+			"# TYPE dp_loop_jitter_seconds histogram\n", nominalPeriod);
+	for (int c = 0; c < channelCount; c++)
+	{
+		unsigned long cumulative = 0;
+		for (unsigned int i = 0; i < JITTER_BUCKETS; i++)
+		{
+			cumulative += snapshots[c].jitterCounts[i];
+			if (i < JITTER_BUCKETS - 1)
+				append(buffer, size, &n,
+						"dp_loop_jitter_seconds_bucket{channel=\"%s\",le=\"%g\"} %lu\n",
+						channels[c].name, JITTER_BOUNDS[i], cumulative);
+			else
+				append(buffer, size, &n,
+						"dp_loop_jitter_seconds_bucket{channel=\"%s\",le=\"+Inf\"} %lu\n",
+						channels[c].name, cumulative);
+		}
+		append(buffer, size, &n,
+				"dp_loop_jitter_seconds_sum{channel=\"%s\"} %.6f\n"
+				"dp_loop_jitter_seconds_count{channel=\"%s\"} %lu\n", channels[c].name,
+				snapshots[c].jitterSum, channels[c].name, cumulative);
+	}
+
+	for (unsigned int m = 0; m < METRIC_COUNT; m++)
+	{
+		const MetricInfo *metric = &METRICS[m];
+
+		// labeled series of the same metric share the description
+		if (m == 0 || strcmp((*metric).name, METRICS[m - 1].name) != 0)
+			append(buffer, size, &n, "# HELP %s %s\n# TYPE %s %s\n",
+					(*metric).name, (*metric).help, (*metric).name, (*metric).type);
+
+		for (int c = 0; c < channelCount; c++)
+		{
+			const char *value = (const char*) &snapshots[c] + (*metric).offset;
+			append(buffer, size, &n, "%s{channel=\"%s\"%s%s} ", (*metric).name,
+					channels[c].name, (*metric).labels ? "," : "",
+					(*metric).labels ? (*metric).labels : "");
+
+			switch ((*metric).kind)
+			{
+			case VALUE_COUNT:
+				append(buffer, size, &n, "%lu\n", *(const unsigned long*) value);
+				break;
+			case VALUE_FLOAT:
+				append(buffer, size, &n, "%.3f\n", *(const float*) value);
+				break;
+			case VALUE_DOUBLE:
+				append(buffer, size, &n, "%.3f\n", *(const double*) value);
+				break;
+			case VALUE_PRECISE:
+				append(buffer, size, &n, "%.6g\n", *(const double*) value);
+				break;
+			case VALUE_ROOT:
+				append(buffer, size, &n, "%.3f\n", sqrtf(*(const float*) value));
+				break;
+			case VALUE_FLAG:
+				append(buffer, size, &n, "%d\n", *(const bool*) value ? 1 : 0);
+				break;
+			}
+		}
+	}
+
+	// the servos are shared by the channels, so these are labeled by servo
+	append(buffer, size, &n,
+			"# HELP dp_actuator_positions_total Servo positions requested, by what became of them.\n"
+			"# TYPE dp_actuator_positions_total counter\n");
+	for (int i = 0; i < ACTUATOR_MAX_SERVOS; i++)
+	{
+		ActuatorStatistics a;
+		actuator_statistics(i, &a);
+		if (a.requested == 0)
+			continue;
+
+		unsigned long coalesced = a.requested - a.written - a.deadband;
+		append(buffer, size, &n,
+				"dp_actuator_positions_total{servo=\"%d\",result=\"written\"} %lu\n"
+				"dp_actuator_positions_total{servo=\"%d\",result=\"deadband\"} %lu\n"
+				"dp_actuator_positions_total{servo=\"%d\",result=\"coalesced\"} %lu\n", i,
+				a.written, i, a.deadband, i, coalesced);
+	}
+
+	return n;	// cut off at size - 1 if it did not fit
+}
+
+/**************************************************
+ * NAME: static void serve_client(int client)
+ *
+ * DESCRIPTION:
+ * 		Answers one connection. If the client sends an HTTP request the metrics are
+ * 		wrapped in an HTTP response, otherwise the bare text is written.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int client:	The connected socket.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void serve_client(int client)
+{
+	char request[512];
+	int length = 0;
+
+	// give the client a moment to send a request, bare connections send nothing
+	struct pollfd pfd = { client, POLLIN, 0 };
+	if (poll(&pfd, 1, 100) > 0)
+	{
+		length = read(client, request, sizeof(request) - 1);
+		if (length < 0)
+			length = 0;
+	}
+	request[length] = '\0';
+
+	static char body[RESPONSE_SIZE];	// only used by the server thread
+	int bodyLength = format_metrics(body, sizeof(body));
+
+	if (strncmp(request, "GET", 3) == 0)
+	{
+		char header[160];
+		int headerLength = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+				"Content-Type: text/plain; version=0.0.4\r\n"
+				"Content-Length: %d\r\n\r\n", bodyLength);
+		if (write(client, header, headerLength) < 0)
+			return;
+	}
+
+	if (write(client, body, bodyLength) < 0)
+		return;
+}
+
+/**************************************************
+ * NAME: static void *server_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Accepts connections on the metrics socket until the server is stopped. This
+ * 		function is run in a separate thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	Not used.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *server_func(void *void_ptr)
+{
+	while (atomic_load(&serverRunning))
+	{
+		// wake up regularly to check if the server should stop
+		struct pollfd pfd = { listenSocket, POLLIN, 0 };
+		if (poll(&pfd, 1, 200) <= 0)
+			continue;
+
+		int client = accept(listenSocket, NULL, NULL);
+		if (client < 0)
+			continue;
+
+		serve_client(client);
+		close(client);
+	}
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int metrics_start_server(const char *socketPath, float loopPeriod,
+ * 				const char *channelNames[], int count)
+ *
+ * DESCRIPTION:
+ * 		Sets up the statistics of the channels, creates the metrics socket and
+ * 		starts the thread serving it. An old socket file left behind by a previous
+ * 		run is replaced. Must be called before any thread recording into the
+ * 		statistics is started, the channels are not set up again.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *socketPath:		Path of the Unix domain socket.
+ * 			float loopPeriod:			Nominal period of the control loop in seconds.
+ * 			const char *channelNames[]:	Names of the channels, used as labels.
+ * 			int count:					Number of channels.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+int metrics_start_server(const char *socketPath, float loopPeriod,
+		const char *channelNames[], int count)
+{
+	nominalPeriod = loopPeriod;
+
+	if (count > METRICS_MAX_CHANNELS)
+	{
+		printf("Too many channels for the metrics, only the first %d are recorded\n",
+				METRICS_MAX_CHANNELS);
+		count = METRICS_MAX_CHANNELS;
+	}
+	for (int c = 0; c < count; c++)
+		snprintf(channels[c].name, METRICS_NAME_LENGTH, "%s", channelNames[c]);
+	channelCount = count;
+
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		printf("Metrics socket path too long: %s\n", socketPath);
+		return 1;
+	}
+	strcpy(address.sun_path, socketPath);
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+	{
+		perror("Could not create metrics socket");
+		return 1;
+	}
+
+	unlink(socketPath);
+	if (bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) < 0
+			|| listen(listenSocket, 4) < 0)
+	{
+		perror("Could not listen on metrics socket");
+		close(listenSocket);
+		listenSocket = -1;
+		return 1;
+	}
+	strcpy(socketFile, socketPath);
+
+	atomic_store(&serverRunning, true);
+	pthread_create(&serverThread, NULL, server_func, NULL);
+
+	printf("Serving metrics on %s\n", socketPath);
+	return 0;
+}
+
+/**************************************************
+ * NAME: void metrics_stop_server(void)
+ *
+ * DESCRIPTION:
+ * 		Stops the server thread and removes the socket.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void metrics_stop_server(void)
+{
+	if (listenSocket < 0)
+		return;
+
+	atomic_store(&serverRunning, false);
+	pthread_join(serverThread, NULL);
+
+	close(listenSocket);
+	listenSocket = -1;
+	unlink(socketFile);
+}
@@ -0,0 +1,176 @@
+/**************************************************
+ * FILENAME:	mpc_benchmark.c
+ *
+ * DESCRIPTION:
+ * 		Compares the controllers on a simulated boat, without any hardware. A
+ * 		channel follows large moves across the tank, as fast as the thruster
+ * 		allows, once with the PID-controller and once with the MPC, the latter also
+ * 		without warm starts. The simulated boat responds to the power after the
+ * 		transport delay measured on the rig, if any.
+ *
+ * 		For every run the tracking error, the time at the thrust limits and the
+ * 		time spent computing an iteration are printed. The worst case is compared
+ * 		to the period of the control loop, the budget of an iteration.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int mpc_benchmark(float period, float delay)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headers/control_channel.h"
+#include "headers/histogram.h"
+#include "headers/mpc_benchmark.h"
+#include "headers/simulated_boat.h"
+#include "headers/time_utils.h"
+
+#define SIMULATED_TIME 300.0	// seconds per run
+#define MOVE_INTERVAL 30.0		// seconds between moves
+#define MOVE_NEAR 40.0			// sensor units from the start of the tank
+#define MOVE_FAR 100.0
+
+// limits of the moves, close to what the simulated boat can do against the current
+#define MOVE_VELOCITY 2.5
+#define MOVE_ACCELERATION 3.0
+
+static const double START_POSITION = 400.0;	// printed units
+
+typedef struct
+{
+	const char *name;
+	ControllerMode controller;
+	bool warmStart;
+} BenchmarkRun;
+
+/**************************************************
+ * NAME: static void run(const BenchmarkRun *benchmarkRun, float period, float delay,
+ * 				Histogram *times)
+ *
+ * DESCRIPTION:
+ * 		Runs a channel on the simulated boat and prints the results.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const BenchmarkRun *benchmarkRun:	The controller to run.
+ * 			float period:						Seconds between iterations.
+ * 			float delay:						Seconds until the boat feels the power.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Histogram *times:	Time spent computing every iteration [ns].
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void run(const BenchmarkRun *benchmarkRun, float period, float delay,
+		Histogram *times)
+{
+	static ControlChannel channel;	// too large for the stack
+	static SimulatedBoat boat;
+	channel_init(&channel, (*benchmarkRun).name, 0, 0);
+	channel.controller = (*benchmarkRun).controller;
+
+	simulated_boat_init(&boat, START_POSITION, delay);
+	srand(1);	// the same noise for every run
+
+	unsigned long now = sec_to_nano(1.0);	// 0 means not started to the PID-controller
+	unsigned long step = sec_to_nano(period);
+	channel_start(&channel, 1000 - (int) boat.position, period);
+
+	// moves as fast as the thruster allows, not leaving margin like the default limits
+	trajectory_init(&channel.trajectory, channel.data.setpoint, MOVE_VELOCITY,
+			MOVE_ACCELERATION, TRAJECTORY_MAX_JERK);
+
+	histogram_reset(times);
+	double errorSquared = 0.0, maxError = 0.0;
+	int saturated = 0, maxIterations = 0;
+	int iterations = (int) (SIMULATED_TIME / period);
+	int moveIterations = (int) (MOVE_INTERVAL / period);
+
+	for (int i = 0; i < iterations; i++)
+	{
+		if (i % moveIterations == 0)
+		{
+			// alternate between the two sides of the tank
+			bool away = (i / moveIterations) % 2 == 0;
+			channel.data.target = channel.data.startpoint - (away ? MOVE_FAR : MOVE_NEAR);
+		}
+
+		// quantized sensor value with noise
+		int sensorValue = (int) lround(1000.0 - boat.position) + rand() % 3 - 1;
+
+		if (!(*benchmarkRun).warmStart)
+			memset(channel.mpc.solution, 0, sizeof(channel.mpc.solution));
+
+		unsigned long start = nano_time();
+		PIDdata pid = channel_update(&channel, sensorValue, now);
+		histogram_record(times, nano_time() - start);
+
+		double error = channel.data.setpoint - channel.data.sensorValue;
+		errorSquared += error * error;
+		if (fabs(error) > maxError)
+			maxError = fabs(error);
+		if (pid.output <= MIN_OUTPUT || pid.output >= MAX_OUTPUT)
+			saturated++;
+		if (channel.controller == CONTROLLER_MPC && channel.mpc.iterations > maxIterations)
+			maxIterations = channel.mpc.iterations;
+
+		// the boat over one period with the power held
+		simulated_boat_step(&boat, MAX_OUTPUT - pid.output, period);
+		now += step;
+	}
+
+	printf("%-10s %10.2f %10.2f %9.1f%% %10.1f %10.1f %10.1f %10d\n", (*benchmarkRun).name,
+			sqrt(errorSquared / iterations), maxError, 100.0 * saturated / iterations,
+			histogram_percentile(times, 50.0) / 1000.0,
+			histogram_percentile(times, 99.0) / 1000.0, (*times).max / 1000.0, maxIterations);
+}
+
+/**************************************************
+ * NAME: int mpc_benchmark(float period, float delay)
+ *
+ * DESCRIPTION:
+ * 		Runs the controllers on the simulated boat and prints how well they track
+ * 		and how long an iteration takes.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			float period:	Seconds between iterations of the control loop.
+ * 			float delay:	Seconds from writing the power until the boat feels it.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if the worst case iteration fits in the period, 1 if not.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int mpc_benchmark(float period, float delay)
+{
+	static Histogram times;	// too large for the stack
+	static const BenchmarkRun RUNS[] = { { "pid", CONTROLLER_PID, true },
+			{ "mpc", CONTROLLER_MPC, true }, { "mpc-cold", CONTROLLER_MPC, false } };
+
+	printf("Simulated %.0f s of %.0f unit moves every %.0f s, period %.1f ms, "
+			"delay %.1f ms\n", SIMULATED_TIME, MOVE_FAR - MOVE_NEAR, MOVE_INTERVAL,
+			period * 1000.0, delay * 1000.0);
+	printf("%-10s %10s %10s %10s %10s %10s %10s %10s\n", "controller", "error rms",
+			"error max", "saturated", "p50 [us]", "p99 [us]", "max [us]", "iterations");
+
+	unsigned long worst = 0;
+	for (unsigned int r = 0; r < sizeof(RUNS) / sizeof(RUNS[0]); r++)
+	{
+		run(&RUNS[r], period, delay, &times);
+		if (RUNS[r].warmStart && times.max > worst)
+			worst = times.max;
+	}
+
+	double budget = period * 1e6;
+	printf("Worst case %.1f us of the %.0f us budget (%.2f%%)\n", worst / 1000.0, budget,
+			100.0 * worst / 1000.0 / budget);
+	return worst / 1000.0 > budget;
+}
@@ -0,0 +1,491 @@
+/**************************************************
+ * FILENAME:	mpc_controller.c
+ *
+ * DESCRIPTION:
+ * 		Implementation of a linear model predictive controller, an alternative to
+ * 		the PID-controller that respects the thrust limits instead of clipping its
+ * 		output. Every iteration the position is predicted MPC_HORIZON iterations
+ * 		ahead with a model of the boat (see plant_estimator.h), and the powers
+ * 		minimizing
+ * 			sum (y - r)^2 + moveWeight * sum (change of power)^2
+ * 		within 0..MAX_OUTPUT - MIN_OUTPUT are found, y being the predicted and r the
+ * 		reference position from the trajectory. Only the first power is applied.
+ *
+ * 		The box constrained quadratic program is solved by accelerated projected
+ * 		gradient descent (FISTA) on fixed size arrays, without allocations and
+ * 		with a bounded number of iterations. It is warm started from the previous
+ * 		solution moved on by one iteration, which usually leaves only a few
+ * 		iterations to do. A constant force not explained by the model, e.g. a
+ * 		current or a wrong bias in the model, is estimated from the prediction
+ * 		errors, so the boat ends up at the reference without an integral term.
+ *
+ * 		The state is kept in printed positions, so the model may change between
+ * 		iterations, also its origin. The estimated force is then carried over as
+ * 		the same power at the current position.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void mpc_init(MPCController *mpc, float period)
+ * 		void mpc_default_model(PlantModel *model, float period)
+ * 		bool mpc_model_usable(const PlantModel *model)
+ * 		void mpc_reset(MPCController *mpc, float output)
+ * 		PIDdata mpc_compute(MPCController *mpc, const PlantModel *model, float input,
+ * 				const Trajectory *trajectory, unsigned long now)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "headers/mpc_controller.h"
+#include "headers/time_utils.h"
+
+#define H MPC_HORIZON
+#define M MPC_MOVES
+
+#define MAX_POWER (MAX_OUTPUT - MIN_OUTPUT)
+
+// found by tuning on the simulated boat
+#define DEFAULT_MOVE_WEIGHT 20.0
+#define DEFAULT_MAX_ITERATIONS 200
+
+static const double SOLVER_TOLERANCE = 1e-4;	// largest change of a power to stop at
+static const double DISTURBANCE_GAIN = 0.05;	// per iteration
+
+// the boat decelerates in the water by DRAG times its velocity
+static const double DRAG = 0.5;
+
+/**************************************************
+ * NAME: void mpc_init(MPCController *mpc, float period)
+ *
+ * DESCRIPTION:
+ * 		Initializes a controller with the tuned weights.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The controller to initialize.
+ * 			float period:		Seconds between iterations of the control loop.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The initialized controller.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void mpc_init(MPCController *mpc, float period)
+{
+	memset(mpc, 0, sizeof(*mpc));
+	(*mpc).period = period;
+	(*mpc).moveWeight = DEFAULT_MOVE_WEIGHT;
+	(*mpc).maxIterations = DEFAULT_MAX_ITERATIONS;
+	mpc_reset(mpc, MAX_OUTPUT);
+}
+
+/**************************************************
+ * NAME: void mpc_default_model(PlantModel *model, float period)
+ *
+ * DESCRIPTION:
+ * 		Gives the model of a boat accelerated by THRUST_ACCELERATION at full power
+ * 		and slowed down by drag, sampled at the period of the control loop. Used
+ * 		until a model has been identified.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			float period:	Seconds between iterations of the control loop.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			PlantModel *model:	The model.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void mpc_default_model(PlantModel *model, float period)
+{
+	memset(model, 0, sizeof(*model));
+
+	// exact discretization of x'' = -DRAG x' + gain u with the power held over a period
+	double gain = THRUST_ACCELERATION / MAX_POWER;
+	double pole = exp(-DRAG * period);
+	(*model).a[0] = 1.0 + pole;
+	(*model).a[1] = -pole;
+	(*model).b[0] = gain / DRAG * (period - (1.0 - pole) / DRAG);
+	(*model).b[1] = gain / DRAG * ((1.0 - pole) / DRAG - pole * period);
+}
+
+/**************************************************
+ * NAME: bool mpc_model_usable(const PlantModel *model)
+ *
+ * DESCRIPTION:
+ * 		Checks that the predictions of a model stay bounded over the horizon, up
+ * 		to an integrator, and that power moves the boat forward.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const PlantModel *model:	The model.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			bool:	true if the controller can use the model.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool mpc_model_usable(const PlantModel *model)
+{
+	double a1 = (*model).a[0], a2 = (*model).a[1];
+	if (!isfinite(a1) || !isfinite(a2) || !isfinite((*model).b[0])
+			|| !isfinite((*model).b[1]) || !isfinite((*model).c))
+		return false;
+
+	// both poles within the unit circle, or on it at 1
+	static const double MARGIN = 1e-3;
+	if (fabs(a2) > 1.0 || fabs(a1) > 1.0 - a2 + MARGIN)
+		return false;
+
+	return (*model).b[0] + (*model).b[1] > 0.0;
+}
+
+/**************************************************
+ * NAME: void mpc_reset(MPCController *mpc, float output)
+ *
+ * DESCRIPTION:
+ * 		Forgets the state from previous iterations, as if the controller was
+ * 		started for the first time. Used when the control loop has been paused or
+ * 		another controller ran in the meantime.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The controller.
+ * 			float output:		The servo output currently applied.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The controller without state.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void mpc_reset(MPCController *mpc, float output)
+{
+	double power = MAX_OUTPUT - output;
+	(*mpc).started = false;
+	(*mpc).lastPower = power;
+	(*mpc).disturbance = 0.0;
+	for (int m = 0; m < M; m++)
+		(*mpc).solution[m] = power;
+}
+
+/**************************************************
+ * NAME: static bool same_model(const PlantModel *a, const PlantModel *b)
+ *
+ * DESCRIPTION:
+ * 		Compares the parameters of two models.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const PlantModel *a:	A model.
+ * 			const PlantModel *b:	Another model.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			bool:	true if they predict the same.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static bool same_model(const PlantModel *a, const PlantModel *b)
+{
+	return (*a).a[0] == (*b).a[0] && (*a).a[1] == (*b).a[1] && (*a).b[0] == (*b).b[0]
+			&& (*a).b[1] == (*b).b[1] && (*a).c == (*b).c && (*a).origin == (*b).origin;
+}
+
+/**************************************************
+ * NAME: static void rebase(MPCController *mpc, const PlantModel *model, double position)
+ *
+ * DESCRIPTION:
+ * 		Carries the estimated disturbance over to another model. What the boat is
+ * 		pushed by is expressed as the power holding it at the current position,
+ * 		and the disturbance of the new model is chosen to need the same power.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:			The controller with the model of the previous
+ * 										iteration.
+ * 			const PlantModel *model:	The new model.
+ * 			double position:			The current printed position.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The controller with the disturbance of the new model.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void rebase(MPCController *mpc, const PlantModel *model, double position)
+{
+	const PlantModel *old = &(*mpc).model;
+	double oldGain = (*old).b[0] + (*old).b[1];
+	double newGain = (*model).b[0] + (*model).b[1];
+	if (oldGain <= 0.0 || newGain <= 0.0)
+	{
+		(*mpc).disturbance = 0.0;	// no power to express it in
+		return;
+	}
+
+	// at rest y (1 - a1 - a2) = (b1 + b2) u + c + disturbance, so the boat is pushed
+	// as if by the power -u holding it
+	double y = position - (*old).origin;
+	double force = ((*old).a[0] + (*old).a[1] - 1.0) * y + (*old).c + (*mpc).disturbance;
+	force /= oldGain;
+
+	y = position - (*model).origin;
+	(*mpc).disturbance = force * newGain - (*model).c
+			- ((*model).a[0] + (*model).a[1] - 1.0) * y;
+}
+
+/**************************************************
+ * NAME: static void build_problem(MPCController *mpc, const PlantModel *model,
+ * 				double position, const double reference[], double *firstFree,
+ * 				double *firstGain)
+ *
+ * DESCRIPTION:
+ * 		Builds the quadratic program 0.5 x'Qx + g'x over the powers of the moves
+ * 		from the predictions of the model, and an upper bound on its largest
+ * 		eigenvalue.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:			The controller.
+ * 			const PlantModel *model:	The model, positions relative to its origin.
+ * 			double position:			The current position relative to the origin.
+ * 			const double reference[]:	The reference for the next H iterations.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The hessian, gradient and lipschitz constant.
+ * 			double *firstFree:	Position predicted for the next iteration without power.
+ * 			double *firstGain:	Change of that position per unit of the first power.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void build_problem(MPCController *mpc, const PlantModel *model, double position,
+		const double reference[], double *firstFree, double *firstGain)
+{
+	double a1 = (*model).a[0], a2 = (*model).a[1];
+	double b1 = (*model).b[0], b2 = (*model).b[1];
+	double bias = (*model).c + (*mpc).disturbance;
+
+	// step response: position j iterations after the power was raised by one
+	double step[H + 1];
+	double impulse1 = 0.0, impulse2 = 0.0;
+	step[0] = 0.0;
+	for (int j = 1; j <= H; j++)
+	{
+		double impulse = a1 * impulse1 + a2 * impulse2 + (j == 1 ? b1 : 0.0)
+				+ (j == 2 ? b2 : 0.0);
+		step[j] = step[j - 1] + impulse;
+		impulse2 = impulse1;
+		impulse1 = impulse;
+	}
+
+	// free response: the positions if no power is given from now on, minus the reference
+	double error[H];
+	double y1 = position, y2 = (*mpc).lastPosition - (*model).origin;
+	for (int j = 0; j < H; j++)
+	{
+		double y = a1 * y1 + a2 * y2 + (j == 0 ? b2 * (*mpc).lastPower : 0.0) + bias;
+		error[j] = y - reference[j];
+		y2 = y1;
+		y1 = y;
+	}
+	*firstFree = error[0] + reference[0];
+
+	// gain from the power of every move to every predicted position
+	double gains[H][M];
+	for (int j = 0; j < H; j++)
+	{
+		for (int m = 0; m < M; m++)
+		{
+			// powers applied in iterations first..last reach position j + 1
+			int first = m * MPC_BLOCK;
+			int last = m == M - 1 ? H - 1 : first + MPC_BLOCK - 1;
+			if (last > j)
+				last = j;
+			gains[j][m] = first > j ? 0.0 : step[j + 1 - first] - step[j - last];
+		}
+	}
+	*firstGain = gains[0][0];
+
+	// Q = 2 (G'G + w D'D), g = 2 (G'e - w u[k-1] e1), the factor 2 is left out
+	double weight = (*mpc).moveWeight;
+	for (int m = 0; m < M; m++)
+	{
+		for (int n = m; n < M; n++)
+		{
+			double sum = 0.0;
+			for (int j = 0; j < H; j++)
+				sum += gains[j][m] * gains[j][n];
+			(*mpc).hessian[m][n] = (*mpc).hessian[n][m] = sum;
+		}
+
+		double sum = 0.0;
+		for (int j = 0; j < H; j++)
+			sum += gains[j][m] * error[j];
+		(*mpc).gradient[m] = sum;
+
+		// changes of power, the first one from the power applied now
+		(*mpc).hessian[m][m] += m < M - 1 ? 2.0 * weight : weight;
+		if (m > 0)
+			(*mpc).hessian[m][m - 1] = (*mpc).hessian[m - 1][m] -= weight;
+	}
+	(*mpc).gradient[0] -= weight * (*mpc).lastPower;
+
+	// Gershgorin bound on the largest eigenvalue
+	double lipschitz = 0.0;
+	for (int m = 0; m < M; m++)
+	{
+		double sum = 0.0;
+		for (int n = 0; n < M; n++)
+			sum += fabs((*mpc).hessian[m][n]);
+		if (sum > lipschitz)
+			lipschitz = sum;
+	}
+	(*mpc).lipschitz = lipschitz;
+}
+
+/**************************************************
+ * NAME: static int solve(MPCController *mpc)
+ *
+ * DESCRIPTION:
+ * 		Minimizes the quadratic program within the power limits by FISTA, starting
+ * 		from the previous solution.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The controller with the problem and the last solution.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The new solution.
+ * 		RETURN:
+ * 			int:	The number of iterations used.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int solve(MPCController *mpc)
+{
+	double *x = (*mpc).solution;
+	double y[M], next[M];
+	double stepSize = 1.0 / (*mpc).lipschitz;
+	double t = 1.0;
+
+	for (int m = 0; m < M; m++)
+		y[m] = x[m];
+
+	int iteration = 0;
+	while (iteration < (*mpc).maxIterations)
+	{
+		iteration++;
+
+		// projected gradient step from the extrapolated point
+		double change = 0.0;
+		for (int m = 0; m < M; m++)
+		{
+			double gradient = (*mpc).gradient[m];
+			for (int n = 0; n < M; n++)
+				gradient += (*mpc).hessian[m][n] * y[n];
+
+			double value = y[m] - stepSize * gradient;
+			if (value < 0.0)
+				value = 0.0;
+			else if (value > MAX_POWER)
+				value = MAX_POWER;
+			next[m] = value;
+
+			if (fabs(value - x[m]) > change)
+				change = fabs(value - x[m]);
+		}
+
+		double tNext = (1.0 + sqrt(1.0 + 4.0 * t * t)) / 2.0;
+		double momentum = (t - 1.0) / tNext;
+		for (int m = 0; m < M; m++)
+		{
+			y[m] = next[m] + momentum * (next[m] - x[m]);
+			x[m] = next[m];
+		}
+		t = tNext;
+
+		if (change < SOLVER_TOLERANCE)
+			break;
+	}
+	return iteration;
+}
+
+/**************************************************
+ * NAME: PIDdata mpc_compute(MPCController *mpc, const PlantModel *model, float input,
+ * 				const Trajectory *trajectory, unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Computes the output of one iteration of the control loop: updates the
+ * 		estimated disturbance, predicts the positions along the trajectory and
+ * 		solves for the powers. The allocation free solver runs in bounded time.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:				The controller with its weights and state.
+ * 			const PlantModel *model:		The model of the boat, see mpc_model_usable().
+ * 			float input:					The measured position in sensor units.
+ * 			const Trajectory *trajectory:	The trajectory to follow, looked ahead on.
+ * 			unsigned long now:				Time of the input from nano_time().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			MPCController *mpc:	The updated state.
+ * 		RETURN:
+ * 			PIDdata:	The power output, the PID terms are 0.0.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+PIDdata mpc_compute(MPCController *mpc, const PlantModel *model, float input,
+		const Trajectory *trajectory, unsigned long now)
+{
+	double printed = 1000.0 - input;
+	if (!(*mpc).started)
+	{
+		(*mpc).started = true;
+		(*mpc).lastPosition = printed;
+		(*mpc).model = *model;
+	} else
+	{
+		// the error of the prediction made with the model of the previous iteration
+		(*mpc).disturbance += DISTURBANCE_GAIN * (printed - (*mpc).predicted);
+		if (!same_model(model, &(*mpc).model))
+		{
+			rebase(mpc, model, printed);
+			(*mpc).model = *model;
+		}
+	}
+
+	// warm start from the last solution moved on by one iteration, the moves are
+	// MPC_BLOCK iterations long
+	for (int m = 0; m < M - 1; m++)
+		(*mpc).solution[m] += ((*mpc).solution[m + 1] - (*mpc).solution[m]) / MPC_BLOCK;
+
+	// the model works on printed positions relative to its origin
+	double position = printed - (*model).origin;
+	double reference[H];
+	unsigned long period = sec_to_nano((*mpc).period);
+	for (int j = 0; j < H; j++)
+	{
+		TrajectoryPoint point = trajectory_evaluate(trajectory, now + (j + 1) * period);
+		reference[j] = 1000.0 - point.position - (*model).origin;
+	}
+
+	double firstFree, firstGain;
+	build_problem(mpc, model, position, reference, &firstFree, &firstGain);
+	(*mpc).iterations = solve(mpc);
+
+	double power = (*mpc).solution[0];
+	(*mpc).predicted = firstFree + firstGain * power + (*model).origin;
+	(*mpc).lastPosition = printed;
+	(*mpc).lastPower = power;
+
+	PIDdata res = { MAX_OUTPUT - power, 0.0, 0.0, 0.0, 0.0 };
+	return res;
+}
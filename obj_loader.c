@@ -2,66 +2,70 @@
  * FILENAME:	obj_loader.c
  *
  * DESCRIPTION:
- * 		Contains a function for loading wavefront .obj files into OpenGL.
+ * 		Contains a function for loading wavefront .obj files into a mesh that can
+ * 		be copied to an OpenGL vertex buffer.
  *
  * PUBLIC FUNCTIONS:
- * 		GLuint load_obj(char fname[])
+ * 		int load_obj(const char *filename, Mesh *mesh)
+ * 		void free_mesh(Mesh *mesh)
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 
-#include <GL/gl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "headers/obj_loader.h"
+
 /**************************************************
- * NAME: GLuint load_obj(char fname[])
+ * NAME: int load_obj(const char *filename, Mesh *mesh)
  *
  * DESCRIPTION:
- * 		Loads the data from a wavefront .obj file into OpenGl compatible format.
+ * 		Loads the data from a wavefront .obj file into a list of triangles.
  * 		An .obj file is a geometry definition file format containing vertices,
  * 		normals, texture coordinates and faces. Description of the file format can
  * 		be found here: https://en.wikipedia.org/wiki/Wavefront_.obj_file#File_format
+ * 		Only triangles with vertex, texture and normal indices are read, the
+ * 		texture coordinates are not used.
  *
  * INPUTS:
  * 		PARAMETERS:
- *      	char fname[]:	The file name to extract the data from.
+ *      	const char *filename:	The file name to extract the data from.
  *
  * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Mesh *mesh:	The triangles, to be freed with free_mesh().
  *		RETURNS:
- *			GLuint:	A reference to a openGL display list containing the model from the .obj file.
+ *			int:	0 if successful, 1 if failure.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-GLuint load_obj(char fname[])
+int load_obj(const char *filename, Mesh *mesh)
 {
+	(*mesh).vertices = NULL;
+	(*mesh).vertexCount = 0;
+
 	// open file
 	FILE *fp;
-	fp = fopen(fname, "r");
+	fp = fopen(filename, "r");
 	if (!fp)
 	{
-		printf("can't open file: %s\n", fname);
-		exit(1);
+		printf("can't open file: %s\n", filename);
+		return 1;
 	}
 
 	// Count occurrences of the different data types
 	int nV = 0;		// number of vertices
-	int nVT = 0;	// number of vertex textures
 	int nVN = 0;	// number of vertex normals
 	int nF = 0;		// number of faces/triangles
 
 	char firstWord[30];
-	while (!feof(fp))
+	while (fscanf(fp, "%29s%*[^\n]", firstWord) == 1)	// reads only first word
 	{
-		fscanf(fp, "%s%*[^\n]", firstWord);	// reads only first word
-
 		if (strcmp(firstWord, "v") == 0)
 		{
 			nV++;
-		} else if (strcmp(firstWord, "vt") == 0)
-		{
-			nVT++;
 		} else if (strcmp(firstWord, "vn") == 0)
 		{
 			nVN++;
@@ -70,36 +74,34 @@ GLuint load_obj(char fname[])
 			nF++;
 		}
 	}
-	fclose(fp);
 
-	// open file again, we need to read from the start now that
-	// we know how many occurrences there are of each data type.
-	fp = fopen(fname, "r");
-	if (!fp)
+	// read again from the start now that we know how many occurrences there are
+	// of each data type
+	rewind(fp);
+
+	// arrays to store data in, too large for the stack
+	float (*vertices)[3] = malloc((nV + 1) * sizeof(*vertices));
+	float (*normals)[3] = malloc((nVN + 1) * sizeof(*normals));
+	(*mesh).vertices = malloc((3 * nF + 1) * sizeof(MeshVertex));
+	if (!vertices || !normals || !(*mesh).vertices)
 	{
-		printf("can't open file: %s\n", fname);
-		exit(1);
+		printf("Out of memory loading %s\n", filename);
+		free(vertices);
+		free(normals);
+		fclose(fp);
+		free_mesh(mesh);
+		return 1;
 	}
 
-	// arrays to store data in
-	GLfloat vertices[nV][3];
-	GLfloat textures[nVT][2];
-	GLfloat normals[nVN][3];
-	GLuint vertexIndices[3 * nF];
-	GLuint textureIndices[3 * nF];
-	GLuint normalIndices[3 * nF];
-
 	// counter variables
 	int i = 0;
-	int j = 0;
 	int k = 0;
 	int l = 0;
 
 	char lineHeader[20];
-	while (!feof(fp))
+	while (fscanf(fp, "%19s", lineHeader) == 1)	// reads only first word
 	{
-		fscanf(fp, "%s", lineHeader);		// reads only first word
-		if (strcmp(lineHeader, "v") == 0)	// if vertex
+		if (strcmp(lineHeader, "v") == 0 && i < nV)	// if vertex
 		{
 			float x, y, z;
 			int n = fscanf(fp, "%f %f %f", &x, &y, &z);
@@ -109,16 +111,7 @@ GLuint load_obj(char fname[])
 				vertices[i][1] = y;
 				vertices[i++][2] = z;
 			}
-		} else if (strcmp(lineHeader, "vt") == 0)	// if vertex texture
-		{
-			float x, y;
-			int n = fscanf(fp, "%f %f", &x, &y);
-			if (n == 2)
-			{
-				textures[j][0] = x;
-				textures[j++][1] = y;
-			}
-		} else if (strcmp(lineHeader, "vn") == 0)	// if vertex normal
+		} else if (strcmp(lineHeader, "vn") == 0 && k < nVN)	// if vertex normal
 		{
 			float x, y, z;
 			int n = fscanf(fp, "%f %f %f", &x, &y, &z);
@@ -128,55 +121,55 @@ GLuint load_obj(char fname[])
 				normals[k][1] = y;
 				normals[k++][2] = z;
 			}
-		} else if (strcmp(lineHeader, "f") == 0)	// if face
+		} else if (strcmp(lineHeader, "f") == 0 && l < 3 * nF)	// if face
 		{
-			int a, b, c, d, e, f, g, h, i;
-			int n = fscanf(fp, "%d/%d/%d %d/%d/%d %d/%d/%d", &a, &b, &c, &d, &e, &f, &g, &h, &i);
-			if (n == 9)
-			{
-				// OpenGL is 0-indexed, thus -1
-				vertexIndices[l] = a - 1;
-				textureIndices[l] = b - 1;
-				normalIndices[l++] = c - 1;
+			int v[3], t[3], n[3];
+			int count = fscanf(fp, "%d/%d/%d %d/%d/%d %d/%d/%d", &v[0], &t[0], &n[0], &v[1],
+					&t[1], &n[1], &v[2], &t[2], &n[2]);
+			if (count != 9)
+				continue;
 
-				vertexIndices[l] = d - 1;
-				textureIndices[l] = e - 1;
-				normalIndices[l++] = f - 1;
-
-				vertexIndices[l] = g - 1;
-				textureIndices[l] = h - 1;
-				normalIndices[l++] = i - 1;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				// .obj is 1-indexed, thus -1
+				int vertexIndex = v[corner] - 1;
+				int normalIndex = n[corner] - 1;
+				if (vertexIndex < 0 || vertexIndex >= i || normalIndex < 0 || normalIndex >= k)
+					break;	// refers to data not read (yet)
+
+				memcpy((*mesh).vertices[l].position, vertices[vertexIndex], sizeof(vertices[0]));
+				memcpy((*mesh).vertices[l++].normal, normals[normalIndex], sizeof(normals[0]));
 			}
+			l -= l % 3;	// drop a triangle left incomplete
 		}
 	}
 	fclose(fp);
+	free(vertices);
+	free(normals);
 
-	/* Reading data is complete, now it needs to be translated to openGL format.
-	 This is done in a display list for increased performance */
-	GLuint objDisplayList = glGenLists(1);
-	glNewList(objDisplayList, GL_COMPILE);
-
-	// do some transformations
-	glTranslatef(0.0, -3.5, 0.0);
-	glRotatef(90, 0.0, 1.0, 0.0);
-	glRotatef(15, 0.0, 0.0, 1.0);
-	glScalef(0.14, 0.14, 0.14);
-
-	glBegin(GL_TRIANGLES);
-	for (int m = 0; m < l; m++)
-	{
-		int normalIndex = normalIndices[m];
-		int textureIndex = 2 * textureIndices[m];
-		int vertexIndex = vertexIndices[m];
-
-		glNormal3f(normals[normalIndex][0], normals[normalIndex][1], normals[normalIndex][2]);
-		glTexCoord2f(textures[textureIndex][0], textures[textureIndex][1]);
-		glVertex3f(vertices[vertexIndex][0], vertices[vertexIndex][1], vertices[vertexIndex][2]);
-	}
-	glEnd();
-
-	glEndList();
+	(*mesh).vertexCount = l;
+	return 0;
+}
 
-	// return reference to display list
-	return objDisplayList;
+/**************************************************
+ * NAME: void free_mesh(Mesh *mesh)
+ *
+ * DESCRIPTION:
+ * 		Frees the triangles of a mesh.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	Mesh *mesh:	A mesh from load_obj().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	Mesh *mesh:	An empty mesh.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void free_mesh(Mesh *mesh)
+{
+	free((*mesh).vertices);
+	(*mesh).vertices = NULL;
+	(*mesh).vertexCount = 0;
 }
@@ -8,117 +8,271 @@
  * 		encapsulation.
  *
  * PUBLIC FUNCTIONS:
+ * 		void open_phidgets(void)
+ * 		int wait_for_interface_kit(void)
+ * 		int wait_for_servo(void)
  * 		int connect_phidgets(void)
- * 		int get_sensor_value(void)
- * 		void set_servo_position(double)
+ * 		int get_sensor_value(int index)
+ * 		void read_frame(SensorFrame *frame)
+ * 		void set_servo_position(int index, double position)
  * 		void close_connections(void)
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 
 #include <phidget21.h>
+#include <stdatomic.h>
 #include <stdio.h>
 
-#include "headers/responsive_analog_read.h"
-
-// IMPORTANT: set this to the id of your sensor on the interface kit
-static const int SENSOR_ID = 2;
+#include "headers/phidget_connection.h"
+#include "headers/time_utils.h"
 
 // handles for identifying the phidgets
 static CPhidgetInterfaceKitHandle kitHandle;
 static CPhidgetServoHandle servoHandle;
 
+/* Latest values of all inputs of the interface kit, written by the change handlers
+ * on the thread of the phidget library and read by read_frame(). */
+static int sensorCount;
+static int inputCount;
+static atomic_int sensorCache[PHIDGET_MAX_SENSORS];
+static atomic_bool inputCache[PHIDGET_MAX_INPUTS];
+static atomic_ulong cacheUpdated;	// time of the latest change from nano_time()
+
 /**************************************************
- * NAME: static int setup_interface_kit_connection(void)
+ * NAME: static int wait_for_attachment(CPhidgetHandle handle, const char *device)
  *
  * DESCRIPTION:
- * 		Creates an interface kit object, opens the device for connections and waits for
- * 		attachment.
+ * 		Waits for an opened device to be attached, at most ATTACH_TIMEOUT.
  *
  * INPUTS:
- * 		EXTERNALS:
- *      	CPhidgetInterfaceKitHandle kitHandle:	An empty handle which will be attached
- *                                               	to a device.
+ * 		PARAMETERS:
+ * 			CPhidgetHandle handle:	The opened device.
+ * 			const char *device:		What it is, for the messages.
  *
  * OUTPUTS:
- *      EXTERNALS:
- *      	CPhidgetInterfaceKitHandle kitHandle:	A handle with a registered phidget.
- *
  *     	RETURNS:
  *        	int:	0 if successful, 1 if failure.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static int setup_interface_kit_connection(void)
+static int wait_for_attachment(CPhidgetHandle handle, const char *device)
 {
-
-	// create the InterfaceKit object
-	CPhidgetInterfaceKit_create(&kitHandle);
-
-	// open the interfacekit for device connections, -1 opens any serial number available
-	CPhidget_open((CPhidgetHandle) kitHandle, -1);
-
-	// get the program to wait for the interface kit device to be attached
 	int result;
 	const char *err;
-	printf("Waiting for interface kit to be attached...\n");
-	if ((result = CPhidget_waitForAttachment((CPhidgetHandle) kitHandle, 10000)))
+	printf("Waiting for %s to be attached...\n", device);
+	if ((result = CPhidget_waitForAttachment(handle, ATTACH_TIMEOUT)))
 	{
 		CPhidget_getErrorDescription(result, &err);
-		printf("Problem waiting for attachment: %s\n", err);
+		printf("Problem waiting for attachment of %s: %s\n", device, err);
 		return 1;
 	}
 	return 0;
 }
 
 /**************************************************
- * NAME: static int setup_servo_motor_connection(void)
+ * NAME: static int on_sensor_change(CPhidgetInterfaceKitHandle handle, void *userPtr,
+ * 				int index, int sensorValue)
+ *
+ * DESCRIPTION:
+ * 		Change handler of the analog inputs, keeps the latest value of every input.
+ * 		Called from the thread of the phidget library.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			CPhidgetInterfaceKitHandle handle:	The interface kit.
+ * 			void *userPtr:						Not used.
+ * 			int index:							The analog input that changed.
+ * 			int sensorValue:					The new value (0-1000).
+ *
+ * OUTPUTS:
+ * 		EXTERNALS:
+ * 			atomic_int sensorCache[]:	Latest values of the analog inputs.
+ * 		RETURN:
+ * 			int:	Always 0.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int on_sensor_change(CPhidgetInterfaceKitHandle handle, void *userPtr, int index,
+		int sensorValue)
+{
+	if (index >= 0 && index < PHIDGET_MAX_SENSORS)
+	{
+		atomic_store_explicit(&sensorCache[index], sensorValue, memory_order_relaxed);
+		atomic_store_explicit(&cacheUpdated, nano_time(), memory_order_release);
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static int on_input_change(CPhidgetInterfaceKitHandle handle, void *userPtr,
+ * 				int index, int inputState)
  *
  * DESCRIPTION:
- * 		Creates a servo object, opens the device for connections and waits for
- * 		attachment.
+ * 		Change handler of the digital inputs, keeps the latest state of every input.
+ * 		Called from the thread of the phidget library.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			CPhidgetInterfaceKitHandle handle:	The interface kit.
+ * 			void *userPtr:						Not used.
+ * 			int index:							The digital input that changed.
+ * 			int inputState:						The new state.
+ *
+ * OUTPUTS:
+ * 		EXTERNALS:
+ * 			atomic_bool inputCache[]:	Latest states of the digital inputs.
+ * 		RETURN:
+ * 			int:	Always 0.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int on_input_change(CPhidgetInterfaceKitHandle handle, void *userPtr, int index,
+		int inputState)
+{
+	if (index >= 0 && index < PHIDGET_MAX_INPUTS)
+	{
+		atomic_store_explicit(&inputCache[index], inputState != PFALSE, memory_order_relaxed);
+		atomic_store_explicit(&cacheUpdated, nano_time(), memory_order_release);
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void setup_input_cache(void)
+ *
+ * DESCRIPTION:
+ * 		Makes the interface kit report every change of its inputs as fast as it
+ * 		can, and fills the cache with the current values so it is complete before
+ * 		the first change arrives.
+ *
+ * INPUTS:
+ * 		EXTERNALS:
+ *     		CPhidgetInterfaceKitHandle kitHandle:	A handle with a registered interface kit.
+ *
+ * OUTPUTS:
+ * 		EXTERNALS:
+ * 			atomic_int sensorCache[]:	Values of the analog inputs.
+ * 			atomic_bool inputCache[]:	States of the digital inputs.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void setup_input_cache(void)
+{
+	CPhidgetInterfaceKit_getSensorCount(kitHandle, &sensorCount);
+	CPhidgetInterfaceKit_getInputCount(kitHandle, &inputCount);
+	if (sensorCount > PHIDGET_MAX_SENSORS)
+		sensorCount = PHIDGET_MAX_SENSORS;
+	if (inputCount > PHIDGET_MAX_INPUTS)
+		inputCount = PHIDGET_MAX_INPUTS;
+
+	CPhidgetInterfaceKit_set_OnSensorChange_Handler(kitHandle, on_sensor_change, NULL);
+	CPhidgetInterfaceKit_set_OnInputChange_Handler(kitHandle, on_input_change, NULL);
+
+	for (int i = 0; i < sensorCount; i++)
+	{
+		// report every change at the highest rate, not supported by all kits
+		int rate;
+		CPhidgetInterfaceKit_setSensorChangeTrigger(kitHandle, i, 0);
+		if (CPhidgetInterfaceKit_getDataRateMin(kitHandle, i, &rate) == EPHIDGET_OK)
+			CPhidgetInterfaceKit_setDataRate(kitHandle, i, rate);
+
+		int value = 0;
+		CPhidgetInterfaceKit_getSensorValue(kitHandle, i, &value);
+		atomic_store(&sensorCache[i], value);
+	}
+
+	for (int i = 0; i < inputCount; i++)
+	{
+		int state = PFALSE;
+		CPhidgetInterfaceKit_getInputState(kitHandle, i, &state);
+		atomic_store(&inputCache[i], state != PFALSE);
+	}
+
+	atomic_store(&cacheUpdated, nano_time());
+}
+
+/**************************************************
+ * NAME: void open_phidgets(void)
+ *
+ * DESCRIPTION:
+ * 		Creates the interface kit and servo objects and opens both for device
+ * 		connections. Opening does not wait, the phidget library looks for both
+ * 		devices and attaches them in the background at the same time.
  *
  * INPUTS:
  *     	EXTERNALS:
- *      	CPhidgetServoHandle servoHandle:	An empty handle which will be attached
- *                                          	to a device.
+ *      	CPhidgetInterfaceKitHandle kitHandle:	An empty handle.
+ *      	CPhidgetServoHandle servoHandle:		An empty handle.
  *
  * OUTPUTS:
  *      EXTERNALS:
- *      	CPhidgetServoHandle kitHandle:		A handle with a registered phidget.
- *
- *     	RETURNS:
- *        	int:	0 if successful, 1 if failure.
+ *      	CPhidgetInterfaceKitHandle kitHandle:	A handle being attached to a device.
+ *      	CPhidgetServoHandle servoHandle:		A handle being attached to a device.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static int setup_servo_motor_connection(void)
+void open_phidgets(void)
 {
-	// create the servo object
+	// create the objects and open them, -1 opens any serial number available
+	CPhidgetInterfaceKit_create(&kitHandle);
 	CPhidgetServo_create(&servoHandle);
-
-	// open the servoHandle for device connections, -1 opens any serial number available
+	CPhidget_open((CPhidgetHandle) kitHandle, -1);
 	CPhidget_open((CPhidgetHandle) servoHandle, -1);
+}
 
-	// get the program to wait for an servoHandle device to be attached
-	int result;
-	const char *err;
-	printf("Waiting for servo to be attached...\n");
-	if ((result = CPhidget_waitForAttachment((CPhidgetHandle) servoHandle, 10000)))
-	{
-		CPhidget_getErrorDescription(result, &err);
-		printf("Problem waiting for attachment: %s\n", err);
+/**************************************************
+ * NAME: int wait_for_interface_kit(void)
+ *
+ * DESCRIPTION:
+ * 		Waits for the interface kit opened by open_phidgets() to be attached and
+ * 		fills the cache of its inputs.
+ *
+ * INPUTS:
+ *     	EXTERNALS:
+ *      	CPhidgetInterfaceKitHandle kitHandle:	A handle being attached.
+ *
+ * OUTPUTS:
+ *     	RETURNS:
+ *        	int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int wait_for_interface_kit(void)
+{
+	if (wait_for_attachment((CPhidgetHandle) kitHandle, "interface kit"))
 		return 1;
-	}
+	setup_input_cache();
 	return 0;
 }
 
+/**************************************************
+ * NAME: int wait_for_servo(void)
+ *
+ * DESCRIPTION:
+ * 		Waits for the servo controller opened by open_phidgets() to be attached.
+ *
+ * INPUTS:
+ *     	EXTERNALS:
+ *      	CPhidgetServoHandle servoHandle:	A handle being attached.
+ *
+ * OUTPUTS:
+ *     	RETURNS:
+ *        	int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int wait_for_servo(void)
+{
+	return wait_for_attachment((CPhidgetHandle) servoHandle, "servo");
+}
+
 /**************************************************
  * NAME: int connect_phidgets(void)
  *
  * DESCRIPTION:
- * 		Connects to both the interface kit and servo by calling the private
- * 		functions setup_interface_kit_connection() and setup_servo_motor_connection().
+ * 		Connects to both the interface kit and servo: opens both, then waits for
+ * 		each, so the time is that of the slower one rather than the sum.
  *
  * INPUTS:
  * 		none
@@ -127,25 +281,27 @@ static int setup_servo_motor_connection(void)
  *     	RETURNS:
  *        	int: 0 if successful, 1 if failure.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 int connect_phidgets(void)
 {
 	// setup a connection to the phidgets we are going to use
-	if (setup_interface_kit_connection())
-		return 1;
-	if (setup_servo_motor_connection())
+	open_phidgets();
+	if (wait_for_interface_kit() || wait_for_servo())
 		return 1;
 	return 0;
 }
 
 /**************************************************
- * NAME: int get_sensor_value(void)
+ * NAME: int get_sensor_value(int index)
  *
  * DESCRIPTION:
- * 		Gets the current sensor value from the interface kit.
+ * 		Gets the current, unfiltered sensor value directly from the interface kit.
+ * 		The control loop reads its sensors through read_frame() instead.
  *
  * INPUTS:
+ * 		PARAMETERS:
+ * 			int index:	The analog input the sensor is connected to.
  * 		EXTERNALS:
  *     		CPhidgetInterfaceKitHandle kitHandle:	A handle with a registered interface kit.
  *
@@ -153,25 +309,55 @@ int connect_phidgets(void)
  *     	RETURN:
  *        	int:	The sensor value (0-1000).
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-int get_sensor_value(void)
+int get_sensor_value(int index)
 {
-	int sensorValue;
-	CPhidgetInterfaceKit_getSensorValue(kitHandle, SENSOR_ID, &sensorValue);
+	int sensorValue = 0;
+	CPhidgetInterfaceKit_getSensorValue(kitHandle, index, &sensorValue);
+	return sensorValue;
+}
 
-	// return noise reduced value
-	return responsive_analog_read(sensorValue);
+/**************************************************
+ * NAME: void read_frame(SensorFrame *frame)
+ *
+ * DESCRIPTION:
+ * 		Takes a snapshot of all analog and digital inputs of the interface kit. The
+ * 		values come from the cache kept up to date by the change handlers, so a
+ * 		frame costs no transaction with the device however many inputs are used.
+ *
+ * INPUTS:
+ * 		EXTERNALS:
+ * 			atomic_int sensorCache[]:	Latest values of the analog inputs.
+ * 			atomic_bool inputCache[]:	Latest states of the digital inputs.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SensorFrame *frame:	The snapshot.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void read_frame(SensorFrame *frame)
+{
+	(*frame).updated = atomic_load_explicit(&cacheUpdated, memory_order_acquire);
+	(*frame).sensorCount = sensorCount;
+	(*frame).inputCount = inputCount;
+	for (int i = 0; i < sensorCount; i++)
+		(*frame).sensors[i] = atomic_load_explicit(&sensorCache[i], memory_order_relaxed);
+	for (int i = 0; i < inputCount; i++)
+		(*frame).inputs[i] = atomic_load_explicit(&inputCache[i], memory_order_relaxed);
+	(*frame).time = nano_time();
 }
 
 /**************************************************
- * NAME: void set_servo_position(double position)
+ * NAME: void set_servo_position(int index, double position)
  *
  * DESCRIPTION:
- * 		Sets the position of the servo motor.
+ * 		Sets the position of a servo motor.
  *
  * INPUTS:
  *		PARAMETERS:
+ *			int index:			The servo motor on the controller.
  *			double position:	The new servo motor position.
  *		EXTERNALS:
  *			CPhidgetServoHandle servoHandle:	A handle with a registered servo motor.
@@ -179,11 +365,11 @@ int get_sensor_value(void)
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-void set_servo_position(double position)
+void set_servo_position(int index, double position)
 {
-	CPhidgetServo_setPosition(servoHandle, 0, position);
+	CPhidgetServo_setPosition(servoHandle, index, position);
 	return;
 }
 
@@ -2,23 +2,45 @@
  * FILENAME:	pid_controller.c
  *
  * DESCRIPTION:
- * 		Implementation of a PID-controller.
+ * 		Implementation of a PID-controller with optional feed-forward from the
+ * 		reference motion, compensation of a known force and selectable anti-windup
+ * 		strategies:
+ * 			ANTI_WINDUP_CLAMP:				the integral term is kept within the output
+ * 											range, but keeps integrating while saturated.
+ * 			ANTI_WINDUP_CONDITIONAL:		the integral is frozen while the output is
+ * 											saturated and the error drives it further.
+ * 			ANTI_WINDUP_BACK_CALCULATION:	the integral is pulled back by the amount
+ * 											the output was clipped, with time constant
+ * 											trackingTime.
+ *
+ * 		Every controlled channel has its own PIDController holding coefficients,
+ * 		options and state, so any number of controllers can run side by side.
  *
  * PUBLIC FUNCTIONS:
- * 		PIDdata pid_compute(float input, float setpoint)
+ * 		void pid_init(PIDController *pid)
+ * 		PIDdata pid_compute(PIDController *pid, float input, float setpoint,
+ * 				float setpointVelocity, float setpointAcceleration, unsigned long now)
+ * 		void pid_set_gains(PIDController *pid, float kp, float ki, float kd)
+ * 		void pid_set_anti_windup(PIDController *pid, AntiWindupMode mode, float time)
+ * 		void pid_set_feed_forward(PIDController *pid, float velocityGain,
+ * 				float accelerationGain)
+ * 		void pid_set_compensation(PIDController *pid, float compensation)
+ * 		void pid_reset(PIDController *pid)
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 21.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 
+#include <math.h>
+
 #include "headers/pid_controller.h"
 #include "headers/time_utils.h"
 
 // PID coefficients, found by tuning
-#define Kp 0.059
-#define Ki 0.050
-#define Kd 0.035
+#define DEFAULT_KP 0.059
+#define DEFAULT_KI 0.050
+#define DEFAULT_KD 0.035
 
-#define N 10 // number of derivatives to average
+#define N PID_DERIVATIVE_COUNT // number of derivatives to average
 
 /**************************************************
  * NAME: static float average(float array[])
@@ -48,72 +70,294 @@ static float average(float array[])
 }
 
 /**************************************************
- * NAME: PIDdata pid_compute(float input, float setpoint)
+ * NAME: static float clamp_output(float value)
+ *
+ * DESCRIPTION:
+ * 		Keeps a value within the output range.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	float value:	The value to clamp.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	float:	The value, limited to MIN_OUTPUT..MAX_OUTPUT.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static float clamp_output(float value)
+{
+	if (value > MAX_OUTPUT)
+		return MAX_OUTPUT;
+	else if (value < MIN_OUTPUT)
+		return MIN_OUTPUT;
+	return value;
+}
+
+/**************************************************
+ * NAME: void pid_init(PIDController *pid)
+ *
+ * DESCRIPTION:
+ * 		Initializes a controller with the tuned coefficients, no feed-forward and
+ * 		the integral clamped to the output range, as the coefficients were tuned
+ * 		with.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller to initialize.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The initialized controller.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void pid_init(PIDController *pid)
+{
+	(*pid).Kp = DEFAULT_KP;
+	(*pid).Ki = DEFAULT_KI;
+	(*pid).Kd = DEFAULT_KD;
+	(*pid).Kv = 0.0;
+	(*pid).Ka = 0.0;
+	(*pid).compensation = 0.0;
+	(*pid).antiWindup = ANTI_WINDUP_CLAMP;
+	(*pid).trackingTime = 0.0;
+	pid_reset(pid);
+}
+
+/**************************************************
+ * NAME: PIDdata pid_compute(PIDController *pid, float input, float setpoint,
+ * 				float setpointVelocity, float setpointAcceleration, unsigned long now)
  *
  * DESCRIPTION:
- * 		Applies the PID-regulator control loop algorithm.
+ * 		Applies the PID-regulator control loop algorithm. The derivative term acts on
+ * 		the error rate, using the known rate of change of the setpoint instead of
+ * 		differentiating the setpoint, so a moving setpoint is followed without lag
+ * 		and without derivative kicks. The feed-forward term adds the output needed
+ * 		to follow the reference motion, so the integral does not have to build up
+ * 		for it. The compensation is added the same way and reported with the
+ * 		feed-forward term. Saturation of the integral is handled by the anti-windup
+ * 		mode, so it also sees the output the compensation takes up.
  *
  * INPUTS:
  * 		PARAMETERS:
- *      	float input:   	The input value to regulate.
- *      	float setpoint:	The setpoint to follow.
+ *      	PIDController *pid:			The controller with its coefficients and state.
+ *      	float input:   				The input value to regulate.
+ *      	float setpoint:				The setpoint to follow.
+ *      	float setpointVelocity:		Rate of change of the setpoint per second.
+ *      	float setpointAcceleration:	Rate of change of the setpoint velocity.
+ *      	unsigned long now:			Time of the input from nano_time().
  *
  * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The updated state.
  *     	RETURN:
  *        	PIDdata:	A struct containing the power output required to
  *                  	regulate the system and the PID terms.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 01.04.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-PIDdata pid_compute(float input, float setpoint)
+PIDdata pid_compute(PIDController *pid, float input, float setpoint,
+		float setpointVelocity, float setpointAcceleration, unsigned long now)
 {
-	static unsigned long lastTime;
-	static float lastInput;
-	static float integralTerm = MAX_OUTPUT;	// MAX_OUTPUT means no power
-	static float derivativeTerms[N];
-	static int i = 0;
-
-	if (lastTime == 0UL)
+	if ((*pid).lastTime == 0UL)
 	{
-		lastTime = nano_time();
-		lastInput = input;
+		(*pid).lastTime = now;
+		(*pid).lastInput = input;
 	}
 
 	// get time passed
-	unsigned long timeNow = nano_time();
-	float dt = nano_to_sec(timeNow - lastTime);
+	float dt = nano_to_sec(now - (*pid).lastTime);
 
 	float error = setpoint - input;
 
 	// calculate the terms
-	float proportionalTerm = Kp * error;
-	integralTerm += Ki * error * dt;
-
-	// ensure value is in bounds
-	if (integralTerm > MAX_OUTPUT)
-		integralTerm = MAX_OUTPUT;
-	else if (integralTerm < MIN_OUTPUT)
-		integralTerm = MIN_OUTPUT;
+	float proportionalTerm = (*pid).Kp * error;
+	float feedForwardTerm = (*pid).Kv * setpointVelocity + (*pid).Ka * setpointAcceleration
+			+ (*pid).compensation;
 
 	// get average value for derivative term
-	float dInput = (input - lastInput) / dt;
-	derivativeTerms[i++] = -Kd * dInput;
-	if (i >= N) i = 0;
-	float derivativeTerm = average(derivativeTerms);
+	float dInput = dt > 0.0 ? (input - (*pid).lastInput) / dt : 0.0;
+	(*pid).derivativeTerms[(*pid).derivativeIndex++] = (*pid).Kd * (setpointVelocity - dInput);
+	if ((*pid).derivativeIndex >= N) (*pid).derivativeIndex = 0;
+	float derivativeTerm = average((*pid).derivativeTerms);
 
-	float output = proportionalTerm + integralTerm + derivativeTerm;
+	float integralStep = (*pid).Ki * error * dt;
+	float otherTerms = proportionalTerm + derivativeTerm + feedForwardTerm;
+
+	switch ((*pid).antiWindup)
+	{
+	case ANTI_WINDUP_CLAMP:
+		(*pid).integralTerm += integralStep;
+		break;
+	case ANTI_WINDUP_CONDITIONAL:
+	{
+		// don't integrate if it would push the output further into saturation
+		float unsaturated = otherTerms + (*pid).integralTerm + integralStep;
+		if (!((unsaturated > MAX_OUTPUT && error > 0.0)
+				|| (unsaturated < MIN_OUTPUT && error < 0.0)))
+			(*pid).integralTerm += integralStep;
+		break;
+	}
+	case ANTI_WINDUP_BACK_CALCULATION:
+	{
+		// feed the clipped part of the output back into the integral
+		(*pid).integralTerm += integralStep;
+		float unsaturated = otherTerms + (*pid).integralTerm;
+		float tracking = (*pid).trackingTime;
+		if (tracking <= 0.0)
+			tracking = (*pid).Kd > 0.0 && (*pid).Ki > 0.0 ?
+					sqrtf((*pid).Kd / (*pid).Ki) : 1.0;	// sqrt(Ti * Td)
+		if (tracking < dt)
+			tracking = dt;	// stronger feedback would overshoot
+		(*pid).integralTerm += (clamp_output(unsaturated) - unsaturated) * dt / tracking;
+		break;
+	}
+	}
+
+	// ensure value is in bounds
+	(*pid).integralTerm = clamp_output((*pid).integralTerm);
 
 	// ensure output is in bounds
-	if (output > MAX_OUTPUT)
-		output = MAX_OUTPUT;
-	else if (output < MIN_OUTPUT)
-		output = MIN_OUTPUT;
+	float output = clamp_output(otherTerms + (*pid).integralTerm);
 
 	// remember some variables for next iteration
-	lastInput = input;
-	lastTime = timeNow;
+	(*pid).lastInput = input;
+	(*pid).lastTime = now;
 
-	PIDdata res = { output, proportionalTerm, integralTerm, derivativeTerm };
+	PIDdata res = { output, proportionalTerm, (*pid).integralTerm, derivativeTerm,
+			feedForwardTerm };
 
 	return res;
 }
+
+/**************************************************
+ * NAME: void pid_set_gains(PIDController *pid, float kp, float ki, float kd)
+ *
+ * DESCRIPTION:
+ * 		Changes the coefficients of the controller. Must be called from the thread
+ * 		running pid_compute(), between two iterations.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller.
+ *      	float kp:			The proportional coefficient.
+ *      	float ki:			The integral coefficient.
+ *      	float kd:			The derivative coefficient.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller with the new coefficients.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void pid_set_gains(PIDController *pid, float kp, float ki, float kd)
+{
+	(*pid).Kp = kp;
+	(*pid).Ki = ki;
+	(*pid).Kd = kd;
+}
+
+/**************************************************
+ * NAME: void pid_set_anti_windup(PIDController *pid, AntiWindupMode mode, float time)
+ *
+ * DESCRIPTION:
+ * 		Selects how the integral term is kept from winding up while the output is
+ * 		saturated. Must be called from the thread running pid_compute(), between
+ * 		two iterations.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:		The controller.
+ *      	AntiWindupMode mode:	The anti-windup strategy.
+ *      	float time:				Time constant of the back-calculation in seconds,
+ *      							0.0 to derive it from the gains as sqrt(Ti * Td).
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller with the new strategy.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void pid_set_anti_windup(PIDController *pid, AntiWindupMode mode, float time)
+{
+	(*pid).antiWindup = mode;
+	(*pid).trackingTime = time;
+}
+
+/**************************************************
+ * NAME: void pid_set_feed_forward(PIDController *pid, float velocityGain,
+ * 				float accelerationGain)
+ *
+ * DESCRIPTION:
+ * 		Sets the feed-forward coefficients, 0.0 turns feed-forward off. Must be
+ * 		called from the thread running pid_compute(), between two iterations.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:		The controller.
+ *      	float velocityGain:		Output per unit of reference velocity.
+ *      	float accelerationGain:	Output per unit of reference acceleration.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller with the new coefficients.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void pid_set_feed_forward(PIDController *pid, float velocityGain, float accelerationGain)
+{
+	(*pid).Kv = velocityGain;
+	(*pid).Ka = accelerationGain;
+}
+
+/**************************************************
+ * NAME: void pid_set_compensation(PIDController *pid, float compensation)
+ *
+ * DESCRIPTION:
+ * 		Sets the output added to cancel a force on the boat, such as the estimate
+ * 		of a disturbance observer, until it is set again. Must be called from the
+ * 		thread running pid_compute(), before the iteration it is for.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:		The controller.
+ *      	float compensation:		Output added, 0.0 for none.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller with the new compensation.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void pid_set_compensation(PIDController *pid, float compensation)
+{
+	(*pid).compensation = compensation;
+}
+
+/**************************************************
+ * NAME: void pid_reset(PIDController *pid)
+ *
+ * DESCRIPTION:
+ * 		Forgets the state from previous iterations, as if the controller was
+ * 		started for the first time. Used when the control loop has been paused.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ *      	PIDController *pid:	The controller without state.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void pid_reset(PIDController *pid)
+{
+	(*pid).lastTime = 0UL;
+	(*pid).lastInput = 0.0;
+	(*pid).integralTerm = MAX_OUTPUT;	// MAX_OUTPUT means no power
+	for (int j = 0; j < N; j++)
+		(*pid).derivativeTerms[j] = 0.0;
+	(*pid).derivativeIndex = 0;
+}
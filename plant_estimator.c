@@ -0,0 +1,266 @@
+/**************************************************
+ * FILENAME:	plant_estimator.c
+ *
+ * DESCRIPTION:
+ * 		Online identification of the boat from the data of its control loop. A
+ * 		second order discrete model from thruster power to position is fitted by
+ * 		recursive least squares with exponential forgetting, so the model follows
+ * 		slow changes of the boat. An update takes O(PLANT_PARAMETERS^2) operations
+ * 		on fixed size arrays and never allocates, so it runs in the control loop.
+ *
+ * 		Without excitation, e.g. while the boat rests at its setpoint, forgetting
+ * 		would let the covariance grow without bound and the next disturbance would
+ * 		throw the parameters around. The covariance is therefore limited.
+ *
+ * 		The model is published through a sequence lock, together with the standard
+ * 		deviations of the parameters and the prediction error variance. A slowly
+ * 		following reference model is kept as well. When it predicts well worse than
+ * 		the noise level for a while, the dynamics of the boat have changed, e.g. by
+ * 		a different load, and the change is flagged until the reference has caught up.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void plant_estimator_init(PlantEstimator *estimator)
+ * 		void plant_estimator_update(PlantEstimator *estimator, float sensorValue,
+ * 				float output)
+ * 		void plant_estimator_read(PlantEstimator *estimator, PlantModel *model)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "headers/pid_controller.h"
+#include "headers/plant_estimator.h"
+#include "headers/seqlock.h"
+
+#define N PLANT_PARAMETERS
+
+static const double FORGETTING_FACTOR = 0.998;	// memory of about 500 iterations
+static const double INITIAL_COVARIANCE = 1000.0;
+static const double MAX_COVARIANCE_TRACE = 10000.0;
+
+// weights of the averages of the squared prediction errors, per iteration
+static const double SHORT_ERROR_WEIGHT = 1.0 / 50.0;
+static const double LONG_ERROR_WEIGHT = 1.0 / 2000.0;
+
+// how fast the reference model follows the estimate, per iteration
+static const double REFERENCE_WEIGHT = 1.0 / 2000.0;
+
+// the dynamics have changed when the reference error stays this much above the noise
+static const double CHANGE_RATIO = 2.5;
+static const unsigned int CHANGE_SAMPLES = 50;
+
+// iterations before the model is trusted
+static const unsigned long WARMUP_SAMPLES = 500;
+
+/**************************************************
+ * NAME: void plant_estimator_init(PlantEstimator *estimator)
+ *
+ * DESCRIPTION:
+ * 		Initializes an estimator which knows nothing about the boat.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The estimator to initialize.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The initialized estimator.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void plant_estimator_init(PlantEstimator *estimator)
+{
+	memset(estimator, 0, sizeof(*estimator));
+	for (int i = 0; i < N; i++)
+		(*estimator).P[i][i] = INITIAL_COVARIANCE;
+}
+
+/**************************************************
+ * NAME: static void publish(PlantEstimator *estimator)
+ *
+ * DESCRIPTION:
+ * 		Copies the current model to the published model. The sequence number is
+ * 		odd while the copy is in progress.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The estimator.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The estimator with the model published.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void publish(PlantEstimator *estimator)
+{
+	PlantModel model;
+	for (int i = 0; i < PLANT_ORDER; i++)
+	{
+		model.a[i] = (*estimator).theta[i];
+		model.b[i] = (*estimator).theta[PLANT_ORDER + i];
+	}
+	model.c = (*estimator).theta[2 * PLANT_ORDER];
+	model.origin = (*estimator).origin;
+
+	// the covariance of the parameters is P scaled by the noise variance
+	model.errorVariance = (*estimator).longErrorSquared;
+	for (int i = 0; i < N; i++)
+		model.deviation[i] = sqrt((*estimator).P[i][i] * model.errorVariance);
+
+	model.samples = (*estimator).samples;
+	model.dynamicsChanged = (*estimator).changedSamples >= CHANGE_SAMPLES;
+
+	seqlock_publish(&(*estimator).sequence, &(*estimator).published, &model,
+			sizeof(model));
+}
+
+/**************************************************
+ * NAME: void plant_estimator_update(PlantEstimator *estimator, float sensorValue,
+ * 				float output)
+ *
+ * DESCRIPTION:
+ * 		Updates the model with one iteration of the control loop and publishes it.
+ * 		Must only be called from the thread running the channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The estimator.
+ * 			float sensorValue:			The measured position.
+ * 			float output:				The servo output computed in this iteration.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The updated estimator.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void plant_estimator_update(PlantEstimator *estimator, float sensorValue, float output)
+{
+	double position = 1000.0 - sensorValue;
+	double power = MAX_OUTPUT - output;
+
+	if ((*estimator).samples == 0)
+		(*estimator).origin = position;
+	double y = position - (*estimator).origin;
+
+	// the regressors need a full history
+	if ((*estimator).samples >= PLANT_ORDER)
+	{
+		double phi[N];
+		for (int i = 0; i < PLANT_ORDER; i++)
+		{
+			phi[i] = (*estimator).y[i];
+			phi[PLANT_ORDER + i] = (*estimator).u[i];
+		}
+		phi[2 * PLANT_ORDER] = 1.0;
+
+		// prediction errors before the update
+		double error = y;
+		double referenceError = y;
+		for (int i = 0; i < N; i++)
+		{
+			error -= phi[i] * (*estimator).theta[i];
+			referenceError -= phi[i] * (*estimator).reference[i];
+		}
+
+		// gain K = P phi / (lambda + phi' P phi)
+		double Pphi[N];
+		double denominator = FORGETTING_FACTOR;
+		for (int i = 0; i < N; i++)
+		{
+			Pphi[i] = 0.0;
+			for (int j = 0; j < N; j++)
+				Pphi[i] += (*estimator).P[i][j] * phi[j];
+			denominator += phi[i] * Pphi[i];
+		}
+
+		for (int i = 0; i < N; i++)
+			(*estimator).theta[i] += Pphi[i] / denominator * error;
+
+		// P = (P - P phi phi' P / denominator) / lambda, kept symmetric
+		double trace = 0.0;
+		for (int i = 0; i < N; i++)
+		{
+			for (int j = i; j < N; j++)
+			{
+				double value = ((*estimator).P[i][j] - Pphi[i] * Pphi[j] / denominator)
+						/ FORGETTING_FACTOR;
+				(*estimator).P[i][j] = (*estimator).P[j][i] = value;
+			}
+			trace += (*estimator).P[i][i];
+		}
+
+		// don't let the covariance wind up while nothing happens
+		if (trace > MAX_COVARIANCE_TRACE)
+		{
+			double scale = MAX_COVARIANCE_TRACE / trace;
+			for (int i = 0; i < N; i++)
+				for (int j = 0; j < N; j++)
+					(*estimator).P[i][j] *= scale;
+		}
+
+		// compare the recent error of the reference with the noise level, ignoring the
+		// large errors while the parameters are still converging
+		if ((*estimator).samples >= WARMUP_SAMPLES)
+		{
+			// plain means until enough errors are seen for the exponential averages
+			double count = (*estimator).samples - WARMUP_SAMPLES + 1;
+			double referenceSquared = referenceError * referenceError;
+			(*estimator).shortErrorSquared += (referenceSquared
+					- (*estimator).shortErrorSquared) * fmax(SHORT_ERROR_WEIGHT, 1.0 / count);
+			(*estimator).longErrorSquared += (error * error - (*estimator).longErrorSquared)
+					* fmax(LONG_ERROR_WEIGHT, 1.0 / count);
+
+			for (int i = 0; i < N; i++)
+				(*estimator).reference[i] += ((*estimator).theta[i] - (*estimator).reference[i])
+						* fmax(REFERENCE_WEIGHT, 1.0 / count);
+		}
+
+		if ((*estimator).samples >= 2 * WARMUP_SAMPLES
+				&& (*estimator).shortErrorSquared > CHANGE_RATIO * (*estimator).longErrorSquared)
+		{
+			if ((*estimator).changedSamples < CHANGE_SAMPLES)
+				(*estimator).changedSamples++;
+		} else
+		{
+			(*estimator).changedSamples = 0;
+		}
+	}
+
+	// shift the history
+	for (int i = PLANT_ORDER - 1; i > 0; i--)
+	{
+		(*estimator).y[i] = (*estimator).y[i - 1];
+		(*estimator).u[i] = (*estimator).u[i - 1];
+	}
+	(*estimator).y[0] = y;
+	(*estimator).u[0] = power;
+	(*estimator).samples++;
+
+	publish(estimator);
+}
+
+/**************************************************
+ * NAME: void plant_estimator_read(PlantEstimator *estimator, PlantModel *model)
+ *
+ * DESCRIPTION:
+ * 		Reads a consistent copy of the published model, retrying if the channel
+ * 		thread published in the meantime. May be called from any thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			PlantEstimator *estimator:	The estimator.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			PlantModel *model:	Where to store the copy.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void plant_estimator_read(PlantEstimator *estimator, PlantModel *model)
+{
+	seqlock_read(&(*estimator).sequence, &(*estimator).published, model, sizeof(*model));
+}
@@ -0,0 +1,690 @@
+/**************************************************
+ * FILENAME:	renderer.c
+ *
+ * DESCRIPTION:
+ * 		Draws the vessels with OpenGL 3.3 core profile. All geometry lives in
+ * 		vertex buffers on the GPU, created once: the boat model and a unit quad and
+ * 		triangle that every flat shape is made of. What changes between frames, the
+ * 		placement and color of every boat, setline and power gauge, is written to
+ * 		one instance buffer per shape once per frame, and every kind of shape is
+ * 		drawn with a single instanced draw call however many vessels there are.
+ * 		The projection and lighting are held in a uniform buffer shared by both
+ * 		shader programs, the boat is lit per pixel.
+ *
+ * 		Every vessel gets a lane of its own, stacked from the top of the window.
+ * 		A single vessel fills the whole window.
+ *
+ * 		The boat is drawn at the level of detail its size on the screen calls for.
+ * 		Simpler versions of the model are made when it is loaded, and the simplest
+ * 		one whose error stays within LOD_MAX_ERROR pixels is drawn, so a window of
+ * 		many small boats costs little more to draw than one of a single boat.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int renderer_load(const char *boatModel)
+ * 		int renderer_init(const char *boatModel)
+ * 		void renderer_resize(int width, int height)
+ * 		void renderer_draw(const VesselView vessels[], int count)
+ * 		void renderer_cleanup(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#define GL_GLEXT_PROTOTYPES	// core functions are exported by libGL on Linux
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headers/mesh_simplify.h"
+#include "headers/obj_loader.h"
+#include "headers/renderer.h"
+
+// window coordinates, the same in x and y
+#define VIEW_SIZE 5.0
+
+// shapes of a vessel in the coordinates of a lane filling the window
+#define SETLINE_WIDTH 0.02
+#define SETLINE_BOTTOM -4.4
+#define SETLINE_TOP -1.6
+#define GAUGE_LEFT -2.5
+#define GAUGE_RIGHT 2.5
+#define GAUGE_BOTTOM -0.5
+#define GAUGE_TOP 1.5
+#define GAUGE_BORDER 0.03
+#define ARROW_LENGTH 4.0	// of the body at full power
+#define QUADS_PER_VESSEL 6	// setline, arrow body and the four sides of the border
+
+// levels of detail of the boat, the first one is the model as loaded
+#define LOD_LEVELS 5
+#define LOD_MAX_ERROR 1.0	// pixels
+
+// vertex attribute locations, the same in both programs
+enum
+{
+	ATTRIBUTE_POSITION,
+	ATTRIBUTE_NORMAL,
+	ATTRIBUTE_PLACEMENT,
+	ATTRIBUTE_COLOR,
+	ATTRIBUTE_DEPTH
+};
+
+// the uniform block "Frame", in std140 layout
+typedef struct
+{
+	float projection[16];
+	float lightDirection[4];	// towards the light
+	float lightColor[4];
+	float ambient[4];
+	float specular[4];			// color, shininess in w
+} FrameUniforms;
+
+typedef struct
+{
+	float placement[4];	// x, y, scale
+	float color[4];
+} BoatInstance;
+
+typedef struct
+{
+	float placement[4];	// x, y, width, height of the unit shape
+	float color[4];
+	float depth;
+} ShapeInstance;
+
+// a part of the vertex buffer of the boat
+typedef struct
+{
+	int first;
+	int count;
+	float error;	// largest distance from the model, in window coordinates
+} DetailLevel;
+
+// a shape drawn with instancing
+typedef struct
+{
+	GLuint vertexArray;
+	GLuint vertexBuffer;
+	GLuint instanceBuffer;
+	int vertexCount;
+} InstancedShape;
+
+static const char *FRAME_BLOCK =
+		"layout(std140) uniform Frame\n"
+		"{\n"
+		"	mat4 projection;\n"
+		"	vec4 lightDirection;\n"
+		"	vec4 lightColor;\n"
+		"	vec4 ambient;\n"
+		"	vec4 specular;\n"
+		"};\n";
+
+static const char *LIT_VERTEX_SHADER =
+		"layout(location = 0) in vec3 position;\n"
+		"layout(location = 1) in vec3 normal;\n"
+		"layout(location = 2) in vec4 placement;\n"
+		"layout(location = 3) in vec4 color;\n"
+		"out vec3 fragmentNormal;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	vec3 world = position * placement.z + vec3(placement.xy, 0.0);\n"
+		"	gl_Position = projection * vec4(world, 1.0);\n"
+		"	fragmentNormal = normal;\n"
+		"	fragmentColor = color;\n"
+		"}\n";
+
+static const char *LIT_FRAGMENT_SHADER =
+		"in vec3 fragmentNormal;\n"
+		"in vec4 fragmentColor;\n"
+		"out vec4 outputColor;\n"
+		"void main()\n"
+		"{\n"
+		"	vec3 n = normalize(fragmentNormal);\n"
+		"	vec3 l = normalize(lightDirection.xyz);\n"
+		"	vec3 h = normalize(l + vec3(0.0, 0.0, 1.0));\n"
+		"	float diffuse = max(dot(n, l), 0.0);\n"
+		"	float shine = diffuse > 0.0 ? pow(max(dot(n, h), 0.0), specular.w) : 0.0;\n"
+		"	vec3 lit = fragmentColor.rgb * (ambient.rgb + lightColor.rgb * diffuse)\n"
+		"			+ specular.rgb * shine;\n"
+		"	outputColor = vec4(lit, fragmentColor.a);\n"
+		"}\n";
+
+static const char *FLAT_VERTEX_SHADER =
+		"layout(location = 0) in vec2 position;\n"
+		"layout(location = 2) in vec4 placement;\n"
+		"layout(location = 3) in vec4 color;\n"
+		"layout(location = 4) in float depth;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 world = position * placement.zw + placement.xy;\n"
+		"	gl_Position = projection * vec4(world, depth, 1.0);\n"
+		"	fragmentColor = color;\n"
+		"}\n";
+
+static const char *FLAT_FRAGMENT_SHADER =
+		"in vec4 fragmentColor;\n"
+		"out vec4 outputColor;\n"
+		"void main()\n"
+		"{\n"
+		"	outputColor = fragmentColor;\n"
+		"}\n";
+
+static const GLfloat UNIT_QUAD[] = { 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1 };
+static const GLfloat UNIT_TRIANGLE[] = { 0, 0, 1, 0.5, 0, 1 };
+
+// grid cells along the boat of every simplified level
+static const int LOD_RESOLUTIONS[LOD_LEVELS - 1] = { 256, 96, 32, 12 };
+
+static GLuint litProgram;
+static GLuint flatProgram;
+static GLuint frameBuffer;		// the uniform buffer
+static InstancedShape boats;
+static InstancedShape quads;
+static InstancedShape triangles;
+static DetailLevel levels[LOD_LEVELS];
+static int levelCount;
+static MeshVertex *boatVertices;	// loaded, not uploaded yet
+static int boatVertexCount;
+static float pixelsPerUnit;		// of window coordinates, along the longer side
+
+/**************************************************
+ * NAME: static GLuint compile_program(const char *vertexSource,
+ * 				const char *fragmentSource)
+ *
+ * DESCRIPTION:
+ * 		Compiles and links a shader program using the uniform block Frame.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *vertexSource:	The vertex shader, without version and Frame.
+ * 			const char *fragmentSource:	The fragment shader, likewise.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			GLuint:	The program, 0 if it could not be built.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static GLuint compile_program(const char *vertexSource, const char *fragmentSource)
+{
+	const GLenum TYPES[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char *sources[] = { vertexSource, fragmentSource };
+	char log[1024];
+
+	GLuint program = glCreateProgram();
+	for (int s = 0; s < 2; s++)
+	{
+		const char *parts[] = { "#version 330 core\n", FRAME_BLOCK, sources[s] };
+		GLuint shader = glCreateShader(TYPES[s]);
+		glShaderSource(shader, 3, parts, NULL);
+		glCompileShader(shader);
+
+		GLint compiled;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+		if (!compiled)
+		{
+			glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+			printf("Could not compile shader: %s\n", log);
+			glDeleteShader(shader);
+			glDeleteProgram(program);
+			return 0;
+		}
+		glAttachShader(program, shader);
+		glDeleteShader(shader);	// deleted along with the program
+	}
+
+	glLinkProgram(program);
+	GLint linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		printf("Could not link shaders: %s\n", log);
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Frame"), 0);
+	return program;
+}
+
+/**************************************************
+ * NAME: static void create_shape(InstancedShape *shape, const void *vertices,
+ * 				size_t size, int vertexCount, bool lit)
+ *
+ * DESCRIPTION:
+ * 		Uploads the vertices of a shape and sets up the attributes of its
+ * 		vertices and instances.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const void *vertices:	MeshVertex if lit, else 2D positions.
+ * 			size_t size:			Bytes of vertices.
+ * 			int vertexCount:		Number of vertices.
+ * 			bool lit:				Drawn with the lit program, using BoatInstance.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			InstancedShape *shape:	The shape, ready to be drawn.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void create_shape(InstancedShape *shape, const void *vertices, size_t size,
+		int vertexCount, bool lit)
+{
+	(*shape).vertexCount = vertexCount;
+	glGenVertexArrays(1, &(*shape).vertexArray);
+	glBindVertexArray((*shape).vertexArray);
+
+	glGenBuffers(1, &(*shape).vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, (*shape).vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	if (lit)
+	{
+		glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+				(void*) offsetof(MeshVertex, position));
+		glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
+		glVertexAttribPointer(ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+				(void*) offsetof(MeshVertex, normal));
+	} else
+	{
+		glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+	}
+
+	// filled every frame, one element per instance
+	glGenBuffers(1, &(*shape).instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, (*shape).instanceBuffer);
+	GLsizei stride = lit ? sizeof(BoatInstance) : sizeof(ShapeInstance);
+	glEnableVertexAttribArray(ATTRIBUTE_PLACEMENT);
+	glVertexAttribPointer(ATTRIBUTE_PLACEMENT, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*) (lit ? offsetof(BoatInstance, placement) : offsetof(ShapeInstance, placement)));
+	glVertexAttribDivisor(ATTRIBUTE_PLACEMENT, 1);
+	glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+	glVertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*) (lit ? offsetof(BoatInstance, color) : offsetof(ShapeInstance, color)));
+	glVertexAttribDivisor(ATTRIBUTE_COLOR, 1);
+	if (!lit)
+	{
+		glEnableVertexAttribArray(ATTRIBUTE_DEPTH);
+		glVertexAttribPointer(ATTRIBUTE_DEPTH, 1, GL_FLOAT, GL_FALSE, stride,
+				(void*) offsetof(ShapeInstance, depth));
+		glVertexAttribDivisor(ATTRIBUTE_DEPTH, 1);
+	}
+
+	glBindVertexArray(0);
+}
+
+/**************************************************
+ * NAME: static void place_boat(Mesh *mesh)
+ *
+ * DESCRIPTION:
+ * 		Turns and scales the boat model to the bottom of the window, seen from the
+ * 		side.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Mesh *mesh:	The boat as modelled.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Mesh *mesh:	The boat in window coordinates.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void place_boat(Mesh *mesh)
+{
+	static const float SCALE = 0.14;
+	static const float HEIGHT = -3.5;
+	static const float ROLL = 15.0 * M_PI / 180.0;	// about z, before turning about y by 90
+	float c = cosf(ROLL), s = sinf(ROLL);
+
+	for (int v = 0; v < (*mesh).vertexCount; v++)
+	{
+		float *p = (*mesh).vertices[v].position;
+		float *n = (*mesh).vertices[v].normal;
+
+		// rotate about z, then 90 degrees about y: (x, y, z) -> (z, y, -x)
+		float x = c * p[0] - s * p[1], y = s * p[0] + c * p[1];
+		float nx = c * n[0] - s * n[1], ny = s * n[0] + c * n[1];
+		p[0] = SCALE * p[2];
+		p[1] = SCALE * y + HEIGHT;
+		p[2] = -SCALE * x;
+		n[0] = n[2];
+		n[1] = ny;
+		n[2] = -nx;
+	}
+}
+
+/**************************************************
+ * NAME: int renderer_load(const char *boatModel)
+ *
+ * DESCRIPTION:
+ * 		Loads the boat and makes its levels of detail, ready to be uploaded by
+ * 		renderer_init(). Needs no OpenGL context, so it can be done on any thread
+ * 		while the window is still being made.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *boatModel:	The .obj file of the boat.
+ *
+ * OUTPUTS:
+ * 		EXTERNALS:
+ * 			MeshVertex *boatVertices:	All levels one after another.
+ * 			DetailLevel levels[]:		Where each level is.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int renderer_load(const char *boatModel)
+{
+	Mesh meshes[LOD_LEVELS];
+	if (load_obj(boatModel, &meshes[0]))
+		return 1;
+	place_boat(&meshes[0]);
+	levels[0].error = 0.0;
+	levelCount = 1;
+
+	int total = meshes[0].vertexCount;
+	for (int l = 1; l < LOD_LEVELS; l++)
+	{
+		if (mesh_simplify(&meshes[0], LOD_RESOLUTIONS[l - 1], &meshes[levelCount],
+				&levels[levelCount].error))
+			continue;	// drawn with more detail instead
+		total += meshes[levelCount++].vertexCount;
+	}
+
+	free(boatVertices);
+	boatVertices = malloc(total * sizeof(MeshVertex));
+	if (!boatVertices)
+	{
+		for (int l = 0; l < levelCount; l++)
+			free_mesh(&meshes[l]);
+		return 1;
+	}
+
+	printf("Boat model:");
+	int first = 0;
+	for (int l = 0; l < levelCount; l++)
+	{
+		levels[l].first = first;
+		levels[l].count = meshes[l].vertexCount;
+		memcpy(boatVertices + first, meshes[l].vertices,
+				meshes[l].vertexCount * sizeof(MeshVertex));
+		first += meshes[l].vertexCount;
+		printf(" %d", meshes[l].vertexCount / 3);
+		free_mesh(&meshes[l]);
+	}
+	printf(" triangles\n");
+	boatVertexCount = total;
+	return 0;
+}
+
+/**************************************************
+ * NAME: int renderer_init(const char *boatModel)
+ *
+ * DESCRIPTION:
+ * 		Builds the shader programs and uploads the geometry, the boat as loaded by
+ * 		renderer_load() or else loaded now. Needs a current OpenGL 3.3 core profile
+ * 		context.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *boatModel:	The .obj file of the boat.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int renderer_init(const char *boatModel)
+{
+	litProgram = compile_program(LIT_VERTEX_SHADER, LIT_FRAGMENT_SHADER);
+	flatProgram = compile_program(FLAT_VERTEX_SHADER, FLAT_FRAGMENT_SHADER);
+	if (!litProgram || !flatProgram)
+		return 1;
+
+	if (!boatVertices && renderer_load(boatModel))
+		return 1;
+	create_shape(&boats, boatVertices, boatVertexCount * sizeof(MeshVertex),
+			boatVertexCount, true);
+	free(boatVertices);	// on the GPU now
+	boatVertices = NULL;
+
+	create_shape(&quads, UNIT_QUAD, sizeof(UNIT_QUAD), 6, false);
+	create_shape(&triangles, UNIT_TRIANGLE, sizeof(UNIT_TRIANGLE), 3, false);
+
+	glGenBuffers(1, &frameBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, frameBuffer);
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	renderer_resize(viewport[2], viewport[3]);
+
+	glEnable(GL_DEPTH_TEST);
+	return 0;
+}
+
+/**************************************************
+ * NAME: void renderer_resize(int width, int height)
+ *
+ * DESCRIPTION:
+ * 		Draws to the whole window after its size changed.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int width:	Width of the window in pixels.
+ * 			int height:	Height of the window in pixels.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void renderer_resize(int width, int height)
+{
+	glViewport(0, 0, width, height);
+	pixelsPerUnit = (width > height ? width : height) / (2.0 * VIEW_SIZE);
+}
+
+/**************************************************
+ * NAME: static void add_rectangle(ShapeInstance *shape, float x, float laneTop,
+ * 				float scale, const float box[4], const float color[3], float depth)
+ *
+ * DESCRIPTION:
+ * 		Places a rectangle, given in the coordinates of a lane filling the window,
+ * 		in a lane.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			float x:				Horizontal position of the shape in the window.
+ * 			float laneTop:			Top of the lane in the window.
+ * 			float scale:			Height of the lane relative to the window.
+ * 			const float box[4]:		Left, bottom, right and top of the rectangle.
+ * 			const float color[3]:	The color.
+ * 			float depth:			Larger is closer to the viewer.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ShapeInstance *shape:	The instance.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void add_rectangle(ShapeInstance *shape, float x, float laneTop, float scale,
+		const float box[4], const float color[3], float depth)
+{
+	(*shape).placement[0] = x + box[0] * scale;
+	(*shape).placement[1] = laneTop + (box[1] - VIEW_SIZE) * scale;
+	(*shape).placement[2] = (box[2] - box[0]) * scale;
+	(*shape).placement[3] = (box[3] - box[1]) * scale;
+	memcpy((*shape).color, color, 3 * sizeof(float));
+	(*shape).color[3] = 1.0;
+	(*shape).depth = depth;
+}
+
+/**************************************************
+ * NAME: static void upload(GLuint buffer, const void *data, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Replaces the content of a buffer written every frame. The old storage is
+ * 		orphaned, so the GPU can still draw the last frame from it.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			GLuint buffer:		The buffer.
+ * 			const void *data:	The new content.
+ * 			size_t size:		Bytes of content.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void upload(GLuint buffer, const void *data, size_t size)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+}
+
+/**************************************************
+ * NAME: void renderer_draw(const VesselView vessels[], int count)
+ *
+ * DESCRIPTION:
+ * 		Draws a frame: every vessel in its lane with its setline and power gauge.
+ * 		The window is cleared before, the buffers are not swapped.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const VesselView vessels[]:	The vessels.
+ * 			int count:					Number of vessels, RENDERER_MAX_VESSELS at most.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void renderer_draw(const VesselView vessels[], int count)
+{
+	static const float BOAT_COLOR[4] = { 1.0, 0.2, 0.2, 1.0 };
+	static const float BORDER_COLOR[3] = { 0.0, 0.0, 0.0 };
+	static const float ON_TARGET_COLOR[3] = { 0.0, 1.0, 0.0 };		// green
+	static const float OFF_TARGET_COLOR[3] = { 1.0, 0.0, 0.0 };	// red
+	static BoatInstance boatInstances[RENDERER_MAX_VESSELS];
+	static ShapeInstance quadInstances[RENDERER_MAX_VESSELS * QUADS_PER_VESSEL];
+	static ShapeInstance triangleInstances[RENDERER_MAX_VESSELS];
+
+	if (count > RENDERER_MAX_VESSELS)
+		count = RENDERER_MAX_VESSELS;
+
+	// the same for every frame but for the window being shared by the lanes
+	const float r = VIEW_SIZE;
+	FrameUniforms frame = {
+			{ 1 / r, 0, 0, 0, 0, 1 / r, 0, 0, 0, 0, -1 / r, 0, 0, 0, 0, 1 },	// glOrtho
+			{ 5.0, 5.0, 3.0, 0.0 }, { 0.8, 0.8, 0.8, 1.0 }, { 0.2, 0.2, 0.2, 1.0 },
+			{ 0.3, 0.3, 0.3, 16.0 } };
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+
+	float scale = count > 0 ? 1.0 / count : 1.0;
+
+	// lines keep their width in the window however narrow the lanes
+	float setlineWidth = SETLINE_WIDTH / scale, border = GAUGE_BORDER / scale;
+	const float setline[4] = { -setlineWidth, SETLINE_BOTTOM, setlineWidth, SETLINE_TOP };
+	const float borders[4][4] = {
+			{ GAUGE_LEFT, GAUGE_BOTTOM, GAUGE_RIGHT, GAUGE_BOTTOM + border },
+			{ GAUGE_LEFT, GAUGE_TOP - border, GAUGE_RIGHT, GAUGE_TOP },
+			{ GAUGE_LEFT, GAUGE_BOTTOM, GAUGE_LEFT + border, GAUGE_TOP },
+			{ GAUGE_RIGHT - border, GAUGE_BOTTOM, GAUGE_RIGHT, GAUGE_TOP } };
+
+	int quadCount = 0;
+	for (int v = 0; v < count; v++)
+	{
+		const VesselView *vessel = &vessels[v];
+		float laneTop = VIEW_SIZE - 2 * VIEW_SIZE * v * scale;
+
+		BoatInstance *boat = &boatInstances[v];
+		(*boat).placement[0] = (*vessel).boatX;
+		(*boat).placement[1] = laneTop - VIEW_SIZE * scale;
+		(*boat).placement[2] = scale;
+		(*boat).placement[3] = 0.0;
+		memcpy((*boat).color, BOAT_COLOR, sizeof(BOAT_COLOR));
+
+		add_rectangle(&quadInstances[quadCount++], (*vessel).setpointX, laneTop, scale,
+				setline, (*vessel).onTarget ? ON_TARGET_COLOR : OFF_TARGET_COLOR, 4.0);
+
+		// arrow from the left of the gauge, whiter the less power, simple color mapping
+		float arrowColor = 0.9 * (1.0 - (*vessel).power);
+		float color[3] = { 1.0, arrowColor, arrowColor * 0.6 };
+		float arrowX = GAUGE_LEFT + ARROW_LENGTH * (*vessel).power;
+		float body[4] = { GAUGE_LEFT, 0.0, arrowX, 1.0 };
+		float head[4] = { arrowX, GAUGE_BOTTOM, arrowX + 1.0, GAUGE_TOP };
+		add_rectangle(&quadInstances[quadCount++], 0.0, laneTop, scale, body, color, 0.0);
+		add_rectangle(&triangleInstances[v], 0.0, laneTop, scale, head, color, 0.0);
+		for (int b = 0; b < 4; b++)
+			add_rectangle(&quadInstances[quadCount++], 0.0, laneTop, scale, borders[b],
+					BORDER_COLOR, 0.1);
+	}
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (count == 0)
+		return;
+
+	upload(boats.instanceBuffer, boatInstances, count * sizeof(BoatInstance));
+	upload(quads.instanceBuffer, quadInstances, quadCount * sizeof(ShapeInstance));
+	upload(triangles.instanceBuffer, triangleInstances, count * sizeof(ShapeInstance));
+
+	// the boats are all the same size, the simplest level that looks the same
+	int level = 0;
+	while (level + 1 < levelCount
+			&& levels[level + 1].error * scale * pixelsPerUnit <= LOD_MAX_ERROR)
+		level++;
+
+	glUseProgram(litProgram);
+	glBindVertexArray(boats.vertexArray);
+	glDrawArraysInstanced(GL_TRIANGLES, levels[level].first, levels[level].count, count);
+
+	glUseProgram(flatProgram);
+	glBindVertexArray(quads.vertexArray);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, quads.vertexCount, quadCount);
+	glBindVertexArray(triangles.vertexArray);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, triangles.vertexCount, count);
+	glBindVertexArray(0);
+}
+
+/**************************************************
+ * NAME: void renderer_cleanup(void)
+ *
+ * DESCRIPTION:
+ * 		Deletes the programs and buffers, while the context is still current.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void renderer_cleanup(void)
+{
+	InstancedShape *shapes[] = { &boats, &quads, &triangles };
+	for (int s = 0; s < 3; s++)
+	{
+		glDeleteVertexArrays(1, &(*shapes[s]).vertexArray);
+		glDeleteBuffers(1, &(*shapes[s]).vertexBuffer);
+		glDeleteBuffers(1, &(*shapes[s]).instanceBuffer);
+	}
+	glDeleteBuffers(1, &frameBuffer);
+	glDeleteProgram(litProgram);
+	glDeleteProgram(flatProgram);
+}
@@ -3,16 +3,19 @@
  *
  * DESCRIPTION:
  * 		Implementation of a noise-reduction algorithm. It also ensures
- * 		responsiveness by reducing accuracy when it is not needed.
+ * 		responsiveness by reducing accuracy when it is not needed. Every filtered
+ * 		signal keeps its own state in a ResponsiveAnalogRead struct.
  *
  * PUBLIC FUNCTIONS:
- * 		int responsive_analog_read(int newValue)
+ * 		int responsive_analog_read(ResponsiveAnalogRead *filter, float newValue)
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 
 #include <stdlib.h>
 
+#include "headers/responsive_analog_read.h"
+
 static const int ANALOG_RESOLUTION = 1000;
 
 // value between 0 and 1 that controls how smooth the output is
@@ -46,7 +49,7 @@ static float smoothness_curve(float diff)
 }
 
 /**************************************************
- * NAME: int responsive_analog_read(int newValue)
+ * NAME: int responsive_analog_read(ResponsiveAnalogRead *filter, float newValue)
  *
  * DESCRIPTION:
  * 		Applies the exponential running average algorithm to values and
@@ -54,17 +57,21 @@ static float smoothness_curve(float diff)
  *
  * INPUTS:
  *		PARAMETERS:
- *			float newValue:	The new value which will be smoothed.
+ *			ResponsiveAnalogRead *filter:	The state of the filtered signal, zero
+ *											initialized before the first value.
+ *			float newValue:					The new value which will be smoothed.
  *
  * OUTPUTS:
+ *		PARAMETERS:
+ *			ResponsiveAnalogRead *filter:	The updated state.
  *		RETURN:
  *			int:	The smoothed value.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-int responsive_analog_read(float newValue)
+int responsive_analog_read(ResponsiveAnalogRead *filter, float newValue)
 {
-	static float smoothValue = 0.0;
+	float smoothValue = (*filter).smoothValue;
 
 	float diff = abs(newValue - smoothValue);
 
@@ -79,6 +86,7 @@ int responsive_analog_read(float newValue)
 	else if (smoothValue > ANALOG_RESOLUTION - 1)
 		smoothValue = ANALOG_RESOLUTION - 1;
 
+	(*filter).smoothValue = smoothValue;
 	return (int) smoothValue;
 }
 
@@ -0,0 +1,487 @@
+/**************************************************
+ * FILENAME:	scenarios.c
+ *
+ * DESCRIPTION:
+ * 		A regression suite for the closed loop. Scripted scenarios are run through
+ * 		the whole stack of a channel, from the sensor filter to the PID-controller
+ * 		with the gains and disturbance observer of the first channel, against the
+ * 		simulated boat: setpoint steps and ramps, a push on the boat, a burst of
+ * 		sensor noise, a sensor that stops updating and waves. The scenarios run
+ * 		in parallel, one per core, as fast as they can be computed.
+ *
+ * 		Every scenario is scored on the boat rather than on what the sensor says:
+ * 		the time until it stays within SETTLING_BAND of the target, how far it goes
+ * 		past the target (or away from it when holding), the mean error over the last
+ * 		STEADY_TIME seconds and the control effort, the integral of the power
+ * 		squared. A scenario that has not stayed within the band for the last
+ * 		STEADY_TIME seconds never settled, and fails the suite outright. The scores
+ * 		are compared to a baseline file and the suite fails if any has got worse by
+ * 		more than TOLERANCE. The baseline is written when there is none or when
+ * 		asked to update it, and is only valid for the gains, observer, period and
+ * 		delay it was written with.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int scenarios_run(const PIDController *pid, float observerBandwidth, float period,
+ * 				float delay, const char *baselineFile, bool update)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "headers/control_channel.h"
+#include "headers/scenarios.h"
+#include "headers/simulated_boat.h"
+#include "headers/time_utils.h"
+
+#define WARMUP_TIME 180.0	// seconds holding at the start before the event, long enough
+							// for the integral term to settle against the current
+#define SCENARIO_TIME 240.0	// seconds after the event
+#define STEADY_TIME 10.0	// seconds at the end the steady-state error is averaged over
+#define SETTLING_BAND 5.0	// printed units
+#define MAX_THREADS 64
+#define METRIC_COUNT 4
+
+// a metric has regressed when above baseline * (1 + TOLERANCE) + its slack
+#define TOLERANCE 0.10
+
+static const double START_POSITION = 400.0;	// printed units
+
+// the noise every metric varies with, in its unit
+static const double SLACK[METRIC_COUNT] = { 0.1, 0.2, 0.05, 1.0 };
+static const char *METRIC_NAMES[METRIC_COUNT] = { "settling", "overshoot", "steady",
+		"effort" };
+
+typedef struct
+{
+	const char *name;
+	double move;		// sensor units the target moves into the tank at the event
+	double ramp;		// units per second the target moves with, 0 for a step
+	double impulse;		// printed units per second added to the boat at the event
+	double waves;		// amplitude of the force of the waves after the event [units/s^2]
+	double wavePeriod;	// seconds
+	double noise;		// amplitude of the sensor noise added after the event
+	double noiseTime;	// seconds the noise lasts
+	double dropStart;	// seconds after the event the sensor stops updating
+	double dropTime;	// seconds it keeps its last reading
+} Scenario;
+
+static const Scenario SCENARIOS[] =
+{
+	{ .name = "step", .move = 60.0 },
+	{ .name = "step-small", .move = 10.0 },
+	{ .name = "ramp", .move = 60.0, .ramp = 3.0 },
+	{ .name = "impulse", .impulse = 20.0 },
+	{ .name = "noise-burst", .noise = 15.0, .noiseTime = 5.0 },
+	{ .name = "dropout", .move = 60.0, .dropStart = 2.0, .dropTime = 1.0 },
+	{ .name = "waves", .waves = 5.0, .wavePeriod = 5.0 },
+};
+
+#define SCENARIO_COUNT ((int) (sizeof(SCENARIOS) / sizeof(SCENARIOS[0])))
+
+// settling [s], overshoot [printed units], steady-state error [printed units], effort
+typedef struct
+{
+	double metrics[METRIC_COUNT];
+} Score;
+
+typedef struct
+{
+	PIDController pid;	// copied to every scenario
+	float bandwidth;	// of the disturbance observer, 0 when off
+	float period;
+	float delay;
+	atomic_int next;	// index of the first scenario not taken by a thread
+	Score scores[SCENARIO_COUNT];
+} Suite;
+
+/**************************************************
+ * NAME: static unsigned int hash(const char *name)
+ *
+ * DESCRIPTION:
+ * 		Hashes a name with 32 bit FNV-1a.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *name:	The name.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			unsigned int:	The hash.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static unsigned int hash(const char *name)
+{
+	uint32_t value = 2166136261u;
+	for (; *name != '\0'; name++)
+		value = (value ^ (unsigned char) *name) * 16777619u;
+	return value;
+}
+
+/**************************************************
+ * NAME: static void run_scenario(int index, const Suite *suite, Score *score)
+ *
+ * DESCRIPTION:
+ * 		Runs a channel on the simulated boat through a scenario and scores it. The
+ * 		noise of every scenario is seeded by its name, so the scores only change
+ * 		with the code, not with the scenarios added or removed before it.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int index:				Index of the scenario in SCENARIOS.
+ * 			const Suite *suite:		The controller, observer, period and delay to run with.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Score *score:	The metrics of the run.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void run_scenario(int index, const Suite *suite, Score *score)
+{
+	float period = (*suite).period;
+	const Scenario *scenario = &SCENARIOS[index];
+	ControlChannel *channel = malloc(sizeof(ControlChannel));	// too large for the stack
+	SimulatedBoat *boat = malloc(sizeof(SimulatedBoat));
+	if (channel == NULL || boat == NULL)
+	{
+		perror("malloc");
+		exit(1);
+	}
+	channel_init(channel, (*scenario).name, 0, 0);
+	(*channel).pid = (*suite).pid;
+	(*channel).observer.bandwidth = (*suite).bandwidth;
+	simulated_boat_init(boat, START_POSITION, (*suite).delay);
+	unsigned int seed = hash((*scenario).name);
+
+	unsigned long now = sec_to_nano(1.0);	// 0 means not started to the PID-controller
+	unsigned long step = sec_to_nano(period);
+	channel_start(channel, 1000 - (int) lround((*boat).position), period);
+	float startpoint = (*channel).data.startpoint;
+	(*channel).data.target = startpoint;	// hold where it starts
+
+	// the target after the event, in printed units and the direction of the move
+	double target = 1000.0 - (startpoint - (*scenario).move);
+	double direction = (*scenario).move > 0.0 ? 1.0 : 0.0;
+
+	int warmup = (int) lround(WARMUP_TIME / period);
+	int iterations = warmup + (int) lround(SCENARIO_TIME / period);
+	int steadyStart = iterations - (int) lround(STEADY_TIME / period);
+	int heldValue = 0, steadyCount = 0;
+	double lastOutside = 0.0, overshoot = 0.0, steady = 0.0, effort = 0.0;
+
+	for (int i = 0; i < iterations; i++)
+	{
+		double t = (i - warmup) * (double) period;	// seconds since the event
+
+		if (t >= 0.0)
+		{
+			double moved = (*scenario).move;
+			if ((*scenario).ramp > 0.0 && (*scenario).ramp * t < moved)
+				moved = (*scenario).ramp * t;
+			(*channel).data.target = startpoint - moved;
+		}
+		if (i == warmup)
+			(*boat).velocity += (*scenario).impulse;
+		if (t >= 0.0 && (*scenario).waves > 0.0)
+			(*boat).force = (*scenario).waves * sin(2.0 * M_PI * t / (*scenario).wavePeriod);
+
+		// quantized sensor value with noise
+		int sensorValue = (int) lround(1000.0 - (*boat).position) + rand_r(&seed) % 3 - 1;
+		if (t >= 0.0 && t < (*scenario).noiseTime)
+			sensorValue += (int) lround((*scenario).noise
+					* (2.0 * rand_r(&seed) / RAND_MAX - 1.0));
+		if (t >= (*scenario).dropStart && t < (*scenario).dropStart + (*scenario).dropTime)
+			sensorValue = heldValue;
+		heldValue = sensorValue;
+
+		PIDdata pid = channel_update(channel, sensorValue, now);
+		double power = MAX_OUTPUT - pid.output;
+		simulated_boat_step(boat, power, period);
+		now += step;
+
+		if (t < 0.0)
+			continue;
+
+		double error = (*boat).position - target;
+		if (fabs(error) > SETTLING_BAND)
+			lastOutside = t + period;
+		if (direction > 0.0 && error * direction > overshoot)
+			overshoot = error * direction;
+		else if (direction == 0.0 && fabs(error) > overshoot)
+			overshoot = fabs(error);	// how far it was pushed away when holding
+		if (i >= steadyStart)
+		{
+			steady += fabs(error);
+			steadyCount++;
+		}
+		effort += power * power * period;
+	}
+
+	(*score).metrics[0] = lastOutside;
+	(*score).metrics[1] = overshoot;
+	(*score).metrics[2] = steadyCount > 0 ? steady / steadyCount : 0.0;
+	(*score).metrics[3] = effort;
+
+	free(channel);
+	free(boat);
+}
+
+/**************************************************
+ * NAME: static void *runner_func(void *arg)
+ *
+ * DESCRIPTION:
+ * 		Runs scenarios until all have been taken.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *arg:	The suite.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			void*:	NULL.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *runner_func(void *arg)
+{
+	Suite *suite = arg;
+	int index;
+	while ((index = atomic_fetch_add(&(*suite).next, 1)) < SCENARIO_COUNT)
+		run_scenario(index, suite, &(*suite).scores[index]);
+	return NULL;
+}
+
+/**************************************************
+ * NAME: static int load_baseline(const char *filename, const Suite *suite,
+ * 				Score baseline[], bool found[])
+ *
+ * DESCRIPTION:
+ * 		Reads the scores of a baseline file, written with the same gains,
+ * 		observer, period and delay. A file without an observer line was written
+ * 		without one.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *filename:	The baseline file.
+ * 			const Suite *suite:		The suite run.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Score baseline[]:	The scores, by index in SCENARIOS.
+ * 			bool found[]:		Whether a scenario had a score in the file.
+ *		RETURNS:
+ *			int:	0 if successful, 1 if it cannot be read or is for another run.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int load_baseline(const char *filename, const Suite *suite, Score baseline[],
+		bool found[])
+{
+	FILE *fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		perror(filename);
+		return 1;
+	}
+
+	char line[256], name[64];
+	float filePeriod = -1.0, fileDelay = -1.0, gains[3] = { -1.0, -1.0, -1.0 };
+	float bandwidth = 0.0;
+	double m[METRIC_COUNT];
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (sscanf(line, "period %f", &filePeriod) == 1
+				|| sscanf(line, "delay %f", &fileDelay) == 1
+				|| sscanf(line, "observer %f", &bandwidth) == 1
+				|| sscanf(line, "gains %f %f %f", &gains[0], &gains[1], &gains[2]) == 3)
+			continue;
+		if (sscanf(line, "%63s %lf %lf %lf %lf", name, &m[0], &m[1], &m[2], &m[3]) != 5)
+			continue;	// comments and empty lines
+		for (int s = 0; s < SCENARIO_COUNT; s++)
+		{
+			if (strcmp(name, SCENARIOS[s].name) == 0)
+			{
+				memcpy(baseline[s].metrics, m, sizeof(m));
+				found[s] = true;
+			}
+		}
+	}
+	fclose(fp);
+
+	const PIDController *pid = &(*suite).pid;
+	if (fabsf(filePeriod - (*suite).period) > 1e-5 || fabsf(fileDelay - (*suite).delay) > 1e-5
+			|| fabsf(gains[0] - (*pid).Kp) > 1e-5 || fabsf(gains[1] - (*pid).Ki) > 1e-5
+			|| fabsf(gains[2] - (*pid).Kd) > 1e-5
+			|| fabsf(bandwidth - (*suite).bandwidth) > 1e-5)
+	{
+		printf("The baseline %s is for the gains %.4f %.4f %.4f, an observer of %.2f Hz, "
+				"a period of %.1f ms and a delay of %.1f ms, update it for these\n", filename,
+				gains[0], gains[1], gains[2], bandwidth, filePeriod * 1000.0,
+				fileDelay * 1000.0);
+		return 1;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: static int save_baseline(const char *filename, const Suite *suite)
+ *
+ * DESCRIPTION:
+ * 		Writes the scores of a run as the new baseline.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *filename:	The baseline file.
+ * 			const Suite *suite:		The suite run, with its scores.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int save_baseline(const char *filename, const Suite *suite)
+{
+	FILE *fp = fopen(filename, "w");
+	if (fp == NULL)
+	{
+		perror(filename);
+		return 1;
+	}
+	fprintf(fp, "# scenario settling [s] overshoot steady-state error effort\n");
+	fprintf(fp, "gains %.6f %.6f %.6f\n", (*suite).pid.Kp, (*suite).pid.Ki, (*suite).pid.Kd);
+	fprintf(fp, "observer %.6f\n", (*suite).bandwidth);
+	fprintf(fp, "period %.6f\n", (*suite).period);
+	fprintf(fp, "delay %.6f\n", (*suite).delay);
+	for (int s = 0; s < SCENARIO_COUNT; s++)
+	{
+		const double *m = (*suite).scores[s].metrics;
+		fprintf(fp, "%s %.3f %.3f %.3f %.1f\n", SCENARIOS[s].name, m[0], m[1], m[2], m[3]);
+	}
+	fclose(fp);
+	printf("Baseline written to %s\n", filename);
+	return 0;
+}
+
+/**************************************************
+ * NAME: int scenarios_run(const PIDController *pid, float observerBandwidth, float period,
+ * 				float delay, const char *baselineFile, bool update)
+ *
+ * DESCRIPTION:
+ * 		Runs all scenarios, one thread per core, prints their scores and compares
+ * 		them to the baseline.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const PIDController *pid:	The configured controller, not yet started.
+ * 			float observerBandwidth:	Hz of the disturbance observer, 0 when off.
+ * 			float period:				Seconds between iterations of the loop.
+ * 			float delay:				Seconds until the simulated boat feels the power.
+ * 			const char *baselineFile:	Scores to compare to.
+ * 			bool update:				Write the scores as the new baseline.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	0 if no metric has regressed, 1 if any has or on failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int scenarios_run(const PIDController *pid, float observerBandwidth, float period,
+		float delay, const char *baselineFile, bool update)
+{
+	static Suite suite;
+	static Score baseline[SCENARIO_COUNT];
+	bool found[SCENARIO_COUNT] = { false };
+	suite.pid = *pid;
+	suite.bandwidth = observerBandwidth;
+	suite.period = period;
+	suite.delay = delay;
+	atomic_store(&suite.next, 0);
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int threadCount = cores < 1 ? 1 : cores > MAX_THREADS ? MAX_THREADS : (int) cores;
+	if (threadCount > SCENARIO_COUNT)
+		threadCount = SCENARIO_COUNT;
+
+	unsigned long start = nano_time();
+	pthread_t threads[MAX_THREADS];
+	int started = 0;
+	for (; started < threadCount - 1; started++)	// the calling thread runs too
+		if (pthread_create(&threads[started], NULL, runner_func, &suite) != 0)
+			break;
+	runner_func(&suite);	// also when no thread could be started
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	double wall = nano_to_sec(nano_time() - start);
+
+	printf("Ran %d scenarios of %.0f s on %d threads in %.2f s (%.0fx real time), "
+			"period %.1f ms, delay %.1f ms\n", SCENARIO_COUNT, WARMUP_TIME + SCENARIO_TIME,
+			started + 1, wall, SCENARIO_COUNT * (WARMUP_TIME + SCENARIO_TIME) / wall,
+			period * 1000.0, delay * 1000.0);
+
+	// the first run without a baseline makes one
+	bool compare = !update && access(baselineFile, F_OK) == 0;
+	if (compare && load_baseline(baselineFile, &suite, baseline, found))
+		return 1;
+	int regressions = 0, unsettled = 0;
+
+	printf("scenario     settling [s]  overshoot  steady err     effort\n");
+	for (int s = 0; s < SCENARIO_COUNT; s++)
+	{
+		const double *m = suite.scores[s].metrics;
+		printf("%-12s %12.2f %10.2f %10.2f %10.1f", SCENARIOS[s].name, m[0], m[1], m[2],
+				m[3]);
+		if (m[0] > SCENARIO_TIME - STEADY_TIME)
+		{
+			printf("  NEVER SETTLED\n");
+			unsettled++;
+			continue;
+		}
+		if (!compare || !found[s])
+		{
+			printf(compare ? "  no baseline\n" : "\n");
+			continue;
+		}
+		bool regressed = false;
+		for (int k = 0; k < METRIC_COUNT; k++)
+		{
+			double limit = baseline[s].metrics[k] * (1.0 + TOLERANCE) + SLACK[k];
+			if (m[k] > limit)
+			{
+				printf("%s %s %.2f > %.2f", regressed ? "," : "  REGRESSED", METRIC_NAMES[k],
+						m[k], limit);
+				regressed = true;
+			}
+		}
+		printf(regressed ? "\n" : "  ok\n");
+		if (regressed)
+			regressions++;
+	}
+
+	if (unsettled > 0)
+	{
+		// a baseline with such a scenario could not catch its settling getting worse
+		printf("%d of %d scenarios never settled within %.0f units\n", unsettled,
+				SCENARIO_COUNT, SETTLING_BAND);
+		return 1;
+	}
+	if (!compare)
+		return save_baseline(baselineFile, &suite);
+	if (regressions > 0)
+	{
+		printf("%d of %d scenarios regressed beyond %.0f%% of %s\n", regressions,
+				SCENARIO_COUNT, TOLERANCE * 100.0, baselineFile);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,117 @@
+/**************************************************
+ * FILENAME:	seqlock.c
+ *
+ * DESCRIPTION:
+ * 		Sequence locks, publishing data written by one thread to any number of
+ * 		readers. The writer never waits, a reader copies the data and copies it
+ * 		again if the sequence number shows it was written in the meantime.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void seqlock_write(_Atomic uint64_t *sequence, uint64_t version, void *data,
+ * 				const void *value, size_t size)
+ * 		void seqlock_publish(_Atomic uint64_t *sequence, void *data,
+ * 				const void *value, size_t size)
+ * 		uint64_t seqlock_read(_Atomic uint64_t *sequence, const void *data,
+ * 				void *value, size_t size)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <string.h>
+
+#include "headers/seqlock.h"
+
+/**************************************************
+ * NAME: void seqlock_write(_Atomic uint64_t *sequence, uint64_t version, void *data,
+ * 				const void *value, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Writes a given version of the data. For data in a ring, where the
+ * 		version tells the readers which record they see. Must only be called by
+ * 		the writer.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			_Atomic uint64_t *sequence:	The sequence number guarding the data.
+ * 			uint64_t version:			The version written.
+ * 			const void *value:			The new data.
+ * 			size_t size:				Size of the data in bytes.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			void *data:	The published data.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void seqlock_write(_Atomic uint64_t *sequence, uint64_t version, void *data,
+		const void *value, size_t size)
+{
+	atomic_store_explicit(sequence, 2 * version + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	memcpy(data, value, size);
+
+	atomic_store_explicit(sequence, 2 * version + 2, memory_order_release);
+}
+
+/**************************************************
+ * NAME: void seqlock_publish(_Atomic uint64_t *sequence, void *data,
+ * 				const void *value, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Writes the next version of the data. Must only be called by the writer.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			_Atomic uint64_t *sequence:	The sequence number guarding the data.
+ * 			const void *value:			The new data.
+ * 			size_t size:				Size of the data in bytes.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			void *data:	The published data.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void seqlock_publish(_Atomic uint64_t *sequence, void *data, const void *value,
+		size_t size)
+{
+	uint64_t current = atomic_load_explicit(sequence, memory_order_relaxed);
+	seqlock_write(sequence, current / 2, data, value, size);
+}
+
+/**************************************************
+ * NAME: uint64_t seqlock_read(_Atomic uint64_t *sequence, const void *data,
+ * 				void *value, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Reads a consistent copy of the data, retrying while it is written. May be
+ * 		called from any thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			_Atomic uint64_t *sequence:	The sequence number guarding the data.
+ * 			const void *data:			The published data.
+ * 			size_t size:				Size of the data in bytes.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			void *value:	Where to store the copy.
+ * 		RETURN:
+ * 			uint64_t:	The sequence number of the copy, 0 if nothing was published.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+uint64_t seqlock_read(_Atomic uint64_t *sequence, const void *data, void *value,
+		size_t size)
+{
+	uint64_t before, after;
+	do
+	{
+		before = atomic_load_explicit(sequence, memory_order_acquire);
+		memcpy(value, data, size);
+		atomic_thread_fence(memory_order_acquire);
+		after = atomic_load_explicit(sequence, memory_order_relaxed);
+	} while ((before & 1) || before != after);
+	return before;
+}
@@ -0,0 +1,606 @@
+/**************************************************
+ * FILENAME:	session.c
+ *
+ * DESCRIPTION:
+ * 		Every run of the program is recorded in a directory of its own under
+ * 		SESSION_ROOT, named by its start time, so no run overwrites the data of
+ * 		another. The settings of the run are written to 'session.txt' in the
+ * 		directory and repeated as comment lines atop every log file: the start
+ * 		time, the git revision the program was built from, the loop rate, the
+ * 		output limits, and the sensor, servo, controller and gains of every
+ * 		channel. The results of the run are written to SESSION_SUMMARY, below the
+ * 		same settings.
+ *
+ * 		A log is continued in a new part, output_<name>_<part>.dat, when the
+ * 		current part reaches SESSION_ROTATE_SIZE bytes or SESSION_ROTATE_TIME
+ * 		seconds. Lines are collected in one of two buffers while the other is
+ * 		written by a thread of the log, which also opens the new parts. The space
+ * 		of a part is allocated up front, so writing does not wait for the file
+ * 		system to find blocks. The one logging only waits when the writer is still
+ * 		busy with the previous buffer, which is counted as a stall. A buffer is
+ * 		handed over when it is full or, if the writer is idle, after a second.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int session_create(Session *session, const ControlRuntime *runtime)
+ * 		FILE *session_open_summary(const Session *session)
+ * 		int session_log_open(SessionLog *log, const Session *session, const char *name,
+ * 				const char *columns)
+ * 		void session_log_printf(SessionLog *log, const char *format, ...)
+ * 		void session_log_close(SessionLog *log)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#define _GNU_SOURCE	// fallocate()
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "headers/session.h"
+#include "headers/time_utils.h"
+
+// set by the makefile
+#ifndef GIT_REVISION
+#define GIT_REVISION "unknown"
+#endif
+
+#define LINE_LENGTH 512
+
+static const unsigned long HAND_OVER_INTERVAL = 1000000000UL;	// 1 second
+
+static const char *ANTI_WINDUP_NAMES[] = { "clamp", "conditional", "back-calculation" };
+
+/**************************************************
+ * NAME: static void append(Session *session, const char *format, ...)
+ *
+ * DESCRIPTION:
+ * 		Adds a comment line to the metadata of the session, as much as fits.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Session *session:		The session.
+ * 			const char *format:		Format of the line, without "# " and newline.
+ * 			...:					The values of the format.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Session *session:	The session with the line.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void append(Session *session, const char *format, ...)
+		__attribute__((format(printf, 2, 3)));
+static void append(Session *session, const char *format, ...)
+{
+	size_t used = strlen((*session).header);
+	char *end = (*session).header + used;
+	size_t left = SESSION_HEADER_LENGTH - used;
+	if (left < 4)
+		return;
+
+	va_list arguments;
+	va_start(arguments, format);
+	int length = snprintf(end, left - 1, "# ");
+	length += vsnprintf(end + length, left - 1 - length, format, arguments);
+	va_end(arguments);
+
+	if ((size_t) length >= left - 1)
+		length = left - 2;	// cut off
+	end[length] = '\n';
+	end[length + 1] = '\0';
+}
+
+/**************************************************
+ * NAME: static void describe(Session *session, const ControlRuntime *runtime,
+ * 				const struct tm *start)
+ *
+ * DESCRIPTION:
+ * 		Writes the settings of the run to the metadata of the session.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Session *session:				The session.
+ * 			const ControlRuntime *runtime:	The loaded channels.
+ * 			const struct tm *start:			Local start time of the run.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Session *session:	The session with the metadata.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void describe(Session *session, const ControlRuntime *runtime, const struct tm *start)
+{
+	char started[64];
+	strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S %z", start);
+
+	(*session).header[0] = '\0';
+	append(session, "Data gathered from running the dynamic positioning program.");
+	append(session, "start: %s", started);
+	append(session, "revision: %s", GIT_REVISION);
+	append(session, "loop rate: %.1f Hz (period %.4f s), %d workers",
+			1.0 / nano_to_sec((*runtime).period), nano_to_sec((*runtime).period),
+			(*runtime).workerCount);
+	append(session, "servo output: %.1f (full power) to %.1f (no power), deadband %.3f",
+			MIN_OUTPUT, MAX_OUTPUT, (*runtime).deadband);
+	append(session, "watchdog: timeout %.1f ms, stuck sensor %.1f ms, sensor range %d to %d",
+			(*runtime).watchdogTimeout / 1e6, (*runtime).sensorStuckTime / 1e6,
+			(*runtime).sensorMin, (*runtime).sensorMax);
+
+	for (int c = 0; c < (*runtime).channelCount; c++)
+	{
+		const ControlChannel *channel = &(*runtime).channels[c];
+		const PIDController *pid = &(*channel).pid;
+		const Trajectory *trajectory = &(*channel).trajectory;
+
+		append(session, "channel %s: sensor %d, servo %d, responsive analog read filter, "
+				"controller %s", (*channel).name, (*channel).sensorIndex,
+				(*channel).servoIndex, (*channel).controller == CONTROLLER_MPC ? "mpc" : "pid");
+		append(session, "  gains: Kp %g Ki %g Kd %g, feed forward Kv %g Ka %g, "
+				"anti-windup %s (tracking time %g s)", (*pid).Kp, (*pid).Ki, (*pid).Kd,
+				(*pid).Kv, (*pid).Ka, ANTI_WINDUP_NAMES[(*pid).antiWindup],
+				(*pid).trackingTime);
+		append(session, "  trajectory limits: velocity %g, acceleration %g, jerk %g",
+				(*trajectory).maxVelocity, (*trajectory).maxAcceleration,
+				(*trajectory).maxJerk);
+		if ((*channel).schedule.filename[0])
+			append(session, "  gain schedule: %s", (*channel).schedule.filename);
+		if ((*channel).calibration.loaded)
+			append(session, "  calibration: %s", (*channel).calibration.filename);
+		if ((*channel).thrustMap.loaded)
+			append(session, "  thrust curve: %s", (*channel).thrustMap.filename);
+		if ((*channel).observer.bandwidth > 0.0)
+			append(session, "  disturbance observer: bandwidth %g Hz",
+					(*channel).observer.bandwidth);
+		if ((*channel).modelConfigured)
+			append(session, "  model: %g %g %g %g %g", (*channel).model.a[0],
+					(*channel).model.a[1], (*channel).model.b[0], (*channel).model.b[1],
+					(*channel).model.c);
+	}
+}
+
+/**************************************************
+ * NAME: static int write_all(int fd, const char *data, size_t size)
+ *
+ * DESCRIPTION:
+ * 		Writes all of the data, continuing after partial writes.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int fd:				The file.
+ * 			const char *data:	The data.
+ * 			size_t size:		Number of bytes.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int write_all(int fd, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t written = write(fd, data, size);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return 1;
+		data += written;
+		size -= written;
+	}
+	return 0;
+}
+
+/**************************************************
+ * NAME: int session_create(Session *session, const ControlRuntime *runtime)
+ *
+ * DESCRIPTION:
+ * 		Creates the directory of a new session and writes its metadata to
+ * 		'session.txt'.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Session *session:				The session.
+ * 			const ControlRuntime *runtime:	The loaded channels.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Session *session:	The new session, without a directory if it could
+ * 								not be created.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int session_create(Session *session, const ControlRuntime *runtime)
+{
+	(*session).directory[0] = '\0';
+	if (mkdir(SESSION_ROOT, 0755) < 0 && errno != EEXIST)
+	{
+		perror(SESSION_ROOT);
+		return 1;
+	}
+
+	time_t now = time(NULL);
+	struct tm start;
+	localtime_r(&now, &start);
+	char name[32];
+	strftime(name, sizeof(name), "%Y-%m-%d_%H-%M-%S", &start);
+
+	// runs started within the same second get a number
+	snprintf((*session).directory, SESSION_PATH_LENGTH, "%s/%s", SESSION_ROOT, name);
+	for (int n = 2; mkdir((*session).directory, 0755) < 0; n++)
+	{
+		if (errno != EEXIST || n > 100)
+		{
+			perror((*session).directory);
+			(*session).directory[0] = '\0';
+			return 1;
+		}
+		snprintf((*session).directory, SESSION_PATH_LENGTH, "%s/%s_%d", SESSION_ROOT, name, n);
+	}
+
+	describe(session, runtime, &start);
+
+	char filename[SESSION_PATH_LENGTH + 16];
+	snprintf(filename, sizeof(filename), "%s/session.txt", (*session).directory);
+	FILE *file = fopen(filename, "w");
+	if (!file)
+	{
+		perror(filename);
+		return 1;
+	}
+	fputs((*session).header, file);
+	fclose(file);
+
+	printf("Recording to %s\n", (*session).directory);
+	return 0;
+}
+
+/**************************************************
+ * NAME: FILE *session_open_summary(const Session *session)
+ *
+ * DESCRIPTION:
+ * 		Creates the summary of a session, starting with its settings.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const Session *session:	The session.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			FILE *:	The summary open for writing, NULL without a directory or on
+ * 					failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+FILE *session_open_summary(const Session *session)
+{
+	if ((*session).directory[0] == '\0')
+		return NULL;
+
+	char filename[SESSION_PATH_LENGTH + sizeof(SESSION_SUMMARY) + 1];
+	snprintf(filename, sizeof(filename), "%s/%s", (*session).directory, SESSION_SUMMARY);
+	FILE *file = fopen(filename, "w");
+	if (!file)
+	{
+		perror(filename);
+		return NULL;
+	}
+	fputs((*session).header, file);
+	return file;
+}
+
+/**************************************************
+ * NAME: static void close_part(SessionLog *log)
+ *
+ * DESCRIPTION:
+ * 		Closes the current part of a log, giving back the space allocated beyond
+ * 		what was written.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log without an open part.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void close_part(SessionLog *log)
+{
+	if ((*log).fd < 0)
+		return;
+	if (ftruncate((*log).fd, (*log).size) < 0)
+		perror((*log).filename);
+	close((*log).fd);
+	(*log).fd = -1;
+}
+
+/**************************************************
+ * NAME: static int open_part(SessionLog *log)
+ *
+ * DESCRIPTION:
+ * 		Closes the current part of a log and starts the next one with the
+ * 		metadata of the session.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log writing to the new part.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int open_part(SessionLog *log)
+{
+	close_part(log);
+
+	(*log).part++;
+	snprintf((*log).filename, sizeof((*log).filename), "%s/output_%s_%d.dat",
+			(*(*log).session).directory, (*log).name, (*log).part);
+	(*log).fd = open((*log).filename, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if ((*log).fd < 0)
+	{
+		perror((*log).filename);
+		return 1;
+	}
+
+	// reserve the space of a whole part without changing the size of the file
+	if (fallocate((*log).fd, FALLOC_FL_KEEP_SIZE, 0, SESSION_ROTATE_SIZE) < 0
+			&& errno != EOPNOTSUPP)
+		perror((*log).filename);	// still written, only without space reserved
+
+	char part[64];
+	int length = snprintf(part, sizeof(part), "# part: %d\n", (*log).part);
+	const char *header = (*(*log).session).header;
+	if (write_all((*log).fd, header, strlen(header)) || write_all((*log).fd, part, length)
+			|| write_all((*log).fd, (*log).columns, strlen((*log).columns)))
+	{
+		perror((*log).filename);
+		return 1;
+	}
+	(*log).size = strlen(header) + length + strlen((*log).columns);
+	(*log).opened = nano_time();
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void *writer_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Writes the buffers handed over to the current part of a log, starting a
+ * 		new part when the current one is full or old, until the log is closed.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	The SessionLog.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *writer_func(void *void_ptr)
+{
+	SessionLog *log = (SessionLog*) void_ptr;
+
+	pthread_mutex_lock(&(*log).lock);
+	while (true)
+	{
+		while (!(*log).pending && !(*log).stopping)
+			pthread_cond_wait(&(*log).changed, &(*log).lock);
+		if (!(*log).pending)
+			break;	// stopping with everything written
+
+		// the buffer is not touched by the one logging until pending is cleared
+		const char *buffer = (*log).buffers[!(*log).active];
+		size_t size = (*log).pending;
+		pthread_mutex_unlock(&(*log).lock);
+
+		if ((*log).size + size > SESSION_ROTATE_SIZE
+				|| nano_time() - (*log).opened > sec_to_nano(SESSION_ROTATE_TIME))
+			open_part(log);
+		if ((*log).fd >= 0)
+		{
+			if (write_all((*log).fd, buffer, size))
+				perror((*log).filename);
+			else
+				(*log).size += size;
+		}
+
+		pthread_mutex_lock(&(*log).lock);
+		(*log).pending = 0;
+		pthread_cond_broadcast(&(*log).changed);
+	}
+	pthread_mutex_unlock(&(*log).lock);
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int session_log_open(SessionLog *log, const Session *session, const char *name,
+ * 				const char *columns)
+ *
+ * DESCRIPTION:
+ * 		Opens the first part of a log in the directory of a session and starts
+ * 		its writer thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:			The log, usually static for its size.
+ * 			const Session *session:		The session, valid until the log is closed.
+ * 			const char *name:			Name of the log, part of the file names.
+ * 			const char *columns:		Comment line naming the columns, with newline.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The open log.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int session_log_open(SessionLog *log, const Session *session, const char *name,
+		const char *columns)
+{
+	(*log).session = session;
+	(*log).running = false;
+	if (!(*session).directory[0])
+		return 1;	// nowhere to write
+	snprintf((*log).name, CHANNEL_NAME_LENGTH, "%s", name);
+	snprintf((*log).columns, sizeof((*log).columns), "%s", columns);
+	(*log).part = 0;
+	(*log).fd = -1;
+	(*log).active = 0;
+	(*log).fill = 0;
+	(*log).pending = 0;
+	(*log).stopping = false;
+	(*log).stalls = 0;
+	(*log).handedOver = nano_time();
+
+	if (open_part(log))
+		return 1;
+
+	pthread_mutex_init(&(*log).lock, NULL);
+	pthread_cond_init(&(*log).changed, NULL);
+	if (pthread_create(&(*log).thread, NULL, writer_func, log))
+	{
+		printf("Could not start the writer of %s\n", (*log).filename);
+		close_part(log);
+		return 1;
+	}
+	(*log).running = true;
+	return 0;
+}
+
+/**************************************************
+ * NAME: static void hand_over(SessionLog *log, bool wait)
+ *
+ * DESCRIPTION:
+ * 		Hands the filled buffer over to the writer and continues in the other.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log.
+ * 			bool wait:			Wait for the writer if it is busy, else keep filling.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log with an empty buffer, unless not waiting
+ * 								for a busy writer.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void hand_over(SessionLog *log, bool wait)
+{
+	pthread_mutex_lock(&(*log).lock);
+	if ((*log).pending)
+	{
+		if (!wait)
+		{
+			pthread_mutex_unlock(&(*log).lock);
+			return;
+		}
+		(*log).stalls++;
+		while ((*log).pending)
+			pthread_cond_wait(&(*log).changed, &(*log).lock);
+	}
+
+	(*log).pending = (*log).fill;
+	(*log).active = !(*log).active;
+	(*log).fill = 0;
+	(*log).handedOver = nano_time();
+	pthread_cond_broadcast(&(*log).changed);
+	pthread_mutex_unlock(&(*log).lock);
+}
+
+/**************************************************
+ * NAME: void session_log_printf(SessionLog *log, const char *format, ...)
+ *
+ * DESCRIPTION:
+ * 		Adds text to a log. Lines are never split between parts as long as
+ * 		every call ends with a newline.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:		The open log.
+ * 			const char *format:		Format of the text, shorter than LINE_LENGTH.
+ * 			...:					The values of the format.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The log with the text.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void session_log_printf(SessionLog *log, const char *format, ...)
+{
+	char line[LINE_LENGTH];
+	va_list arguments;
+	va_start(arguments, format);
+	int length = vsnprintf(line, sizeof(line), format, arguments);
+	va_end(arguments);
+	if (length < 0)
+		return;
+	if (length >= LINE_LENGTH)
+		length = LINE_LENGTH - 1;
+
+	if ((*log).fill + length > SESSION_BUFFER_SIZE)
+		hand_over(log, true);
+	memcpy((*log).buffers[(*log).active] + (*log).fill, line, length);
+	(*log).fill += length;
+
+	// keep the files close to the present while the writer has nothing to do
+	if (nano_time() - (*log).handedOver > HAND_OVER_INTERVAL)
+		hand_over(log, false);
+}
+
+/**************************************************
+ * NAME: void session_log_close(SessionLog *log)
+ *
+ * DESCRIPTION:
+ * 		Writes what is left of a log, stops its writer and closes the current part.
+ * 		The name of the last part stays in the filename of the log.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The open log.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SessionLog *log:	The closed log.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void session_log_close(SessionLog *log)
+{
+	if (!(*log).running)
+		return;
+	(*log).running = false;
+
+	if ((*log).fill)
+		hand_over(log, true);
+	pthread_mutex_lock(&(*log).lock);
+	(*log).stopping = true;
+	pthread_cond_broadcast(&(*log).changed);
+	pthread_mutex_unlock(&(*log).lock);
+	pthread_join((*log).thread, NULL);
+
+	close_part(log);
+	pthread_mutex_destroy(&(*log).lock);
+	pthread_cond_destroy(&(*log).changed);
+	if ((*log).stalls)
+		printf("Log %s waited for the disk %lu times\n", (*log).name, (*log).stalls);
+}
@@ -0,0 +1,92 @@
+/**************************************************
+ * FILENAME:	simulated_boat.c
+ *
+ * DESCRIPTION:
+ * 		A boat in the tank for running the controllers without any hardware. It
+ * 		differs from the default model of the MPC in thrust and drag and is
+ * 		pushed by a current, countered by about half the power. The power is felt
+ * 		after a transport delay, like on the rig. Waves and pushes are added as a
+ * 		force set between the steps.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void simulated_boat_init(SimulatedBoat *boat, double position, double delay)
+ * 		void simulated_boat_step(SimulatedBoat *boat, double power, double duration)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "headers/pid_controller.h"
+#include "headers/simulated_boat.h"
+#include "headers/trajectory.h"
+
+static const double BOAT_THRUST = 0.85 * THRUST_ACCELERATION;	// at full power
+static const double BOAT_DRAG = 2.0;
+static const double BOAT_CURRENT = -10.0;	// countered by about half the power
+
+/**************************************************
+ * NAME: void simulated_boat_init(SimulatedBoat *boat, double position, double delay)
+ *
+ * DESCRIPTION:
+ * 		Puts the boat at rest at a position, with no power on its way and no
+ * 		force other than the current.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SimulatedBoat *boat:	The boat.
+ * 			double position:		Printed units.
+ * 			double delay:			Seconds until the boat feels the power, at most
+ * 									SIMULATION_MAX_DELAY steps.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SimulatedBoat *boat:	The initialized boat.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void simulated_boat_init(SimulatedBoat *boat, double position, double delay)
+{
+	memset(boat, 0, sizeof(*boat));
+	(*boat).position = position;
+	(*boat).delaySteps = (int) lround(delay / SIMULATION_STEP);
+	if ((*boat).delaySteps > SIMULATION_MAX_DELAY)
+		(*boat).delaySteps = SIMULATION_MAX_DELAY;
+}
+
+/**************************************************
+ * NAME: void simulated_boat_step(SimulatedBoat *boat, double power, double duration)
+ *
+ * DESCRIPTION:
+ * 		Moves the boat on with the power and the force held, in steps of
+ * 		SIMULATION_STEP.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			SimulatedBoat *boat:	The boat.
+ * 			double power:			MAX_OUTPUT - servo output.
+ * 			double duration:		Seconds, usually the period of the control loop.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			SimulatedBoat *boat:	The boat after the duration.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void simulated_boat_step(SimulatedBoat *boat, double power, double duration)
+{
+	for (double t = 0.0; t < duration; t += SIMULATION_STEP)
+	{
+		double felt = power;
+		if ((*boat).delaySteps > 0)
+		{
+			felt = (*boat).delayed[(*boat).delayIndex];
+			(*boat).delayed[(*boat).delayIndex] = power;
+			(*boat).delayIndex = ((*boat).delayIndex + 1) % (*boat).delaySteps;
+		}
+		(*boat).velocity += (BOAT_THRUST * felt / (MAX_OUTPUT - MIN_OUTPUT)
+				- BOAT_DRAG * (*boat).velocity + BOAT_CURRENT + (*boat).force) * SIMULATION_STEP;
+		(*boat).position += (*boat).velocity * SIMULATION_STEP;
+	}
+}
@@ -0,0 +1,104 @@
+/**************************************************
+ * FILENAME:	startup.c
+ *
+ * DESCRIPTION:
+ * 		Runs the slow parts of the startup, like waiting for the devices to be
+ * 		attached, at the same time, each on a thread of its own. Startup then
+ * 		takes as long as the slowest part rather than all of them together.
+ * 		Nothing is started before every part is done, and the time each of them
+ * 		took is printed.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int startup_run(StartupStage stages[], int count)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "headers/startup.h"
+#include "headers/time_utils.h"
+
+/**************************************************
+ * NAME: static void *stage_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Runs a stage and times it.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	The 'StartupStage'.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	The result and time of the stage.
+ * 		RETURN:
+ * 			void*:	Always NULL.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *stage_func(void *void_ptr)
+{
+	StartupStage *stage = (StartupStage*) void_ptr;
+	unsigned long start = nano_time();
+	(*stage).result = (*stage).run();
+	(*stage).time = nano_time() - start;
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int startup_run(StartupStage stages[], int count)
+ *
+ * DESCRIPTION:
+ * 		Runs all stages at the same time and returns when the last one is done,
+ * 		the barrier after which the program is ready to run. Prints how long each
+ * 		stage and the whole startup took. A stage whose thread cannot be made is
+ * 		run on this one instead.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			StartupStage stages[]:	What to run.
+ * 			int count:				Number of stages.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			StartupStage stages[]:	The result and time of every stage.
+ * 		RETURN:
+ * 			int:	0 if all required stages succeeded, else 1.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int startup_run(StartupStage stages[], int count)
+{
+	pthread_t threads[count];
+	bool started[count];
+	unsigned long start = nano_time();
+
+	for (int s = 0; s < count; s++)
+		started[s] = pthread_create(&threads[s], NULL, stage_func, &stages[s]) == 0;
+	for (int s = 0; s < count; s++)
+	{
+		if (started[s])
+			pthread_join(threads[s], NULL);
+		else
+			stage_func(&stages[s]);
+	}
+	unsigned long ready = nano_time() - start;
+
+	// what it took, and what it would have taken one after another
+	int failed = 0;
+	unsigned long sum = 0;
+	printf("Startup:");
+	for (int s = 0; s < count; s++)
+	{
+		printf(" %s %.0f ms%s%s", stages[s].name, nano_to_sec(stages[s].time) * 1000.0,
+				stages[s].result ? " (failed)" : "", s < count - 1 ? "," : "");
+		sum += stages[s].time;
+		if (stages[s].result && stages[s].required)
+			failed = 1;
+	}
+	printf("\nReady after %.0f ms, %.0f ms one after another\n", nano_to_sec(ready) * 1000.0,
+			nano_to_sec(sum) * 1000.0);
+	return failed;
+}
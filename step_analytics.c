@@ -0,0 +1,384 @@
+/**************************************************
+ * FILENAME:	step_analytics.c
+ *
+ * DESCRIPTION:
+ * 		Measures how a channel answers changes of its target while it runs, so
+ * 		tunings can be compared by numbers instead of by the plots. Every change
+ * 		of at least STEP_MIN_SIZE starts a step, followed until the boat has
+ * 		stayed within the settling band for STEP_HOLD_TIME, until STEP_MAX_TIME,
+ * 		or until the next step or a stop. Each iteration only updates running
+ * 		values: the times the boat passed 10% and 90% of the step, the furthest it
+ * 		went past the target, the last time it was outside the band, the integrals
+ * 		of the absolute and time weighted absolute error and the iterations the
+ * 		output was at a limit. The memory used is the same for any length of run.
+ *
+ * 		The results are handed to another thread through a lock-free queue of
+ * 		STEP_QUEUE_SIZE, so the control loop never waits and never prints. The
+ * 		thread taking them keeps the totals of the run.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void step_analytics_init(StepAnalytics *analytics)
+ * 		void step_analytics_record(StepAnalytics *analytics, unsigned long now,
+ * 				float target, float position, float output, bool active)
+ * 		void step_analytics_finish(StepAnalytics *analytics)
+ * 		bool step_analytics_take(StepAnalytics *analytics, StepResult *result)
+ * 		void step_analytics_print(FILE *file, const char *name, const StepResult *result,
+ * 				float time)
+ * 		void step_analytics_print_totals(FILE *file, const char *name,
+ * 				const StepAnalytics *analytics)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "headers/pid_controller.h"
+#include "headers/step_analytics.h"
+#include "headers/time_utils.h"
+
+#define OUTPUT_EPSILON 0.001	// an output this close to a limit is at the limit
+
+/**************************************************
+ * NAME: void step_analytics_init(StepAnalytics *analytics)
+ *
+ * DESCRIPTION:
+ * 		Initializes the analytics of a channel, with no step and no results.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The initialized analytics.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void step_analytics_init(StepAnalytics *analytics)
+{
+	memset(analytics, 0, sizeof(*analytics));
+	atomic_init(&(*analytics).head, 0);
+	atomic_init(&(*analytics).tail, 0);
+	atomic_init(&(*analytics).dropped, 0);
+}
+
+/**************************************************
+ * NAME: static void end_step(StepAnalytics *analytics, bool interrupted)
+ *
+ * DESCRIPTION:
+ * 		Completes the result of the running step and queues it. Must only be
+ * 		called from the channel thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics, with a step running.
+ * 			bool interrupted:			The step ended before it settled.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics without a running step.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void end_step(StepAnalytics *analytics, bool interrupted)
+{
+	StepResult *result = &(*analytics).current;
+	(*result).riseTime = (*analytics).rise10 >= 0.0 && (*analytics).rise90 >= 0.0 ?
+			(*analytics).rise90 - (*analytics).rise10 : NAN;
+	(*result).settlingTime = interrupted ? NAN : (*analytics).lastOutside;
+	(*result).saturation = (*analytics).ticks > 0 ?
+			100.0 * (*analytics).saturatedTicks / (*analytics).ticks : 0.0;
+	(*result).interrupted = interrupted;
+	(*analytics).running = false;
+
+	unsigned int tail = atomic_load_explicit(&(*analytics).tail, memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&(*analytics).head, memory_order_acquire);
+	if (tail - head >= STEP_QUEUE_SIZE)
+	{
+		atomic_fetch_add_explicit(&(*analytics).dropped, 1, memory_order_relaxed);
+		return;	// nobody is taking them
+	}
+	(*analytics).results[tail & (STEP_QUEUE_SIZE - 1)] = *result;
+	atomic_store_explicit(&(*analytics).tail, tail + 1, memory_order_release);
+}
+
+/**************************************************
+ * NAME: void step_analytics_record(StepAnalytics *analytics, unsigned long now,
+ * 				float target, float position, float output, bool active)
+ *
+ * DESCRIPTION:
+ * 		Updates the running step with one iteration of the control loop, or starts
+ * 		a new one when the target has moved. Must be called from the channel
+ * 		thread, every iteration.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics of the channel.
+ * 			unsigned long now:			Time of the iteration from nano_time().
+ * 			float target:				Printed position the boat is sent to.
+ * 			float position:				Printed position of the boat.
+ * 			float output:				Servo output of the iteration.
+ * 			bool active:				The controller is running.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The updated analytics, with the result queued
+ * 										if the step has ended.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void step_analytics_record(StepAnalytics *analytics, unsigned long now, float target,
+		float position, float output, bool active)
+{
+	if (!active)
+	{
+		if ((*analytics).running)
+			end_step(analytics, true);
+		(*analytics).targetKnown = false;
+		return;
+	}
+
+	// when control starts, moving to the target from where the boat is is a step too
+	if (!(*analytics).targetKnown)
+	{
+		(*analytics).target = position;
+		(*analytics).targetKnown = true;
+	}
+	if (fabsf(target - (*analytics).target) >= STEP_MIN_SIZE)
+	{
+		if ((*analytics).running)
+			end_step(analytics, true);
+		(*analytics).target = target;
+
+		// a step is measured from where the boat is, it may not have reached the last target
+		if (fabsf(target - position) >= STEP_MIN_SIZE)
+		{
+			StepResult *result = &(*analytics).current;
+			memset(result, 0, sizeof(*result));
+			(*result).start = now;
+			(*result).size = target - position;
+			(*analytics).startPosition = position;
+			(*analytics).lastTime = now;
+			(*analytics).rise10 = -1.0;
+			(*analytics).rise90 = -1.0;
+			(*analytics).lastOutside = 0.0;
+			(*analytics).ticks = 0;
+			(*analytics).saturatedTicks = 0;
+			(*analytics).running = true;
+		}
+	}
+	if (!(*analytics).running)
+		return;
+
+	StepResult *result = &(*analytics).current;
+	double t = nano_to_sec(now - (*result).start);
+	double dt = nano_to_sec(now - (*analytics).lastTime);
+	(*analytics).lastTime = now;
+
+	double error = fabs((*analytics).target - position);
+	(*result).iae += error * dt;
+	(*result).itae += t * error * dt;
+
+	// progress towards the target, 1 when there
+	double progress = (position - (*analytics).startPosition) / (*result).size;
+	if ((*analytics).rise10 < 0.0 && progress >= 0.1)
+		(*analytics).rise10 = t;
+	if ((*analytics).rise90 < 0.0 && progress >= 0.9)
+		(*analytics).rise90 = t;
+	if (progress > 1.0 && (progress - 1.0) * 100.0 > (*result).overshoot)
+		(*result).overshoot = (progress - 1.0) * 100.0;
+
+	double band = STEP_SETTLING_FRACTION * fabsf((*result).size);
+	if (band < STEP_SETTLING_MIN)
+		band = STEP_SETTLING_MIN;
+	if (error > band)
+		(*analytics).lastOutside = t;
+
+	(*analytics).ticks++;
+	if (output <= MIN_OUTPUT + OUTPUT_EPSILON || output >= MAX_OUTPUT - OUTPUT_EPSILON)
+		(*analytics).saturatedTicks++;
+
+	if ((*analytics).rise90 >= 0.0 && t - (*analytics).lastOutside >= STEP_HOLD_TIME)
+		end_step(analytics, false);
+	else if (t >= STEP_MAX_TIME)
+	{
+		(*analytics).lastOutside = NAN;	// it has not settled
+		end_step(analytics, false);
+	}
+}
+
+/**************************************************
+ * NAME: void step_analytics_finish(StepAnalytics *analytics)
+ *
+ * DESCRIPTION:
+ * 		Ends the running step as interrupted, at the end of the run. Must only be
+ * 		called once the channel thread has stopped.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics with every step queued.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void step_analytics_finish(StepAnalytics *analytics)
+{
+	if ((*analytics).running)
+		end_step(analytics, true);
+}
+
+/**************************************************
+ * NAME: bool step_analytics_take(StepAnalytics *analytics, StepResult *result)
+ *
+ * DESCRIPTION:
+ * 		Takes the oldest result of a step and adds it to the totals of the run.
+ * 		Must only be called from one thread, not the channel thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics of the channel.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			StepAnalytics *analytics:	The analytics with the totals updated.
+ * 			StepResult *result:			The result, if there was one.
+ * 		RETURN:
+ * 			bool:	true if a result was taken, false if there was none.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool step_analytics_take(StepAnalytics *analytics, StepResult *result)
+{
+	unsigned int head = atomic_load_explicit(&(*analytics).head, memory_order_relaxed);
+	unsigned int tail = atomic_load_explicit(&(*analytics).tail, memory_order_acquire);
+	if (head == tail)
+		return false;
+	*result = (*analytics).results[head & (STEP_QUEUE_SIZE - 1)];
+	atomic_store_explicit(&(*analytics).head, head + 1, memory_order_release);
+
+	(*analytics).count++;
+	if (!isnan((*result).riseTime))
+	{
+		(*analytics).risen++;
+		(*analytics).riseSum += (*result).riseTime;
+	}
+	if (!isnan((*result).settlingTime))
+	{
+		(*analytics).settled++;
+		(*analytics).settlingSum += (*result).settlingTime;
+		if ((*result).settlingTime > (*analytics).settlingMax)
+			(*analytics).settlingMax = (*result).settlingTime;
+	}
+	(*analytics).overshootSum += (*result).overshoot;
+	if ((*result).overshoot > (*analytics).overshootMax)
+		(*analytics).overshootMax = (*result).overshoot;
+	(*analytics).iaeSum += (*result).iae;
+	(*analytics).itaeSum += (*result).itae;
+	(*analytics).saturationSum += (*result).saturation;
+	return true;
+}
+
+/**************************************************
+ * NAME: static void print_seconds(FILE *file, const char *label, double seconds)
+ *
+ * DESCRIPTION:
+ * 		Prints a time of a step, or a dash when it was not reached.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			FILE *file:				Where to print.
+ * 			const char *label:		Name of the time.
+ * 			double seconds:			The time, NAN if not reached.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void print_seconds(FILE *file, const char *label, double seconds)
+{
+	if (isnan(seconds))
+		fprintf(file, "%s -", label);
+	else
+		fprintf(file, "%s %.2f s", label, seconds);
+}
+
+/**************************************************
+ * NAME: void step_analytics_print(FILE *file, const char *name, const StepResult *result,
+ * 				float time)
+ *
+ * DESCRIPTION:
+ * 		Prints the result of a step on one line.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			FILE *file:					Where to print.
+ * 			const char *name:			Name of the channel.
+ * 			const StepResult *result:	The result.
+ * 			float time:					Seconds into the run the step started.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void step_analytics_print(FILE *file, const char *name, const StepResult *result,
+		float time)
+{
+	fprintf(file, "%-8s step %+.1f at %.1f s: ", name, (*result).size, time);
+	print_seconds(file, "rise", (*result).riseTime);
+	fprintf(file, ", overshoot %.1f%%, ", (*result).overshoot);
+	print_seconds(file, "settling", (*result).settlingTime);
+	fprintf(file, ", IAE %.1f, ITAE %.1f, saturated %.0f%%%s\n", (*result).iae,
+			(*result).itae, (*result).saturation,
+			(*result).interrupted ? ", interrupted" : "");
+}
+
+/**************************************************
+ * NAME: void step_analytics_print_totals(FILE *file, const char *name,
+ * 				const StepAnalytics *analytics)
+ *
+ * DESCRIPTION:
+ * 		Prints the means and worst values of the steps taken in the run. Must be
+ * 		called from the thread taking the results.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			FILE *file:						Where to print.
+ * 			const char *name:				Name of the channel.
+ * 			const StepAnalytics *analytics:	The analytics.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void step_analytics_print_totals(FILE *file, const char *name,
+		const StepAnalytics *analytics)
+{
+	int count = (*analytics).count;
+	unsigned int dropped = atomic_load(&(*analytics).dropped);
+	fprintf(file, "%-8s %d steps, %d settled", name, count, (*analytics).settled);
+	if (dropped > 0)
+		fprintf(file, ", %u not reported", dropped);
+	if (count == 0)
+	{
+		fprintf(file, "\n");
+		return;
+	}
+	fprintf(file, ": mean ");
+	print_seconds(file, "rise", (*analytics).risen > 0 ?
+			(*analytics).riseSum / (*analytics).risen : NAN);
+	fprintf(file, ", overshoot %.1f%% (worst %.1f%%), ", (*analytics).overshootSum / count,
+			(*analytics).overshootMax);
+	print_seconds(file, "settling", (*analytics).settled > 0 ?
+			(*analytics).settlingSum / (*analytics).settled : NAN);
+	if ((*analytics).settled > 0)
+		fprintf(file, " (worst %.2f s)", (*analytics).settlingMax);
+	fprintf(file, ", IAE %.1f, ITAE %.1f, saturated %.0f%%\n", (*analytics).iaeSum / count,
+			(*analytics).itaeSum / count, (*analytics).saturationSum / count);
+}
@@ -0,0 +1,193 @@
+/**************************************************
+ * FILENAME:	telemetry.c
+ *
+ * DESCRIPTION:
+ * 		Publishes every tick of the control loops in a POSIX shared memory object,
+ * 		for other processes on the machine (dashboards, recorders, analysis). Each
+ * 		channel has a ring of records written by the thread running the channel,
+ * 		every record guarded by a sequence number. Readers map the object read-only
+ * 		and follow the rings on their own, so publishing costs the same few stores
+ * 		no matter how many readers there are, and never waits for one. A reader
+ * 		falling more than a ring behind sees from the sequence numbers which records
+ * 		it lost. The layout is described in telemetry.h, the reader in tools/.
+ *
+ * 		A new object is created for every run, so readers of the previous run keep
+ * 		their mapping until they notice it has been closed.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int telemetry_open(const char *name, float period, const char *channelNames[],
+ * 				int count)
+ * 		void telemetry_publish(int channel, const TelemetryRecord *record)
+ * 		void telemetry_close(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "headers/seqlock.h"
+#include "headers/telemetry.h"
+#include "headers/time_utils.h"
+
+static TelemetryHeader *header = NULL;
+static size_t mappedSize = 0;
+static char objectName[64];
+
+/**************************************************
+ * NAME: static TelemetrySlot *slot(int channel, uint64_t number)
+ *
+ * DESCRIPTION:
+ * 		Finds the slot of a record in the ring of a channel.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int channel:		Index of the channel.
+ * 			uint64_t number:	Number of the record, counted from the start.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			TelemetrySlot*:	The slot.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static TelemetrySlot *slot(int channel, uint64_t number)
+{
+	char *rings = (char*) header + sizeof(TelemetryHeader);
+	return (TelemetrySlot*) (rings + ((size_t) channel * TELEMETRY_SLOTS
+			+ (number & (TELEMETRY_SLOTS - 1))) * sizeof(TelemetrySlot));
+}
+
+/**************************************************
+ * NAME: int telemetry_open(const char *name, float period, const char *channelNames[],
+ * 				int count)
+ *
+ * DESCRIPTION:
+ * 		Creates the shared memory object, replacing one left by an earlier run, and
+ * 		writes its header. The magic number is written last, so a reader never
+ * 		sees a header half written.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *name:			Name of the object, e.g. TELEMETRY_NAME.
+ * 			float period:				Seconds between ticks.
+ * 			const char *channelNames[]:	Names of the channels, in order.
+ * 			int count:					Number of channels.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int telemetry_open(const char *name, float period, const char *channelNames[], int count)
+{
+	if (count > TELEMETRY_MAX_CHANNELS)
+		count = TELEMETRY_MAX_CHANNELS;
+
+	// a new object, the readers of an earlier run keep the old one
+	snprintf(objectName, sizeof(objectName), "%s", name);
+	shm_unlink(objectName);
+	int fd = shm_open(objectName, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		perror("shm_open");
+		return 1;
+	}
+
+	size_t size = sizeof(TelemetryHeader)
+			+ (size_t) count * TELEMETRY_SLOTS * sizeof(TelemetrySlot);
+	if (ftruncate(fd, size) != 0)
+	{
+		perror("ftruncate");
+		close(fd);
+		shm_unlink(objectName);
+		return 1;
+	}
+	void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		perror("mmap");
+		shm_unlink(objectName);
+		return 1;
+	}
+
+	// the object is zero-filled: no records yet and every sequence number 0
+	TelemetryHeader *created = mapped;
+	(*created).versionMajor = TELEMETRY_VERSION_MAJOR;
+	(*created).versionMinor = TELEMETRY_VERSION_MINOR;
+	(*created).headerSize = sizeof(TelemetryHeader);
+	(*created).slotSize = sizeof(TelemetrySlot);
+	(*created).slotCount = TELEMETRY_SLOTS;
+	(*created).channelCount = count;
+	(*created).period = period;
+	(*created).started = micro_wall_time();
+	for (int c = 0; c < count; c++)
+		snprintf((*created).channelNames[c], TELEMETRY_NAME_LENGTH, "%s", channelNames[c]);
+	atomic_store_explicit(&(*created).magic, TELEMETRY_MAGIC, memory_order_release);
+
+	mappedSize = size;
+	header = created;
+	return 0;
+}
+
+/**************************************************
+ * NAME: void telemetry_publish(int channel, const TelemetryRecord *record)
+ *
+ * DESCRIPTION:
+ * 		Writes a record to the ring of a channel, overwriting the oldest. Must only
+ * 		be called by the thread running the channel. Does nothing if the telemetry
+ * 		has not been opened.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int channel:					Index of the channel.
+ * 			const TelemetryRecord *record:	The tick.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void telemetry_publish(int channel, const TelemetryRecord *record)
+{
+	if (header == NULL || channel < 0 || channel >= (int) (*header).channelCount)
+		return;
+
+	_Atomic uint64_t *head = &(*header).heads[channel].head;
+	uint64_t number = atomic_load_explicit(head, memory_order_relaxed);
+	TelemetrySlot *next = slot(channel, number);
+
+	seqlock_write(&(*next).sequence, number, &(*next).record, record, sizeof(*record));
+	atomic_store_explicit(head, number + 1, memory_order_release);
+}
+
+/**************************************************
+ * NAME: void telemetry_close(void)
+ *
+ * DESCRIPTION:
+ * 		Tells the readers the run has ended and removes the shared memory object.
+ * 		Readers still mapping it can read the last records. Must not be called
+ * 		while the control loops are running.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void telemetry_close(void)
+{
+	if (header == NULL)
+		return;
+	atomic_store_explicit(&(*header).closed, 1, memory_order_release);
+	munmap(header, mappedSize);
+	shm_unlink(objectName);
+	header = NULL;
+}
@@ -0,0 +1,210 @@
+/**************************************************
+ * FILENAME:	thrust_map.c
+ *
+ * DESCRIPTION:
+ * 		Makes the thrust of a thruster linear in the output of the controller.
+ * 		The thrust is far from linear in the servo position over the narrow band
+ * 		from MAX_OUTPUT to MIN_OUTPUT, and there is none at all over a dead zone
+ * 		next to MAX_OUTPUT. Given a measured thrust curve, the output is taken as
+ * 		a fraction of the full thrust, (MAX_OUTPUT - output) / (MAX_OUTPUT -
+ * 		MIN_OUTPUT), and looked up in a table of the servo positions giving every
+ * 		fraction, made by inverting the curve when it is loaded. Any thrust at all
+ * 		starts at the end of the dead zone.
+ *
+ * 		The thrust file holds the measured points, in any order and any unit of
+ * 		thrust, '#' starts a comment:
+ * 			point <servo position> <thrust>
+ * 		The thrust must not decrease with the power, the point with the most
+ * 		thrust is full thrust.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int thrust_map_load(ThrustMap *map, const char *filename)
+ * 		float thrust_map_apply(const ThrustMap *map, float output)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "headers/pid_controller.h"
+#include "headers/thrust_map.h"
+
+#define LINE_LENGTH 256
+
+/**************************************************
+ * NAME: static int read_points(const char *filename, float power[], float thrust[])
+ *
+ * DESCRIPTION:
+ * 		Reads the points of a thrust file, sorted by increasing power.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const char *filename:	The thrust file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			float power[]:	MAX_OUTPUT - servo position of every point.
+ * 			float thrust[]:	The thrust of every point.
+ * 		RETURN:
+ * 			int:	The number of points, -1 if the file could not be read.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static int read_points(const char *filename, float power[], float thrust[])
+{
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+	{
+		printf("Could not open thrust curve %s\n", filename);
+		return -1;
+	}
+
+	char line[LINE_LENGTH];
+	int count = 0, lineNumber = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		lineNumber++;
+		char *comment = strchr(line, '#');
+		if (comment)
+			*comment = '\0';
+
+		float position, value;
+		char extra[2];
+		int fields = sscanf(line, " point %f %f %1s", &position, &value, extra);
+		if (fields == EOF || (fields <= 0 && line[strspn(line, " \t\r\n")] == '\0'))
+			continue;	// empty line
+		if (fields != 2 || position < MIN_OUTPUT || position > MAX_OUTPUT || value < 0.0
+				|| count >= THRUST_MAX_POINTS)
+		{
+			printf("Invalid point in %s on line %d\n", filename, lineNumber);
+			fclose(fp);
+			return -1;
+		}
+
+		// insert in order of the power
+		int i = count++;
+		for (; i > 0 && power[i - 1] > MAX_OUTPUT - position; i--)
+		{
+			power[i] = power[i - 1];
+			thrust[i] = thrust[i - 1];
+		}
+		power[i] = MAX_OUTPUT - position;
+		thrust[i] = value;
+	}
+	fclose(fp);
+	return count;
+}
+
+/**************************************************
+ * NAME: int thrust_map_load(ThrustMap *map, const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Loads a measured thrust curve and inverts it into the table of the map:
+ * 		for every fraction of the full thrust, the servo position at which the
+ * 		curve reaches it, interpolating linearly between the points. No thrust is
+ * 		MAX_OUTPUT, the thruster off.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ThrustMap *map:			The map of a channel.
+ * 			const char *filename:	The thrust file.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			ThrustMap *map:	The loaded map.
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int thrust_map_load(ThrustMap *map, const char *filename)
+{
+	if (strlen(filename) >= THRUST_FILENAME_LENGTH)
+	{
+		printf("Thrust curve file name too long: %s\n", filename);
+		return 1;
+	}
+
+	float power[THRUST_MAX_POINTS], thrust[THRUST_MAX_POINTS];
+	int count = read_points(filename, power, thrust);
+	if (count < 0)
+		return 1;
+	if (count < 2 || thrust[count - 1] <= thrust[0])
+	{
+		printf("Thrust curve %s needs at least two points of different thrust\n", filename);
+		return 1;
+	}
+	for (int i = 1; i < count; i++)
+	{
+		if (thrust[i] < thrust[i - 1])
+		{
+			printf("Thrust decreases with the power in %s at %.3f\n", filename,
+					MAX_OUTPUT - power[i]);
+			return 1;
+		}
+	}
+
+	// the first point reaching every fraction, interpolated from the one before
+	float full = thrust[count - 1];
+	int segment = 0;
+	(*map).table[0] = MAX_OUTPUT;
+	for (int k = 1; k < THRUST_TABLE_SIZE; k++)
+	{
+		float wanted = full * k / (THRUST_TABLE_SIZE - 1);
+		while (segment < count - 1 && thrust[segment + 1] < wanted)
+			segment++;
+		float position;
+		if (wanted <= thrust[0])
+			position = MAX_OUTPUT - power[0];
+		else
+		{
+			float fraction = (wanted - thrust[segment])
+					/ (thrust[segment + 1] - thrust[segment]);
+			position = MAX_OUTPUT - (power[segment]
+					+ (power[segment + 1] - power[segment]) * fraction);
+		}
+		(*map).table[k] = position;
+	}
+
+	strcpy((*map).filename, filename);
+	(*map).loaded = true;
+	printf("Thrust curve %s: thrust starts at %.3f, full at %.3f\n", filename,
+			(*map).table[1], (*map).table[THRUST_TABLE_SIZE - 1]);
+	return 0;
+}
+
+/**************************************************
+ * NAME: float thrust_map_apply(const ThrustMap *map, float output)
+ *
+ * DESCRIPTION:
+ * 		Converts an output of the controller, taken as linear in the thrust, to
+ * 		the servo position giving that thrust, interpolating between neighboring
+ * 		entries of the table.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const ThrustMap *map:	The map of the thruster.
+ * 			float output:			The output, MIN_OUTPUT to MAX_OUTPUT.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			float:	The servo position, the output itself if there is no map.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+float thrust_map_apply(const ThrustMap *map, float output)
+{
+	if (!(*map).loaded)
+		return output;
+
+	float point = (MAX_OUTPUT - output) / (MAX_OUTPUT - MIN_OUTPUT) * (THRUST_TABLE_SIZE - 1);
+	if (point <= 0.0)
+		return (*map).table[0];
+	if (point >= THRUST_TABLE_SIZE - 1)
+		return (*map).table[THRUST_TABLE_SIZE - 1];
+
+	int index = (int) point;
+	float fraction = point - index;
+	return (*map).table[index] + ((*map).table[index + 1] - (*map).table[index]) * fraction;
+}
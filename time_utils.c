@@ -8,8 +8,10 @@
  * 		float nano_to_sec(unsigned long nanos)
  * 		unsigned long sec_to_nano(float secs)
  * 		unsigned long nano_time(void)
+ * 		long micro_wall_time(void)
+ * 		void to_timespec(unsigned long nanos, struct timespec *time)
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 
 #include <sys/time.h>
@@ -72,12 +74,58 @@ unsigned long sec_to_nano(float secs)
  *		RETURN:
  *			unsigned long:	The current time in nanoseconds.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 unsigned long nano_time(void)
 {
 	struct timespec timeSpec;
 	clock_gettime(CLOCK_MONOTONIC, &timeSpec);
-	return (unsigned long) (sec_to_nano(timeSpec.tv_sec) + timeSpec.tv_nsec);
+
+	// integer arithmetic, a float conversion of the seconds would lose the nanoseconds
+	return (unsigned long) timeSpec.tv_sec * 1000000000UL + (unsigned long) timeSpec.tv_nsec;
+}
+
+/**************************************************
+ * NAME: long micro_wall_time(void)
+ *
+ * DESCRIPTION:
+ *		Returns the time of day in microseconds since the Unix epoch. Unlike
+ *		nano_time() it can jump when the clock is set, use it for time stamps only.
+ *
+ * INPUTS:
+ *		none
+ *
+ * OUTPUTS:
+ *		RETURN:
+ *			long:	Microseconds since 1970-01-01 00:00:00 UTC.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+long micro_wall_time(void)
+{
+	struct timespec timeSpec;
+	clock_gettime(CLOCK_REALTIME, &timeSpec);
+	return (long) timeSpec.tv_sec * 1000000L + timeSpec.tv_nsec / 1000L;
 }
 
+/**************************************************
+ * NAME: void to_timespec(unsigned long nanos, struct timespec *time)
+ *
+ * DESCRIPTION:
+ *		Converts a time from nano_time() to a timespec of the same clock.
+ *
+ * INPUTS:
+ *		PARAMETERS:
+ *			unsigned long nanos:	The time in nanoseconds.
+ *
+ * OUTPUTS:
+ *		PARAMETERS:
+ *			struct timespec *time:	The same time.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void to_timespec(unsigned long nanos, struct timespec *time)
+{
+	(*time).tv_sec = nanos / 1000000000UL;
+	(*time).tv_nsec = nanos % 1000000000UL;
+}
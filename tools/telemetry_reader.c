@@ -0,0 +1,330 @@
+/**************************************************
+ * FILENAME:	telemetry_reader.c
+ *
+ * DESCRIPTION:
+ * 		Reads the ticks the control program publishes in shared memory, see
+ * 		telemetry.c. The object is mapped read-only and every reader keeps its own
+ * 		position in the rings, so any number of readers can follow without the
+ * 		control program noticing. A reader that falls more than a ring behind
+ * 		skips to the oldest record still there and counts the records it lost.
+ *
+ * 		Built into tools/libtelemetry.a by 'make tools'.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int telemetry_reader_open(TelemetryReader *reader, const char *name)
+ * 		int telemetry_reader_find(const TelemetryReader *reader, const char *channelName)
+ * 		void telemetry_reader_rewind(TelemetryReader *reader, int channel,
+ * 				uint64_t records)
+ * 		int telemetry_reader_next(TelemetryReader *reader, int channel,
+ * 				TelemetryRecord *record)
+ * 		int telemetry_reader_latest(TelemetryReader *reader, int channel,
+ * 				TelemetryRecord *record)
+ * 		bool telemetry_reader_closed(const TelemetryReader *reader)
+ * 		void telemetry_reader_close(TelemetryReader *reader)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "headers/telemetry_reader.h"
+
+/**************************************************
+ * NAME: static uint64_t head(const TelemetryReader *reader, int channel)
+ *
+ * DESCRIPTION:
+ * 		Number of records written to a channel so far.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const TelemetryReader *reader:	The open reader.
+ * 			int channel:					Index of the channel.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			uint64_t:	The number of records.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static uint64_t head(const TelemetryReader *reader, int channel)
+{
+	return atomic_load_explicit((_Atomic uint64_t*) &(*(*reader).header).heads[channel].head,
+			memory_order_acquire);
+}
+
+/**************************************************
+ * NAME: int telemetry_reader_open(TelemetryReader *reader, const char *name)
+ *
+ * DESCRIPTION:
+ * 		Maps a telemetry object read-only and checks its header. Every channel is
+ * 		followed from the newest record on. Fails quietly if there is no object,
+ * 		as when the control program has not been started yet.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	The reader.
+ * 			const char *name:			Name of the object, e.g. TELEMETRY_NAME.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	The open reader.
+ *		RETURNS:
+ *			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int telemetry_reader_open(TelemetryReader *reader, const char *name)
+{
+	memset(reader, 0, sizeof(*reader));
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		if (errno != ENOENT)
+			perror(name);
+		return 1;
+	}
+	struct stat status;
+	if (fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(TelemetryHeader))
+	{
+		printf("%s is not a telemetry object\n", name);
+		close(fd);
+		return 1;
+	}
+	void *mapped = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		perror("mmap");
+		return 1;
+	}
+	(*reader).header = mapped;
+	(*reader).size = status.st_size;
+
+	const TelemetryHeader *header = (*reader).header;
+	uint32_t magic = atomic_load_explicit((_Atomic uint32_t*) &(*header).magic,
+			memory_order_acquire);
+	const char *problem = NULL;
+	if (magic != TELEMETRY_MAGIC)
+		problem = "is not a telemetry object or not ready yet";
+	else if ((*header).versionMajor != TELEMETRY_VERSION_MAJOR)
+		problem = "has a layout of another version";
+	else if ((*header).slotSize < offsetof(TelemetrySlot, record) + sizeof(uint64_t)
+			|| (*header).slotSize % sizeof(uint64_t) != 0 || (*header).slotCount == 0
+			|| ((*header).slotCount & ((*header).slotCount - 1)) != 0
+			|| (*header).channelCount > TELEMETRY_MAX_CHANNELS
+			|| (*header).headerSize + (size_t) (*header).channelCount
+					* (*header).slotCount * (*header).slotSize > (*reader).size)
+		problem = "has an invalid header";
+	if (problem != NULL)
+	{
+		printf("%s %s\n", name, problem);
+		telemetry_reader_close(reader);
+		return 1;
+	}
+
+	for (uint32_t c = 0; c < (*header).channelCount; c++)
+		(*reader).next[c] = head(reader, c);
+	return 0;
+}
+
+/**************************************************
+ * NAME: int telemetry_reader_find(const TelemetryReader *reader,
+ * 				const char *channelName)
+ *
+ * DESCRIPTION:
+ * 		Finds a channel by name.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const TelemetryReader *reader:	The open reader.
+ * 			const char *channelName:		Name of the channel.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	Index of the channel, -1 if there is none with the name.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int telemetry_reader_find(const TelemetryReader *reader, const char *channelName)
+{
+	const TelemetryHeader *header = (*reader).header;
+	for (uint32_t c = 0; c < (*header).channelCount; c++)
+		if (strncmp((*header).channelNames[c], channelName, TELEMETRY_NAME_LENGTH) == 0)
+			return c;
+	return -1;
+}
+
+/**************************************************
+ * NAME: void telemetry_reader_rewind(TelemetryReader *reader, int channel,
+ * 				uint64_t records)
+ *
+ * DESCRIPTION:
+ * 		Goes back to a number of records before the newest, as far as the ring
+ * 		still holds them.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	The open reader.
+ * 			int channel:				Index of the channel.
+ * 			uint64_t records:			Records to read again.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	Reader at the new position.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void telemetry_reader_rewind(TelemetryReader *reader, int channel, uint64_t records)
+{
+	uint64_t written = head(reader, channel);
+	if (records > (*(*reader).header).slotCount)
+		records = (*(*reader).header).slotCount;
+	(*reader).next[channel] = written > records ? written - records : 0;
+}
+
+/**************************************************
+ * NAME: int telemetry_reader_next(TelemetryReader *reader, int channel,
+ * 				TelemetryRecord *record)
+ *
+ * DESCRIPTION:
+ * 		Reads the next record of a channel. A record is only returned if its
+ * 		sequence number shows it was neither being written nor overwritten while
+ * 		it was copied. Records overwritten before they could be read are skipped
+ * 		and counted as lost.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	The open reader.
+ * 			int channel:				Index of the channel.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryRecord *record:	The record. Fields a writer of an older minor
+ * 										version does not have are zero.
+ *		RETURNS:
+ *			int:	1 if a record was read, 0 if there is no new record.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int telemetry_reader_next(TelemetryReader *reader, int channel, TelemetryRecord *record)
+{
+	const TelemetryHeader *header = (*reader).header;
+	if (channel < 0 || channel >= (int) (*header).channelCount)
+		return 0;
+
+	const char *ring = (const char*) header + (*header).headerSize
+			+ (size_t) channel * (*header).slotCount * (*header).slotSize;
+	size_t recordSize = (*header).slotSize - offsetof(TelemetrySlot, record);
+	if (recordSize > sizeof(TelemetryRecord))
+		recordSize = sizeof(TelemetryRecord);	// fields appended by a newer writer
+
+	for (;;)
+	{
+		uint64_t written = head(reader, channel);
+		uint64_t number = (*reader).next[channel];
+		if (number >= written)
+			return 0;
+		if (written - number > (*header).slotCount)
+		{
+			// overrun, continue with the oldest record still in the ring
+			(*reader).lost[channel] += written - (*header).slotCount - number;
+			number = written - (*header).slotCount;
+		}
+
+		const TelemetrySlot *slot = (const TelemetrySlot*) (ring
+				+ (number & ((*header).slotCount - 1)) * (*header).slotSize);
+		_Atomic uint64_t *sequence = (_Atomic uint64_t*) &(*slot).sequence;
+		uint64_t before = atomic_load_explicit(sequence, memory_order_acquire);
+		memset(record, 0, sizeof(*record));
+		memcpy(record, (const char*) slot + offsetof(TelemetrySlot, record), recordSize);
+		atomic_thread_fence(memory_order_acquire);
+		uint64_t after = atomic_load_explicit(sequence, memory_order_relaxed);
+
+		(*reader).next[channel] = number + 1;
+		if (before == 2 * number + 2 && after == before)
+			return 1;
+		(*reader).lost[channel]++;	// overwritten while it was copied
+	}
+}
+
+/**************************************************
+ * NAME: int telemetry_reader_latest(TelemetryReader *reader, int channel,
+ * 				TelemetryRecord *record)
+ *
+ * DESCRIPTION:
+ * 		Reads the newest record of a channel, skipping those not read yet without
+ * 		counting them as lost. For readers wanting the state rather than every tick.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	The open reader.
+ * 			int channel:				Index of the channel.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryRecord *record:	The record.
+ *		RETURNS:
+ *			int:	1 if a record was read, 0 if nothing has been written yet.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int telemetry_reader_latest(TelemetryReader *reader, int channel, TelemetryRecord *record)
+{
+	if (channel < 0 || channel >= (int) (*(*reader).header).channelCount)
+		return 0;
+	telemetry_reader_rewind(reader, channel, 1);
+	return telemetry_reader_next(reader, channel, record);
+}
+
+/**************************************************
+ * NAME: bool telemetry_reader_closed(const TelemetryReader *reader)
+ *
+ * DESCRIPTION:
+ * 		Tells if the control program has stopped. The records still in the rings
+ * 		can be read.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const TelemetryReader *reader:	The open reader.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			bool:	True if no more records will be written.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool telemetry_reader_closed(const TelemetryReader *reader)
+{
+	return atomic_load_explicit((_Atomic uint32_t*) &(*(*reader).header).closed,
+			memory_order_acquire) != 0;
+}
+
+/**************************************************
+ * NAME: void telemetry_reader_close(TelemetryReader *reader)
+ *
+ * DESCRIPTION:
+ * 		Unmaps the telemetry object.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			TelemetryReader *reader:	The reader.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void telemetry_reader_close(TelemetryReader *reader)
+{
+	if ((*reader).header != NULL)
+		munmap((void*) (*reader).header, (*reader).size);
+	(*reader).header = NULL;
+}
@@ -0,0 +1,125 @@
+/**************************************************
+ * FILENAME:	telemetry_tail.c
+ *
+ * DESCRIPTION:
+ * 		Prints the ticks the control program publishes in shared memory as they
+ * 		come, one line per tick and channel, until the program stops. Lost records
+ * 		are reported when a channel is read again.
+ *
+ * 		Usage: telemetry_tail [-n <records>] [<channel>]
+ * 			-n <records>	Start with up to this many of the latest records.
+ * 			<channel>		Only follow the channel with this name.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int main(int argc, char *argv[])
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "headers/telemetry_reader.h"
+
+/**************************************************
+ * NAME: int main(int argc, char *argv[])
+ *
+ * DESCRIPTION:
+ * 		Opens TELEMETRY_NAME and prints every record of the channels followed,
+ * 		polling at half the loop period.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int argc:		Number of arguments.
+ * 			char *argv[]:	The arguments.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int main(int argc, char *argv[])
+{
+	long backlog = 0;
+	const char *channelName = NULL;
+	for (int a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "-n") == 0 && a + 1 < argc)
+			backlog = atol(argv[++a]);
+		else if (argv[a][0] != '-' && channelName == NULL)
+			channelName = argv[a];
+		else
+		{
+			printf("Usage: %s [-n <records>] [<channel>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	TelemetryReader reader;
+	if (telemetry_reader_open(&reader, TELEMETRY_NAME))
+	{
+		printf("No telemetry to follow, is the control program running?\n");
+		return 1;
+	}
+	const TelemetryHeader *header = reader.header;
+
+	int first = 0, last = (int) (*header).channelCount - 1;
+	if (channelName != NULL)
+	{
+		first = last = telemetry_reader_find(&reader, channelName);
+		if (first < 0)
+		{
+			printf("No channel named %s\n", channelName);
+			telemetry_reader_close(&reader);
+			return 1;
+		}
+	}
+	for (int c = first; c <= last; c++)
+		telemetry_reader_rewind(&reader, c, backlog > 0 ? (uint64_t) backlog : 0);
+
+	printf("# telemetry %u.%u, period %.1f ms, %u channels\n", (*header).versionMajor,
+			(*header).versionMinor, (*header).period * 1000.0, (*header).channelCount);
+	printf("#%-8s\t%12s\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\t%8s\n", "channel", "time[s]",
+			"position", "setpoint", "target", "power", "P-term", "I-term", "D-term");
+
+	struct timespec poll = { 0, (*header).period > 0.002 ? (long) ((*header).period * 0.5e9)
+			: 1000000L };
+	uint64_t reported[TELEMETRY_MAX_CHANNELS] = { 0 };
+	for (;;)
+	{
+		// closed is checked first, so the records written before it are all printed
+		bool closed = telemetry_reader_closed(&reader);
+		int read = 0;
+		TelemetryRecord record;
+		for (int c = first; c <= last; c++)
+		{
+			while (telemetry_reader_next(&reader, c, &record))
+			{
+				if (reader.lost[c] != reported[c])
+				{
+					printf("# lost %llu records of %s\n",
+							(unsigned long long) (reader.lost[c] - reported[c]),
+							(*header).channelNames[c]);
+					reported[c] = reader.lost[c];
+				}
+				printf(" %-8s\t%12.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\t%8.3f\n",
+						(*header).channelNames[c], record.time / 1e9, record.position,
+						record.setpoint, record.target, record.power, record.pTerm,
+						record.iTerm, record.dTerm);
+				read++;
+			}
+		}
+		fflush(stdout);
+		if (closed)
+			break;
+		if (read == 0)
+			nanosleep(&poll, NULL);
+	}
+
+	printf("# the control program has stopped\n");
+	telemetry_reader_close(&reader);
+	return 0;
+}
@@ -0,0 +1,356 @@
+/**************************************************
+ * FILENAME:	trace.c
+ *
+ * DESCRIPTION:
+ * 		Lightweight latency tracing of the control loop. Every thread that wants to
+ * 		record spans registers itself once and gets a preallocated ring buffer, so
+ * 		recording a span is a couple of stores and a histogram increment, without
+ * 		locks or allocations. At exit the recorded spans can be exported to the
+ * 		Chrome trace event format (readable by chrome://tracing and Perfetto) and
+ * 		summarized as latency percentiles.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int trace_thread_init(const char *threadName)
+ * 		void trace_record(TraceStage stage, unsigned long start, unsigned long end)
+ * 		int trace_export_chrome(const char *filename)
+ * 		void trace_print_summary(void)
+ * 		void trace_cleanup(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "headers/histogram.h"
+#include "headers/time_utils.h"
+#include "headers/trace.h"
+
+#define TRACE_MAX_THREADS 8
+#define TRACE_CAPACITY (1 << 16)	// events kept per thread, must be a power of two
+#define TRACE_NAME_LENGTH 16
+
+typedef struct
+{
+	unsigned long start;
+	unsigned int duration;
+	unsigned int stage;
+} TraceEvent;
+
+typedef struct
+{
+	char name[TRACE_NAME_LENGTH];
+	int tid;
+	atomic_bool ended;		// set when the owning thread has exited
+	unsigned long recorded;	// total number of events, may exceed TRACE_CAPACITY
+	TraceEvent events[TRACE_CAPACITY];
+	Histogram histograms[TRACE_STAGE_COUNT];
+} TraceBuffer;
+
+static const char *STAGE_NAMES[TRACE_STAGE_COUNT] = { "loop", "read_frame",
+		"pid_compute", "actuator_set", "set_servo_position" };
+
+static TraceBuffer *buffers[TRACE_MAX_THREADS];
+static atomic_int bufferCount;
+
+static __thread TraceBuffer *threadBuffer;	// buffer owned by the calling thread
+static pthread_key_t endKey;	// marks the buffer of an exiting thread as ended
+static pthread_once_t endKeyOnce = PTHREAD_ONCE_INIT;
+
+/**************************************************
+ * NAME: static void end_buffer(void *value)
+ *
+ * DESCRIPTION:
+ * 		Marks the buffer of an exiting thread as ended, it records nothing more.
+ * 		Called by pthreads when a thread with a buffer exits.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *value:	The 'TraceBuffer' of the thread.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static void end_buffer(void *value)
+{
+	atomic_store(&(*(TraceBuffer*) value).ended, true);
+}
+
+/**************************************************
+ * NAME: static void create_end_key(void)
+ *
+ * DESCRIPTION:
+ * 		Creates the key whose destructor marks buffers as ended. Called once.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static void create_end_key(void)
+{
+	pthread_key_create(&endKey, end_buffer);
+}
+
+/**************************************************
+ * NAME: int trace_thread_init(const char *threadName)
+ *
+ * DESCRIPTION:
+ * 		Allocates the trace buffer for the calling thread. Must be called before the
+ * 		thread starts recording, spans recorded by threads without a buffer are
+ * 		silently ignored.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	const char *threadName:	Name of the thread shown in the exported trace.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int trace_thread_init(const char *threadName)
+{
+	if (threadBuffer)
+		return 0;	// already initialized
+
+	int slot = atomic_fetch_add(&bufferCount, 1);
+	if (slot >= TRACE_MAX_THREADS)
+	{
+		atomic_fetch_sub(&bufferCount, 1);
+		printf("Too many traced threads, not tracing '%s'\n", threadName);
+		return 1;
+	}
+
+	TraceBuffer *buffer = calloc(1, sizeof(TraceBuffer));
+	if (!buffer)
+	{
+		printf("Could not allocate trace buffer for '%s'\n", threadName);
+		buffers[slot] = NULL;
+		return 1;
+	}
+
+	// a buffer this large is mapped lazily, fault its pages in now and not while recording
+	long page = sysconf(_SC_PAGESIZE);
+	for (size_t offset = 0; offset < sizeof(TraceBuffer); offset += page)
+		((volatile char*) buffer)[offset] = 0;
+
+	snprintf((*buffer).name, TRACE_NAME_LENGTH, "%s", threadName);
+	(*buffer).tid = slot + 1;
+
+	buffers[slot] = buffer;
+	threadBuffer = buffer;
+	pthread_once(&endKeyOnce, create_end_key);
+	pthread_setspecific(endKey, buffer);
+	return 0;
+}
+
+/**************************************************
+ * NAME: void trace_record(TraceStage stage, unsigned long start, unsigned long end)
+ *
+ * DESCRIPTION:
+ * 		Records a span in the buffer of the calling thread. When the buffer is full
+ * 		the oldest events are overwritten, the histograms keep all spans.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	TraceStage stage:		The stage of the control loop the span belongs to.
+ *      	unsigned long start:	Start time of the span from nano_time().
+ *      	unsigned long end:		End time of the span from nano_time().
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void trace_record(TraceStage stage, unsigned long start, unsigned long end)
+{
+	TraceBuffer *buffer = threadBuffer;
+	if (!buffer)
+		return;
+
+	unsigned long duration = end - start;
+
+	TraceEvent *event = &(*buffer).events[(*buffer).recorded & (TRACE_CAPACITY - 1)];
+	(*event).start = start;
+	(*event).duration = (unsigned int) duration;
+	(*event).stage = stage;
+	(*buffer).recorded++;
+
+	histogram_record(&(*buffer).histograms[stage], duration);
+}
+
+/**************************************************
+ * NAME: int trace_export_chrome(const char *filename)
+ *
+ * DESCRIPTION:
+ * 		Writes the events still held in the trace buffers to a JSON file in the
+ * 		Chrome trace event format. Should only be called when the traced threads
+ * 		have stopped recording.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ *      	const char *filename:	The file to write to.
+ *
+ * OUTPUTS:
+ *     	RETURN:
+ *        	int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int trace_export_chrome(const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+	if (!fp)
+	{
+		printf("can't open file: %s\n", filename);
+		return 1;
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"args\":{\"name\":\"DynamicPositioning\"}}");
+
+	int count = atomic_load(&bufferCount);
+	if (count > TRACE_MAX_THREADS)
+		count = TRACE_MAX_THREADS;
+
+	// let the trace start at the oldest event still held in any buffer
+	unsigned long origin = nano_time();
+	for (int b = 0; b < count; b++)
+	{
+		TraceBuffer *buffer = buffers[b];
+		if (!buffer || (*buffer).recorded == 0)
+			continue;
+
+		unsigned long first = 0;
+		if ((*buffer).recorded > TRACE_CAPACITY)
+			first = (*buffer).recorded - TRACE_CAPACITY;
+		unsigned long start = (*buffer).events[first & (TRACE_CAPACITY - 1)].start;
+		if (start < origin)
+			origin = start;
+	}
+
+	for (int b = 0; b < count; b++)
+	{
+		TraceBuffer *buffer = buffers[b];
+		if (!buffer)
+			continue;
+
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}", (*buffer).tid, (*buffer).name);
+
+		// oldest event still in the buffer
+		unsigned long first = 0;
+		if ((*buffer).recorded > TRACE_CAPACITY)
+			first = (*buffer).recorded - TRACE_CAPACITY;
+
+		for (unsigned long e = first; e < (*buffer).recorded; e++)
+		{
+			TraceEvent *event = &(*buffer).events[e & (TRACE_CAPACITY - 1)];
+
+			// timestamps are given in microseconds
+			fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"control\",\"ph\":\"X\",\"pid\":1,"
+					"\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", STAGE_NAMES[(*event).stage],
+					(*buffer).tid, ((*event).start - origin) / 1000.0,
+					(*event).duration / 1000.0);
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return 0;
+}
+
+/**************************************************
+ * NAME: void trace_print_summary(void)
+ *
+ * DESCRIPTION:
+ * 		Prints latency percentiles for every stage of the control loop, merged over
+ * 		all traced threads.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void trace_print_summary(void)
+{
+	static Histogram merged;	// too large for the stack of some threads
+
+	int count = atomic_load(&bufferCount);
+	if (count > TRACE_MAX_THREADS)
+		count = TRACE_MAX_THREADS;
+
+	printf("\nLatency summary [us]:\n%-20s %10s %10s %10s %10s %10s %10s %10s\n", "stage",
+			"count", "mean", "p50", "p90", "p99", "p99.9", "max");
+
+	for (int s = 0; s < TRACE_STAGE_COUNT; s++)
+	{
+		histogram_reset(&merged);
+		for (int b = 0; b < count; b++)
+		{
+			if (buffers[b])
+				histogram_merge(&merged, &(*buffers[b]).histograms[s]);
+		}
+
+		if (merged.count == 0)
+			continue;
+
+		printf("%-20s %10lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", STAGE_NAMES[s],
+				merged.count, histogram_mean(&merged) / 1000.0,
+				histogram_percentile(&merged, 50.0) / 1000.0,
+				histogram_percentile(&merged, 90.0) / 1000.0,
+				histogram_percentile(&merged, 99.0) / 1000.0,
+				histogram_percentile(&merged, 99.9) / 1000.0, merged.max / 1000.0);
+	}
+}
+
+/**************************************************
+ * NAME: void trace_cleanup(void)
+ *
+ * DESCRIPTION:
+ * 		Frees the trace buffers of the threads that have ended and of the calling
+ * 		thread. The buffer of a thread still running, e.g. one left behind stuck in
+ * 		a device, is kept, since it may still record into it.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+void trace_cleanup(void)
+{
+	int count = atomic_load(&bufferCount);
+	if (count > TRACE_MAX_THREADS)
+		count = TRACE_MAX_THREADS;
+
+	for (int b = 0; b < count; b++)
+	{
+		if (!buffers[b])
+			continue;
+		if (buffers[b] != threadBuffer && !atomic_load(&(*buffers[b]).ended))
+			continue;	// the thread is still running
+		free(buffers[b]);
+		buffers[b] = NULL;
+	}
+	if (threadBuffer)
+		pthread_setspecific(endKey, NULL);
+	threadBuffer = NULL;
+}
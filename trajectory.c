@@ -0,0 +1,351 @@
+/**************************************************
+ * FILENAME:	trajectory.c
+ *
+ * DESCRIPTION:
+ * 		Generates jerk-limited (S-curve) motion profiles between setpoints. A step
+ * 		in the setpoint is turned into a time-parameterized profile with limited
+ * 		velocity, acceleration and jerk, consisting of up to seven phases: jerk up,
+ * 		constant acceleration, jerk down, cruise, and the same mirrored for the
+ * 		deceleration. The profile is planned once when the target changes, after
+ * 		that sampling it is a closed form evaluation in constant time.
+ *
+ * 		A target received while a profile is running is kept and started when the
+ * 		current profile ends, so the limits are never violated.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		void trajectory_init(Trajectory *trajectory, float position, float maxVelocity,
+ * 				float maxAcceleration, float maxJerk)
+ * 		void trajectory_set_target(Trajectory *trajectory, float target, unsigned long now)
+ * 		float trajectory_target(const Trajectory *trajectory)
+ * 		TrajectoryPoint trajectory_evaluate(const Trajectory *trajectory,
+ * 				unsigned long time)
+ * 		TrajectoryPoint trajectory_sample(Trajectory *trajectory, unsigned long now)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <math.h>
+
+#include "headers/time_utils.h"
+#include "headers/trajectory.h"
+
+/**************************************************
+ * NAME: static void plan(Trajectory *trajectory, float start, float target,
+ * 				unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Plans a rest-to-rest profile from start to target with the limits of the
+ * 		trajectory. If the distance is too short to reach the maximum velocity or
+ * 		acceleration, the peak values are lowered.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The trajectory with its limits.
+ * 			float start:			Position to start from.
+ * 			float target:			Position to end at.
+ * 			unsigned long now:		Start time of the profile from nano_time().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The planned profile.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void plan(Trajectory *trajectory, float start, float target, unsigned long now)
+{
+	float vMax = (*trajectory).maxVelocity;
+	float aMax = (*trajectory).maxAcceleration;
+	float jMax = (*trajectory).maxJerk;
+	float distance = fabsf(target - start);
+
+	(*trajectory).startTime = now;
+	(*trajectory).start = start;
+	(*trajectory).distance = distance;
+	(*trajectory).direction = target >= start ? 1.0 : -1.0;
+
+	if (distance <= 0.0)
+	{
+		(*trajectory).jerkTime = 0.0;
+		(*trajectory).accelerationTime = 0.0;
+		(*trajectory).cruiseTime = 0.0;
+		(*trajectory).duration = 0.0;
+		(*trajectory).peakAcceleration = 0.0;
+		(*trajectory).peakVelocity = 0.0;
+		return;
+	}
+
+	// time spent changing the acceleration and time spent accelerating
+	float jerkTime, accelerationTime;
+	if (vMax * jMax >= aMax * aMax)
+	{
+		jerkTime = aMax / jMax;
+		accelerationTime = jerkTime + vMax / aMax;
+	} else
+	{
+		jerkTime = sqrtf(vMax / jMax);	// maximum acceleration is never reached
+		accelerationTime = 2.0 * jerkTime;
+	}
+
+	float cruiseTime = distance / vMax - accelerationTime;
+	if (cruiseTime < 0.0)
+	{
+		// maximum velocity is not reached
+		cruiseTime = 0.0;
+		if (distance >= 2.0 * aMax * aMax * aMax / (jMax * jMax))
+		{
+			jerkTime = aMax / jMax;
+			accelerationTime = jerkTime / 2.0
+					+ sqrtf(jerkTime * jerkTime / 4.0 + distance / aMax);
+		} else
+		{
+			jerkTime = cbrtf(distance / (2.0 * jMax));
+			accelerationTime = 2.0 * jerkTime;
+		}
+	}
+
+	(*trajectory).jerkTime = jerkTime;
+	(*trajectory).accelerationTime = accelerationTime;
+	(*trajectory).cruiseTime = cruiseTime;
+	(*trajectory).duration = 2.0 * accelerationTime + cruiseTime;
+	(*trajectory).peakAcceleration = jMax * jerkTime;
+	(*trajectory).peakVelocity = (accelerationTime - jerkTime) * jMax * jerkTime;
+}
+
+/**************************************************
+ * NAME: static TrajectoryPoint accelerate(const Trajectory *trajectory, float t)
+ *
+ * DESCRIPTION:
+ * 		Evaluates the acceleration phase of the profile, relative to the start and
+ * 		in the positive direction. The deceleration phase is the same mirrored.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const Trajectory *trajectory:	The planned profile.
+ * 			float t:						Time since the start of the phase.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			TrajectoryPoint:	Distance traveled, velocity and acceleration.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static TrajectoryPoint accelerate(const Trajectory *trajectory, float t)
+{
+	float jerk = (*trajectory).maxJerk;
+	float jerkTime = (*trajectory).jerkTime;
+	float accelerationTime = (*trajectory).accelerationTime;
+	float peakAcceleration = (*trajectory).peakAcceleration;
+	float peakVelocity = (*trajectory).peakVelocity;
+
+	TrajectoryPoint point;
+	if (t < jerkTime)
+	{
+		// increasing acceleration
+		point.position = jerk * t * t * t / 6.0;
+		point.velocity = jerk * t * t / 2.0;
+		point.acceleration = jerk * t;
+	} else if (t < accelerationTime - jerkTime)
+	{
+		// constant acceleration
+		point.position = peakAcceleration / 6.0
+				* (3.0 * t * t - 3.0 * jerkTime * t + jerkTime * jerkTime);
+		point.velocity = peakAcceleration * (t - jerkTime / 2.0);
+		point.acceleration = peakAcceleration;
+	} else
+	{
+		// decreasing acceleration
+		float left = accelerationTime - t;
+		point.position = peakVelocity * accelerationTime / 2.0 - peakVelocity * left
+				+ jerk * left * left * left / 6.0;
+		point.velocity = peakVelocity - jerk * left * left / 2.0;
+		point.acceleration = jerk * left;
+	}
+	return point;
+}
+
+/**************************************************
+ * NAME: void trajectory_init(Trajectory *trajectory, float position, float maxVelocity,
+ * 				float maxAcceleration, float maxJerk)
+ *
+ * DESCRIPTION:
+ * 		Initializes a trajectory resting at a position.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The trajectory to initialize.
+ * 			float position:			The initial position.
+ * 			float maxVelocity:		Velocity limit, positive.
+ * 			float maxAcceleration:	Acceleration limit, positive.
+ * 			float maxJerk:			Jerk limit, positive.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The initialized trajectory.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void trajectory_init(Trajectory *trajectory, float position, float maxVelocity,
+		float maxAcceleration, float maxJerk)
+{
+	(*trajectory).maxVelocity = maxVelocity;
+	(*trajectory).maxAcceleration = maxAcceleration;
+	(*trajectory).maxJerk = maxJerk;
+	(*trajectory).hasPending = false;
+	plan(trajectory, position, position, 0UL);
+}
+
+/**************************************************
+ * NAME: void trajectory_set_target(Trajectory *trajectory, float target,
+ * 				unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Sets the position the trajectory should move to. If the current profile has
+ * 		ended a new one starts immediately, otherwise the target is kept until it
+ * 		ends.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The trajectory.
+ * 			float target:			The new target position.
+ * 			unsigned long now:		The current time from nano_time().
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The updated trajectory.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void trajectory_set_target(Trajectory *trajectory, float target, unsigned long now)
+{
+	if (target == trajectory_target(trajectory))
+		return;
+
+	float end = (*trajectory).start + (*trajectory).direction * (*trajectory).distance;
+	if (nano_to_sec(now - (*trajectory).startTime) >= (*trajectory).duration)
+	{
+		(*trajectory).hasPending = false;
+		plan(trajectory, end, target, now);
+	} else if (target == end)
+	{
+		(*trajectory).hasPending = false;	// back to where we are going anyway
+	} else
+	{
+		(*trajectory).pendingTarget = target;
+		(*trajectory).hasPending = true;
+	}
+}
+
+/**************************************************
+ * NAME: float trajectory_target(const Trajectory *trajectory)
+ *
+ * DESCRIPTION:
+ * 		Returns the position the trajectory will finally come to rest at.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const Trajectory *trajectory:	The trajectory.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			float:	The final position.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+float trajectory_target(const Trajectory *trajectory)
+{
+	if ((*trajectory).hasPending)
+		return (*trajectory).pendingTarget;
+	return (*trajectory).start + (*trajectory).direction * (*trajectory).distance;
+}
+
+/**************************************************
+ * NAME: TrajectoryPoint trajectory_evaluate(const Trajectory *trajectory,
+ * 				unsigned long time)
+ *
+ * DESCRIPTION:
+ * 		Evaluates the current profile at a point in time without changing the
+ * 		trajectory, e.g. to look ahead. A pending target is not taken into
+ * 		account, after the end of the profile it stays at rest. Runs in constant time.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			const Trajectory *trajectory:	The trajectory.
+ * 			unsigned long time:				The time to evaluate at from nano_time().
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			TrajectoryPoint:	Reference position, velocity and acceleration.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+TrajectoryPoint trajectory_evaluate(const Trajectory *trajectory, unsigned long time)
+{
+	float t = time > (*trajectory).startTime ?
+			nano_to_sec(time - (*trajectory).startTime) : 0.0;
+
+	float accelerationTime = (*trajectory).accelerationTime;
+	float cruiseEnd = accelerationTime + (*trajectory).cruiseTime;
+	float duration = (*trajectory).duration;
+
+	TrajectoryPoint point;
+	if (t >= duration)
+	{
+		point.position = (*trajectory).distance;
+		point.velocity = 0.0;
+		point.acceleration = 0.0;
+	} else if (t < accelerationTime)
+	{
+		point = accelerate(trajectory, t);
+	} else if (t < cruiseEnd)
+	{
+		point.position = (*trajectory).peakVelocity * (accelerationTime / 2.0 + t
+				- accelerationTime);
+		point.velocity = (*trajectory).peakVelocity;
+		point.acceleration = 0.0;
+	} else
+	{
+		// deceleration mirrors the acceleration in time
+		point = accelerate(trajectory, duration - t);
+		point.position = (*trajectory).distance - point.position;
+		point.acceleration = -point.acceleration;
+	}
+
+	// from distance traveled in the positive direction to absolute values
+	float direction = (*trajectory).direction;
+	point.position = (*trajectory).start + direction * point.position;
+	point.velocity *= direction;
+	point.acceleration *= direction;
+	return point;
+}
+
+/**************************************************
+ * NAME: TrajectoryPoint trajectory_sample(Trajectory *trajectory, unsigned long now)
+ *
+ * DESCRIPTION:
+ * 		Evaluates the trajectory at a point in time. Runs in constant time. Starts
+ * 		the profile to a pending target when the current profile has ended.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			Trajectory *trajectory:	The trajectory.
+ * 			unsigned long now:		The time to evaluate at from nano_time().
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			TrajectoryPoint:	Reference position, velocity and acceleration.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+TrajectoryPoint trajectory_sample(Trajectory *trajectory, unsigned long now)
+{
+	float t = nano_to_sec(now - (*trajectory).startTime);
+
+	if (t >= (*trajectory).duration && (*trajectory).hasPending)
+	{
+		float end = (*trajectory).start + (*trajectory).direction * (*trajectory).distance;
+		(*trajectory).hasPending = false;
+		plan(trajectory, end, (*trajectory).pendingTarget, now);
+	}
+
+	return trajectory_evaluate(trajectory, now);
+}
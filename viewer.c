@@ -0,0 +1,43 @@
+/**************************************************
+ * FILENAME:	viewer.c
+ *
+ * DESCRIPTION:
+ * 		The viewer, the window of the dynamic positioning as a program of its own.
+ * 		It shows the boats of a running control program, which it finds through
+ * 		the telemetry in shared memory, and sends the keys pressed to its command
+ * 		socket. It can be started and closed at any time without affecting the
+ * 		control loops, and waits for the control program if started first.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int main(int argc, char *argv[])
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+
+#include <stdio.h>
+
+#include "headers/visualization.h"
+
+/**************************************************
+ * NAME: int main(int argc, char *argv[])
+ *
+ * DESCRIPTION:
+ * 		Shows the window until it is closed or the run ends.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int argc:		Number of arguments, none are used.
+ * 			char *argv[]:	The arguments.
+ *
+ * OUTPUTS:
+ *		RETURNS:
+ *			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int main(int argc, char *argv[])
+{
+	printf("Showing the control program once it runs, "
+			"arrow keys move the setpoint, enter ends the run\n");
+	return start_animation();
+}
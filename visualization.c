@@ -2,83 +2,205 @@
  * FILENAME:	animation.c
  *
  * DESCRIPTION:
- * 		This file contains everything related to visualization. The graphics
- * 		are made in OpenGL. This file also handles keyboard events.
+ * 		This file contains the window showing the boats of all channels, drawn by
+ * 		the renderer with OpenGL 3.3. It runs in the viewer, a program of its own,
+ * 		and follows the control program through the telemetry in shared memory, so
+ * 		nothing the window does can hold up the control loops. This file also
+ * 		handles keyboard events, which are sent to the command socket to move the
+ * 		setpoint of the first channel.
  *
  * PUBLIC FUNCTIONS:
- * 			void *start_animation(void*)
+ * 			int start_animation(void)
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 03.04.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 
 #include <GL/freeglut.h>
-#include <stdlib.h>
-
+#include <math.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "headers/command_server.h"
 #include "headers/main.h"
-#include "headers/obj_loader.h"
 #include "headers/pid_controller.h"
+#include "headers/renderer.h"
+#include "headers/telemetry_reader.h"
+#include "headers/time_utils.h"
+#include "headers/visualization.h"
 
 // constants used for drawing
 #define WINDOW_WIDTH 10.0
 #define BOAT_WIDTH 3.5
-#define SETLINE_WIDTH 0.02
-#define SETLINE_HEIGHT 1.4
 
 #define KEY_ENTER 13
 
 #define SETPOINT_INCREMENT 3
+#define REPLY_TIMEOUT 0.5	// seconds to wait for the answer to a command
+#define MAX_PENDING 16		// commands sent and not answered yet
+#define COMMAND_LENGTH 32
+#define RETRY_INTERVAL 1.0	// seconds between attempts to find the control program
 
 /* Functions in OpenGL are predefined to a specific format.
  * External variables are therefore necessary. */
-static BoatData *boatData;	// data from control loop
-static GLuint speedboat;  	// display list ID for boat
-static GLuint setline;    	// display list ID for setline
+static TelemetryReader reader;		// the state of the control loops
+static bool connected = false;		// reader open
+static unsigned long lastAttempt;	// from nano_time(), last time the reader was opened
+
+// connection to the command server, never waited on so the window keeps drawing
+static int commandSocket = -1;
+static char pending[MAX_PENDING][COMMAND_LENGTH];	// sent and not answered, oldest first
+static unsigned long pendingSince[MAX_PENDING];	// from nano_time(), when sent
+static int pendingFirst, pendingCount;
+static char replies[256];	// answers read, up to an incomplete line
+static size_t replyLength;
 
 /**************************************************
- * NAME: static void drawPowerArrow(void)
+ * NAME: static void disconnect(const char *reason)
  *
  * DESCRIPTION:
- * 		Draws an arrow depicting the power output from the boat.
+ * 		Closes the connection to the command server, telling which commands
+ * 		were not answered.
  *
  * INPUTS:
- * 		EXTERNALS:
- * 			BoatData *boatData:		A collection of data for the boat
+ *     	PARAMETERS:
+ *     		const char *reason:	Why, printed for every command not answered.
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 02.04.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static void drawPowerArrow(void)
+static void disconnect(const char *reason)
 {
-	// calculate position and color of arrow based on the power
-	float arrowX = ((*boatData).servoValue - MAX_OUTPUT) / ( MIN_OUTPUT - MAX_OUTPUT)
-			* 4.0 - 2.0;
-	float arrowColor = 0.9
-			* (1 - ((*boatData).servoValue - MAX_OUTPUT) / (MIN_OUTPUT - MAX_OUTPUT));
-
-	glLoadIdentity();
-	glTranslatef(-0.5, 0.0, 0.0);
-	glColor3f(1.0, arrowColor, arrowColor * 0.6);	// simple color mapping
-	glBegin(GL_QUADS);		// main body of arrow
-	glVertex3f(-2.0, 1.0, 0.0);
-	glVertex3f(-2.0, 0.0, 0.0);
-	glVertex3f(arrowX, 0.0, 0.0);
-	glVertex3f(arrowX, 1.0, 0.0);
-	glEnd();
-	glBegin(GL_TRIANGLES);	// arrowhead
-	glVertex3f(arrowX, -0.5, 0.0);
-	glVertex3f(arrowX + 1.0, 0.5, 0.0);
-	glVertex3f(arrowX, 1.5, 0.0);
-	glEnd();
-	glColor3f(0.0, 0.0, 0.0);
-	glLineWidth(2.0);
-	glBegin(GL_LINE_LOOP);	// surrounding rectangle
-	glVertex3f(-2.0, 1.5, 0.0);
-	glVertex3f(-2.0, -0.5, 0.0);
-	glVertex3f(3.0, -0.5, 0.0);
-	glVertex3f(3.0, 1.5, 0.0);
-	glEnd();
+	for (; pendingCount > 0; pendingCount--)
+	{
+		printf("%s: %s\n", reason, pending[pendingFirst]);
+		pendingFirst = (pendingFirst + 1) % MAX_PENDING;
+	}
+	if (commandSocket >= 0)
+		close(commandSocket);
+	commandSocket = -1;
+	replyLength = 0;
+}
+
+/**************************************************
+ * NAME: static void read_replies(void)
+ *
+ * DESCRIPTION:
+ * 		Takes the answers of the command server that have arrived, without
+ * 		waiting, and prints those rejecting a command. Gives up on the connection
+ * 		when the oldest command has not been answered within REPLY_TIMEOUT, as a
+ * 		late answer could no longer be told from the next.
+ *
+ * INPUTS:
+ *     	EXTERNALS:
+ *     		int commandSocket:	The connection, if open.
+ *     		char pending[][]:	The commands waiting for an answer.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void read_replies(void)
+{
+	if (commandSocket < 0)
+		return;
+
+	ssize_t n = recv(commandSocket, replies + replyLength, sizeof(replies) - 1 - replyLength,
+			MSG_DONTWAIT);
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+	{
+		disconnect("No answer to command");
+		return;
+	}
+	if (n > 0)
+		replyLength += n;
+	replies[replyLength] = '\0';
+
+	// the server answers every line in order, with "ok" or the error
+	char *line = replies;
+	char *end;
+	while ((end = strchr(line, '\n')))
+	{
+		if (pendingCount > 0)
+		{
+			if (strncmp(line, "ok", 2) != 0)
+				printf("Command %s rejected: %.*s\n", pending[pendingFirst],
+						(int) (end - line), line);
+			pendingFirst = (pendingFirst + 1) % MAX_PENDING;
+			pendingCount--;
+		}
+		line = end + 1;
+	}
+	replyLength -= line - replies;
+	memmove(replies, line, replyLength);
+	if (replyLength >= sizeof(replies) - 1)
+		replyLength = 0;	// not an answer of the server
+
+	if (pendingCount > 0
+			&& nano_to_sec(nano_time() - pendingSince[pendingFirst]) > REPLY_TIMEOUT)
+		disconnect("No answer to command");
+}
+
+/**************************************************
+ * NAME: static void send_command(const char *line)
+ *
+ * DESCRIPTION:
+ * 		Sends a command to the control program on COMMAND_SOCKET_PATH without
+ * 		waiting, connecting first if not connected. The answer is taken by
+ * 		read_replies() when it has arrived, so a busy control program never holds
+ * 		up the window.
+ *
+ * INPUTS:
+ *     	PARAMETERS:
+ *     		const char *line:	The command, ending with a newline, shorter than
+ *     							COMMAND_LENGTH.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void send_command(const char *line)
+{
+	read_replies();	// notices a connection closed by the control program
+	if (commandSocket < 0)
+	{
+		struct sockaddr_un address = { .sun_family = AF_UNIX };
+		snprintf(address.sun_path, sizeof(address.sun_path), "%s", COMMAND_SOCKET_PATH);
+
+		// a local socket connects at once or not at all
+		commandSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		if (commandSocket < 0
+				|| connect(commandSocket, (struct sockaddr*) &address, sizeof(address)) < 0)
+		{
+			printf("Could not send command, is the control program running?\n");
+			disconnect("Not sent");
+			return;
+		}
+	}
+	if (pendingCount == MAX_PENDING)
+	{
+		printf("Too many commands without an answer, not sent: %s", line);
+		return;
+	}
+
+	size_t length = strlen(line);
+	if (send(commandSocket, line, length, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t) length)
+	{
+		printf("Could not send command: %s", line);
+		disconnect("No answer to command");
+		return;
+	}
+	int slot = (pendingFirst + pendingCount) % MAX_PENDING;
+	snprintf(pending[slot], COMMAND_LENGTH, "%.*s", (int) strcspn(line, "\n"), line);
+	pendingSince[slot] = nano_time();
+	pendingCount++;
 }
 
 /**************************************************
@@ -86,262 +208,238 @@ static void drawPowerArrow(void)
  *
  * DESCRIPTION:
  * 		This function is called over and over and is responsible for drawing
- * 		everything.
+ * 		everything. Takes the latest tick of every channel and has the renderer
+ * 		draw them, one lane each. Leaves the main loop when the run has ended.
  *
  * INPUTS:
  *     	EXTERNALS:
- *      	Data *boatData:		A struct containing data from the current run.
- *      	GLuint speedboat:	ID for the speedboat display list.
- *      	GLuint setline:		ID for the setline display list.
+ *      	TelemetryReader reader:	The state of the control loops.
+ *      	bool connected:			Whether the control program has been found.
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 02.04.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
 static void display(void)
 {
 	// convert from our values to window coordinates
 	static const float TO_WINDOW_COORDS = -(WINDOW_WIDTH - BOAT_WIDTH) / TANK_WIDTH;
 
-	// calculate the updated positions for the boat and setpoint
-	float boatX = ((*boatData).sensorValue - (*boatData).startpoint + TANK_WIDTH / 2.0)
-			* TO_WINDOW_COORDS;
-	float setpointX = ((*boatData).setpoint - (*boatData).startpoint + TANK_WIDTH / 2.0)
-			* TO_WINDOW_COORDS;
-
-	// clear window and select the modelview matrix
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glMatrixMode(GL_MODELVIEW);
-
-	// draw the boat
-	glLoadIdentity();
-	glEnable(GL_LIGHTING);
-	glTranslatef(boatX, 0.0, 0.0);
-	glCallList(speedboat);
-
-	// draw the setline
-	glLoadIdentity();
-	glDisable(GL_LIGHTING);
-	if (abs((*boatData).setpoint - (*boatData).sensorValue) < 5)
-		glColor3f(0.0, 1.0, 0.0);	// green
-	else
-		glColor3f(1.0, 0.0, 0.0);	// red
-	glTranslatef(setpointX, 0.0, 0.0);
-	glCallList(setline);
-
-	drawPowerArrow();
-
-	glFlush();
+	VesselView vessels[TELEMETRY_MAX_CHANNELS];
+	int count = 0;
+	bool closed = connected && telemetry_reader_closed(&reader);
+	for (int c = 0; connected && c < (int) (*reader.header).channelCount; c++)
+	{
+		TelemetryRecord tick;
+		if (!telemetry_reader_latest(&reader, c, &tick))
+			continue;	// not started yet
+
+		// calculate the updated positions for the boat and the target it is moving to,
+		// in printed units, which grow away from the start
+		vessels[count].boatX = (tick.startpoint - tick.position + TANK_WIDTH / 2.0)
+				* TO_WINDOW_COORDS;
+		vessels[count].setpointX = (tick.startpoint - tick.target + TANK_WIDTH / 2.0)
+				* TO_WINDOW_COORDS;
+		vessels[count].power = tick.power / (MAX_OUTPUT - MIN_OUTPUT);
+		vessels[count].onTarget = fabsf(tick.target - tick.position) < 5;
+		count++;
+	}
+
+	renderer_draw(vessels, count);
+	glutSwapBuffers();
+
+	// the run has ended, close the window
+	if (closed)
+		glutLeaveMainLoop();
 }
 
 /**************************************************
- * NAME: static void keyboard(unsigned char key, int x, int y)
+ * NAME: static void idle(void)
  *
  * DESCRIPTION:
- * 		This is the keyboard function handed to glut. It handles regular
- * 		keypresses.
+ * 		Redraws whenever there is nothing else to do. The frame rate is limited by
+ * 		the swap of the buffers. Looks for the control program every
+ * 		RETRY_INTERVAL until it has been found, and takes the answers to the
+ * 		commands sent.
  *
  * INPUTS:
- *     	PARAMETERS:
- *     		unsigned char key:	Value of the key pressed
- *     		int x:            	Mouse pointer position.
- *     		int y:            	Mouse pointer position.
+ *     	EXTERNALS:
+ *      	TelemetryReader reader:		The state of the control loops.
+ *      	bool connected:				Whether the control program has been found.
+ *      	unsigned long lastAttempt:	Last time it was looked for.
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static void keyboard(unsigned char key, int x, int y)
+static void idle(void)
 {
-	switch (key)
+	unsigned long now = nano_time();
+	if (!connected && nano_to_sec(now - lastAttempt) > RETRY_INTERVAL)
 	{
-	case KEY_ENTER:
-		glutLeaveMainLoop();	// terminate program, causes close_func() to be run
-		break;
+		lastAttempt = now;
+		connected = telemetry_reader_open(&reader, TELEMETRY_NAME) == 0;
 	}
+	read_replies();
+	glutPostRedisplay();
 }
 
 /**************************************************
- * NAME: static void special_keyboard(int key, int x, int y)
+ * NAME: static void reshape(int width, int height)
  *
  * DESCRIPTION:
- * 		This is the special keyboard function handed to glut. It handles
- * 		special keypresses, e.g arrow keys, F1, F2...
+ * 		This is the reshape function handed to glut, called when the size of the
+ * 		window changes. The detail of the boats follows the size.
  *
  * INPUTS:
  *     	PARAMETERS:
- *     		int key:			Value of the key pressed
- *     		int x:				Mouse pointer position.
- *     		int y:				Mouse pointer position.
- *		EXTERNALS:
- * 			BoatData *boatData:		A struct containing data from the current run.
+ *     		int width:	Width of the window in pixels.
+ *     		int height:	Height of the window in pixels.
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 01.04.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static void special_keyboard(int key, int x, int y)
+static void reshape(int width, int height)
 {
-	switch (key)
-	{
-	case GLUT_KEY_LEFT:
-		(*boatData).setpoint += SETPOINT_INCREMENT;
-		if ((*boatData).setpoint > (*boatData).startpoint)
-			(*boatData).setpoint = (*boatData).startpoint;
-		break;
-	case GLUT_KEY_RIGHT:
-		(*boatData).setpoint -= SETPOINT_INCREMENT;
-		if ((*boatData).setpoint < (*boatData).startpoint - TANK_WIDTH)
-			(*boatData).setpoint = (*boatData).startpoint - TANK_WIDTH;
-		break;
-	}
+	renderer_resize(width, height);
 }
 
 /**************************************************
- * NAME: static void close_func()
+ * NAME: static void keyboard(unsigned char key, int x, int y)
  *
  * DESCRIPTION:
- *		This function will run when the openGL window is closed. It sets
- * 		the main loop condition to false, causing the program to finish.
+ * 		This is the keyboard function handed to glut. It handles regular
+ * 		keypresses. Enter ends the run.
  *
  * INPUTS:
- *		EXTERNALS:
- *			BoatData *boatData:	A struct containing data from the current run.
+ *     	PARAMETERS:
+ *     		unsigned char key:	Value of the key pressed
+ *     		int x:            	Mouse pointer position.
+ *     		int y:            	Mouse pointer position.
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static void close_func()
+static void keyboard(unsigned char key, int x, int y)
 {
-	(*boatData).programRunning = false;
+	switch (key)
+	{
+	case KEY_ENTER:
+		send_command("quit\n");	// the window closes when the run has ended
+		break;
+	}
 }
 
 /**************************************************
- * NAME: static void setupLighting()
+ * NAME: static void special_keyboard(int key, int x, int y)
  *
  * DESCRIPTION:
- * 		Sets up the lighting conditions. Standard openGL lighting is Gouraud shading
- * 		which is fast but not the best looking alternative. The functions sets the
- * 		light's position and color, and specifies the material's reflection parameters.
+ * 		This is the special keyboard function handed to glut. It handles
+ * 		special keypresses, e.g arrow keys, F1, F2... Setpoint changes are sent to
+ * 		the control loop of the first channel as commands.
  *
  * INPUTS:
- *		none
+ *     	PARAMETERS:
+ *     		int key:			Value of the key pressed
+ *     		int x:				Mouse pointer position.
+ *     		int y:				Mouse pointer position.
  *
  * OUTPUTS:
- *		none
+ * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static void setupLighting()
+static void special_keyboard(int key, int x, int y)
 {
-
-	GLfloat light_position[] = { 5.0, 5.0, 3.0, 0.0 };
-
-	GLfloat diffuse[] = { 0.8, 0.8, 0.8, 1.0 };
-	GLfloat shininess[] = { 0.0 };
-
-	GLfloat mat[] = { 1.0, 0.2, 0.2, 1.0 };
-	glShadeModel(GL_SMOOTH);
-
-	glLightfv(GL_LIGHT0, GL_POSITION, light_position);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse);
-
-	glMaterialfv(GL_FRONT, GL_AMBIENT, mat);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, mat);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, mat);
-	glMaterialfv(GL_FRONT, GL_SHININESS, shininess);
-
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glEnable(GL_DEPTH_TEST);
+	// the control loop moves the setpoint, keeping it inside the tank
+	char line[32];
+	switch (key)
+	{
+	case GLUT_KEY_LEFT:
+		snprintf(line, sizeof(line), "move %d\n", -SETPOINT_INCREMENT);
+		break;
+	case GLUT_KEY_RIGHT:
+		snprintf(line, sizeof(line), "move %d\n", SETPOINT_INCREMENT);
+		break;
+	default:
+		return;
+	}
+	send_command(line);
 }
 
 /**************************************************
- * NAME: static void init(void)
+ * NAME: static void close_func()
  *
  * DESCRIPTION:
- * 		Does some configuring that only needs to be done once before the program starts.
+ *		This function will run when the openGL window is closed. It frees what
+ * 		the renderer holds while its context is still there. The control loops
+ * 		keep running.
  *
  * INPUTS:
- *     	none
+ *		none
  *
  * OUTPUTS:
  * 		none
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-static void init(void)
+static void close_func()
 {
-	//  select clearing (background) color
-	glClearColor(0.0, 119.0 / 255, 190.0 / 255, 0.0);
-
-	//  initialize viewing values
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(-5.0, 5.0, -5.0, 5.0, -5.0, 5.0);
-
-	setupLighting();
-
-	// get a display list for the boat
-	speedboat = load_obj("data/boat.obj");
-
-	// create display list for setline
-	setline = glGenLists(1);
-	glNewList(setline, GL_COMPILE);
-	glTranslatef(0.0, -3.0, 0.0);
-	glBegin(GL_POLYGON);
-	glVertex3f(-SETLINE_WIDTH, -SETLINE_HEIGHT, 4.0);
-	glVertex3f(SETLINE_WIDTH, -SETLINE_HEIGHT, 4.0);
-	glVertex3f(SETLINE_WIDTH, SETLINE_HEIGHT, 4.0);
-	glVertex3f(-SETLINE_WIDTH, SETLINE_HEIGHT, 4.0);
-	glEnd();
-	glEndList();
+	renderer_cleanup();
 }
 
 /**************************************************
- * NAME: void *start_animation(void *void_ptr)
+ * NAME: int start_animation(void)
  *
  * DESCRIPTION:
  *		Starting point for the graphics. Initializes window with parameters,
- * 		sets event handlers for keyboard and sets display function. This
- * 		function is started from a new thread, thus the format of the function.
+ * 		sets event handlers for keyboard and sets display function. Returns when
+ * 		the window is closed or the run has ended.
  *
  * INPUTS:
- *		void *void_ptr:	A pointer to a 'BoatData' struct containing data
- *                     	from the current run.
+ *		none
  *
  * OUTPUTS:
- *		none
+ *		RETURNS:
+ *			int:	0 if successful, 1 if the window could not be shown.
  *
- * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 20.03.2017
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
  **************************************************/
-void *start_animation(void *void_ptr)
+int start_animation(void)
 {
-	boatData = (BoatData*) void_ptr;
-
 	// no input args supported
 	int argc = 0;
 	char *argv[0];
 	glutInit(&argc, argv);
 
-	glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
+	glutInitContextVersion(3, 3);
+	glutInitContextProfile(GLUT_CORE_PROFILE);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
 	glutInitWindowSize(750, 550);
 	glutInitWindowPosition(50, 50);
-	glutCreateWindow("Dynamic Positioning");
+	int window = glutCreateWindow("Dynamic Positioning");
 
-	init();
+	//  select clearing (background) color
+	glClearColor(0.0, 119.0 / 255, 190.0 / 255, 0.0);
+	if (renderer_init(BOAT_MODEL))
+	{
+		glutDestroyWindow(window);
+		return 1;
+	}
 
-	// don't exit on window close, some things needs to be done afterwards e.g. plotting
+	// return from the main loop on window close, to unmap the telemetry
 	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
 
 	// set glut functions
 	glutDisplayFunc(display);
-	glutIdleFunc(display);
+	glutIdleFunc(idle);
+	glutReshapeFunc(reshape);
 	glutKeyboardFunc(keyboard);
 	glutSpecialFunc(special_keyboard);
 	glutCloseFunc(close_func);
@@ -349,6 +447,8 @@ void *start_animation(void *void_ptr)
 	// start
 	glutMainLoop();
 
-	return NULL;
+	if (connected)
+		telemetry_reader_close(&reader);
+	return 0;
 }
 
@@ -0,0 +1,552 @@
+/**************************************************
+ * FILENAME:	watchdog.c
+ *
+ * DESCRIPTION:
+ * 		Turns the motors off when the control loops stop doing their job. A thread
+ * 		of high priority wakes up from a periodic timerfd every quarter of the
+ * 		timeout and checks that:
+ * 			- every worker has finished an iteration no later than the timeout
+ * 			  after its deadline (the workers kick the watchdog every iteration),
+ * 			- no servo write has taken longer than the timeout,
+ * 			- every sensor reads within the valid range and has changed its
+ * 			  reading within the stuck time. Readings stop changing when the
+ * 			  phidget library stalls; the noise of a real sensor keeps them
+ * 			  changing while the boat holds still.
+ * 		The first failure trips the watchdog: the actuator is made safe, which
+ * 		turns every servo in use off and ignores positions requested afterwards,
+ * 		the incident is recorded and the runtime is stopped. The servo controller
+ * 		may stall the writes turning the motors off, so they are made from a
+ * 		thread of their own and waited for at most the timeout. The watchdog
+ * 		thread does no other I/O; the incident is printed and appended to the log
+ * 		file by watchdog_stop() once the loops have ended.
+ * 		A failure is detected at most one check interval after the timeout ran
+ * 		out, plus the wake-up latency of the thread, which is measured and
+ * 		reported. Without the permission to run with real-time priority the
+ * 		watchdog runs at normal priority and the latency is not bounded.
+ *
+ * PUBLIC FUNCTIONS:
+ * 		int watchdog_start(ControlRuntime *runtime, const char *logFilename)
+ * 		void watchdog_kick(int worker, unsigned long time)
+ * 		void watchdog_sensor(int channel, int value, unsigned long time)
+ * 		bool watchdog_tripped(WatchdogIncident *incident)
+ * 		void watchdog_stop(void)
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "headers/actuator.h"
+#include "headers/time_utils.h"
+#include "headers/watchdog.h"
+
+static const char *INCIDENT_NAMES[] = { "deadline missed", "servo write stalled",
+		"sensor stuck", "sensor out of range" };
+
+// signs of life, written by the workers
+static _Alignas(64) atomic_ulong lastKick[MAX_WORKERS];
+static _Alignas(64) atomic_int sensorValue[MAX_CHANNELS];
+static atomic_ulong sensorChanged[MAX_CHANNELS];
+static atomic_bool sensorSeen[MAX_CHANNELS];
+
+static ControlRuntime *watched;
+static char logPath[256];
+static unsigned long interval;	// nanoseconds between checks
+
+static WatchdogIncident recorded;
+static long trippedAt;	// wall time, for the log
+static atomic_bool tripped;
+static sem_t safeDone;	// posted when the motors have been turned off
+
+// timing of the checks
+static unsigned long checks;
+static unsigned long maxLatency;
+
+static int timerFd = -1;
+static pthread_t watchdogThread;
+static atomic_bool watchdogRunning;
+static bool realTime;
+
+/**************************************************
+ * NAME: static bool check(unsigned long now, WatchdogIncident *found)
+ *
+ * DESCRIPTION:
+ * 		Checks the workers, the actuator and the sensors once.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			unsigned long now:	The time of the check, from nano_time().
+ * 		EXTERNALS:
+ * 			ControlRuntime *watched:	The runtime with its limits.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			WatchdogIncident *found:	The first failure found, if any.
+ * 		RETURN:
+ * 			bool:	true if something failed.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static bool check(unsigned long now, WatchdogIncident *found)
+{
+	unsigned long timeout = (*watched).watchdogTimeout;
+	memset(found, 0, sizeof(*found));
+	(*found).detected = now;
+
+	// a worker is due one period after its last kick
+	for (int w = 0; w < (*watched).workerCount; w++)
+	{
+		unsigned long kick = atomic_load_explicit(&lastKick[w], memory_order_relaxed);
+		unsigned long limit = kick + (*watched).period + timeout;
+		if (now > limit)
+		{
+			(*found).kind = INCIDENT_DEADLINE;
+			(*found).index = w;
+			(*found).last = kick;
+			(*found).late = now - limit;
+			return true;
+		}
+	}
+
+	unsigned long writeStart;
+	int servo = actuator_busy_since(&writeStart);
+	if (servo >= 0 && now > writeStart + timeout)
+	{
+		(*found).kind = INCIDENT_SERVO_STALL;
+		(*found).index = servo;
+		(*found).last = writeStart;
+		(*found).late = now - writeStart - timeout;
+		return true;
+	}
+
+	for (int c = 0; c < (*watched).channelCount; c++)
+	{
+		if (!atomic_load_explicit(&sensorSeen[c], memory_order_acquire))
+			continue;	// not read yet
+
+		int value = atomic_load_explicit(&sensorValue[c], memory_order_relaxed);
+		unsigned long changed = atomic_load_explicit(&sensorChanged[c], memory_order_relaxed);
+		(*found).index = c;
+		(*found).value = value;
+		(*found).last = changed;
+		if (value < (*watched).sensorMin || value > (*watched).sensorMax)
+		{
+			(*found).kind = INCIDENT_SENSOR_RANGE;
+			return true;
+		}
+		unsigned long stuckTime = (*watched).sensorStuckTime;
+		if (stuckTime > 0 && now > changed + stuckTime)
+		{
+			(*found).kind = INCIDENT_SENSOR_STUCK;
+			(*found).late = now - changed - stuckTime;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**************************************************
+ * NAME: static void *safe_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Turns the motors off. This function is run in a separate thread, which
+ * 		may never return if the servo controller has stalled.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	Not used.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			void *:	NULL
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *safe_func(void *void_ptr)
+{
+	actuator_safe();
+	sem_post(&safeDone);
+	return NULL;
+}
+
+/**************************************************
+ * NAME: static bool make_safe(void)
+ *
+ * DESCRIPTION:
+ * 		Turns the motors off from a thread of its own, waited for at most the
+ * 		timeout, so a servo controller that never answers does not hold up the
+ * 		watchdog. Only if that thread can not be started are the motors turned off
+ * 		directly. Positions requested by the loops are ignored from the start of
+ * 		the call either way.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			none
+ * 		EXTERNALS:
+ * 			ControlRuntime *watched:	The runtime with the timeout.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			bool:	false if the motors were not confirmed off within the timeout.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static bool make_safe(void)
+{
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, safe_func, NULL) != 0)
+	{
+		actuator_safe();	// not bounded, but better than leaving the motors running
+		return true;
+	}
+	pthread_detach(thread);
+
+	// sem_timedwait() takes the wall clock
+	struct timespec now, until;
+	clock_gettime(CLOCK_REALTIME, &now);
+	to_timespec(now.tv_sec * 1000000000UL + now.tv_nsec + (*watched).watchdogTimeout, &until);
+	while (sem_timedwait(&safeDone, &until) < 0)
+	{
+		if (errno != EINTR)
+			return false;
+	}
+	return true;
+}
+
+/**************************************************
+ * NAME: static void trip(WatchdogIncident *found)
+ *
+ * DESCRIPTION:
+ * 		Turns the motors off, records the incident and stops the runtime. Nothing
+ * 		is printed or written here, the incident is reported by watchdog_stop().
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			WatchdogIncident *found:	What failed.
+ * 		EXTERNALS:
+ * 			ControlRuntime *watched:	The runtime to stop.
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			WatchdogIncident *found:	The incident with the time spent on the motors.
+ * 		EXTERNALS:
+ * 			WatchdogIncident recorded:	The incident.
+ * 			long trippedAt:				When it tripped, from micro_wall_time().
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static void trip(WatchdogIncident *found)
+{
+	// the motors first, everything else can wait
+	(*found).safe = make_safe();
+	(*found).safeTime = nano_time() - (*found).detected;
+
+	recorded = *found;
+	trippedAt = micro_wall_time();
+	atomic_store(&tripped, true);
+	runtime_stop(watched);
+}
+
+/**************************************************
+ * NAME: static void report(void)
+ *
+ * DESCRIPTION:
+ * 		Prints the recorded incident and appends it to the log file. Called once
+ * 		the watchdog thread has ended, never by it.
+ *
+ * INPUTS:
+ * 		EXTERNALS:
+ * 			WatchdogIncident recorded:	The incident.
+ * 			long trippedAt:				When it tripped, from micro_wall_time().
+ * 			char logPath[]:				The file the incident is appended to, if not empty.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+static void report(void)
+{
+	char subject[64];
+	if (recorded.kind == INCIDENT_DEADLINE)
+		snprintf(subject, sizeof(subject), "worker %d", recorded.index);
+	else if (recorded.kind == INCIDENT_SERVO_STALL)
+		snprintf(subject, sizeof(subject), "servo %d", recorded.index);
+	else
+		snprintf(subject, sizeof(subject), "channel %s, reading %d",
+				(*watched).channels[recorded.index].name, recorded.value);
+
+	char line[256];
+	snprintf(line, sizeof(line), "%s (%s): last sign of life %.3f ms before detection, "
+			"detected %.3f ms late, motors %s after %.3f ms", INCIDENT_NAMES[recorded.kind],
+			subject, (recorded.detected - recorded.last) / 1e6, recorded.late / 1e6,
+			recorded.safe ? "off" : "not confirmed off", recorded.safeTime / 1e6);
+	printf("Watchdog tripped: %s\n", line);
+
+	if (logPath[0] == '\0')
+		return;
+	FILE *fp = fopen(logPath, "a");
+	if (!fp)
+	{
+		perror("Could not record the watchdog incident");
+		return;
+	}
+	fprintf(fp, "%.6f\t%s\n", trippedAt / 1e6, line);
+	fclose(fp);
+}
+
+/**************************************************
+ * NAME: static void *watchdog_func(void *void_ptr)
+ *
+ * DESCRIPTION:
+ * 		Checks at every expiration of the timer while the runtime is running,
+ * 		until the watchdog trips or is stopped. This function is run in a
+ * 		separate thread.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			void *void_ptr:	Not used.
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+static void *watchdog_func(void *void_ptr)
+{
+	unsigned long expected = nano_time() + interval;
+	struct itimerspec timer;
+	to_timespec(expected, &timer.it_value);
+	to_timespec(interval, &timer.it_interval);
+	if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &timer, NULL) < 0)
+	{
+		perror("Could not start the watchdog timer");
+		return NULL;
+	}
+
+	while (atomic_load(&watchdogRunning))
+	{
+		uint64_t expirations;
+		if (read(timerFd, &expirations, sizeof(expirations)) != sizeof(expirations))
+			continue;	// interrupted by a signal
+
+		unsigned long now = nano_time();
+		expected += (expirations - 1) * interval;
+		if (now - expected > maxLatency)
+			maxLatency = now - expected;
+		expected += interval;
+		checks++;
+
+		if (!runtime_is_running(watched))
+			continue;	// the workers are leaving
+
+		WatchdogIncident found;
+		if (check(now, &found))
+		{
+			trip(&found);
+			break;
+		}
+	}
+	return NULL;
+}
+
+/**************************************************
+ * NAME: int watchdog_start(ControlRuntime *runtime, const char *logFilename)
+ *
+ * DESCRIPTION:
+ * 		Starts watching the runtime, with real-time priority if allowed. Does
+ * 		nothing if the watchdog timeout of the runtime is 0. Must be called after
+ * 		the actuator is started and before the control loops are run.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			ControlRuntime *runtime:	The runtime with the limits to watch.
+ * 			const char *logFilename:	The file incidents are appended to, or NULL.
+ *
+ * OUTPUTS:
+ * 		RETURN:
+ * 			int:	0 if successful, 1 if failure.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+int watchdog_start(ControlRuntime *runtime, const char *logFilename)
+{
+	if ((*runtime).watchdogTimeout == 0)
+		return 0;
+
+	watched = runtime;
+	snprintf(logPath, sizeof(logPath), "%s", logFilename ? logFilename : "");
+	interval = (*runtime).watchdogTimeout / 4;
+	if (interval < WATCHDOG_MIN_INTERVAL)
+		interval = WATCHDOG_MIN_INTERVAL;
+	atomic_store(&tripped, false);
+	sem_init(&safeDone, 0, 0);
+	checks = 0;
+	maxLatency = 0;
+
+	// the workers have not run yet, their first deadline is one period away
+	unsigned long now = nano_time();
+	for (int w = 0; w < MAX_WORKERS; w++)
+		atomic_store(&lastKick[w], now);
+	for (int c = 0; c < MAX_CHANNELS; c++)
+		atomic_store(&sensorSeen[c], false);
+
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timerFd < 0)
+	{
+		perror("Could not create the watchdog timer");
+		return 1;
+	}
+
+	atomic_store(&watchdogRunning, true);
+
+	// above the control loops, so a loop that does not yield can not starve the watchdog
+	pthread_attr_t attributes;
+	struct sched_param parameters = { .sched_priority = sched_get_priority_max(SCHED_FIFO) };
+	pthread_attr_init(&attributes);
+	pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+	pthread_attr_setschedparam(&attributes, &parameters);
+	realTime = pthread_create(&watchdogThread, &attributes, watchdog_func, NULL) == 0;
+	pthread_attr_destroy(&attributes);
+	if (!realTime)
+	{
+		printf("Not permitted to run the watchdog with real-time priority, its reaction "
+				"time is not bounded\n");
+		if (pthread_create(&watchdogThread, NULL, watchdog_func, NULL) != 0)
+		{
+			printf("Could not start the watchdog\n");
+			atomic_store(&watchdogRunning, false);
+			close(timerFd);
+			timerFd = -1;
+			return 1;
+		}
+	}
+
+	printf("Watchdog: timeout %.1f ms, checked every %.2f ms\n",
+			(*runtime).watchdogTimeout / 1e6, interval / 1e6);
+	return 0;
+}
+
+/**************************************************
+ * NAME: void watchdog_kick(int worker, unsigned long time)
+ *
+ * DESCRIPTION:
+ * 		Tells the watchdog that a worker has finished an iteration. Called by
+ * 		every worker at the end of every iteration.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int worker:			The index of the worker.
+ * 			unsigned long time:	When the iteration finished, from nano_time().
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void watchdog_kick(int worker, unsigned long time)
+{
+	atomic_store_explicit(&lastKick[worker], time, memory_order_relaxed);
+}
+
+/**************************************************
+ * NAME: void watchdog_sensor(int channel, int value, unsigned long time)
+ *
+ * DESCRIPTION:
+ * 		Hands the reading a channel used to the watchdog. Only the worker running
+ * 		the channel may call this.
+ *
+ * INPUTS:
+ * 		PARAMETERS:
+ * 			int channel:		The index of the channel.
+ * 			int value:			The reading of its sensor.
+ * 			unsigned long time:	When it was read, from nano_time().
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+void watchdog_sensor(int channel, int value, unsigned long time)
+{
+	bool seen = atomic_load_explicit(&sensorSeen[channel], memory_order_relaxed);
+	if (seen && atomic_load_explicit(&sensorValue[channel], memory_order_relaxed) == value)
+		return;
+
+	atomic_store_explicit(&sensorValue[channel], value, memory_order_relaxed);
+	atomic_store_explicit(&sensorChanged[channel], time, memory_order_relaxed);
+	if (!seen)
+		atomic_store_explicit(&sensorSeen[channel], true, memory_order_release);
+}
+
+/**************************************************
+ * NAME: bool watchdog_tripped(WatchdogIncident *incident)
+ *
+ * DESCRIPTION:
+ * 		Tells if the watchdog has turned the motors off, and why.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		PARAMETERS:
+ * 			WatchdogIncident *incident:	The incident if tripped, may be NULL.
+ * 		RETURN:
+ * 			bool:	true if tripped.
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 18.10.2026
+ **************************************************/
+bool watchdog_tripped(WatchdogIncident *incident)
+{
+	if (!atomic_load(&tripped))
+		return false;
+	if (incident)
+		*incident = recorded;
+	return true;
+}
+
+/**************************************************
+ * NAME: void watchdog_stop(void)
+ *
+ * DESCRIPTION:
+ * 		Stops the watchdog thread, reports the incident if it tripped and prints
+ * 		how late it woke up at worst. Must be called after the control loops have
+ * 		ended.
+ *
+ * INPUTS:
+ * 		none
+ *
+ * OUTPUTS:
+ * 		none
+ *
+ * AUTHOR: Jan Henrik Lenes		LAST CHANGE: 19.10.2026
+ **************************************************/
+void watchdog_stop(void)
+{
+	if (!atomic_load(&watchdogRunning))
+		return;
+
+	atomic_store(&watchdogRunning, false);
+	pthread_join(watchdogThread, NULL);	// wakes up within one interval
+	close(timerFd);
+	timerFd = -1;
+
+	if (atomic_load(&tripped))
+		report();
+
+	printf("Watchdog: %lu checks%s, woken up at most %.3f ms late, so failures were "
+			"detected within %.3f ms of the timeout\n", checks,
+			realTime ? " at real-time priority" : "", maxLatency / 1e6,
+			(interval + maxLatency) / 1e6);
+}